@@ -0,0 +1,148 @@
+/**
+ * @file opus_abr.cpp
+ * @brief Adaptive bitrate / complexity controller for the Opus encoder
+ *
+ * Bitrate follows the host's receiver reports (loss) and the heartbeat RTT,
+ * AIMD style:
+ *  - loss above 10%: cut by loss/2 (a 20% loss report costs 10% bitrate)
+ *  - RTT 100ms above its baseline (queue building up): cut by 15%
+ *  - loss between 2% and 10%: hold
+ *  - otherwise: +5% per second, once 3s have passed since the last cut
+ * so a congested link steps down before it starts dropping bursts.
+ *
+ * The FEC loss expectation tracks the smoothed reported loss (never below the
+ * configured value), and complexity steps down while encoding takes more than
+ * half of each frame's duration - the Vita can't always afford complexity 10.
+ */
+
+#include "moonmic_internal.h"
+#include "moonmic_debug.h"
+#include <math.h>
+#include <string.h>
+
+#define ABR_DECREASE_LOSS 0.10f
+#define ABR_HOLD_LOSS 0.02f
+#define ABR_QUEUE_DELAY_MS 100
+#define ABR_DELAY_DECREASE 0.85f
+#define ABR_INCREASE 1.05f
+#define ABR_INCREASE_INTERVAL_MS 1000
+#define ABR_HOLD_AFTER_DECREASE_MS 3000
+#define ABR_DECREASE_INTERVAL_MS 1000   // Let one cut show up in the reports before the next
+#define ABR_LOSS_ALPHA 0.3f
+#define ABR_MAX_LOSS_PERC 30
+#define ABR_RTT_WINDOW_MS 10000         // RTT baseline = minimum of the last window
+#define ABR_ENCODE_WINDOW_MS 2000
+#define ABR_ENCODE_BUDGET_HIGH 0.5f     // Share of the frame time spent encoding
+#define ABR_ENCODE_BUDGET_LOW 0.2f
+
+static uint32_t abr_clamp_bitrate(const moonmic_abr_t* abr, float bitrate) {
+    if (bitrate < (float)abr->min_bitrate) return abr->min_bitrate;
+    if (bitrate > (float)abr->max_bitrate) return abr->max_bitrate;
+    return (uint32_t)bitrate;
+}
+
+void moonmic_abr_init(moonmic_abr_t* abr, uint32_t max_bitrate, uint32_t min_bitrate,
+                      int packet_loss_perc, int max_complexity) {
+    memset(abr, 0, sizeof(*abr));
+    abr->max_bitrate = max_bitrate;
+    abr->min_bitrate = min_bitrate ? min_bitrate : MOONMIC_ABR_DEFAULT_MIN_BITRATE;
+    if (abr->min_bitrate > max_bitrate) {
+        abr->min_bitrate = max_bitrate;
+    }
+    abr->bitrate = max_bitrate;
+    abr->base_loss_perc = packet_loss_perc > 0 ? packet_loss_perc : 0;
+    abr->loss_perc = abr->base_loss_perc;
+    abr->min_rtt_ms = -1;
+    abr->window_min_rtt_ms = -1;
+    abr->max_complexity = max_complexity;
+    abr->complexity = max_complexity;
+}
+
+void moonmic_abr_set_limits(moonmic_abr_t* abr, uint32_t max_bitrate, int max_complexity) {
+    abr->max_bitrate = max_bitrate;
+    if (abr->min_bitrate > max_bitrate) {
+        abr->min_bitrate = max_bitrate;
+    }
+    if (abr->bitrate > max_bitrate) {
+        abr->bitrate = max_bitrate;
+    }
+    abr->max_complexity = max_complexity;
+    if (abr->complexity > max_complexity) {
+        abr->complexity = max_complexity;
+    }
+}
+
+void moonmic_abr_on_report(moonmic_abr_t* abr, uint64_t now_ms, float fraction_lost, int rtt_ms) {
+    abr->loss_ewma += ABR_LOSS_ALPHA * (fraction_lost - abr->loss_ewma);
+
+    // RTT baseline: minimum of the previous window, so a route change is picked up
+    bool queueing = false;
+    if (rtt_ms >= 0) {
+        if (abr->window_min_rtt_ms < 0 || rtt_ms < abr->window_min_rtt_ms) {
+            abr->window_min_rtt_ms = rtt_ms;
+        }
+        if (abr->min_rtt_ms < 0 || rtt_ms < abr->min_rtt_ms) {
+            abr->min_rtt_ms = rtt_ms;
+        }
+        if (now_ms - abr->rtt_window_ms >= ABR_RTT_WINDOW_MS) {
+            abr->min_rtt_ms = abr->window_min_rtt_ms;
+            abr->window_min_rtt_ms = rtt_ms;
+            abr->rtt_window_ms = now_ms;
+        }
+        queueing = rtt_ms > abr->min_rtt_ms + ABR_QUEUE_DELAY_MS;
+    }
+
+    uint32_t previous = abr->bitrate;
+    bool may_decrease = now_ms - abr->last_decrease_ms >= ABR_DECREASE_INTERVAL_MS;
+    if (fraction_lost > ABR_DECREASE_LOSS && may_decrease) {
+        abr->bitrate = abr_clamp_bitrate(abr, abr->bitrate * (1.0f - 0.5f * fraction_lost));
+        abr->last_decrease_ms = now_ms;
+    } else if (queueing && may_decrease) {
+        abr->bitrate = abr_clamp_bitrate(abr, abr->bitrate * ABR_DELAY_DECREASE);
+        abr->last_decrease_ms = now_ms;
+    } else if (fraction_lost < ABR_HOLD_LOSS && !queueing &&
+               now_ms - abr->last_decrease_ms >= ABR_HOLD_AFTER_DECREASE_MS &&
+               now_ms - abr->last_increase_ms >= ABR_INCREASE_INTERVAL_MS) {
+        abr->bitrate = abr_clamp_bitrate(abr, abr->bitrate * ABR_INCREASE);
+        abr->last_increase_ms = now_ms;
+    }
+    if (abr->bitrate != previous) {
+        MOONMIC_LOG("[ABR] Bitrate %u -> %u bps (loss %.1f%%, rtt %dms, base %dms)",
+                    previous, abr->bitrate, fraction_lost * 100.0f, rtt_ms, abr->min_rtt_ms);
+    }
+
+    // FEC sized for the loss the host actually sees
+    if (abr->base_loss_perc > 0) {
+        int perc = (int)ceilf(abr->loss_ewma * 100.0f);
+        if (perc < abr->base_loss_perc) perc = abr->base_loss_perc;
+        if (perc > ABR_MAX_LOSS_PERC) perc = ABR_MAX_LOSS_PERC;
+        abr->loss_perc = perc;
+    }
+}
+
+void moonmic_abr_on_encode(moonmic_abr_t* abr, uint64_t now_ms, uint32_t encode_us, uint32_t frame_us) {
+    if (abr->encode_window_ms == 0) {
+        abr->encode_window_ms = now_ms;
+    }
+    abr->encode_us_sum += encode_us;
+    abr->frame_us_sum += frame_us;
+    if (now_ms - abr->encode_window_ms < ABR_ENCODE_WINDOW_MS || abr->frame_us_sum == 0) {
+        return;
+    }
+
+    float load = (float)abr->encode_us_sum / (float)abr->frame_us_sum;
+    int previous = abr->complexity;
+    if (load > ABR_ENCODE_BUDGET_HIGH && abr->complexity > 0) {
+        abr->complexity--;
+    } else if (load < ABR_ENCODE_BUDGET_LOW && abr->complexity < abr->max_complexity) {
+        abr->complexity++;
+    }
+    if (abr->complexity != previous) {
+        MOONMIC_LOG("[ABR] Complexity %d -> %d (encoding %.0f%% of frame time)",
+                    previous, abr->complexity, load * 100.0f);
+    }
+
+    abr->encode_window_ms = now_ms;
+    abr->encode_us_sum = 0;
+    abr->frame_us_sum = 0;
+}
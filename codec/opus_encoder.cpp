@@ -7,9 +7,30 @@
 #include "moonmic_debug.h"
 #include <opus/opus.h>
 #include <stdlib.h>
+#include <string.h>
 
-moonmic_opus_encoder_t* moonmic_opus_encoder_create(uint32_t sample_rate, uint8_t channels, uint32_t bitrate) {
-    MOONMIC_LOG("[opus_encoder] Creating encoder: %uHz, %dch, %ubps", sample_rate, channels, bitrate);
+static int moonmic_opus_application(moonmic_opus_app_t application) {
+    switch (application) {
+        case MOONMIC_OPUS_APP_VOIP: return OPUS_APPLICATION_VOIP;
+        case MOONMIC_OPUS_APP_LOWDELAY: return OPUS_APPLICATION_RESTRICTED_LOWDELAY;
+        default: return OPUS_APPLICATION_AUDIO;
+    }
+}
+
+static const char* moonmic_opus_application_name(moonmic_opus_app_t application) {
+    switch (application) {
+        case MOONMIC_OPUS_APP_VOIP: return "VOIP";
+        case MOONMIC_OPUS_APP_LOWDELAY: return "LOWDELAY";
+        default: return "AUDIO";
+    }
+}
+
+moonmic_opus_encoder_t* moonmic_opus_encoder_create(uint32_t sample_rate, uint8_t channels, uint32_t bitrate,
+                                                     moonmic_opus_app_t application, int complexity,
+                                                     int packet_loss_perc, bool dtx) {
+    MOONMIC_LOG("[opus_encoder] Creating encoder: %uHz, %dch, %ubps, %s, loss=%d%%, dtx=%d",
+                sample_rate, channels, bitrate, moonmic_opus_application_name(application),
+                packet_loss_perc, dtx ? 1 : 0);
     
     moonmic_opus_encoder_t* enc = (moonmic_opus_encoder_t*)calloc(1, sizeof(moonmic_opus_encoder_t));
     if (!enc) {
@@ -18,12 +39,13 @@ moonmic_opus_encoder_t* moonmic_opus_encoder_create(uint32_t sample_rate, uint8_
     }
     
     int error;    
-    // Create Opus encoder with AUDIO application for better quality
-    // AUDIO mode is better than VOIP for music/general audio quality
+    // Application comes from the latency profile: AUDIO (balanced, best general
+    // quality), VOIP (bandwidth saver) or RESTRICTED_LOWDELAY (ultra-low: CELT
+    // only, which also allows 5ms frames). It can't be changed after creation.
     enc->encoder = opus_encoder_create(
         sample_rate,
         channels,
-        OPUS_APPLICATION_AUDIO,  // Changed from VOIP for better quality
+        moonmic_opus_application(application),
         &error
     );
     
@@ -37,21 +59,43 @@ moonmic_opus_encoder_t* moonmic_opus_encoder_create(uint32_t sample_rate, uint8_
     // Set bitrate (96kbps for good voice quality)
     opus_encoder_ctl((OpusEncoder*)enc->encoder, OPUS_SET_BITRATE(bitrate));
     
-    // Set maximum complexity (10 = best quality, slower encoding)
-    opus_encoder_ctl((OpusEncoder*)enc->encoder, OPUS_SET_COMPLEXITY(10));
+    // Start at the profile's complexity (10 = best quality, slower encoding);
+    // the client lowers it at runtime if encoding can't keep up
+    if (complexity < 0) complexity = 0;
+    if (complexity > 10) complexity = 10;
+    opus_encoder_ctl((OpusEncoder*)enc->encoder, OPUS_SET_COMPLEXITY(complexity));
     
     // Enable VBR (Variable Bit Rate) for better quality
     opus_encoder_ctl((OpusEncoder*)enc->encoder, OPUS_SET_VBR(1));
     
-    // Disable DTX (Discontinuous Transmission) - better for continuous audio
-    opus_encoder_ctl((OpusEncoder*)enc->encoder, OPUS_SET_DTX(0));
+    // DTX (Discontinuous Transmission): the encoder's VAD turns silent frames into
+    // 1-2 byte packets the client doesn't send. Off by default - continuous audio.
+    opus_encoder_ctl((OpusEncoder*)enc->encoder, OPUS_SET_DTX(dtx ? 1 : 0));
+    
+    // In-band FEC: each packet carries a low-bitrate copy of the previous frame
+    // (LBRR) so the host can rebuild a single lost packet from the next one.
+    // The loss percentage sizes the redundancy; FEC is only emitted in SILK/hybrid modes,
+    // so RESTRICTED_LOWDELAY never carries any.
+    if (packet_loss_perc > 0) {
+        if (packet_loss_perc > 100) packet_loss_perc = 100;
+        opus_encoder_ctl((OpusEncoder*)enc->encoder, OPUS_SET_INBAND_FEC(1));
+        opus_encoder_ctl((OpusEncoder*)enc->encoder, OPUS_SET_PACKET_LOSS_PERC(packet_loss_perc));
+    } else {
+        packet_loss_perc = 0;
+        opus_encoder_ctl((OpusEncoder*)enc->encoder, OPUS_SET_INBAND_FEC(0));
+    }
     
-    MOONMIC_LOG("[opus_encoder] Created: %dHz, %dch, %dbps (AUDIO mode, complexity=10, VBR)",
-                sample_rate, channels, bitrate);
+    MOONMIC_LOG("[opus_encoder] Created: %dHz, %dch, %dbps (%s mode, complexity=%d, VBR, FEC=%s, DTX=%s)",
+                sample_rate, channels, bitrate, moonmic_opus_application_name(application), complexity,
+                packet_loss_perc > 0 ? "on" : "off", dtx ? "on" : "off");
     
     enc->sample_rate = sample_rate;
     enc->channels = channels;
     enc->bitrate = bitrate;
+    enc->packet_loss_perc = packet_loss_perc;
+    enc->application = application;
+    enc->complexity = complexity;
+    enc->dtx = dtx;
     
     MOONMIC_LOG("[opus_encoder] Encoder created successfully");
     return enc;
@@ -103,3 +147,122 @@ int moonmic_opus_encoder_encode(moonmic_opus_encoder_t* encoder, const float* pc
     
     return result;
 }
+
+void moonmic_opus_encoder_set_bitrate(moonmic_opus_encoder_t* encoder, uint32_t bitrate) {
+    if (!encoder || !encoder->encoder || bitrate == encoder->bitrate) {
+        return;
+    }
+    opus_encoder_ctl((OpusEncoder*)encoder->encoder, OPUS_SET_BITRATE(bitrate));
+    encoder->bitrate = bitrate;
+}
+
+void moonmic_opus_encoder_set_complexity(moonmic_opus_encoder_t* encoder, int complexity) {
+    if (complexity < 0) complexity = 0;
+    if (complexity > 10) complexity = 10;
+    if (!encoder || !encoder->encoder || complexity == encoder->complexity) {
+        return;
+    }
+    opus_encoder_ctl((OpusEncoder*)encoder->encoder, OPUS_SET_COMPLEXITY(complexity));
+    encoder->complexity = complexity;
+}
+
+void moonmic_opus_encoder_set_packet_loss_perc(moonmic_opus_encoder_t* encoder, int packet_loss_perc) {
+    // FEC on/off is fixed at creation; only the redundancy level follows the network
+    if (!encoder || !encoder->encoder || encoder->packet_loss_perc == 0 || packet_loss_perc <= 0 ||
+        packet_loss_perc == encoder->packet_loss_perc) {
+        return;
+    }
+    if (packet_loss_perc > 100) packet_loss_perc = 100;
+    opus_encoder_ctl((OpusEncoder*)encoder->encoder, OPUS_SET_PACKET_LOSS_PERC(packet_loss_perc));
+    encoder->packet_loss_perc = packet_loss_perc;
+}
+
+moonmic_opus_bundler_t* moonmic_opus_bundler_create(int max_frames) {
+    if (max_frames < 1) max_frames = 1;
+    if (max_frames > MOONMIC_MAX_FRAMES_PER_PACKET) max_frames = MOONMIC_MAX_FRAMES_PER_PACKET;
+    
+    moonmic_opus_bundler_t* bundler = (moonmic_opus_bundler_t*)calloc(1, sizeof(moonmic_opus_bundler_t));
+    if (!bundler) {
+        MOONMIC_LOG("[opus_bundler] ERROR: Failed to allocate bundler");
+        return NULL;
+    }
+    
+    bundler->repacketizer = opus_repacketizer_create();
+    bundler->storage = (uint8_t*)malloc((size_t)max_frames * MOONMIC_OPUS_MAX_FRAME_BYTES);
+    if (!bundler->repacketizer || !bundler->storage) {
+        MOONMIC_LOG("[opus_bundler] ERROR: Failed to create repacketizer");
+        moonmic_opus_bundler_destroy(bundler);
+        return NULL;
+    }
+    
+    bundler->max_frames = max_frames;
+    bundler->count = 0;
+    
+    MOONMIC_LOG("[opus_bundler] Created: %d frames per packet", max_frames);
+    return bundler;
+}
+
+void moonmic_opus_bundler_destroy(moonmic_opus_bundler_t* bundler) {
+    if (!bundler) {
+        return;
+    }
+    
+    if (bundler->repacketizer) {
+        opus_repacketizer_destroy((OpusRepacketizer*)bundler->repacketizer);
+    }
+    free(bundler->storage);
+    free(bundler);
+}
+
+int moonmic_opus_bundler_add(moonmic_opus_bundler_t* bundler, const uint8_t* frame, int size) {
+    if (!bundler || !frame || size <= 0 || size > MOONMIC_OPUS_MAX_FRAME_BYTES) {
+        return -1;
+    }
+    if (bundler->count >= bundler->max_frames) {
+        return 0;  // Full - flush first
+    }
+    
+    // The repacketizer references the data until opus_repacketizer_out(), so keep a copy
+    uint8_t* slot = bundler->storage + (size_t)bundler->count * MOONMIC_OPUS_MAX_FRAME_BYTES;
+    memcpy(slot, frame, size);
+    
+    int result = opus_repacketizer_cat((OpusRepacketizer*)bundler->repacketizer, slot, size);
+    if (result != OPUS_OK) {
+        // All frames of a packet must share one TOC config; the encoder may switch
+        // SILK/CELT or bandwidth between frames. Left unchanged on failure.
+        if (bundler->count > 0) {
+            return 0;
+        }
+        MOONMIC_LOG("[opus_bundler] ERROR: opus_repacketizer_cat failed: %d", result);
+        return -1;
+    }
+    
+    bundler->count++;
+    return 1;
+}
+
+int moonmic_opus_bundler_count(const moonmic_opus_bundler_t* bundler) {
+    return bundler ? bundler->count : 0;
+}
+
+int moonmic_opus_bundler_flush(moonmic_opus_bundler_t* bundler, uint8_t* output, int max_output_bytes) {
+    if (!bundler || !output || bundler->count == 0) {
+        return -1;
+    }
+    
+    opus_int32 bytes = opus_repacketizer_out((OpusRepacketizer*)bundler->repacketizer, output, max_output_bytes);
+    if (bytes < 0) {
+        MOONMIC_LOG("[opus_bundler] ERROR: opus_repacketizer_out failed: %d", bytes);
+    }
+    
+    moonmic_opus_bundler_reset(bundler);
+    return bytes;
+}
+
+void moonmic_opus_bundler_reset(moonmic_opus_bundler_t* bundler) {
+    if (!bundler) {
+        return;
+    }
+    opus_repacketizer_init((OpusRepacketizer*)bundler->repacketizer);
+    bundler->count = 0;
+}
@@ -0,0 +1,455 @@
+/**
+ * @file moonmic_dsp.cpp
+ * @brief Scalar reference, SSE2, AVX2 and NEON sample kernels with runtime dispatch
+ */
+
+#include "moonmic_dsp.h"
+#include <algorithm>
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MOONMIC_DSP_HAVE_SSE2 1
+#endif
+
+// AVX2 is compiled per function and only called when CPUID reports it
+#if defined(MOONMIC_DSP_HAVE_SSE2) && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define MOONMIC_DSP_HAVE_AVX2 1
+#define MOONMIC_DSP_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MOONMIC_DSP_HAVE_NEON 1
+#endif
+
+namespace {
+
+const float S16_TO_FLOAT = 1.0f / 32768.0f;  // Exact power of two: same result as dividing
+const float FLOAT_TO_S16 = 32767.0f;
+
+typedef struct {
+    moonmic_dsp_isa_t isa;
+    void (*gain)(float*, size_t, float);
+    void (*clamp)(float*, size_t);
+    void (*gain_clamp)(float*, size_t, float);
+    void (*mix_add)(float*, const float*, size_t);
+    void (*s16_to_float)(const int16_t*, float*, size_t);
+    void (*gain_clamp_to_s16)(const float*, int16_t*, size_t, float);
+} dsp_kernels_t;
+
+// ============================================================================
+// Scalar reference (also handles the tails of the vector kernels)
+// ============================================================================
+
+inline float clampSample(float x) {
+    return std::min(1.0f, std::max(-1.0f, x));
+}
+
+void scalarGain(float* buf, size_t samples, float gain) {
+    for (size_t i = 0; i < samples; i++) {
+        buf[i] *= gain;
+    }
+}
+
+void scalarClamp(float* buf, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        buf[i] = clampSample(buf[i]);
+    }
+}
+
+void scalarGainClamp(float* buf, size_t samples, float gain) {
+    for (size_t i = 0; i < samples; i++) {
+        buf[i] = clampSample(buf[i] * gain);
+    }
+}
+
+void scalarMixAdd(float* dst, const float* src, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        dst[i] += src[i];
+    }
+}
+
+void scalarS16ToFloat(const int16_t* in, float* out, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        out[i] = (float)in[i] * S16_TO_FLOAT;
+    }
+}
+
+void scalarGainClampToS16(const float* in, int16_t* out, size_t samples, float gain) {
+    for (size_t i = 0; i < samples; i++) {
+        out[i] = (int16_t)(clampSample(in[i] * gain) * FLOAT_TO_S16);
+    }
+}
+
+const dsp_kernels_t SCALAR_KERNELS = {
+    MOONMIC_DSP_SCALAR, scalarGain, scalarClamp, scalarGainClamp,
+    scalarMixAdd, scalarS16ToFloat, scalarGainClampToS16
+};
+
+// ============================================================================
+// SSE2 (baseline on x86-64)
+// ============================================================================
+
+#if defined(MOONMIC_DSP_HAVE_SSE2)
+void sse2Gain(float* buf, size_t samples, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        _mm_storeu_ps(buf + i, _mm_mul_ps(_mm_loadu_ps(buf + i), g));
+        _mm_storeu_ps(buf + i + 4, _mm_mul_ps(_mm_loadu_ps(buf + i + 4), g));
+    }
+    scalarGain(buf + i, samples - i, gain);
+}
+
+void sse2Clamp(float* buf, size_t samples) {
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        __m128 v = _mm_loadu_ps(buf + i);
+        _mm_storeu_ps(buf + i, _mm_min_ps(_mm_max_ps(v, lo), hi));
+    }
+    scalarClamp(buf + i, samples - i);
+}
+
+void sse2GainClamp(float* buf, size_t samples, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(buf + i), g);
+        _mm_storeu_ps(buf + i, _mm_min_ps(_mm_max_ps(v, lo), hi));
+    }
+    scalarGainClamp(buf + i, samples - i, gain);
+}
+
+void sse2MixAdd(float* dst, const float* src, size_t samples) {
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m128 a0 = _mm_loadu_ps(dst + i);
+        __m128 a1 = _mm_loadu_ps(dst + i + 4);
+        __m128 b0 = _mm_loadu_ps(src + i);
+        __m128 b1 = _mm_loadu_ps(src + i + 4);
+        _mm_storeu_ps(dst + i, _mm_add_ps(a0, b0));
+        _mm_storeu_ps(dst + i + 4, _mm_add_ps(a1, b1));
+    }
+    scalarMixAdd(dst + i, src + i, samples - i);
+}
+
+void sse2S16ToFloat(const int16_t* in, float* out, size_t samples) {
+    const __m128 scale = _mm_set1_ps(S16_TO_FLOAT);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        // Sign-extend: put each int16 in the top half of an int32, shift back down
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    scalarS16ToFloat(in + i, out + i, samples - i);
+}
+
+void sse2GainClampToS16(const float* in, int16_t* out, size_t samples, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(FLOAT_TO_S16);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i), g), lo), hi);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), g), lo), hi);
+        // cvtt truncates like a C cast; values are within +/-32767 so packs never saturates
+        __m128i ia = _mm_cvttps_epi32(_mm_mul_ps(a, scale));
+        __m128i ib = _mm_cvttps_epi32(_mm_mul_ps(b, scale));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(ia, ib));
+    }
+    scalarGainClampToS16(in + i, out + i, samples - i, gain);
+}
+
+const dsp_kernels_t SSE2_KERNELS = {
+    MOONMIC_DSP_SSE2, sse2Gain, sse2Clamp, sse2GainClamp,
+    sse2MixAdd, sse2S16ToFloat, sse2GainClampToS16
+};
+#endif
+
+// ============================================================================
+// AVX2 (runtime detected)
+// ============================================================================
+
+#if defined(MOONMIC_DSP_HAVE_AVX2)
+MOONMIC_DSP_TARGET_AVX2 void avx2Gain(float* buf, size_t samples, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        _mm256_storeu_ps(buf + i, _mm256_mul_ps(_mm256_loadu_ps(buf + i), g));
+        _mm256_storeu_ps(buf + i + 8, _mm256_mul_ps(_mm256_loadu_ps(buf + i + 8), g));
+    }
+    sse2Gain(buf + i, samples - i, gain);
+}
+
+MOONMIC_DSP_TARGET_AVX2 void avx2Clamp(float* buf, size_t samples) {
+    const __m256 lo = _mm256_set1_ps(-1.0f);
+    const __m256 hi = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m256 v = _mm256_loadu_ps(buf + i);
+        _mm256_storeu_ps(buf + i, _mm256_min_ps(_mm256_max_ps(v, lo), hi));
+    }
+    sse2Clamp(buf + i, samples - i);
+}
+
+MOONMIC_DSP_TARGET_AVX2 void avx2GainClamp(float* buf, size_t samples, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    const __m256 lo = _mm256_set1_ps(-1.0f);
+    const __m256 hi = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m256 v = _mm256_mul_ps(_mm256_loadu_ps(buf + i), g);
+        _mm256_storeu_ps(buf + i, _mm256_min_ps(_mm256_max_ps(v, lo), hi));
+    }
+    sse2GainClamp(buf + i, samples - i, gain);
+}
+
+MOONMIC_DSP_TARGET_AVX2 void avx2MixAdd(float* dst, const float* src, size_t samples) {
+    size_t i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        __m256 a0 = _mm256_loadu_ps(dst + i);
+        __m256 a1 = _mm256_loadu_ps(dst + i + 8);
+        __m256 b0 = _mm256_loadu_ps(src + i);
+        __m256 b1 = _mm256_loadu_ps(src + i + 8);
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(a0, b0));
+        _mm256_storeu_ps(dst + i + 8, _mm256_add_ps(a1, b1));
+    }
+    sse2MixAdd(dst + i, src + i, samples - i);
+}
+
+MOONMIC_DSP_TARGET_AVX2 void avx2S16ToFloat(const int16_t* in, float* out, size_t samples) {
+    const __m256 scale = _mm256_set1_ps(S16_TO_FLOAT);
+    size_t i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i)));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(in + i + 8)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+        _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+    }
+    sse2S16ToFloat(in + i, out + i, samples - i);
+}
+
+MOONMIC_DSP_TARGET_AVX2 void avx2GainClampToS16(const float* in, int16_t* out, size_t samples, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    const __m256 lo = _mm256_set1_ps(-1.0f);
+    const __m256 hi = _mm256_set1_ps(1.0f);
+    const __m256 scale = _mm256_set1_ps(FLOAT_TO_S16);
+    size_t i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), g), lo), hi);
+        __m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i + 8), g), lo), hi);
+        __m256i ia = _mm256_cvttps_epi32(_mm256_mul_ps(a, scale));
+        __m256i ib = _mm256_cvttps_epi32(_mm256_mul_ps(b, scale));
+        // packs works per 128-bit lane: a0-3 b0-3 a4-7 b4-7 -> restore order
+        __m256i packed = _mm256_packs_epi32(ia, ib);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    sse2GainClampToS16(in + i, out + i, samples - i, gain);
+}
+
+const dsp_kernels_t AVX2_KERNELS = {
+    MOONMIC_DSP_AVX2, avx2Gain, avx2Clamp, avx2GainClamp,
+    avx2MixAdd, avx2S16ToFloat, avx2GainClampToS16
+};
+
+bool cpuHasAvx2() {
+    // libgcc also checks OSXSAVE/XCR0, so the YMM state is known to be saved
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+}
+#endif
+
+// ============================================================================
+// NEON (ARMv7 with NEON - PS Vita - and AArch64)
+// ============================================================================
+
+#if defined(MOONMIC_DSP_HAVE_NEON)
+void neonGain(float* buf, size_t samples, float gain) {
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        vst1q_f32(buf + i, vmulq_n_f32(vld1q_f32(buf + i), gain));
+        vst1q_f32(buf + i + 4, vmulq_n_f32(vld1q_f32(buf + i + 4), gain));
+    }
+    scalarGain(buf + i, samples - i, gain);
+}
+
+void neonClamp(float* buf, size_t samples) {
+    const float32x4_t lo = vdupq_n_f32(-1.0f);
+    const float32x4_t hi = vdupq_n_f32(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        float32x4_t v = vld1q_f32(buf + i);
+        vst1q_f32(buf + i, vminq_f32(vmaxq_f32(v, lo), hi));
+    }
+    scalarClamp(buf + i, samples - i);
+}
+
+void neonGainClamp(float* buf, size_t samples, float gain) {
+    const float32x4_t lo = vdupq_n_f32(-1.0f);
+    const float32x4_t hi = vdupq_n_f32(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        float32x4_t v = vmulq_n_f32(vld1q_f32(buf + i), gain);
+        vst1q_f32(buf + i, vminq_f32(vmaxq_f32(v, lo), hi));
+    }
+    scalarGainClamp(buf + i, samples - i, gain);
+}
+
+void neonMixAdd(float* dst, const float* src, size_t samples) {
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        float32x4_t a0 = vld1q_f32(dst + i);
+        float32x4_t a1 = vld1q_f32(dst + i + 4);
+        float32x4_t b0 = vld1q_f32(src + i);
+        float32x4_t b1 = vld1q_f32(src + i + 4);
+        vst1q_f32(dst + i, vaddq_f32(a0, b0));
+        vst1q_f32(dst + i + 4, vaddq_f32(a1, b1));
+    }
+    scalarMixAdd(dst + i, src + i, samples - i);
+}
+
+void neonS16ToFloat(const int16_t* in, float* out, size_t samples) {
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        int16x8_t v = vld1q_s16(in + i);
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+        vst1q_f32(out + i, vmulq_n_f32(lo, S16_TO_FLOAT));
+        vst1q_f32(out + i + 4, vmulq_n_f32(hi, S16_TO_FLOAT));
+    }
+    scalarS16ToFloat(in + i, out + i, samples - i);
+}
+
+void neonGainClampToS16(const float* in, int16_t* out, size_t samples, float gain) {
+    const float32x4_t lo = vdupq_n_f32(-1.0f);
+    const float32x4_t hi = vdupq_n_f32(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        float32x4_t a = vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(in + i), gain), lo), hi);
+        float32x4_t b = vminq_f32(vmaxq_f32(vmulq_n_f32(vld1q_f32(in + i + 4), gain), lo), hi);
+        // vcvtq_s32_f32 rounds toward zero like a C cast
+        int32x4_t ia = vcvtq_s32_f32(vmulq_n_f32(a, FLOAT_TO_S16));
+        int32x4_t ib = vcvtq_s32_f32(vmulq_n_f32(b, FLOAT_TO_S16));
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(ia), vqmovn_s32(ib)));
+    }
+    scalarGainClampToS16(in + i, out + i, samples - i, gain);
+}
+
+const dsp_kernels_t NEON_KERNELS = {
+    MOONMIC_DSP_NEON, neonGain, neonClamp, neonGainClamp,
+    neonMixAdd, neonS16ToFloat, neonGainClampToS16
+};
+#endif
+
+// ============================================================================
+// Dispatch
+// ============================================================================
+
+const dsp_kernels_t* kernelsFor(moonmic_dsp_isa_t isa) {
+    switch (isa) {
+    case MOONMIC_DSP_SCALAR:
+        return &SCALAR_KERNELS;
+#if defined(MOONMIC_DSP_HAVE_SSE2)
+    case MOONMIC_DSP_SSE2:
+        return &SSE2_KERNELS;
+#endif
+#if defined(MOONMIC_DSP_HAVE_AVX2)
+    case MOONMIC_DSP_AVX2:
+        return cpuHasAvx2() ? &AVX2_KERNELS : nullptr;
+#endif
+#if defined(MOONMIC_DSP_HAVE_NEON)
+    case MOONMIC_DSP_NEON:
+        return &NEON_KERNELS;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+const dsp_kernels_t* bestKernels() {
+    const moonmic_dsp_isa_t preference[] = { MOONMIC_DSP_AVX2, MOONMIC_DSP_SSE2, MOONMIC_DSP_NEON };
+    for (moonmic_dsp_isa_t isa : preference) {
+        if (const dsp_kernels_t* kernels = kernelsFor(isa)) {
+            return kernels;
+        }
+    }
+    return &SCALAR_KERNELS;
+}
+
+std::atomic<const dsp_kernels_t*> g_kernels{nullptr};
+
+inline const dsp_kernels_t* kernels() {
+    const dsp_kernels_t* k = g_kernels.load(std::memory_order_acquire);
+    if (!k) {
+        // Racing first calls all pick the same table
+        k = bestKernels();
+        g_kernels.store(k, std::memory_order_release);
+    }
+    return k;
+}
+
+} // namespace
+
+extern "C" {
+
+void moonmic_dsp_gain(float* buf, size_t samples, float gain) {
+    kernels()->gain(buf, samples, gain);
+}
+
+void moonmic_dsp_clamp(float* buf, size_t samples) {
+    kernels()->clamp(buf, samples);
+}
+
+void moonmic_dsp_gain_clamp(float* buf, size_t samples, float gain) {
+    kernels()->gain_clamp(buf, samples, gain);
+}
+
+void moonmic_dsp_mix_add(float* dst, const float* src, size_t samples) {
+    kernels()->mix_add(dst, src, samples);
+}
+
+void moonmic_dsp_s16_to_float(const int16_t* in, float* out, size_t samples) {
+    kernels()->s16_to_float(in, out, samples);
+}
+
+void moonmic_dsp_float_to_s16(const float* in, int16_t* out, size_t samples) {
+    kernels()->gain_clamp_to_s16(in, out, samples, 1.0f);
+}
+
+void moonmic_dsp_gain_clamp_to_s16(const float* in, int16_t* out, size_t samples, float gain) {
+    kernels()->gain_clamp_to_s16(in, out, samples, gain);
+}
+
+moonmic_dsp_isa_t moonmic_dsp_get_isa(void) {
+    return kernels()->isa;
+}
+
+bool moonmic_dsp_set_isa(moonmic_dsp_isa_t isa) {
+    const dsp_kernels_t* k = kernelsFor(isa);
+    if (!k) {
+        return false;
+    }
+    g_kernels.store(k, std::memory_order_release);
+    return true;
+}
+
+const char* moonmic_dsp_isa_name(moonmic_dsp_isa_t isa) {
+    switch (isa) {
+    case MOONMIC_DSP_SSE2: return "sse2";
+    case MOONMIC_DSP_AVX2: return "avx2";
+    case MOONMIC_DSP_NEON: return "neon";
+    default: return "scalar";
+    }
+}
+
+} // extern "C"
@@ -0,0 +1,68 @@
+/**
+ * @file moonmic_dsp.h
+ * @brief Sample kernels shared by libmoonmic and moonmic-host (gain, clamp, int16/float conversion)
+ *
+ * Every kernel has a scalar reference and SSE2 / AVX2 / NEON versions; the
+ * best one the CPU supports is picked on first use (AVX2 by CPUID, SSE2 and
+ * NEON at compile time). The vector versions produce bit-identical output to
+ * the scalar ones for finite input: the same IEEE single operations in the
+ * same order, and float -> int16 truncates toward zero like a C cast.
+ *
+ * Conventions: float samples are full scale at +/-1.0; int16 -> float divides
+ * by 32768, float -> int16 clamps to +/-1.0 and multiplies by 32767.
+ * Buffers need no particular alignment.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    MOONMIC_DSP_SCALAR = 0,
+    MOONMIC_DSP_SSE2,
+    MOONMIC_DSP_AVX2,
+    MOONMIC_DSP_NEON
+} moonmic_dsp_isa_t;
+
+/** buf[i] *= gain */
+void moonmic_dsp_gain(float* buf, size_t samples, float gain);
+
+/** buf[i] = clamp(buf[i], -1, 1) */
+void moonmic_dsp_clamp(float* buf, size_t samples);
+
+/** buf[i] = clamp(buf[i] * gain, -1, 1) */
+void moonmic_dsp_gain_clamp(float* buf, size_t samples, float gain);
+
+/** dst[i] += src[i] */
+void moonmic_dsp_mix_add(float* dst, const float* src, size_t samples);
+
+/** out[i] = in[i] / 32768 */
+void moonmic_dsp_s16_to_float(const int16_t* in, float* out, size_t samples);
+
+/** out[i] = (int16_t)(clamp(in[i], -1, 1) * 32767) */
+void moonmic_dsp_float_to_s16(const float* in, int16_t* out, size_t samples);
+
+/** out[i] = (int16_t)(clamp(in[i] * gain, -1, 1) * 32767), one pass */
+void moonmic_dsp_gain_clamp_to_s16(const float* in, int16_t* out, size_t samples, float gain);
+
+/** Kernel set in use */
+moonmic_dsp_isa_t moonmic_dsp_get_isa(void);
+
+/**
+ * @brief Switch kernel set (benchmarks / verification against the scalar reference)
+ * @return false if this CPU or build can't run it (the current set is kept)
+ */
+bool moonmic_dsp_set_isa(moonmic_dsp_isa_t isa);
+
+/** "scalar", "sse2", "avx2" or "neon" */
+const char* moonmic_dsp_isa_name(moonmic_dsp_isa_t isa);
+
+#ifdef __cplusplus
+}
+#endif
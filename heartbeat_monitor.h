@@ -30,6 +30,9 @@ typedef enum {
  */
 typedef struct heartbeat_monitor_t heartbeat_monitor_t;
 
+/** Host receiver report (moonmic_internal.h) */
+typedef struct moonmic_receiver_report_t moonmic_receiver_report_t;
+
 /**
  * @brief Create and start heartbeat monitor
  * @param socket_fd Existing socket file descriptor to listen on
@@ -73,6 +76,15 @@ bool heartbeat_monitor_is_connected(heartbeat_monitor_t* monitor);
  */
 bool heartbeat_monitor_is_paused(heartbeat_monitor_t* monitor);
 
+/**
+ * @brief Copy the last receiver report the host sent
+ * @param monitor Monitor instance
+ * @param report Filled if a report has arrived
+ * @param age_ms Filled with the time since it arrived (may be NULL)
+ * @return false if no report has arrived yet
+ */
+bool heartbeat_monitor_get_report(heartbeat_monitor_t* monitor, moonmic_receiver_report_t* report, uint32_t* age_ms);
+
 #ifdef __cplusplus
 }
 #endif
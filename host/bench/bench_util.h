@@ -0,0 +1,77 @@
+/**
+ * @file bench_util.h
+ * @brief Shared helpers for moonmic-host benchmarks (timing, JSON output)
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace moonmic {
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsedUs(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+/**
+ * @brief Read an integer "--name value" argument
+ */
+inline int argInt(int argc, char** argv, const char* name, int fallback) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], name) == 0) {
+            return atoi(argv[i + 1]);
+        }
+    }
+    return fallback;
+}
+
+/**
+ * @brief Minimal flat JSON object writer (benchmarks emit one object per run)
+ */
+class JsonObject {
+public:
+    JsonObject& add(const std::string& key, const std::string& value) {
+        return raw(key, "\"" + value + "\"");
+    }
+    // Without this a string literal would pick the bool overload
+    JsonObject& add(const std::string& key, const char* value) { return add(key, std::string(value)); }
+    JsonObject& add(const std::string& key, bool value) { return raw(key, value ? "true" : "false"); }
+    JsonObject& add(const std::string& key, double value) {
+        std::ostringstream ss;
+        ss << value;
+        return raw(key, ss.str());
+    }
+    JsonObject& add(const std::string& key, int value) { return raw(key, std::to_string(value)); }
+    JsonObject& add(const std::string& key, uint64_t value) { return raw(key, std::to_string(value)); }
+    JsonObject& add(const std::string& key, const JsonObject& value) { return raw(key, value.str()); }
+    JsonObject& add(const std::string& key, const std::vector<JsonObject>& values) {
+        std::string out = "[";
+        for (size_t i = 0; i < values.size(); i++) {
+            out += (i ? "," : "") + values[i].str();
+        }
+        return raw(key, out + "]");
+    }
+
+    std::string str() const { return "{" + body_ + "}"; }
+
+private:
+    JsonObject& raw(const std::string& key, const std::string& value) {
+        body_ += (body_.empty() ? "\"" : ",\"") + key + "\":" + value;
+        return *this;
+    }
+
+    std::string body_;
+};
+
+} // namespace bench
+} // namespace moonmic
@@ -0,0 +1,137 @@
+/**
+ * @file bundling_bench.cpp
+ * @brief Packet rate vs. added latency for client frame bundling
+ *
+ * Encodes a test signal in 20ms Opus frames the way the client does, bundles
+ * N = 1..6 consecutive frames with the Opus repacketizer (frames_per_packet)
+ * and decodes every bundle with the host OpusDecoder to check nothing is
+ * lost. Reports packets/sec, wire bitrate including the moonmic header and
+ * UDP/IPv4 headers, header overhead and the latency the bundling adds.
+ *
+ * Usage: bundling_bench [--seconds S] [--bitrate BPS]
+ */
+
+#include "bench_util.h"
+#include "opus_decoder.h"
+#include <opus/opus.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace moonmic;
+
+static const int SAMPLE_RATE = 48000;
+static const int FRAME_SIZE = SAMPLE_RATE / 50;  // 20ms
+static const int FRAME_MS = 20;
+static const int MOONMIC_HEADER_BYTES = 20;
+static const int UDP_IP_HEADER_BYTES = 28;       // IPv4 (20) + UDP (8)
+static const int MAX_FRAMES_PER_PACKET = 6;      // MOONMIC_MAX_FRAMES_PER_PACKET
+
+static std::vector<std::vector<uint8_t>> encodeFrames(int frames, int bitrate) {
+    std::vector<std::vector<uint8_t>> out;
+    int err = 0;
+    ::OpusEncoder* enc = opus_encoder_create(SAMPLE_RATE, 1, OPUS_APPLICATION_VOIP, &err);
+    if (err != OPUS_OK) {
+        std::cerr << "opus_encoder_create failed: " << opus_strerror(err) << std::endl;
+        return out;
+    }
+    opus_encoder_ctl(enc, OPUS_SET_BITRATE(bitrate));
+    opus_encoder_ctl(enc, OPUS_SET_INBAND_FEC(1));
+    opus_encoder_ctl(enc, OPUS_SET_PACKET_LOSS_PERC(10));
+
+    std::vector<float> pcm(FRAME_SIZE);
+    uint8_t buffer[1275];
+    for (int f = 0; f < frames; f++) {
+        for (int i = 0; i < FRAME_SIZE; i++) {
+            double t = (double)(f * FRAME_SIZE + i) / SAMPLE_RATE;
+            pcm[i] = (float)(0.3 * sin(2.0 * M_PI * 220.0 * t) + 0.1 * sin(2.0 * M_PI * 1760.0 * t));
+        }
+        int bytes = opus_encode_float(enc, pcm.data(), FRAME_SIZE, buffer, sizeof(buffer));
+        if (bytes > 0) {
+            out.emplace_back(buffer, buffer + bytes);
+        }
+    }
+    opus_encoder_destroy(enc);
+    return out;
+}
+
+int main(int argc, char** argv) {
+    const int seconds = bench::argInt(argc, argv, "--seconds", 10);
+    const int bitrate = bench::argInt(argc, argv, "--bitrate", 64000);
+
+    auto frames = encodeFrames(seconds * 1000 / FRAME_MS, bitrate);
+    if (frames.empty()) {
+        return 1;
+    }
+
+    OpusRepacketizer* rp = opus_repacketizer_create();
+    std::vector<float> pcm(FRAME_SIZE * MAX_FRAMES_PER_PACKET);
+    std::vector<uint8_t> packet(4000);
+    std::vector<bench::JsonObject> results;
+    bool all_ok = true;
+
+    for (int n = 1; n <= MAX_FRAMES_PER_PACKET; n++) {
+        moonmic::OpusDecoder decoder;
+        if (!decoder.init(SAMPLE_RATE, 1)) {
+            std::cerr << "OpusDecoder init failed" << std::endl;
+            return 1;
+        }
+
+        size_t packets = 0;
+        size_t payload_bytes = 0;
+        size_t decoded_frames = 0;
+        double repack_us = 0.0;
+
+        for (size_t f = 0; f < frames.size(); f += n) {
+            size_t count = std::min(frames.size() - f, (size_t)n);
+
+            // Same calls as moonmic_opus_bundler_add/flush on the client
+            auto start = bench::Clock::now();
+            opus_repacketizer_init(rp);
+            for (size_t i = 0; i < count; i++) {
+                opus_repacketizer_cat(rp, frames[f + i].data(), (opus_int32)frames[f + i].size());
+            }
+            int bytes = opus_repacketizer_out(rp, packet.data(), (opus_int32)packet.size());
+            repack_us += bench::elapsedUs(start, bench::Clock::now());
+            if (bytes <= 0) {
+                std::cerr << "opus_repacketizer_out failed: " << bytes << std::endl;
+                return 1;
+            }
+
+            int decoded = decoder.decode(packet.data(), bytes, pcm.data(), (int)pcm.size());
+            if (decoded > 0) {
+                decoded_frames += decoded;
+            }
+            packets++;
+            payload_bytes += bytes;
+        }
+
+        const double duration_s = (double)frames.size() * FRAME_MS / 1000.0;
+        const double pps = packets / duration_s;
+        const size_t header_bytes = packets * (MOONMIC_HEADER_BYTES + UDP_IP_HEADER_BYTES);
+        const double wire_kbps = (payload_bytes + header_bytes) * 8.0 / duration_s / 1000.0;
+        const bool ok = decoded_frames == frames.size() * FRAME_SIZE;
+        all_ok = all_ok && ok;
+
+        bench::JsonObject entry;
+        entry.add("frames_per_packet", n)
+             .add("packets_per_sec", pps)
+             .add("added_latency_ms", (n - 1) * FRAME_MS)
+             .add("avg_packet_bytes", (double)payload_bytes / packets + MOONMIC_HEADER_BYTES)
+             .add("wire_kbps", wire_kbps)
+             .add("header_overhead_pct", 100.0 * header_bytes / (payload_bytes + header_bytes))
+             .add("repacketize_us_per_packet", repack_us / packets)
+             .add("decode_ok", ok ? 1 : 0);
+        results.push_back(entry);
+    }
+
+    opus_repacketizer_destroy(rp);
+
+    bench::JsonObject out;
+    out.add("benchmark", std::string("bundling"))
+       .add("bitrate", bitrate)
+       .add("seconds", seconds)
+       .add("results", results);
+    std::cout << out.str() << std::endl;
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file capture_backend_bench.cpp
+ * @brief Client capture backends compared: PulseAudio vs. direct ALSA mmap
+ *
+ * Drives each libmoonmic Linux capture backend through its audio_capture_t
+ * vtable the way the client send loop does (one 20ms frame per read) and
+ * reports, per backend:
+ *  - wakeups/sec: context switches of the whole process (voluntary +
+ *    involuntary, getrusage) divided by run time, i.e. what the backend costs
+ *    the CPU beyond the one read per frame
+ *  - capture latency: read return time minus the capture timestamp of the
+ *    first frame returned (avg / p99 / max), the age of audio when it reaches
+ *    the encoder
+ *
+ * Without a sound card, ALSA can be tested on the dummy driver:
+ *   sudo modprobe snd-dummy
+ *   capture_backend_bench --device hw:Dummy
+ * (the "null" PCM plugin has neither mmap access nor timestamps.)
+ *
+ * Usage: capture_backend_bench [--seconds S] [--device ALSA_PCM] [--fragment MS]
+ */
+
+#include "bench_util.h"
+#include "moonmic_internal.h"
+#include <sys/resource.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace moonmic;
+using namespace moonmic::bench;
+
+static const int SAMPLE_RATE = 48000;
+static const int FRAME_SIZE = SAMPLE_RATE / 50;  // 20ms, one Opus frame
+
+// Normally provided by moonmic_client.cpp; the bench links only the backends
+extern "C" uint64_t moonmic_get_timestamp_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t contextSwitches() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (uint64_t)(usage.ru_nvcsw + usage.ru_nivcsw);
+}
+
+static JsonObject runBackend(const char* name, audio_capture_t* capture, const std::string& device,
+                             int fragment_ms, int seconds) {
+    JsonObject result;
+    result.add("backend", std::string(name));
+    if (!capture) {
+        return result.add("error", std::string("create failed"));
+    }
+
+    capture->fragment_ms = (uint32_t)fragment_ms;
+    capture->device_name = device.empty() ? NULL : device.c_str();
+    if (!capture->init(capture, SAMPLE_RATE, 1)) {
+        free(capture);
+        return result.add("error", std::string("init failed"));
+    }
+
+    std::vector<float> buffer(FRAME_SIZE);
+    std::vector<double> latencies_ms;
+    uint64_t frames = 0;
+    uint64_t short_reads = 0;
+    uint64_t untimed = 0;
+
+    // Let the stream settle before counting
+    for (int i = 0; i < 10; i++) {
+        capture->read(capture, buffer.data(), FRAME_SIZE);
+    }
+
+    uint64_t switches_start = contextSwitches();
+    auto start = Clock::now();
+    auto end = start + std::chrono::seconds(seconds);
+    while (Clock::now() < end) {
+        int got = capture->read(capture, buffer.data(), FRAME_SIZE);
+        if (got < 0) {
+            result.add("error", std::string("read failed"));
+            break;
+        }
+        uint64_t now_us = moonmic_get_timestamp_us();
+        frames += (uint64_t)got;
+        if (got < FRAME_SIZE) {
+            short_reads++;
+        }
+
+        uint64_t captured_us = capture->get_capture_timestamp ? capture->get_capture_timestamp(capture) : 0;
+        if (got > 0 && captured_us > 0 && captured_us <= now_us) {
+            latencies_ms.push_back((double)(now_us - captured_us) / 1000.0);
+        } else if (got > 0) {
+            untimed++;
+        }
+    }
+    double elapsed_s = elapsedUs(start, Clock::now()) / 1e6;
+    uint64_t switches = contextSwitches() - switches_start;
+
+    uint32_t native_rate = capture->get_native_sample_rate ? capture->get_native_sample_rate(capture) : SAMPLE_RATE;
+    capture->close(capture);
+    free(capture);
+
+    double avg = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+    if (!latencies_ms.empty()) {
+        for (double l : latencies_ms) avg += l;
+        avg /= latencies_ms.size();
+        std::sort(latencies_ms.begin(), latencies_ms.end());
+        p99 = latencies_ms[std::min(latencies_ms.size() - 1, latencies_ms.size() * 99 / 100)];
+        max = latencies_ms.back();
+    }
+
+    result.add("rate", (int)native_rate)
+          .add("seconds", elapsed_s)
+          .add("frames_per_sec", elapsed_s > 0 ? frames / elapsed_s : 0.0)
+          .add("short_reads", short_reads)
+          .add("wakeups_per_sec", elapsed_s > 0 ? switches / elapsed_s : 0.0)
+          .add("latency_avg_ms", avg)
+          .add("latency_p99_ms", p99)
+          .add("latency_max_ms", max)
+          .add("untimed_reads", untimed);
+    return result;
+}
+
+int main(int argc, char** argv) {
+    int seconds = argInt(argc, argv, "--seconds", 10);
+    int fragment_ms = argInt(argc, argv, "--fragment", 0);
+    std::string device;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--device") device = argv[i + 1];
+    }
+
+    std::vector<JsonObject> results;
+    results.push_back(runBackend("pulseaudio", audio_capture_create_linux(), "", fragment_ms, seconds));
+#ifdef MOONMIC_HAVE_ALSA
+    results.push_back(runBackend("alsa_mmap", audio_capture_create_alsa(), device, fragment_ms, seconds));
+#endif
+
+    JsonObject out;
+    out.add("benchmark", std::string("capture_backend"))
+       .add("frame_ms", 20)
+       .add("backends", results);
+    std::cout << out.str() << std::endl;
+    return 0;
+}
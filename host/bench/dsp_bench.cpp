@@ -0,0 +1,184 @@
+/**
+ * @file dsp_bench.cpp
+ * @brief Shared DSP kernels: exactness against the scalar reference + throughput per ISA
+ *
+ * For every kernel set this CPU can run (scalar, SSE2, AVX2, NEON):
+ *  - verification: runs each kernel on random audio, out-of-range values,
+ *    the exact +/-1.0 / int16 limits and every length 0..67 (all vector
+ *    tails), and compares the output bit for bit with the scalar kernels
+ *  - throughput: Msamples/s per kernel on a 20ms 48kHz stereo block (the
+ *    size the mixer and the client work on), speedup over scalar
+ *
+ * Exits non-zero if any kernel set differs from the reference.
+ *
+ * Usage: dsp_bench [--iterations N]
+ */
+
+#include "bench_util.h"
+#include "moonmic_dsp.h"
+#include <cmath>
+#include <functional>
+#include <random>
+#include <vector>
+
+using namespace moonmic;
+using namespace moonmic::bench;
+
+static const size_t BLOCK_SAMPLES = 960 * 2;  // 20ms @ 48kHz stereo
+static const float TEST_GAIN = 10.0f;         // Client default gain: plenty of clipping
+
+static std::vector<float> makeFloatInput(size_t samples, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(-1.5f, 1.5f);
+    std::vector<float> v(samples);
+    for (auto& x : v) x = dist(rng);
+
+    // Exact limits and values around them
+    const float edges[] = { 0.0f, -0.0f, 1.0f, -1.0f, 0.1f, -0.1f, 1.0000001f, -1.0000001f,
+                            0.99999994f, -0.99999994f, 1.0f / 32767.0f, -1.0f / 32767.0f, 1e-30f, 1e30f, -1e30f };
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]) && i < samples; i++) {
+        v[i * 7 % samples] = edges[i];
+    }
+    return v;
+}
+
+static std::vector<int16_t> makeS16Input(size_t samples, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(-32768, 32767);
+    std::vector<int16_t> v(samples);
+    for (auto& x : v) x = (int16_t)dist(rng);
+    if (samples > 1) {
+        v[0] = -32768;
+        v[1] = 32767;
+    }
+    return v;
+}
+
+template <typename T>
+static bool sameBits(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+// Runs fn under isa and under scalar, returns true if the outputs match
+template <typename T>
+static bool matchesScalar(moonmic_dsp_isa_t isa, const std::function<std::vector<T>()>& fn) {
+    moonmic_dsp_set_isa(MOONMIC_DSP_SCALAR);
+    std::vector<T> expected = fn();
+    moonmic_dsp_set_isa(isa);
+    return sameBits(expected, fn());
+}
+
+static bool verify(moonmic_dsp_isa_t isa, std::string& failed) {
+    bool ok = true;
+    auto check = [&](const char* kernel, bool match) {
+        if (!match) {
+            ok = false;
+            failed += std::string(failed.empty() ? "" : ",") + kernel;
+        }
+    };
+
+    const size_t lengths[] = { 0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 31, 33, 63, 64, 67, BLOCK_SAMPLES, BLOCK_SAMPLES + 5 };
+    for (size_t n : lengths) {
+        const std::vector<float> a = makeFloatInput(n, 1 + (uint32_t)n);
+        const std::vector<float> b = makeFloatInput(n, 1000 + (uint32_t)n);
+        const std::vector<int16_t> s = makeS16Input(n, 2000 + (uint32_t)n);
+
+        check("gain", matchesScalar<float>(isa, [&] { auto v = a; moonmic_dsp_gain(v.data(), n, 0.15f); return v; }));
+        check("clamp", matchesScalar<float>(isa, [&] { auto v = a; moonmic_dsp_clamp(v.data(), n); return v; }));
+        check("gain_clamp", matchesScalar<float>(isa, [&] {
+            auto v = a; moonmic_dsp_gain_clamp(v.data(), n, TEST_GAIN); return v; }));
+        check("mix_add", matchesScalar<float>(isa, [&] { auto v = a; moonmic_dsp_mix_add(v.data(), b.data(), n); return v; }));
+        check("s16_to_float", matchesScalar<float>(isa, [&] {
+            std::vector<float> v(n); moonmic_dsp_s16_to_float(s.data(), v.data(), n); return v; }));
+        check("float_to_s16", matchesScalar<int16_t>(isa, [&] {
+            std::vector<int16_t> v(n); moonmic_dsp_float_to_s16(a.data(), v.data(), n); return v; }));
+        check("gain_clamp_to_s16", matchesScalar<int16_t>(isa, [&] {
+            std::vector<int16_t> v(n); moonmic_dsp_gain_clamp_to_s16(a.data(), v.data(), n, TEST_GAIN); return v; }));
+    }
+
+    // The scalar reference itself must match the loops it replaced
+    if (isa == MOONMIC_DSP_SCALAR) {
+        moonmic_dsp_set_isa(MOONMIC_DSP_SCALAR);
+        const std::vector<float> a = makeFloatInput(BLOCK_SAMPLES, 7);
+        std::vector<int16_t> out(BLOCK_SAMPLES);
+        moonmic_dsp_gain_clamp_to_s16(a.data(), out.data(), BLOCK_SAMPLES, TEST_GAIN);
+        bool legacy = true;
+        for (size_t i = 0; i < BLOCK_SAMPLES; i++) {
+            float v = a[i] * TEST_GAIN;
+            if (v > 1.0f) v = 1.0f;
+            if (v < -1.0f) v = -1.0f;
+            legacy &= out[i] == (int16_t)(v * 32767.0f);
+        }
+        check("legacy_client_loop", legacy);
+    }
+    return ok;
+}
+
+static double measure(int iterations, const std::function<void()>& fn) {
+    fn();  // Warm caches
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        fn();
+    }
+    double us = elapsedUs(start, Clock::now());
+    return us > 0 ? (double)BLOCK_SAMPLES * iterations / us : 0.0;  // Msamples/s
+}
+
+static JsonObject benchmark(int iterations) {
+    std::vector<float> a = makeFloatInput(BLOCK_SAMPLES, 11);
+    std::vector<float> b = makeFloatInput(BLOCK_SAMPLES, 12);
+    std::vector<int16_t> s = makeS16Input(BLOCK_SAMPLES, 13);
+    std::vector<float> f(BLOCK_SAMPLES);
+    std::vector<int16_t> out(BLOCK_SAMPLES);
+
+    // In-place kernels work on a copy refreshed each run so clamping doesn't degenerate
+    JsonObject result;
+    result.add("gain", measure(iterations, [&] { f = a; moonmic_dsp_gain(f.data(), BLOCK_SAMPLES, 0.15f); }))
+          .add("gain_clamp", measure(iterations, [&] { f = a; moonmic_dsp_gain_clamp(f.data(), BLOCK_SAMPLES, TEST_GAIN); }))
+          .add("mix_add_clamp", measure(iterations, [&] {
+              f = a; moonmic_dsp_mix_add(f.data(), b.data(), BLOCK_SAMPLES); moonmic_dsp_clamp(f.data(), BLOCK_SAMPLES); }))
+          .add("s16_to_float", measure(iterations, [&] { moonmic_dsp_s16_to_float(s.data(), f.data(), BLOCK_SAMPLES); }))
+          .add("float_to_s16", measure(iterations, [&] { moonmic_dsp_float_to_s16(a.data(), out.data(), BLOCK_SAMPLES); }))
+          .add("gain_clamp_to_s16", measure(iterations, [&] {
+              moonmic_dsp_gain_clamp_to_s16(a.data(), out.data(), BLOCK_SAMPLES, TEST_GAIN); }))
+          .add("gain_clamp_then_s16", measure(iterations, [&] {
+              f = a; moonmic_dsp_gain_clamp(f.data(), BLOCK_SAMPLES, TEST_GAIN);
+              moonmic_dsp_float_to_s16(f.data(), out.data(), BLOCK_SAMPLES); }));
+    return result;
+}
+
+int main(int argc, char** argv) {
+    int iterations = argInt(argc, argv, "--iterations", 20000);
+    const moonmic_dsp_isa_t default_isa = moonmic_dsp_get_isa();
+
+    bool all_exact = true;
+    std::vector<JsonObject> results;
+    const moonmic_dsp_isa_t isas[] = { MOONMIC_DSP_SCALAR, MOONMIC_DSP_SSE2, MOONMIC_DSP_AVX2, MOONMIC_DSP_NEON };
+    for (moonmic_dsp_isa_t isa : isas) {
+        if (!moonmic_dsp_set_isa(isa)) {
+            continue;
+        }
+        std::string failed;
+        bool exact = verify(isa, failed);
+        all_exact &= exact;
+
+        moonmic_dsp_set_isa(isa);
+        JsonObject entry;
+        entry.add("isa", std::string(moonmic_dsp_isa_name(isa)))
+             .add("exact", exact)
+             .add("msamples_per_sec", benchmark(iterations));
+        if (!exact) {
+            entry.add("mismatch", failed);
+        }
+        results.push_back(entry);
+    }
+    moonmic_dsp_set_isa(default_isa);
+
+    JsonObject out;
+    out.add("benchmark", std::string("dsp"))
+       .add("block_samples", (int)BLOCK_SAMPLES)
+       .add("dispatched", std::string(moonmic_dsp_isa_name(default_isa)))
+       .add("isas", results);
+    std::cout << out.str() << std::endl;
+    return all_exact ? 0 : 1;
+}
@@ -0,0 +1,356 @@
+/**
+ * @file e2e_bench.cpp
+ * @brief End-to-end loopback: libmoonmic client -> localhost UDP -> AudioReceiver -> null device
+ *
+ * Client and host run in one process, exactly as shipped (worker thread,
+ * heartbeat, jitter buffer, decode pool, mixer, device thread):
+ *  - capture: the client's own signal generator backend (MOONMIC_CAPTURE_SYNTH,
+ *    MOONMIC_SIGNAL_BURST, real-time paced): silence with a 5ms 1kHz marker
+ *    burst every 500ms. The bench only wraps its read() to note when each
+ *    burst was "recorded"
+ *  - output: VirtualDevice::create() is replaced at link time by a null device
+ *    that plays each write as soon as the previous one has finished (an ideal
+ *    device with no buffer of its own) and detects the markers
+ *
+ * Latency is from the moment the marker's first sample would have hit the
+ * microphone to the moment it would leave the speaker, so it includes the
+ * capture period, packetization, jitter buffering, resampling, the mix FIFO
+ * and the output queue. Add the real device's buffer (output_latency_ms) on
+ * top. Markers are matched in order, which assumes latency stays below the
+ * marker interval.
+ *
+ * Per scenario (RAW at several capture periods, Opus at 1-3 frames per
+ * packet, and each latency profile with its own frame size, encoder settings
+ * and host buffering): latency percentiles, process CPU (client + host, one
+ * stream) and packets/sec. Logging goes to stderr, the JSON result to stdout.
+ *
+ * Usage: e2e_bench [--seconds S] [--warmup S] [--port P] [--mode raw|opus|profile] 2>/dev/null
+ */
+
+#include "bench_util.h"
+#include "audio_receiver.h"
+#include "moonmic.h"
+#include "moonmic_internal.h"
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+bool g_debug_mode = false;  // Normally defined in main.cpp
+
+using namespace moonmic;
+using namespace moonmic::bench;
+
+static const int CLIENT_RATE = 16000;        // Vita capture rate
+static const int MARKER_INTERVAL_MS = 500;   // MOONMIC_SIGNAL_BURST at 2 bursts/s
+static const float MARKER_AMPLITUDE = 0.5f;
+static const float DETECT_THRESHOLD = 0.1f;  // Opus keeps a 0.5 burst well above this
+
+/**
+ * Marker capture times, waiting for the device side to see them
+ */
+class MarkerTracker {
+public:
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.clear();
+        latencies_ms_.clear();
+        measuring_ = false;
+        lost_ = 0;
+    }
+
+    void setMeasuring(bool measuring) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        measuring_ = measuring;
+    }
+
+    void onCaptured(Clock::time_point when) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(when);
+    }
+
+    void onPlayed(Clock::time_point when) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // A newer marker captured before this one played: the older one never arrived
+        while (pending_.size() >= 2 && pending_[1] <= when) {
+            pending_.pop_front();
+            if (measuring_) lost_++;
+        }
+        if (pending_.empty() || pending_.front() > when) {
+            return;  // Noise, not a marker
+        }
+        if (measuring_) {
+            latencies_ms_.push_back(elapsedUs(pending_.front(), when) / 1000.0);
+        }
+        pending_.pop_front();
+    }
+
+    std::vector<double> latencies() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return latencies_ms_;
+    }
+
+    uint64_t lost() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return lost_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<Clock::time_point> pending_;
+    std::vector<double> latencies_ms_;
+    bool measuring_ = false;
+    uint64_t lost_ = 0;
+};
+
+static MarkerTracker g_markers;
+
+// ---------------------------------------------------------------------------
+// Marker capture times, read off the client's signal generator backend
+// ---------------------------------------------------------------------------
+
+struct CaptureTap {
+    int (*read)(audio_capture_t* self, float* buffer, size_t frames);  // The backend's own read()
+    uint32_t sample_rate;
+    uint64_t position;  // Frames delivered so far (the generator's frame index)
+};
+
+static CaptureTap g_capture_tap;
+
+// Bursts start on every multiple of the interval; the backend stamps each read with its first frame's time
+static int tappedRead(audio_capture_t* self, float* buffer, size_t frames) {
+    int read = g_capture_tap.read(self, buffer, frames);
+    if (read <= 0) {
+        return read;
+    }
+    const uint64_t rate = g_capture_tap.sample_rate;
+    const uint64_t interval = rate * MARKER_INTERVAL_MS / 1000;
+    const uint64_t first = g_capture_tap.position;
+    const uint64_t first_us = self->get_capture_timestamp(self);  // moonmic_get_timestamp_us: CLOCK_MONOTONIC
+    for (uint64_t marker = (first + interval - 1) / interval * interval; marker < first + (uint64_t)read; marker += interval) {
+        g_markers.onCaptured(Clock::time_point(std::chrono::microseconds(first_us + (marker - first) * 1000000 / rate)));
+    }
+    g_capture_tap.position += (uint64_t)read;
+    return read;
+}
+
+static void tapCapture(moonmic_client_t* client) {
+    g_capture_tap.read = client->capture->read;
+    g_capture_tap.sample_rate = client->config.sample_rate;
+    g_capture_tap.position = 0;
+    client->capture->read = tappedRead;
+}
+
+// ---------------------------------------------------------------------------
+// Null output device (stands in for PulseAudio / PipeWire)
+// ---------------------------------------------------------------------------
+
+class MarkerDetectorDevice : public VirtualDevice {
+public:
+    bool init(const std::string& device_name, int sample_rate, int channels) override {
+        (void)device_name;
+        sample_rate_ = sample_rate > 0 ? sample_rate : 48000;
+        channels_ = channels;
+        return true;
+    }
+
+    bool write(const float* data, size_t frames, int channels) override {
+        // Ideal device: starts on this buffer once the previous one has played
+        auto start = std::max(Clock::now(), play_end_);
+        for (size_t i = 0; i < frames; i++) {
+            if (position_ + i >= quiet_until_ && std::fabs(data[i * channels]) > DETECT_THRESHOLD) {
+                g_markers.onPlayed(start + std::chrono::microseconds((uint64_t)i * 1000000 / sample_rate_));
+                quiet_until_ = position_ + i + (uint64_t)sample_rate_ * MARKER_INTERVAL_MS / 2000;
+            }
+        }
+        position_ += frames;
+        play_end_ = start + std::chrono::microseconds((uint64_t)frames * 1000000 / sample_rate_);
+        return true;
+    }
+
+    void close() override {}
+    int getSampleRate() const override { return sample_rate_; }
+
+private:
+    int sample_rate_ = 48000;
+    int channels_ = 1;
+    uint64_t position_ = 0;      // Frames written
+    uint64_t quiet_until_ = 0;   // Ignore the rest of a detected burst
+    Clock::time_point play_end_;
+};
+
+// Replaces the platform device factory in this binary
+std::unique_ptr<VirtualDevice> VirtualDevice::create(const std::string& driver_type) {
+    (void)driver_type;
+    return std::make_unique<MarkerDetectorDevice>();
+}
+
+// ---------------------------------------------------------------------------
+
+struct Scenario {
+    const char* name;
+    const char* mode;       // "raw", "opus" or "profile" (--mode filter)
+    int fragment_ms;        // Capture period (= packet duration in RAW mode, 0 = profile default)
+    int frames_per_packet;  // Opus frames bundled per datagram
+    int latency_profile;    // MOONMIC_PROFILE_*
+    int frame_ms;           // The profile's Opus frame duration
+};
+
+static double cpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static double percentile(const std::vector<double>& sorted, int p) {
+    return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, sorted.size() * p / 100)];
+}
+
+static JsonObject runScenario(const Scenario& scenario, int port, int seconds, int warmup_s) {
+    const bool raw = std::string(scenario.mode) == "raw";
+    JsonObject result;
+    result.add("scenario", std::string(scenario.name))
+          .add("mode", std::string(scenario.mode))
+          .add("packet_ms", raw ? scenario.fragment_ms : scenario.frame_ms * scenario.frames_per_packet);
+
+    g_markers.reset();
+
+    Config config;
+    config.server.port = port;
+    config.server.bind_address = "127.0.0.1";
+    config.security.enable_whitelist = false;
+    AudioReceiver receiver;
+    if (!receiver.start(config)) {
+        return result.add("error", std::string("host start failed"));
+    }
+
+    moonmic_config_t client_config;
+    memset(&client_config, 0, sizeof(client_config));
+    client_config.host_ip = "127.0.0.1";
+    client_config.port = (uint16_t)port;
+    client_config.sample_rate = CLIENT_RATE;
+    client_config.channels = 1;
+    client_config.raw_mode = raw;
+    client_config.gain = 1.0f;
+    client_config.devicename = "e2e_bench";
+    client_config.pair_status = 1;
+    client_config.frames_per_packet = (uint8_t)scenario.frames_per_packet;
+    client_config.capture_fragment_ms = (uint8_t)scenario.fragment_ms;
+    client_config.latency_profile = (uint8_t)scenario.latency_profile;
+    client_config.capture_backend = MOONMIC_CAPTURE_SYNTH;
+    client_config.capture_pacing = MOONMIC_PACING_REALTIME;
+    client_config.capture_signal = MOONMIC_SIGNAL_BURST;
+    client_config.capture_signal_hz = 1000.0f / MARKER_INTERVAL_MS;
+    client_config.capture_signal_level = MARKER_AMPLITUDE;
+    moonmic_client_t* client = moonmic_create(&client_config);
+    if (client) {
+        tapCapture(client);
+    }
+    if (!client || !moonmic_start(client)) {
+        moonmic_destroy(client);
+        receiver.stop();
+        return result.add("error", std::string("client start failed"));
+    }
+
+    // Handshake, first heartbeat, jitter buffer and drift control settle
+    std::this_thread::sleep_for(std::chrono::seconds(warmup_s));
+
+    moonmic_stats_t client_start;
+    moonmic_get_stats(client, &client_start);
+    uint64_t host_packets_start = receiver.getStats()->packets_received;
+    double cpu_start = cpuSeconds();
+    auto start = Clock::now();
+    g_markers.setMeasuring(true);
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+
+    g_markers.setMeasuring(false);
+    double elapsed_s = elapsedUs(start, Clock::now()) / 1e6;
+    double cpu_s = cpuSeconds() - cpu_start;
+    moonmic_stats_t client_end;
+    moonmic_get_stats(client, &client_end);
+    std::shared_ptr<const AudioReceiver::Stats> host_stats = receiver.getStats();
+    const AudioReceiver::Stats& host = *host_stats;
+
+    moonmic_destroy(client);
+    receiver.stop();
+
+    std::vector<double> latencies = g_markers.latencies();
+    std::sort(latencies.begin(), latencies.end());
+    double avg = 0.0;
+    for (double l : latencies) avg += l;
+    avg = latencies.empty() ? 0.0 : avg / latencies.size();
+
+    JsonObject latency;
+    latency.add("markers", (uint64_t)latencies.size())
+           .add("lost", g_markers.lost())
+           .add("min_ms", latencies.empty() ? 0.0 : latencies.front())
+           .add("avg_ms", avg)
+           .add("p50_ms", percentile(latencies, 50))
+           .add("p90_ms", percentile(latencies, 90))
+           .add("p99_ms", percentile(latencies, 99))
+           .add("max_ms", latencies.empty() ? 0.0 : latencies.back());
+
+    result.add("seconds", elapsed_s)
+          .add("latency", latency)
+          .add("cpu_percent", elapsed_s > 0 ? 100.0 * cpu_s / elapsed_s : 0.0)
+          .add("packets_per_sec", elapsed_s > 0 ? (client_end.packets_sent - client_start.packets_sent) / elapsed_s : 0.0)
+          .add("host_datagrams_per_sec", elapsed_s > 0 ? (host.packets_received - host_packets_start) / elapsed_s : 0.0)
+          .add("host_jitter_lost", host.jitter_lost)
+          .add("host_buffer_ms", (int)client_end.buffer_ms);
+    return result;
+}
+
+int main(int argc, char** argv) {
+    int seconds = argInt(argc, argv, "--seconds", 10);
+    int warmup_s = argInt(argc, argv, "--warmup", 3);
+    int port = argInt(argc, argv, "--port", 48190);
+    std::string mode;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--mode") mode = argv[i + 1];
+    }
+
+    // Client and host log to stdout: keep it for the JSON result
+    fflush(stdout);
+    int json_fd = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    const Scenario scenarios[] = {
+        { "raw_5ms", "raw", 5, 1, MOONMIC_PROFILE_BALANCED, 20 },
+        { "raw_10ms", "raw", 10, 1, MOONMIC_PROFILE_BALANCED, 20 },
+        { "raw_20ms", "raw", 20, 1, MOONMIC_PROFILE_BALANCED, 20 },
+        { "opus_20ms", "opus", 10, 1, MOONMIC_PROFILE_BALANCED, 20 },
+        { "opus_40ms", "opus", 10, 2, MOONMIC_PROFILE_BALANCED, 20 },
+        { "opus_60ms", "opus", 10, 3, MOONMIC_PROFILE_BALANCED, 20 },
+        { "profile_ultra_low", "profile", 0, 1, MOONMIC_PROFILE_ULTRA_LOW, 5 },
+        { "profile_balanced", "profile", 0, 1, MOONMIC_PROFILE_BALANCED, 20 },
+        { "profile_bandwidth_saver", "profile", 0, 1, MOONMIC_PROFILE_BANDWIDTH_SAVER, 40 },
+    };
+    std::vector<JsonObject> results;
+    for (const Scenario& scenario : scenarios) {
+        if (!mode.empty() && mode != scenario.mode) {
+            continue;
+        }
+        results.push_back(runScenario(scenario, port, seconds, warmup_s));
+    }
+
+    std::cout.flush();
+    fflush(stdout);
+    dup2(json_fd, STDOUT_FILENO);
+    close(json_fd);
+
+    JsonObject out;
+    out.add("benchmark", std::string("e2e"))
+       .add("client_rate", CLIENT_RATE)
+       .add("marker_interval_ms", MARKER_INTERVAL_MS)
+       .add("scenarios", results);
+    std::cout << out.str() << std::endl;
+    return 0;
+}
@@ -0,0 +1,479 @@
+/**
+ * @file microbench.cpp
+ * @brief Per-call cost of the audio hot paths on both ends of the stream
+ *
+ * Cases (each timed in batches until --min-ms has elapsed; median and best
+ * batch reported):
+ *  - encode:   moonmic_opus_encoder_encode, 48kHz mono 64kbps with FEC, at
+ *              complexity 0/5/10 and 10/20/40/60ms frames
+ *  - profile:  the same encode with each latency profile's application,
+ *              complexity and frame size, at 48kHz and the Vita's 16kHz
+ *  - decode:   one 20ms packet through FFmpegDecoder vs. OpusDecoder (libopus)
+ *  - resample: speex 16k->48k and 48k->44.1k, one 20ms packet, quality 3 vs.
+ *              10 (ClientSession uses 10)
+ *  - chain:    a session's whole decode -> device-rate path for one 20ms packet,
+ *              before (FFmpeg at 48kHz + swr mono interleave + speex q10, plus
+ *              PortAudio's q3 when it resampled too) vs. after (decode at the
+ *              device rate + the session's one q10 resampler), for 48kHz,
+ *              44.1kHz and 16kHz devices; also reports group_delay_ms (summed
+ *              resampler latency) and the stage counts
+ *  - header:   moonmic_write_packet_header (client worker) and
+ *              ClientSession::parseHeader (host)
+ *  - classify: classifyPacket + header parse on the receive thread's traffic
+ *              mix (audio, PING, PONG, handshake, runt)
+ *
+ * Every case reports ns_per_op; audio cases also report ns_per_sample and
+ * stream_cpu_percent, the share of one core a single stream spends there.
+ * Logging goes to stderr, the JSON result to stdout.
+ *
+ * Usage: moonmic_microbench [--min-ms MS] [--batches N]
+ */
+
+#include "bench_util.h"
+#include "client_session.h"
+#include "ffmpeg_decoder.h"
+#include "opus_decoder.h"
+#include "packet_classifier.h"
+#include "moonmic_internal.h"
+#ifdef _WIN32
+#include "platform/windows/platform_config.h"
+#else
+#include "platform/linux/platform_config.h"
+#endif
+#include <speex/speex_resampler.h>
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libavutil/opt.h>
+#include <libswresample/swresample.h>
+}
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#define dup _dup
+#define dup2 _dup2
+#define STDOUT_FILENO 1
+#define STDERR_FILENO 2
+#else
+#include <unistd.h>
+#endif
+
+bool g_debug_mode = false;  // Normally defined in main.cpp
+
+using namespace moonmic;
+
+static const int SAMPLE_RATE = 48000;
+static const int BITRATE = 64000;
+static const int LOSS_PERC = 10;          // MOONMIC_DEFAULT_PACKET_LOSS_PERC
+static const int PACKET_MS = 20;
+
+static volatile uint64_t g_sink = 0;      // Keeps results observable
+
+struct CaseConfig {
+    int min_ms;
+    int batches;
+};
+
+/**
+ * @brief Time op() in batches; ops_per_batch is grown until a batch takes min_ms / batches
+ */
+static bench::JsonObject measure(const CaseConfig& config, const std::string& group, const std::string& name,
+                                 const std::function<void()>& op, double samples_per_op = 0.0,
+                                 double op_duration_us = 0.0) {
+    const double batch_us = config.min_ms * 1000.0 / config.batches;
+
+    // Warm up caches / codec state and size the batch
+    uint64_t ops_per_batch = 1;
+    for (;;) {
+        auto start = bench::Clock::now();
+        for (uint64_t i = 0; i < ops_per_batch; i++) op();
+        double us = bench::elapsedUs(start, bench::Clock::now());
+        if (us >= batch_us || ops_per_batch >= (1ull << 30)) break;
+        ops_per_batch *= us > 0.0 ? std::max<uint64_t>(2, (uint64_t)(batch_us / us)) : 16;
+    }
+
+    std::vector<double> ns_per_op;
+    for (int b = 0; b < config.batches; b++) {
+        auto start = bench::Clock::now();
+        for (uint64_t i = 0; i < ops_per_batch; i++) op();
+        ns_per_op.push_back(bench::elapsedUs(start, bench::Clock::now()) * 1000.0 / ops_per_batch);
+    }
+    std::sort(ns_per_op.begin(), ns_per_op.end());
+    const double median = ns_per_op[ns_per_op.size() / 2];
+
+    bench::JsonObject result;
+    result.add("group", group)
+          .add("name", name)
+          .add("ns_per_op", median)
+          .add("ns_per_op_best", ns_per_op.front())
+          .add("ops_per_batch", ops_per_batch);
+    if (samples_per_op > 0.0) {
+        result.add("ns_per_sample", median / samples_per_op);
+    }
+    if (op_duration_us > 0.0) {
+        result.add("stream_cpu_percent", median / (op_duration_us * 1000.0) * 100.0);
+    }
+    std::cerr << "[microbench] " << group << "/" << name << ": " << median << " ns/op" << std::endl;
+    return result;
+}
+
+// Voice-like test signal: two partials plus a little noise, so SILK/CELT both have work
+static std::vector<float> makeSignal(int rate, int frames) {
+    std::vector<float> pcm(frames);
+    uint32_t noise = 0x12345678;
+    for (int i = 0; i < frames; i++) {
+        noise ^= noise << 13;
+        noise ^= noise >> 17;
+        noise ^= noise << 5;
+        double t = (double)i / rate;
+        pcm[i] = (float)(0.3 * sin(2.0 * M_PI * 220.0 * t) + 0.1 * sin(2.0 * M_PI * 1760.0 * t) +
+                         0.02 * ((double)noise / 2147483648.0 - 1.0));
+    }
+    return pcm;
+}
+
+static void encodeCases(const CaseConfig& config, std::vector<bench::JsonObject>& results) {
+    const std::vector<float> signal = makeSignal(SAMPLE_RATE, SAMPLE_RATE);  // 1s, looped
+    uint8_t out[MOONMIC_OPUS_MAX_FRAME_BYTES * 3];
+
+    for (int complexity : { 0, 5, 10 }) {
+        for (int frame_ms : { 10, 20, 40, 60 }) {
+            moonmic_opus_encoder_t* enc = moonmic_opus_encoder_create(SAMPLE_RATE, 1, BITRATE, MOONMIC_OPUS_APP_AUDIO,
+                                                                      complexity, LOSS_PERC, false);
+            if (!enc) {
+                continue;
+            }
+            const int frame_size = SAMPLE_RATE * frame_ms / 1000;
+            size_t pos = 0;
+            auto op = [&]() {
+                if (pos + frame_size > signal.size()) pos = 0;
+                int bytes = moonmic_opus_encoder_encode(enc, signal.data() + pos, frame_size, out, sizeof(out));
+                pos += frame_size;
+                g_sink += (uint64_t)bytes;
+            };
+            results.push_back(measure(config, "encode",
+                                      "c" + std::to_string(complexity) + "_" + std::to_string(frame_ms) + "ms",
+                                      op, frame_size, frame_ms * 1000.0));
+            moonmic_opus_encoder_destroy(enc);
+        }
+    }
+}
+
+// Encoder settings of each moonmic_config_t::latency_profile (see moonmic_get_profile)
+static void profileCases(const CaseConfig& config, std::vector<bench::JsonObject>& results) {
+    struct Profile { const char* name; moonmic_opus_app_t application; int complexity; int frame_ms; };
+    const Profile profiles[] = {
+        { "ultra_low", MOONMIC_OPUS_APP_LOWDELAY, PLATFORM_LOWDELAY_COMPLEXITY, 5 },
+        { "balanced", MOONMIC_OPUS_APP_AUDIO, MOONMIC_DEFAULT_COMPLEXITY, 20 },
+        { "bandwidth_saver", MOONMIC_OPUS_APP_VOIP, MOONMIC_DEFAULT_COMPLEXITY, 40 },
+    };
+    uint8_t out[MOONMIC_OPUS_MAX_FRAME_BYTES * 3];
+
+    for (int rate : { SAMPLE_RATE, 16000 }) {
+        const std::vector<float> signal = makeSignal(rate, rate);
+        for (const Profile& profile : profiles) {
+            moonmic_opus_encoder_t* enc = moonmic_opus_encoder_create(rate, 1, BITRATE, profile.application,
+                                                                      profile.complexity, LOSS_PERC, false);
+            if (!enc) {
+                continue;
+            }
+            const int frame_size = rate * profile.frame_ms / 1000;
+            size_t pos = 0;
+            auto op = [&]() {
+                if (pos + frame_size > signal.size()) pos = 0;
+                int bytes = moonmic_opus_encoder_encode(enc, signal.data() + pos, frame_size, out, sizeof(out));
+                pos += frame_size;
+                g_sink += (uint64_t)bytes;
+            };
+            results.push_back(measure(config, "profile",
+                                      std::string(profile.name) + "_" + std::to_string(rate / 1000) + "k",
+                                      op, frame_size, profile.frame_ms * 1000.0));
+            moonmic_opus_encoder_destroy(enc);
+        }
+    }
+}
+
+// One second of 20ms 48kHz mono packets
+static std::vector<std::vector<uint8_t>> encodePackets() {
+    const int frame_size = SAMPLE_RATE * PACKET_MS / 1000;
+    const std::vector<float> signal = makeSignal(SAMPLE_RATE, SAMPLE_RATE);
+
+    std::vector<std::vector<uint8_t>> packets;
+    moonmic_opus_encoder_t* enc = moonmic_opus_encoder_create(SAMPLE_RATE, 1, BITRATE, MOONMIC_OPUS_APP_AUDIO,
+                                                              MOONMIC_DEFAULT_COMPLEXITY, LOSS_PERC, false);
+    if (!enc) {
+        return packets;
+    }
+    uint8_t buffer[MOONMIC_OPUS_MAX_FRAME_BYTES];
+    for (size_t pos = 0; pos + frame_size <= signal.size(); pos += frame_size) {
+        int bytes = moonmic_opus_encoder_encode(enc, signal.data() + pos, frame_size, buffer, sizeof(buffer));
+        if (bytes > 0) {
+            packets.emplace_back(buffer, buffer + bytes);
+        }
+    }
+    moonmic_opus_encoder_destroy(enc);
+    return packets;
+}
+
+static void decodeCases(const CaseConfig& config, std::vector<bench::JsonObject>& results) {
+    const int frame_size = SAMPLE_RATE * PACKET_MS / 1000;
+    const std::vector<std::vector<uint8_t>> packets = encodePackets();
+    if (packets.empty()) {
+        return;
+    }
+
+    std::vector<float> pcm(frame_size * 6);
+    {
+        FFmpegDecoder decoder;
+        if (decoder.init(SAMPLE_RATE, 1)) {
+            size_t i = 0;
+            results.push_back(measure(config, "decode", "ffmpeg_20ms", [&]() {
+                const auto& p = packets[i++ % packets.size()];
+                g_sink += (uint64_t)decoder.decode(p.data(), (int)p.size(), pcm.data(), (int)pcm.size());
+            }, frame_size, PACKET_MS * 1000.0));
+        }
+    }
+    {
+        moonmic::OpusDecoder decoder;
+        if (decoder.init(SAMPLE_RATE, 1)) {
+            size_t i = 0;
+            results.push_back(measure(config, "decode", "libopus_20ms", [&]() {
+                const auto& p = packets[i++ % packets.size()];
+                g_sink += (uint64_t)decoder.decode(p.data(), (int)p.size(), pcm.data(), (int)pcm.size());
+            }, frame_size, PACKET_MS * 1000.0));
+        }
+    }
+}
+
+static void resampleCases(const CaseConfig& config, std::vector<bench::JsonObject>& results) {
+    struct Conversion { int in_rate; int out_rate; const char* name; };
+    for (const Conversion& c : { Conversion{ 16000, 48000, "16k_to_48k" }, Conversion{ 48000, 44100, "48k_to_44k1" } }) {
+        const int in_frames = c.in_rate * PACKET_MS / 1000;
+        const std::vector<float> signal = makeSignal(c.in_rate, in_frames);
+        std::vector<float> out(c.out_rate * PACKET_MS / 1000 + 64);
+
+        for (int quality : { 3, 10 }) {
+            int err = 0;
+            SpeexResamplerState* rs = speex_resampler_init(1, c.in_rate, c.out_rate, quality, &err);
+            if (!rs || err != RESAMPLER_ERR_SUCCESS) {
+                continue;
+            }
+            auto op = [&]() {
+                spx_uint32_t in_len = (spx_uint32_t)in_frames;
+                spx_uint32_t out_len = (spx_uint32_t)out.size();
+                speex_resampler_process_interleaved_float(rs, signal.data(), &in_len, out.data(), &out_len);
+                g_sink += out_len;
+            };
+            results.push_back(measure(config, "resample", std::string(c.name) + "_q" + std::to_string(quality),
+                                      op, in_frames, PACKET_MS * 1000.0));
+            speex_resampler_destroy(rs);
+        }
+    }
+}
+
+// Per-packet decode -> device-rate path of one session, before and after decoding at the device rate
+static void chainCases(const CaseConfig& config, std::vector<bench::JsonObject>& results) {
+    const std::vector<std::vector<uint8_t>> packets = encodePackets();
+    if (packets.empty()) {
+        return;
+    }
+
+    struct Stage { int in_rate; int out_rate; int quality; };
+    struct Chain {
+        std::string name;
+        bool libopus;               // else FFmpegDecoder (always 48kHz out)
+        int decode_rate;
+        bool swr_interleave;        // The old FFmpegDecoder's planar mono -> interleaved swr pass
+        std::vector<Stage> stages;  // Speex resamplers in order
+    };
+    std::vector<Chain> chains;
+    for (int device_rate : { 48000, 44100, 16000 }) {
+        std::string dev = device_rate == 44100 ? "44k1" : std::to_string(device_rate / 1000) + "k";
+        int opus_rate = ClientSession::opusDecodeRate(device_rate);
+        chains.push_back({ "before_" + dev, false, 48000, true, { { 48000, device_rate, 10 } } });
+        if (device_rate != 48000) {
+            // resampling_rate pinned at 48kHz: the session stayed at 48kHz and PortAudio converted
+            chains.push_back({ "before_" + dev + "_pinned", false, 48000, true,
+                               { { 48000, 48000, 10 }, { 48000, device_rate, 3 } } });
+        }
+        chains.push_back({ "after_" + dev, true, opus_rate, false, { { opus_rate, device_rate, 10 } } });
+        chains.push_back({ "after_ffmpeg_" + dev, false, 48000, false, { { 48000, device_rate, 10 } } });
+    }
+
+    std::vector<float> pcm(SAMPLE_RATE * 120 / 1000);
+    std::vector<float> interleaved(pcm.size());
+    std::vector<float> stage_out[2] = { std::vector<float>(pcm.size() + 64), std::vector<float>(pcm.size() + 64) };
+
+    for (const Chain& chain : chains) {
+        FFmpegDecoder ffmpeg;
+        moonmic::OpusDecoder opus;
+        if (chain.libopus ? !opus.init(chain.decode_rate, 1) : !ffmpeg.init(chain.decode_rate, 1)) {
+            continue;
+        }
+
+        SwrContext* swr = nullptr;
+        if (chain.swr_interleave) {
+            AVChannelLayout mono = AV_CHANNEL_LAYOUT_MONO;
+            swr = swr_alloc();
+            av_opt_set_chlayout(swr, "in_chlayout", &mono, 0);
+            av_opt_set_int(swr, "in_sample_rate", chain.decode_rate, 0);
+            av_opt_set_sample_fmt(swr, "in_sample_fmt", AV_SAMPLE_FMT_FLTP, 0);
+            av_opt_set_chlayout(swr, "out_chlayout", &mono, 0);
+            av_opt_set_int(swr, "out_sample_rate", chain.decode_rate, 0);
+            av_opt_set_sample_fmt(swr, "out_sample_fmt", AV_SAMPLE_FMT_FLT, 0);
+            if (swr_init(swr) < 0) {
+                swr_free(&swr);
+                continue;
+            }
+        }
+
+        std::vector<SpeexResamplerState*> resamplers;
+        double group_delay_ms = 0.0;
+        for (const Stage& stage : chain.stages) {
+            int err = 0;
+            SpeexResamplerState* rs = speex_resampler_init(1, stage.in_rate, stage.out_rate, stage.quality, &err);
+            if (!rs || err != RESAMPLER_ERR_SUCCESS) {
+                break;
+            }
+            resamplers.push_back(rs);
+            group_delay_ms += speex_resampler_get_output_latency(rs) * 1000.0 / stage.out_rate;
+        }
+
+        if (resamplers.size() == chain.stages.size()) {
+            size_t i = 0;
+            auto op = [&]() {
+                const auto& p = packets[i++ % packets.size()];
+                int frames = chain.libopus ? opus.decode(p.data(), (int)p.size(), pcm.data(), (int)pcm.size())
+                                           : ffmpeg.decode(p.data(), (int)p.size(), pcm.data(), (int)pcm.size());
+                if (frames <= 0) {
+                    return;
+                }
+                const float* in = pcm.data();
+                if (swr) {
+                    const uint8_t* src[1] = { reinterpret_cast<const uint8_t*>(pcm.data()) };
+                    uint8_t* dst[1] = { reinterpret_cast<uint8_t*>(interleaved.data()) };
+                    frames = swr_convert(swr, dst, (int)interleaved.size(), src, frames);
+                    in = interleaved.data();
+                }
+                for (size_t s = 0; s < resamplers.size(); s++) {
+                    spx_uint32_t in_len = (spx_uint32_t)frames;
+                    spx_uint32_t out_len = (spx_uint32_t)stage_out[s % 2].size();
+                    speex_resampler_process_interleaved_float(resamplers[s], in, &in_len, stage_out[s % 2].data(), &out_len);
+                    in = stage_out[s % 2].data();
+                    frames = (int)out_len;
+                }
+                g_sink += (uint64_t)frames;
+            };
+            bench::JsonObject result = measure(config, "chain", chain.name, op,
+                                               chain.decode_rate * PACKET_MS / 1000.0, PACKET_MS * 1000.0);
+            result.add("decoder", std::string(chain.libopus ? "libopus" : "ffmpeg"))
+                  .add("decode_rate", chain.decode_rate)
+                  .add("swr_passes", chain.swr_interleave ? 1 : 0)
+                  .add("resamplers", (int)resamplers.size())
+                  .add("group_delay_ms", group_delay_ms);
+            results.push_back(result);
+        }
+
+        for (SpeexResamplerState* rs : resamplers) {
+            speex_resampler_destroy(rs);
+        }
+        if (swr) {
+            swr_free(&swr);
+        }
+    }
+}
+
+static void headerCases(const CaseConfig& config, std::vector<bench::JsonObject>& results) {
+    uint8_t packet[MOONMIC_HEADER_SIZE];
+    uint32_t sequence = 0;
+    uint64_t timestamp = 1000000;
+    results.push_back(measure(config, "header", "client_write", [&]() {
+        moonmic_write_packet_header(packet, sequence++, timestamp += 20000, SAMPLE_RATE | MOONMIC_RAW_FLAG);
+        g_sink += packet[4];
+    }));
+
+    ClientSession::AudioHeader header;
+    results.push_back(measure(config, "header", "host_parse", [&]() {
+        packet[4] = (uint8_t)sequence++;
+        ClientSession::parseHeader(packet, sizeof(packet), header);
+        g_sink += header.sequence;
+    }));
+}
+
+static void classifyCases(const CaseConfig& config, std::vector<bench::JsonObject>& results) {
+    // A streaming client's traffic: mostly audio, heartbeats every second, the odd handshake / runt
+    std::vector<std::vector<uint8_t>> traffic;
+    std::vector<uint8_t> audio(MOONMIC_HEADER_SIZE + 160);
+    moonmic_write_packet_header(audio.data(), 1, 1000000, SAMPLE_RATE);
+    std::vector<uint8_t> ping(PACKET_PING_SIZE), pong(PACKET_PING_SIZE), handshake(sizeof(MoonMicHandshake) + 16);
+    memcpy(ping.data(), &PACKET_MAGIC_PING, 4);
+    memcpy(pong.data(), &PACKET_MAGIC_PONG, 4);
+    memcpy(handshake.data(), &PACKET_MAGIC_HANDSHAKE, 4);
+    std::vector<uint8_t> runt(8, 0);
+
+    for (int i = 0; i < 100; i++) traffic.push_back(audio);
+    traffic[25] = ping;
+    traffic[50] = pong;
+    traffic[75] = handshake;
+    traffic[99] = runt;
+
+    const std::pair<const char*, std::vector<uint8_t>*> single[] = {
+        { "audio", &audio }, { "ping", &ping }, { "handshake", &handshake }, { "runt", &runt }
+    };
+    ClientSession::AudioHeader header;
+    for (const auto& entry : single) {
+        const std::vector<uint8_t>& p = *entry.second;
+        results.push_back(measure(config, "classify", entry.first, [&]() {
+            PacketKind kind = classifyPacket(p.data(), p.size());
+            if (kind == PacketKind::Audio) {
+                ClientSession::parseHeader(p.data(), p.size(), header);
+            }
+            g_sink += (uint64_t)kind + header.sequence;
+        }));
+    }
+
+    size_t i = 0;
+    results.push_back(measure(config, "classify", "mixed_traffic", [&]() {
+        const std::vector<uint8_t>& p = traffic[i++ % traffic.size()];
+        PacketKind kind = classifyPacket(p.data(), p.size());
+        if (kind == PacketKind::Audio) {
+            ClientSession::parseHeader(p.data(), p.size(), header);
+        }
+        g_sink += (uint64_t)kind + header.sequence;
+    }));
+}
+
+int main(int argc, char** argv) {
+    CaseConfig config;
+    config.min_ms = std::max(10, bench::argInt(argc, argv, "--min-ms", 500));
+    config.batches = std::max(1, bench::argInt(argc, argv, "--batches", 5));
+
+    // The encoder and decoders log to stdout: keep it for the JSON result
+    fflush(stdout);
+    int json_fd = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    std::vector<bench::JsonObject> results;
+    encodeCases(config, results);
+    profileCases(config, results);
+    decodeCases(config, results);
+    resampleCases(config, results);
+    chainCases(config, results);
+    headerCases(config, results);
+    classifyCases(config, results);
+
+    fflush(stdout);
+    dup2(json_fd, STDOUT_FILENO);
+
+    bench::JsonObject out;
+    out.add("benchmark", std::string("microbench"))
+       .add("min_ms", config.min_ms)
+       .add("batches", config.batches)
+       .add("cases", results);
+    std::cout << out.str() << std::endl;
+    return 0;
+}
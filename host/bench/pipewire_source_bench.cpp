@@ -0,0 +1,93 @@
+/**
+ * @file pipewire_source_bench.cpp
+ * @brief Feeds the PipeWire Audio/Source node in mixer-sized ticks
+ *
+ * Writes a sine into VirtualDevicePipeWire every --tick ms (the mix thread's
+ * cadence) and samples getLatencyMs() after each write. Reports average and
+ * worst-case latency plus underruns seen by the process callback.
+ *
+ * The node stays PAUSED until something records from it, so run a consumer.
+ * A private daemon needs no sound hardware - without a card the graph is
+ * clocked by PipeWire's built-in Dummy-Driver node:
+ *
+ *   export XDG_RUNTIME_DIR=$(mktemp -d)
+ *   pipewire &
+ *   wireplumber &                        # links the recorder to the node
+ *   pw-record --target moonmic-mic /dev/null &
+ *   pipewire_source_bench --seconds 10 --latency 40 --prebuf 20
+ *
+ * Usage: pipewire_source_bench [--seconds S] [--rate HZ] [--channels N]
+ *                              [--latency MS] [--prebuf MS] [--tick MS]
+ */
+
+#include "bench_util.h"
+#include "platform/linux/virtual_device_pipewire.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace moonmic;
+
+int main(int argc, char** argv) {
+    const int seconds = bench::argInt(argc, argv, "--seconds", 10);
+    const int rate = bench::argInt(argc, argv, "--rate", 0);  // 0 = graph rate
+    const int channels = bench::argInt(argc, argv, "--channels", 2);
+    const int latency_ms = bench::argInt(argc, argv, "--latency", 40);
+    const int prebuf_ms = bench::argInt(argc, argv, "--prebuf", 20);
+    const int tick_ms = bench::argInt(argc, argv, "--tick", 10);
+
+    VirtualDevicePipeWire device;
+    device.setBufferTargets(latency_ms, prebuf_ms);
+    if (!device.init("", rate, channels)) {
+        std::cerr << "pipewire_source_bench: no PipeWire daemon / stream failed" << std::endl;
+        return 1;
+    }
+
+    const int device_rate = device.getSampleRate();
+    const size_t frames = (size_t)device_rate * tick_ms / 1000;
+    std::vector<float> block(frames * channels);
+    double phase = 0.0;
+    const double step = 2.0 * M_PI * 440.0 / device_rate;
+
+    double latency_sum = 0.0;
+    double latency_max = 0.0;
+    uint64_t samples = 0;
+
+    auto next = bench::Clock::now();
+    auto deadline = next + std::chrono::seconds(seconds);
+    while (bench::Clock::now() < deadline) {
+        for (size_t i = 0; i < frames; i++) {
+            float v = 0.25f * (float)std::sin(phase);
+            phase += step;
+            for (int c = 0; c < channels; c++) {
+                block[i * channels + c] = v;
+            }
+        }
+        device.write(block.data(), frames, channels);
+
+        double latency = device.getLatencyMs();
+        latency_sum += latency;
+        latency_max = std::max(latency_max, latency);
+        samples++;
+
+        next += std::chrono::milliseconds(tick_ms);
+        std::this_thread::sleep_until(next);
+    }
+
+    const uint64_t underruns = device.getUnderruns();
+    device.close();
+
+    bench::JsonObject out;
+    out.add("benchmark", std::string("pipewire_source_bench"))
+       .add("seconds", seconds)
+       .add("sample_rate", device_rate)
+       .add("channels", channels)
+       .add("latency_target_ms", latency_ms)
+       .add("prebuf_ms", prebuf_ms)
+       .add("avg_latency_ms", samples ? latency_sum / samples : 0.0)
+       .add("max_latency_ms", latency_max)
+       .add("underruns", underruns);
+    std::cout << out.str() << std::endl;
+    return 0;
+}
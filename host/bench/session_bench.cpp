@@ -0,0 +1,172 @@
+/**
+ * @file session_bench.cpp
+ * @brief How many concurrent clients one core can decode and mix in real time
+ *
+ * Each iteration feeds one 20ms Opus packet to every ClientSession (jitter
+ * buffer, libopus decode, FIFO) and mixes one 20ms period, all on the calling
+ * thread. A client count is sustainable while a tick costs less than 20ms.
+ *
+ * Usage: session_bench [--max-clients N] [--seconds S] [--bitrate BPS]
+ */
+
+#include "bench_util.h"
+#include "audio_mixer.h"
+#include "client_session.h"
+#include "packet_slab.h"
+#include <opus/opus.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+bool g_debug_mode = false;  // Normally defined in main.cpp
+
+using namespace moonmic;
+
+static const int SAMPLE_RATE = 48000;
+static const int FRAME_SIZE = SAMPLE_RATE / 50;  // 20ms
+static const double TICK_US = 20000.0;
+
+// Little-endian moonmic header, as clients write it
+static void writeHeader(uint8_t* out, uint32_t sequence, uint64_t timestamp, uint32_t sample_rate) {
+    const uint32_t magic = 0x4D4D4943;  // "MMIC"
+    for (int i = 0; i < 4; i++) out[i] = (uint8_t)(magic >> (8 * i));
+    for (int i = 0; i < 4; i++) out[4 + i] = (uint8_t)(sequence >> (8 * i));
+    for (int i = 0; i < 8; i++) out[8 + i] = (uint8_t)(timestamp >> (8 * i));
+    for (int i = 0; i < 4; i++) out[16 + i] = (uint8_t)(sample_rate >> (8 * i));
+}
+
+struct EncodedPacket {
+    std::vector<uint8_t> data;
+};
+
+// One second of speech-band test signal, encoded the way clients send it
+static std::vector<EncodedPacket> encodeTestSignal(int bitrate) {
+    std::vector<EncodedPacket> packets;
+    int err = 0;
+    ::OpusEncoder* enc = opus_encoder_create(SAMPLE_RATE, 1, OPUS_APPLICATION_VOIP, &err);
+    if (err != OPUS_OK) {
+        std::cerr << "opus_encoder_create failed: " << opus_strerror(err) << std::endl;
+        return packets;
+    }
+    opus_encoder_ctl(enc, OPUS_SET_BITRATE(bitrate));
+    opus_encoder_ctl(enc, OPUS_SET_INBAND_FEC(1));
+    opus_encoder_ctl(enc, OPUS_SET_PACKET_LOSS_PERC(10));
+
+    std::vector<float> pcm(FRAME_SIZE);
+    uint8_t buffer[1500];
+    for (int p = 0; p < 50; p++) {
+        for (int i = 0; i < FRAME_SIZE; i++) {
+            double t = (double)(p * FRAME_SIZE + i) / SAMPLE_RATE;
+            pcm[i] = (float)(0.3 * sin(2.0 * M_PI * 220.0 * t) + 0.1 * sin(2.0 * M_PI * 1760.0 * t));
+        }
+        int bytes = opus_encode_float(enc, pcm.data(), FRAME_SIZE, buffer, sizeof(buffer));
+        if (bytes > 0) {
+            packets.push_back({std::vector<uint8_t>(buffer, buffer + bytes)});
+        }
+    }
+    opus_encoder_destroy(enc);
+    return packets;
+}
+
+// Average cost of one 20ms tick with `clients` sessions
+static double measureTick(int clients, int ticks, const std::vector<EncodedPacket>& packets) {
+    AudioMixer mixer;
+    mixer.setFormat(SAMPLE_RATE, 1);
+
+    ClientSession::Params params;
+    params.channels = 1;
+    params.decoder_rate = SAMPLE_RATE;
+    params.output_rate = SAMPLE_RATE;
+    params.enable_fec = true;
+
+    // Room for every session's jitter buffer plus the packet in flight
+    PacketSlab slab((size_t)clients * 16 + 16);
+
+    std::vector<std::unique_ptr<ClientSession>> sessions;
+    for (int i = 0; i < clients; i++) {
+        sessions.push_back(std::make_unique<ClientSession>(
+            (uint32_t)i, "127.0.0.1", (uint16_t)(50000 + i), params, mixer.addSource(200, 40)));
+    }
+
+    std::vector<float> out(FRAME_SIZE);
+    auto virtual_now = ClientSession::Clock::now();  // Packets arrive exactly on time
+    double total_us = 0.0;
+
+    for (int t = 0; t < ticks; t++) {
+        const EncodedPacket& packet = packets[t % packets.size()];
+        uint64_t timestamp = (uint64_t)t * 20000;
+
+        auto start = bench::Clock::now();
+        for (auto& session : sessions) {
+            // Same work the receive thread does: fill a slab slot, hand it over
+            PacketRef slot = slab.acquire();
+            writeHeader(slot->data, (uint32_t)t, timestamp, SAMPLE_RATE);
+            memcpy(slot->data + 20, packet.data.data(), packet.data.size());
+            slot->size = 20 + packet.data.size();
+            slot->arrival = virtual_now;
+            session->onAudioPacket(std::move(slot));
+        }
+        mixer.mix(out.data(), FRAME_SIZE);
+        auto end = bench::Clock::now();
+
+        // First ticks prime the jitter buffers and FIFOs
+        if (t >= 10) {
+            total_us += bench::elapsedUs(start, end);
+        }
+        virtual_now += std::chrono::milliseconds(20);
+    }
+
+    return total_us / (ticks - 10);
+}
+
+int main(int argc, char** argv) {
+    int max_clients = bench::argInt(argc, argv, "--max-clients", 256);
+    int seconds = bench::argInt(argc, argv, "--seconds", 3);
+    int bitrate = bench::argInt(argc, argv, "--bitrate", 32000);
+    int ticks = std::max(20, seconds * 50);
+
+    auto packets = encodeTestSignal(bitrate);
+    if (packets.empty()) {
+        return 1;
+    }
+
+    std::vector<bench::JsonObject> results;
+    int sustained = 0;
+    for (int clients = 1; clients <= max_clients; clients *= 2) {
+        double tick_us = measureTick(clients, ticks, packets);
+        double load = tick_us / TICK_US;
+        results.push_back(bench::JsonObject()
+            .add("clients", clients)
+            .add("us_per_tick", tick_us)
+            .add("us_per_client", tick_us / clients)
+            .add("core_load", load));
+        if (load >= 1.0) {
+            break;
+        }
+        sustained = clients;
+    }
+
+    // Refine between the last sustainable power of two and the first that wasn't
+    int lo = sustained;
+    int hi = std::min(sustained * 2, max_clients + 1);
+    while (lo > 0 && hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (measureTick(mid, ticks, packets) < TICK_US) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    sustained = lo;
+
+    std::cout << bench::JsonObject()
+        .add("bench", std::string("session_scaling"))
+        .add("tick_ms", 20)
+        .add("bitrate", bitrate)
+        .add("results", results)
+        .add("max_clients_per_core", sustained)
+        .str() << std::endl;
+    return 0;
+}
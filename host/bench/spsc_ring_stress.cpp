@@ -0,0 +1,192 @@
+/**
+ * @file spsc_ring_stress.cpp
+ * @brief Stress test for SpscRing: producer and consumer at full speed
+ *
+ * The producer writes a running sample counter in random-sized blocks, the
+ * consumer drains it in callback-sized blocks and checks every value is the
+ * next one expected - a torn read, a duplicate or a lost sample fails the
+ * run. Consumer call durations (p50/p99/p99.9/max) are reported next to a
+ * replica of the previous PortAudio ring, whose writer held the lock for a
+ * per-sample copy loop, so blocking of the realtime side shows up as a
+ * latency spike.
+ *
+ * Usage: spsc_ring_stress [--seconds S] [--capacity SAMPLES] [--block SAMPLES]
+ * Exit code is non-zero if any ordering error was detected. Timings are
+ * reported only (p999_vs_mutex compares the two rings from the same run):
+ * on a loaded or single-core machine preemption dominates both tails.
+ */
+
+#include "bench_util.h"
+#include "platform/spsc_ring.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace moonmic;
+
+// Counter wraps below 2^24 so every value is exact as a float
+static const uint32_t COUNTER_MODULO = 1u << 24;
+
+/**
+ * @brief The old VirtualDevicePortAudio ring: one lock shared by both sides
+ *
+ * Same critical sections as before: write() copies sample by sample with a
+ * modulo and a full check under the lock, and the callback side converts
+ * under the same lock, so it waits out whole producer blocks.
+ */
+class MutexRing {
+public:
+    explicit MutexRing(size_t capacity) : buffer_(capacity + 1), scratch_(capacity) {}
+
+    size_t write(const float* data, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t write_pos = write_pos_;
+        const size_t size = buffer_.size();
+        size_t written = 0;
+        for (; written < count; written++) {
+            size_t next = (write_pos + 1) % size;
+            if (next == read_pos_) {
+                break;  // Overflow
+            }
+            buffer_[write_pos] = data[written];
+            write_pos = next;
+        }
+        write_pos_ = write_pos;
+        return written;
+    }
+
+    template <typename Fn>
+    size_t consume(size_t count, Fn&& fn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t read_pos = read_pos_;
+        const size_t size = buffer_.size();
+        size_t n = 0;
+        while (n < count && n < scratch_.size() && read_pos != write_pos_) {
+            scratch_[n++] = buffer_[read_pos];
+            read_pos = (read_pos + 1) % size;
+        }
+        read_pos_ = read_pos;
+        if (n > 0) {
+            fn(scratch_.data(), n);
+        }
+        return n;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<float> buffer_;   // One slot kept free to tell full from empty
+    std::vector<float> scratch_;  // Stands in for the device's output buffer
+    size_t read_pos_ = 0;
+    size_t write_pos_ = 0;
+};
+
+struct StressResult {
+    uint64_t samples = 0;
+    uint64_t errors = 0;
+    uint64_t reads = 0;
+    double max_read_us = 0.0;
+    double avg_read_us = 0.0;
+    double p50_read_us = 0.0;
+    double p99_read_us = 0.0;
+    double p999_read_us = 0.0;
+};
+
+static double percentile(const std::vector<float>& sorted, double p) {
+    return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * p / 100.0))];
+}
+
+template <typename Ring>
+static StressResult runStress(Ring& ring, int seconds, size_t block) {
+    std::atomic<bool> running{true};
+    StressResult result;
+
+    std::thread producer([&]() {
+        std::mt19937 rng(1234);
+        std::uniform_int_distribution<size_t> sizes(1, block * 2);
+        std::vector<float> chunk(block * 2);
+        uint32_t next = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            size_t n = sizes(rng);
+            for (size_t i = 0; i < n; i++) {
+                chunk[i] = (float)((next + i) % COUNTER_MODULO);
+            }
+            size_t written = ring.write(chunk.data(), n);
+            next = (uint32_t)((next + written) % COUNTER_MODULO);
+        }
+    });
+
+    uint32_t expected = 0;
+    double total_us = 0.0;
+    std::vector<float> read_us;
+    read_us.reserve((size_t)seconds * 1000000);
+    auto deadline = bench::Clock::now() + std::chrono::seconds(seconds);
+    while (bench::Clock::now() < deadline) {
+        auto start = bench::Clock::now();
+        size_t got = ring.consume(block, [&](const float* data, size_t n) {
+            for (size_t i = 0; i < n; i++) {
+                if ((uint32_t)data[i] != expected) {
+                    result.errors++;
+                    expected = (uint32_t)data[i];  // Resync so one fault counts once
+                }
+                expected = (expected + 1) % COUNTER_MODULO;
+            }
+        });
+        double us = bench::elapsedUs(start, bench::Clock::now());
+        if (got > 0) {
+            result.samples += got;
+            result.reads++;
+            total_us += us;
+            result.max_read_us = std::max(result.max_read_us, us);
+            read_us.push_back((float)us);
+        }
+    }
+
+    running = false;
+    producer.join();
+    result.avg_read_us = result.reads ? total_us / result.reads : 0.0;
+    std::sort(read_us.begin(), read_us.end());
+    result.p50_read_us = percentile(read_us, 50.0);
+    result.p99_read_us = percentile(read_us, 99.0);
+    result.p999_read_us = percentile(read_us, 99.9);
+    return result;
+}
+
+static bench::JsonObject toJson(const StressResult& r, int seconds) {
+    bench::JsonObject obj;
+    obj.add("samples", r.samples)
+       .add("samples_per_sec", (double)r.samples / seconds)
+       .add("ordering_errors", r.errors)
+       .add("avg_read_us", r.avg_read_us)
+       .add("p50_read_us", r.p50_read_us)
+       .add("p99_read_us", r.p99_read_us)
+       .add("p999_read_us", r.p999_read_us)
+       .add("max_read_us", r.max_read_us);
+    return obj;
+}
+
+int main(int argc, char** argv) {
+    const int seconds = bench::argInt(argc, argv, "--seconds", 5);
+    const size_t capacity = (size_t)bench::argInt(argc, argv, "--capacity", 7680);   // 80ms 48k stereo (PortAudio ring, 40ms target)
+    const size_t block = (size_t)bench::argInt(argc, argv, "--block", 960);          // 10ms 48k stereo
+
+    SpscRing<float> spsc(capacity);
+    StressResult lock_free = runStress(spsc, seconds, block);
+
+    MutexRing locked(capacity);
+    StressResult mutex = runStress(locked, seconds, block);
+
+    bench::JsonObject out;
+    out.add("benchmark", std::string("spsc_ring_stress"))
+       .add("seconds", seconds)
+       .add("capacity", (int)capacity)
+       .add("block", (int)block)
+       .add("spsc", toJson(lock_free, seconds))
+       .add("mutex", toJson(mutex, seconds))
+       .add("p999_vs_mutex", mutex.p999_read_us > 0.0 ? lock_free.p999_read_us / mutex.p999_read_us : 0.0);
+    std::cout << out.str() << std::endl;
+
+    return (lock_free.errors == 0 && mutex.errors == 0) ? 0 : 1;
+}
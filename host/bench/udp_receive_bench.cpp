@@ -0,0 +1,196 @@
+/**
+ * @file udp_receive_bench.cpp
+ * @brief Receive-loop throughput: legacy per-packet path vs. slab + recvmmsg
+ *
+ * Each round queues a burst of datagrams on a loopback socket (untimed), then
+ * times how long the receive path takes to drain and dispatch them.
+ *
+ *   legacy  - recvfrom into a stack buffer, inet_ntop, std::string,
+ *             ioctl(FIONREAD) and a std::function call per datagram
+ *             (UDPReceiver before the packet slab)
+ *   single  - UDPReceiver, one recvfrom per datagram into slab slots
+ *   batched - UDPReceiver, recvmmsg into slab slots
+ *
+ * Usage: udp_receive_bench [--port P] [--burst N] [--rounds R] [--size BYTES]
+ */
+
+#include "bench_util.h"
+#include "udp_receiver.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <functional>
+
+using namespace moonmic;
+
+struct Options {
+    int port;
+    int burst;
+    int rounds;
+    int size;
+};
+
+struct RoundResult {
+    uint64_t packets = 0;
+    double us = 0.0;
+};
+
+static int openSender() {
+    return socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+}
+
+static void sendBurst(int fd, int port, int count, int size) {
+    struct sockaddr_in dest;
+    memset(&dest, 0, sizeof(dest));
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(port);
+    dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    std::vector<uint8_t> packet(size, 0);
+    memcpy(packet.data(), "CIMM", 4);  // MMIC little-endian
+    for (int i = 0; i < count; i++) {
+        memcpy(packet.data() + 4, &i, sizeof(i));
+        sendto(fd, packet.data(), packet.size(), 0, (struct sockaddr*)&dest, sizeof(dest));
+    }
+}
+
+// The receive loop as it was before the packet slab
+static RoundResult runLegacy(const Options& opt) {
+    int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    int rcvbuf = 1 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct timeval timeout = {0, UDPReceiver::RECV_TIMEOUT_MS * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        std::cerr << "bind failed on port " << opt.port << std::endl;
+        close(fd);
+        return RoundResult();
+    }
+
+    uint64_t bytes_seen = 0;
+    std::function<void(const uint8_t*, size_t, const std::string&, uint16_t)> callback =
+        [&bytes_seen](const uint8_t* data, size_t size, const std::string& ip, uint16_t port) {
+            bytes_seen += size + data[0] + ip.size() + port;
+        };
+
+    int sender = openSender();
+    RoundResult total;
+    for (int r = 0; r < opt.rounds; r++) {
+        sendBurst(sender, opt.port, opt.burst, opt.size);
+
+        uint64_t received_count = 0;
+        auto start = bench::Clock::now();
+        auto last = start;
+        while (received_count < (uint64_t)opt.burst) {
+            uint8_t buffer[4096];
+            struct sockaddr_in sender_addr;
+            socklen_t sender_len = sizeof(sender_addr);
+            int received = recvfrom(fd, (char*)buffer, sizeof(buffer), 0,
+                                    (struct sockaddr*)&sender_addr, &sender_len);
+            if (received < 0) {
+                break;  // Timeout: the kernel dropped part of the burst
+            }
+
+            int pending = 0;
+            ioctl(fd, FIONREAD, &pending);
+
+            char sender_ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &sender_addr.sin_addr, sender_ip, INET_ADDRSTRLEN);
+            uint16_t sender_port = ntohs(sender_addr.sin_port);
+            callback(buffer, received, std::string(sender_ip), sender_port);
+
+            received_count++;
+            last = bench::Clock::now();
+        }
+        total.packets += received_count;
+        total.us += bench::elapsedUs(start, last);
+    }
+
+    close(sender);
+    close(fd);
+    return total;
+}
+
+static RoundResult runReceiver(const Options& opt, size_t batch_size) {
+    UDPReceiver receiver;
+    receiver.setBatchSize(batch_size);
+
+    uint64_t received_count = 0;
+    uint64_t bytes_seen = 0;
+    receiver.setPacketCallback([&](PacketRef packet) {
+        bytes_seen += packet.size() + packet.data()[0];
+        received_count++;
+    });
+
+    if (!receiver.open(opt.port, "127.0.0.1")) {
+        return RoundResult();
+    }
+
+    int sender = openSender();
+    RoundResult total;
+    for (int r = 0; r < opt.rounds; r++) {
+        sendBurst(sender, opt.port, opt.burst, opt.size);
+
+        received_count = 0;
+        auto start = bench::Clock::now();
+        auto last = start;
+        while (received_count < (uint64_t)opt.burst) {
+            int n = receiver.receiveOnce();
+            if (n <= 0) {
+                break;  // Timeout: the kernel dropped part of the burst
+            }
+            last = bench::Clock::now();
+        }
+        total.packets += received_count;
+        total.us += bench::elapsedUs(start, last);
+    }
+
+    close(sender);
+    receiver.stop();
+    return total;
+}
+
+static bench::JsonObject report(const char* mode, const RoundResult& r) {
+    double pps = (r.us > 0.0) ? r.packets * 1e6 / r.us : 0.0;
+    return bench::JsonObject()
+        .add("mode", std::string(mode))
+        .add("packets", (int)r.packets)
+        .add("packets_per_sec", pps)
+        .add("ns_per_packet", (r.packets > 0) ? r.us * 1000.0 / r.packets : 0.0);
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    opt.port = bench::argInt(argc, argv, "--port", 48199);
+    opt.burst = bench::argInt(argc, argv, "--burst", 512);
+    opt.rounds = bench::argInt(argc, argv, "--rounds", 200);
+    opt.size = std::max(20, bench::argInt(argc, argv, "--size", 120));
+
+    RoundResult legacy = runLegacy(opt);
+    RoundResult single = runReceiver(opt, 1);
+    RoundResult batched = runReceiver(opt, UDPReceiver::BATCH_SIZE);
+
+    double legacy_ns = legacy.packets ? legacy.us / legacy.packets : 0.0;
+    double batched_ns = batched.packets ? batched.us / batched.packets : 0.0;
+
+    std::cout << bench::JsonObject()
+        .add("bench", std::string("udp_receive"))
+        .add("burst", opt.burst)
+        .add("rounds", opt.rounds)
+        .add("datagram_bytes", opt.size)
+        .add("results", std::vector<bench::JsonObject>{
+            report("legacy", legacy), report("single", single), report("batched", batched)})
+        .add("speedup_batched_vs_legacy", batched_ns > 0.0 ? legacy_ns / batched_ns : 0.0)
+        .str() << std::endl;
+    return 0;
+}
@@ -0,0 +1,237 @@
+/**
+ * @file audio_mixer.cpp
+ * @brief Multi-client mixer implementation
+ */
+
+#include "audio_mixer.h"
+#include "../../dsp/moonmic_dsp.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace moonmic {
+
+// ============================================================================
+// MixSource
+// ============================================================================
+
+MixSource::MixSource(size_t capacity_frames, size_t target_frames, int channels)
+    : buffer_(capacity_frames * channels)
+    , capacity_(capacity_frames)
+    , target_(std::min(target_frames, capacity_frames))
+    , channels_(channels) {
+}
+
+void MixSource::write(const float* data, size_t frames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (frames > capacity_) {
+        // Only the newest audio fits
+        data += (frames - capacity_) * channels_;
+        frames = capacity_;
+    }
+
+    // Overflow: drop the oldest audio to cap latency
+    if (count_ + frames > capacity_) {
+        size_t excess = count_ + frames - capacity_;
+        read_pos_ = (read_pos_ + excess) % capacity_;
+        count_ -= excess;
+    }
+
+    size_t write_pos = (read_pos_ + count_) % capacity_;
+    size_t first = std::min(frames, capacity_ - write_pos);
+    memcpy(&buffer_[write_pos * channels_], data, first * channels_ * sizeof(float));
+    if (frames > first) {
+        memcpy(&buffer_[0], data + first * channels_, (frames - first) * channels_ * sizeof(float));
+    }
+    count_ += frames;
+
+    if (!primed_ && count_ >= target_) {
+        primed_ = true;
+        noise_rms_ = 0.0f;  // Sender is back
+    }
+}
+
+size_t MixSource::read(float* out, size_t frames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    demand_frames_ += frames;
+
+    if (!primed_) {
+        if (noise_rms_ <= 0.0f) {
+            return 0;
+        }
+        fillNoise(out, frames);
+        return frames;
+    }
+
+    size_t n = std::min(frames, count_);
+    size_t first = std::min(n, capacity_ - read_pos_);
+    memcpy(out, &buffer_[read_pos_ * channels_], first * channels_ * sizeof(float));
+    if (n > first) {
+        memcpy(out + first * channels_, &buffer_[0], (n - first) * channels_ * sizeof(float));
+    }
+    read_pos_ = (read_pos_ + n) % capacity_;
+    count_ -= n;
+
+    // Ran dry: re-prime before mixing again instead of stuttering packet by packet.
+    // In DTX that is expected - the tail of the last real audio blends into noise.
+    if (n < frames) {
+        primed_ = false;
+        if (noise_rms_ > 0.0f) {
+            fillNoise(out + n * channels_, frames - n);
+            return frames;
+        }
+        underruns_++;
+    }
+
+    return n;
+}
+
+void MixSource::setComfortNoise(float rms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    noise_rms_ = std::max(0.0f, rms);
+}
+
+void MixSource::fillNoise(float* out, size_t frames) {
+    // Uniform white noise; sqrt(3) scales [-1, 1) to unit RMS
+    const float scale = noise_rms_ * std::sqrt(3.0f) / 2147483648.0f;
+    for (size_t i = 0; i < frames * channels_; i++) {
+        noise_state_ ^= noise_state_ << 13;
+        noise_state_ ^= noise_state_ >> 17;
+        noise_state_ ^= noise_state_ << 5;
+        out[i] = (float)(int32_t)noise_state_ * scale;
+    }
+}
+
+void MixSource::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    read_pos_ = 0;
+    count_ = 0;
+    primed_ = false;
+    noise_rms_ = 0.0f;
+}
+
+void MixSource::setFormat(size_t capacity_frames, size_t target_frames, int channels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffer_.assign(capacity_frames * channels, 0.0f);
+    capacity_ = capacity_frames;
+    target_ = std::min(target_frames, capacity_frames);
+    channels_ = channels;
+    read_pos_ = 0;
+    count_ = 0;
+    primed_ = false;
+    noise_rms_ = 0.0f;
+}
+
+size_t MixSource::getCapacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity_;
+}
+
+size_t MixSource::getTarget() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return target_;
+}
+
+size_t MixSource::available() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+}
+
+float MixSource::getUsage() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (target_ == 0) return 0.0f;
+    return std::min(1.0f, (float)count_ / (float)(target_ * 2));
+}
+
+uint64_t MixSource::getUnderruns() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return underruns_;
+}
+
+uint64_t MixSource::getDemandFrames() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return demand_frames_;
+}
+
+// ============================================================================
+// AudioMixer
+// ============================================================================
+
+AudioMixer::AudioMixer() = default;
+
+void AudioMixer::setFormat(int sample_rate, int channels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int old_rate = sample_rate_.load(std::memory_order_relaxed);
+    sample_rate_ = sample_rate;
+    channels_ = channels;
+
+    // Sources hold audio at the old rate - flush them, and keep their capacity and
+    // prime target in milliseconds (sized in frames of the old rate)
+    for (auto& source : sources_) {
+        if (old_rate <= 0 || sample_rate <= 0) {
+            source->clear();
+            continue;
+        }
+        source->setFormat((size_t)((uint64_t)source->getCapacity() * sample_rate / old_rate),
+                          (size_t)((uint64_t)source->getTarget() * sample_rate / old_rate),
+                          channels);
+    }
+}
+
+std::shared_ptr<MixSource> AudioMixer::addSource(int capacity_ms, int target_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int rate = sample_rate_.load(std::memory_order_relaxed);
+    auto source = std::make_shared<MixSource>(
+        (size_t)rate * capacity_ms / 1000,
+        (size_t)rate * target_ms / 1000,
+        channels_.load(std::memory_order_relaxed));
+    sources_.push_back(source);
+    return source;
+}
+
+void AudioMixer::removeSource(const std::shared_ptr<MixSource>& source) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sources_.erase(std::remove(sources_.begin(), sources_.end(), source), sources_.end());
+}
+
+size_t AudioMixer::getSourceCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sources_.size();
+}
+
+size_t AudioMixer::mix(float* out, size_t frames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const size_t channels = (size_t)channels_.load(std::memory_order_relaxed);
+    const size_t samples = frames * channels;
+    if (scratch_.size() < samples) {
+        scratch_.resize(samples);
+    }
+
+    size_t active = 0;
+    for (auto& source : sources_) {
+        // First source reads straight into the output, the rest are summed in
+        float* dst = (active == 0) ? out : scratch_.data();
+        size_t got = source->read(dst, frames);
+        if (got == 0) {
+            continue;
+        }
+        if (got < frames) {
+            memset(dst + got * channels, 0, (frames - got) * channels * sizeof(float));
+        }
+        if (active > 0) {
+            moonmic_dsp_mix_add(out, scratch_.data(), samples);
+        }
+        active++;
+    }
+
+    // A single client passes through untouched; sums can exceed full scale
+    if (active > 1) {
+        moonmic_dsp_clamp(out, samples);
+    }
+
+    return active;
+}
+
+} // namespace moonmic
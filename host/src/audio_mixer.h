@@ -0,0 +1,133 @@
+/**
+ * @file audio_mixer.h
+ * @brief Mixes decoded client streams into the single VirtualDevice
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace moonmic {
+
+/**
+ * @brief Per-client FIFO of decoded audio at the device rate
+ *
+ * Written by the session's decode worker, drained by the mix thread.
+ * On overflow the oldest audio is discarded so latency stays bounded.
+ */
+class MixSource {
+public:
+    /**
+     * @param capacity_frames FIFO size in frames
+     * @param target_frames Fill level the source primes to before it is mixed
+     * @param channels Interleaved channel count
+     */
+    MixSource(size_t capacity_frames, size_t target_frames, int channels);
+
+    void write(const float* data, size_t frames);
+
+    /**
+     * @brief Read up to @p frames frames
+     * @return Frames copied (0 while the source is still priming; always
+     *         @p frames while comfort noise is on)
+     */
+    size_t read(float* out, size_t frames);
+
+    void clear();
+
+    /**
+     * @brief Resize for a new device format; drops buffered audio and primes again
+     * @param capacity_frames FIFO size in frames at the new rate
+     * @param target_frames Prime level at the new rate
+     * @param channels Interleaved channel count
+     */
+    void setFormat(size_t capacity_frames, size_t target_frames, int channels);
+
+    size_t getCapacity() const;
+    size_t getTarget() const;
+
+    /**
+     * @brief Play comfort noise at @p rms while the source has no audio (sender in DTX)
+     * Reads are filled with noise instead of running dry; the next write that
+     * primes the source switches it off again. 0 = off.
+     */
+    void setComfortNoise(float rms);
+
+    size_t available() const;
+
+    /**
+     * @brief Fill level relative to target (0.5 = at target)
+     * Same scale as VirtualDevice::getBufferUsage so the drift controller can use either.
+     */
+    float getUsage() const;
+
+    uint64_t getUnderruns() const;
+
+    /**
+     * @brief Frames the mixer has asked for so far (the device's consumption, in source frames)
+     */
+    uint64_t getDemandFrames() const;
+
+private:
+    void fillNoise(float* out, size_t frames);
+
+    mutable std::mutex mutex_;
+    std::vector<float> buffer_;
+    size_t capacity_;       // Frames
+    size_t target_;         // Frames
+    int channels_;
+    size_t read_pos_ = 0;   // Frames
+    size_t count_ = 0;      // Frames
+    bool primed_ = false;
+    float noise_rms_ = 0.0f;
+    uint32_t noise_state_ = 0x9E3779B9;  // xorshift32
+    uint64_t underruns_ = 0;
+    uint64_t demand_frames_ = 0;
+};
+
+/**
+ * @brief Sums all active MixSources into one interleaved buffer
+ */
+class AudioMixer {
+public:
+    AudioMixer();
+
+    /**
+     * @brief Device format changed: every source is flushed and resized so its
+     *        capacity and prime target keep their duration at the new rate
+     */
+    void setFormat(int sample_rate, int channels);
+    // Lock-free: the mix and device threads poll these while setFormat() runs on a device swap
+    int getSampleRate() const { return sample_rate_.load(std::memory_order_relaxed); }
+    int getChannels() const { return channels_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Register a new source (one per client session)
+     * @param capacity_ms FIFO size
+     * @param target_ms Prime level before the source is mixed
+     */
+    std::shared_ptr<MixSource> addSource(int capacity_ms, int target_ms);
+    void removeSource(const std::shared_ptr<MixSource>& source);
+    size_t getSourceCount() const;
+
+    /**
+     * @brief Mix @p frames frames from every source into @p out
+     * Sources that run short are padded with silence.
+     * @return Number of sources that contributed audio (0 = nothing to play)
+     */
+    size_t mix(float* out, size_t frames);
+
+private:
+    mutable std::mutex mutex_;  // Protects sources_
+    std::vector<std::shared_ptr<MixSource>> sources_;
+    std::vector<float> scratch_;
+    std::atomic<int> sample_rate_{48000};  // Written under mutex_
+    std::atomic<int> channels_{1};
+};
+
+} // namespace moonmic
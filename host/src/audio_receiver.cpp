@@ -5,9 +5,16 @@
 
 #include "audio_receiver.h"
 #include "../../moonmic_internal.h"  // For moonmic_packet_header_t
+#include "../../dsp/moonmic_dsp.h"
 #include "debug.h"
+#include "latency_trace.h"
+#include "platform/null/virtual_device_null.h"
 #include <iostream>
+#include <iomanip>
 #include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 #ifdef _WIN32
 #include "platform/windows/audio_utils.h"
@@ -15,63 +22,140 @@
 
 namespace moonmic {
 
+static_assert(PACKET_MAGIC_AUDIO == MOONMIC_MAGIC && PACKET_AUDIO_HEADER_SIZE == MOONMIC_HEADER_SIZE,
+              "packet_classifier.h out of sync with the client protocol");
+static_assert(HANDSHAKE_FLAG_PROFILE_SHIFT == MOONMIC_FLAG_PROFILE_SHIFT &&
+              HANDSHAKE_FLAG_PROFILE_MASK == MOONMIC_FLAG_PROFILE_MASK &&
+              (int)LatencyProfile::UltraLow == MOONMIC_PROFILE_ULTRA_LOW &&
+              (int)LatencyProfile::BandwidthSaver == MOONMIC_PROFILE_BANDWIDTH_SAVER,
+              "latency_profile.h out of sync with the client protocol");
+
 AudioReceiver::AudioReceiver()
     : sunshine_(nullptr)
-    , decoder_(nullptr)
-    , resampler_(nullptr)
     , receiver_(nullptr)
     , virtual_device_(nullptr)
-    , connection_monitor_(nullptr)
     , running_(false)
     , paused_(false)
-    , client_validated_(false)
-    , detected_stream_rate_(0)
-    , system_sample_rate_(0)  // Will be set after VirtualDevice init
-    , rate_logged_(false) {
-    memset(&stats_, 0, sizeof(stats_));
+    , system_sample_rate_(0) {  // Will be set after VirtualDevice init
+    stats_ = Stats();
+    published_stats_.publish(std::make_shared<const Stats>(stats_));
 }
 
 AudioReceiver::~AudioReceiver() {
     stop();
 }
 
+ClientSession::Params AudioReceiver::sessionParams(LatencyProfile profile, const LatencyTargets& targets) const {
+    ClientSession::Params params;
+    params.channels = config_.audio.channels;
+    params.decoder_rate = config_.audio.resampling_rate;  // 0: sessions decode at the device rate
+    params.output_rate = system_sample_rate_;
+    params.enable_fec = config_.audio.enable_fec;
+    params.jitter_min_depth = targets.jitter_min_depth;
+    params.jitter_max_depth = targets.jitter_max_depth;
+    params.drift_target_ms = targets.mix_target_ms;
+    params.latency_profile = profile;
+    return params;
+}
+
+AudioReceiver::SessionPtr AudioReceiver::createSession(const SenderAddress& sender, LatencyProfile profile) {
+    std::string ip = sender.ipString();
+    uint16_t port = sender.hostPort();
+
+    if ((int)sessions_.size() >= config_.server.max_clients) {
+        std::cerr << "[AudioReceiver] Rejecting " << ip << ":" << port << " - max_clients ("
+                  << config_.server.max_clients << ") reached" << std::endl;
+        return nullptr;
+    }
+    
+    // The client's profile sizes its buffering; older clients get the host's targets
+    LatencyTargets targets = (profile == LatencyProfile::Unspecified) ? host_targets_ : latencyTargets(profile);
+    auto source = mixer_.addSource(MIX_SOURCE_CAPACITY_MS, targets.mix_target_ms);
+    auto session = std::make_shared<ClientSession>(next_session_id_++, ip, port, sessionParams(profile, targets), source);
+    sessions_[sender.key()] = session;
+    
+    std::cout << "[AudioReceiver] New session " << session->getId() << " for " << ip << ":" << port
+              << " (profile " << latencyProfileName(profile) << ", mix target " << targets.mix_target_ms
+              << "ms, jitter " << targets.jitter_min_depth << "-" << targets.jitter_max_depth << " packets, "
+              << sessions_.size() << " active)" << std::endl;
+    return session;
+}
+
+void AudioReceiver::removeSession(uint64_t key) {
+    auto it = sessions_.find(key);
+    if (it == sessions_.end()) {
+        return;
+    }
+    
+    SessionPtr session = it->second;
+    sessions_.erase(it);
+    retired_session_drops_ += session->getStats().packets_dropped;  // Kept in housekeeping()'s sum
+    mixer_.removeSource(session->getMixSource());
+    session->getConnectionMonitor().stop();
+    // Decode worker may still hold a reference; the session is freed after its last task
+    
+    std::cout << "[AudioReceiver] Removed session " << session->getId() << " ("
+              << sessions_.size() << " active)" << std::endl;
+}
+
 void AudioReceiver::resetConnectionState() {
-    client_validated_ = false;
+    std::vector<uint64_t> keys;
+    for (const auto& entry : sessions_) {
+        keys.push_back(entry.first);
+    }
+    for (const auto& key : keys) {
+        removeSession(key);
+    }
+    
+    // Only called once the receive thread has stopped - stats_ is ours
     stats_.is_connected = false;
     stats_.is_receiving = false;
+    stats_.active_clients = 0;
+    stats_.clients.clear();
+    published_stats_.publish(std::make_shared<const Stats>(stats_));
     last_validated_ip_.clear();
     last_validated_time_ = std::chrono::steady_clock::time_point{};
-    if (connection_monitor_) {
-        connection_monitor_->stop();
-    }
+}
+
+bool AudioReceiver::openVirtualDevice(const std::string& output_device) {
+    std::lock_guard<std::mutex> lock(device_mutex_);
     
-    // Reset Audio Output to clear accumulated latency buffers
-    // Completely recreate the device to ensure clean state (fixes Speaker Mode init issues)
     if (virtual_device_) {
-        // std::cout << "[AudioReceiver] Resetting audio device..." << std::endl;
         virtual_device_->close();
-        virtual_device_.reset(); // Destroy old instance
-        
-        virtual_device_ = VirtualDevice::create(); // Create fresh instance
-        
-        std::string output_device = config_.audio.use_speaker_mode ? "" : config_.audio.recording_endpoint_name;
-        
-        // Re-init with 0 (Auto)
-        if (!virtual_device_->init(output_device, 0, config_.audio.channels)) {
-            std::cerr << "[AudioReceiver] Failed to recreate virtual device on reset" << std::endl;
-        } else {
-             system_sample_rate_ = virtual_device_->getSampleRate();
-             std::cout << "[AudioReceiver] Audio device reset. Rate: " << system_sample_rate_ << "Hz" << std::endl;
-        }
+        virtual_device_.reset();
+    }
+    
+    // Simulated devices (headless runs, benchmarks) first, then the platform backend
+    SimulatedDeviceOptions simulated;
+    simulated.sample_rate = config_.audio.null_sample_rate;
+    simulated.period_ms = config_.audio.null_period_ms;
+    simulated.drift_ppm = config_.audio.null_drift_ppm;
+    simulated.wav_path = config_.audio.wav_output_path;
+    virtual_device_ = createSimulatedDevice(config_.audio.driver_type, simulated);
+    if (!virtual_device_) {
+        virtual_device_ = VirtualDevice::create(config_.audio.driver_type);
     }
+    virtual_device_->setBufferTargets(host_targets_.output_latency_ms, host_targets_.output_prebuf_ms);
     
-    // Reset Resampler - destroy it forces re-creation on next packet with correct rates
-    if (resampler_) {
-        speex_resampler_destroy(resampler_);
-        resampler_ = nullptr;
+    // Initialize with 0 (Auto) - VirtualDevice will use system's native format directly
+    // This avoids creating an internal resampler inside VirtualDevice
+    if (!virtual_device_->init(output_device, 0, config_.audio.channels)) {
+        virtual_device_.reset();
+        return false;
     }
-    detected_stream_rate_ = 0;
-    rate_logged_ = false;
+    
+    // Decided here, not from config_ on the mix thread: switchAudioOutput() rewrites the mode
+    output_attenuation_ = output_device.find("Steam") != std::string::npos;
+    
+    // Get the actual system sample rate that was detected
+    system_sample_rate_ = virtual_device_->getSampleRate();
+    mixer_.setFormat(system_sample_rate_, config_.audio.channels);
+    device_usage_ = 0.0f;
+    device_latency_ms_ = -1.0f;
+    output_queue_ms_ = 0.0f;
+    output_queue_usage_ = 0.0f;
+    device_generation_++;
+    return true;
 }
 
 bool AudioReceiver::start(const Config& config) {
@@ -80,80 +164,96 @@ bool AudioReceiver::start(const Config& config) {
         return false;
     }
     
-    config_ = config;
-    
     // Note: Sunshine whitelist sync is not currently implemented
     // Whitelist checking would need client UUIDs sent in packets
     
     config_ = config;
     
-    // Note: Sunshine whitelist sync is not currently implemented
-    // Whitelist checking would need client UUIDs sent in packets
+    // Buffering for clients that don't announce a latency profile, and for the device
+    host_targets_ = LatencyTargets();
+    host_targets_.jitter_min_depth = config_.audio.jitter_min_depth;
+    host_targets_.jitter_max_depth = config_.audio.jitter_max_depth;
+    host_targets_.output_latency_ms = config_.audio.output_latency_ms;
+    host_targets_.output_prebuf_ms = config_.audio.output_prebuf_ms;
+    LatencyProfile host_profile;
+    if (parseLatencyProfile(config_.audio.latency_profile, host_profile)) {
+        host_targets_ = latencyTargets(host_profile);
+        std::cout << "[AudioReceiver] Latency profile: " << config_.audio.latency_profile << std::endl;
+    } else if (!config_.audio.latency_profile.empty()) {
+        std::cerr << "[AudioReceiver] Unknown latency_profile '" << config_.audio.latency_profile
+                  << "', using the individual buffer settings" << std::endl;
+    }
+    
+    stats_ = Stats();
+    packets_received_.reset();
+    bytes_received_.reset();
+    packets_dropped_.reset();
+    session_drops_reported_ = 0;
+    retired_session_drops_ = 0;
+    stage_window_start_ = std::chrono::steady_clock::now();
+    published_stats_.publish(std::make_shared<const Stats>(stats_));
     
-    // Initialize audio output device FIRST to detect system sample rate
-    // Speaker mode: use default system speakers (empty device name)
-    // Normal mode: use VB-Cable virtual microphone
-    virtual_device_ = VirtualDevice::create();
+    // Create virtual device or use speakers based on config
     std::string output_device = config_.audio.use_speaker_mode ? "" : config_.audio.recording_endpoint_name;
     std::string output_mode = config_.audio.use_speaker_mode ? "speakers (debug)" : config_.audio.recording_endpoint_name;
     
-    // Initialize with 0 (Auto) - VirtualDevice will use system's native format directly
-    // This avoids creating an internal resampler inside VirtualDevice
-    if (!virtual_device_->init(
-        output_device,
-        0,  // 0 = Auto-detect from device
-        config_.audio.channels
-    )) {
+    if (!openVirtualDevice(output_device)) {
         std::cerr << "[AudioReceiver] Failed to initialize audio device" << std::endl;
         return false;
     }
     
-    // Get the actual system sample rate that was detected
-    system_sample_rate_ = virtual_device_->getSampleRate();
     std::cout << "[AudioReceiver] Audio output: " << output_mode 
               << " @ " << system_sample_rate_ << "Hz (auto-detected)" << std::endl;
               
     // Determine decoder output rate
-    // If config has specific rate (non-zero), use it. Otherwise use detected system rate.
-    int decoder_rate = (config_.audio.resampling_rate > 0) ? config_.audio.resampling_rate : system_sample_rate_;
-    
-    // Initialize FFmpeg Opus decoder at the determined rate
-    decoder_ = std::make_unique<FFmpegDecoder>();
-    if (!decoder_->init(decoder_rate, config_.audio.channels)) {
-        std::cerr << "[AudioReceiver] Failed to initialize FFmpeg Opus decoder" << std::endl;
-        return false;
-    }
-    std::cout << "[AudioReceiver] FFmpeg Opus decoder initialized at " << decoder_rate << "Hz" << std::endl;
-    
-    // Update config with actual rate if it was auto (0) so other parts of code know
-    if (config_.audio.resampling_rate == 0) {
-        config_.audio.resampling_rate = decoder_rate;
-    }
-    
-    // Only initialize resampler if we need it (stream rate != output rate)
-    // For Vita@16kHz -> VB-Cable@16kHz, no resampling needed
-    // For Vita@16kHz -> VB-Cable@48kHz, use Speex resampler
-    resampler_ = nullptr;  // Will be created on-demand when stream rate is detected
+    // If config has specific rate (non-zero), use it. Otherwise decode at the device rate, so each
+    // session's resampler (its only one) just corrects drift. Opus can't produce 44.1kHz: 48kHz then.
+    // Left at 0 when auto, so sessions follow a later device change.
+    int decoder_rate = ClientSession::opusDecodeRate(
+        (config_.audio.resampling_rate > 0) ? config_.audio.resampling_rate : system_sample_rate_.load());
+    std::cout << "[AudioReceiver] Opus decoders will run at " << decoder_rate << "Hz"
+              << (config_.audio.enable_fec ? " (libopus, FEC/PLC enabled)" : " (FFmpeg, may force 48000Hz)") << std::endl;
+    
+    // Per-session decode runs on the worker pool, mixing on its own thread
+    workers_.start(config_.audio.decode_threads > 0 ? (size_t)config_.audio.decode_threads : 0,
+                   [this](ClientSession& session, PacketRef packet) {
+        decodePacket(session, std::move(packet));
+    });
     
     // Initialize UDP receiver
     receiver_ = std::make_unique<UDPReceiver>();
-    receiver_->setPacketCallback([this](const uint8_t* data, size_t size, const std::string& ip, uint16_t port, bool is_lagging) {
-        onPacketReceived(data, size, ip, port, is_lagging);
+    receiver_->setPacketCallback([this](PacketRef packet) {
+        onPacketReceived(std::move(packet));
     });
+    receiver_->setTickCallback([this](std::chrono::steady_clock::time_point now) {
+        housekeeping(now);
+    }, HOUSEKEEPING_MS);
     
     if (!receiver_->start(config_.server.port, config_.server.bind_address)) {
         std::cerr << "[AudioReceiver] Failed to start UDP receiver" << std::endl;
+        workers_.stop();
         return false;
     }
     
+    // Mix -> device hand-off: twice the device's buffer target (what a blocking write can
+    // legitimately hold up), but room for two catch-up blocks. Sized for the larger of the
+    // device rate and 48kHz so a swap to a faster device keeps a usable queue.
+    int queue_ms = std::max(2 * host_targets_.output_latency_ms, 2 * MIX_CATCHUP_PERIODS * MIX_PERIOD_MS);
+    output_ring_.reset((size_t)std::max(system_sample_rate_.load(), 48000) * config_.audio.channels
+                       * queue_ms / 1000);
+    
     running_ = true;
-    std::cout << "[AudioReceiver] Started successfully" << std::endl;
+    mix_thread_ = std::thread(&AudioReceiver::mixThreadFunc, this);
+    device_thread_ = std::thread(&AudioReceiver::deviceThreadFunc, this);
+    display_thread_ = std::thread(&AudioReceiver::displayThreadFunc, this);
+    
+    std::cout << "[AudioReceiver] Started successfully (up to " << config_.server.max_clients << " clients)" << std::endl;
     return true;
 }
 
 void AudioReceiver::stop() {
     std::cout << "[AudioReceiver] stop() called" << std::endl;
-    std::lock_guard<std::mutex> lock(audio_mutex_);
+    std::unique_lock<std::mutex> lock(audio_mutex_);
     if (!running_) {
         std::cout << "[AudioReceiver] Already stopped" << std::endl;
         return;
@@ -161,37 +261,50 @@ void AudioReceiver::stop() {
     
     running_ = false;
     
+    // Mix, device and display threads exit on running_ = false
+    lock.unlock();
+    {
+        std::lock_guard<std::mutex> wake_lock(output_wake_mutex_);
+        output_wake_.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> display_lock(display_mutex_);
+        display_wake_.notify_one();
+    }
+    if (mix_thread_.joinable()) {
+        mix_thread_.join();
+    }
+    if (device_thread_.joinable()) {
+        device_thread_.join();
+    }
+    if (display_thread_.joinable()) {
+        display_thread_.join();  // Waits out an in-flight Sunshine request
+    }
+    lock.lock();
+    
     if (receiver_) {
         std::cout << "[AudioReceiver] Stopping UDP receiver..." << std::endl;
         receiver_->stop();
-        receiver_.reset();
     }
     
-    if (virtual_device_) {
-        std::cout << "[AudioReceiver] Closing virtual device..." << std::endl;
-        virtual_device_->close();
-        virtual_device_.reset();
-    }
+    workers_.stop();
     
-    if (resampler_) {
-        speex_resampler_destroy(resampler_);
-        resampler_ = nullptr;
-    }
+    std::cout << "[AudioReceiver] Closing client sessions..." << std::endl;
+    resetConnectionState();
     
-    // Reset stream detection so next start() creates fresh resampler
-    detected_stream_rate_ = 0;
-    system_sample_rate_ = 0;
-    rate_logged_ = false;
+    // Sessions hold packet slots - the receiver's slab goes last
+    receiver_.reset();
     
-    if (decoder_) {
-        decoder_.reset();
+    {
+        std::lock_guard<std::mutex> device_lock(device_mutex_);
+        if (virtual_device_) {
+            std::cout << "[AudioReceiver] Closing virtual device..." << std::endl;
+            virtual_device_->close();
+            virtual_device_.reset();
+        }
     }
     
-    if (connection_monitor_) {
-        std::cout << "[AudioReceiver] Stopping connection monitor..." << std::endl;
-        connection_monitor_->stop();
-        connection_monitor_.reset();
-    }
+    system_sample_rate_ = 0;
     
 #ifdef _WIN32
     // Restore original default microphone
@@ -217,12 +330,11 @@ void AudioReceiver::pauseInternal() {
     if (!running_ || paused_) return;
     
     paused_ = true;
-    stats_.is_paused = true;
     
-    // Send STOP signal to client
+    // Send STOP signal to clients
     sendControlSignalInternal(MOONMIC_CTRL_STOP);
     
-    std::cout << "[AudioReceiver] Paused - sent STOP to client" << std::endl;
+    std::cout << "[AudioReceiver] Paused - sent STOP to clients" << std::endl;
 }
 
 void AudioReceiver::resume() {
@@ -234,16 +346,18 @@ void AudioReceiver::resumeInternal() {
     if (!running_ || !paused_) return;
     
     paused_ = false;
-    stats_.is_paused = false;
     
     // Reset packet timeout to prevent immediate disconnection
-    // When resuming, client needs time to send first packet
-    last_packet_time_ = std::chrono::steady_clock::now();
+    // When resuming, clients need time to send first packet
+    auto now = std::chrono::steady_clock::now();
+    for (auto& entry : sessions_) {
+        entry.second->touch(now);
+    }
     
-    // Send START signal to client
+    // Send START signal to clients
     sendControlSignalInternal(MOONMIC_CTRL_START);
     
-    std::cout << "[AudioReceiver] Resumed - sent START to client" << std::endl;
+    std::cout << "[AudioReceiver] Resumed - sent START to clients" << std::endl;
 }
 
 void AudioReceiver::sendControlSignal(uint32_t signal_magic) {
@@ -252,33 +366,35 @@ void AudioReceiver::sendControlSignal(uint32_t signal_magic) {
 }
 
 void AudioReceiver::sendControlSignalInternal(uint32_t signal_magic) {
-    if (!connection_monitor_ || last_validated_ip_.empty()) {
-        std::cerr << "[AudioReceiver] Cannot send control signal: no validated client" << std::endl;
-        return;
-    }
-    
-    if (!connection_monitor_->isRunning()) {
-        std::cerr << "[AudioReceiver] Cannot send control signal: connection monitor not running" << std::endl;
-        return;
-    }
-    
     // Create control packet
     moonmic_control_packet_t packet;
     packet.magic = signal_magic;
     packet.reserved = 0;
     
-    // Send to client using connection monitor's socket
-    connection_monitor_->sendPacket(&packet, sizeof(packet));
-    
     const char* signal_name = (signal_magic == MOONMIC_CTRL_STOP) ? "STOP" : 
                               (signal_magic == MOONMIC_CTRL_START) ? "START" : "UNKNOWN";
     
-    std::cout << "[AudioReceiver] Sent control signal: " << signal_name 
-              << " to " << last_validated_ip_ << std::endl;
+    int sent = 0;
+    for (auto& entry : sessions_) {
+        ClientSession& session = *entry.second;
+        if (!session.isValidated() || !session.getConnectionMonitor().isRunning()) {
+            continue;
+        }
+        
+        // Send to client using its connection monitor's socket
+        session.getConnectionMonitor().sendPacket(&packet, sizeof(packet));
+        std::cout << "[AudioReceiver] Sent control signal: " << signal_name 
+                  << " to " << session.getIp() << ":" << session.getPort() << std::endl;
+        sent++;
+    }
+    
+    if (sent == 0) {
+        std::cerr << "[AudioReceiver] Cannot send control signal: no validated client" << std::endl;
+    }
 }
 
 bool AudioReceiver::switchAudioOutput(bool use_speakers) {
-    std::lock_guard<std::mutex> lock(audio_mutex_);
+    std::unique_lock<std::mutex> lock(audio_mutex_);
     if (!running_) return false;
     
     std::cout << "[AudioReceiver] Hot-swapping audio to " 
@@ -288,20 +404,6 @@ bool AudioReceiver::switchAudioOutput(bool use_speakers) {
     bool was_paused = paused_;
     if (!was_paused) pauseInternal();
     
-    // Close current virtual device
-    if (virtual_device_) {
-        virtual_device_->close();
-        virtual_device_.reset();
-    }
-    
-    // Destroy old resampler (new rates may be needed)
-    if (resampler_) {
-        speex_resampler_destroy(resampler_);
-        resampler_ = nullptr;
-    }
-    detected_stream_rate_ = 0;
-    rate_logged_ = false;
-    
     // Update config
     config_.audio.use_speaker_mode = use_speakers;
     
@@ -341,18 +443,36 @@ bool AudioReceiver::switchAudioOutput(bool use_speakers) {
     std::string output_device = use_speakers ? "" : config_.audio.recording_endpoint_name;
     std::string output_mode = use_speakers ? "speakers (debug)" : config_.audio.recording_endpoint_name;
     
-    virtual_device_ = VirtualDevice::create();
+    // Opening a device can take seconds - packets keep being routed meanwhile
+    lock.unlock();
     
     // Initialize with 0 (Auto) to detect system rate and avoid internal resampling
-    if (!virtual_device_->init(output_device, 0, config_.audio.channels)) {
+    bool opened = openVirtualDevice(output_device);
+    
+    lock.lock();
+    if (!running_) {
+        // stop() ran while the device was opening - don't leave the new one open
+        std::lock_guard<std::mutex> device_lock(device_mutex_);
+        if (virtual_device_) {
+            virtual_device_->close();
+            virtual_device_.reset();
+        }
+        return false;
+    }
+    
+    if (!opened) {
         std::cerr << "[AudioReceiver] Failed to initialize new audio device" << std::endl;
         if (!was_paused) resumeInternal();
         return false;
     }
     
-    system_sample_rate_ = virtual_device_->getSampleRate();
     std::cout << "[AudioReceiver] Audio output: " << output_mode 
               << " @ " << system_sample_rate_ << "Hz" << std::endl;
+    
+    // New rates may be needed: sessions rebuild their resamplers on the next packet
+    for (auto& entry : sessions_) {
+        entry.second->setOutputRate(system_sample_rate_);
+    }
 
     // Resume if we weren't paused before
     if (!was_paused) resumeInternal();
@@ -360,6 +480,174 @@ bool AudioReceiver::switchAudioOutput(bool use_speakers) {
     return true;
 }
 
+void AudioReceiver::onStreamStarted() {
+#ifdef _WIN32
+    // Auto-set Default Mic Logic - triggered when a stream starts (first audio packet)
+    // We check this here because this is where we know audio is flowing
+    // Only if NOT in speaker mode
+    if (!config_.audio.use_speaker_mode) {
+        std::string currentId, currentName;
+        if (moonmic::platform::windows::GetDefaultRecordingDevice(currentId, currentName)) {
+            // Check if current device is NOT our virtual device to avoid overwriting original with self
+            std::string virtualId = moonmic::platform::windows::FindRecordingDeviceID(config_.audio.recording_endpoint_name);
+            
+            // Only proceed if we actually FOUND the virtual device ID
+            // If virtualId is empty, the driver is missing, so we can't switch to it anyway.
+            if (!virtualId.empty() && currentId != virtualId) {
+                std::cout << "[AudioReceiver] Saving original default mic: " << currentName << " (" << currentId << ")" << std::endl;
+                config_.audio.original_mic_id = currentId;
+                
+                // Save config immediately to persist backup ID in case of crash
+                config_.save(Config::getDefaultConfigPath());
+                
+                // Set new default
+                if (moonmic::platform::windows::SetDefaultRecordingDevice(config_.audio.recording_endpoint_name)) {
+                    std::cout << "[AudioReceiver] Auto-set default mic to: " << config_.audio.recording_endpoint_name << std::endl;
+                }
+            }
+        }
+    }
+#endif
+}
+
+void AudioReceiver::mixThreadFunc() {
+    // Wall-clock paced: every tick mixes the frames that became due since start.
+    // Devices with their own ring buffer report usage; skip ticks when it is running full.
+    using Clock = std::chrono::steady_clock;
+    
+    std::vector<float> mix_buffer;
+    int rate = 0;
+    Clock::time_point epoch;
+    uint64_t frames_mixed = 0;
+    
+    while (running_) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(MIX_PERIOD_MS));
+        
+        // (Re)start the clock on device swaps
+        if (rate != mixer_.getSampleRate()) {
+            rate = mixer_.getSampleRate();
+            epoch = Clock::now();
+            frames_mixed = 0;
+        }
+        if (rate <= 0) {
+            continue;
+        }
+        
+        auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - epoch).count();
+        uint64_t frames_due = (uint64_t)elapsed_us * rate / 1000000;
+        size_t frames = (size_t)(frames_due - frames_mixed);
+        frames_mixed = frames_due;
+        
+        // Stalled (debugger, suspend): don't try to catch up more than a few periods
+        size_t max_frames = (size_t)rate * MIX_PERIOD_MS * MIX_CATCHUP_PERIODS / 1000;
+        frames = std::min(frames, max_frames);
+        if (frames == 0) {
+            continue;
+        }
+        
+        if (device_usage_.load(std::memory_order_relaxed) > 0.75f) {
+            continue;  // Device behind its own clock - let it drain
+        }
+        
+        size_t channels = (size_t)mixer_.getChannels();
+        size_t samples = frames * channels;
+        if (output_ring_.capacity() - output_ring_.available() < samples) {
+            continue;  // Device thread stuck in a blocking write - don't queue latency behind it
+        }
+        if (mix_buffer.size() < samples) {
+            mix_buffer.resize(samples);
+        }
+        
+        {
+            ScopedStageTimer timer(mix_timer_);
+            if (mixer_.mix(mix_buffer.data(), frames) == 0) {
+                continue;  // No client has audio ready
+            }
+            applyOutputGain(mix_buffer.data(), samples);
+        }
+        
+        // Hand off to the device thread (whole frames only)
+        output_ring_.write(mix_buffer.data(), samples);
+        std::lock_guard<std::mutex> wake_lock(output_wake_mutex_);
+        output_wake_.notify_one();
+    }
+}
+
+void AudioReceiver::deviceThreadFunc() {
+    // Only thread that writes to the device: a blocking write (pa_simple_write,
+    // WASAPI) stalls this thread alone while receive/decode/mix keep running.
+    std::vector<float> buffer(output_ring_.capacity());
+    uint32_t generation = device_generation_.load();
+    
+    while (running_) {
+        {
+            std::unique_lock<std::mutex> wake_lock(output_wake_mutex_);
+            output_wake_.wait_for(wake_lock, std::chrono::milliseconds(MIX_PERIOD_MS * 2), [this] {
+                return !running_ || output_ring_.available() > 0;
+            });
+        }
+        
+        // Queue level as the device finds it, for getStats() and the trace
+        {
+            int channels = std::max(mixer_.getChannels(), 1);
+            int rate = mixer_.getSampleRate();
+            size_t queued_frames = output_ring_.available() / channels;
+            output_queue_ms_.store(rate > 0 ? (float)queued_frames * 1000.0f / (float)rate : 0.0f,
+                                   std::memory_order_relaxed);
+            output_queue_usage_.store(output_ring_.usage(), std::memory_order_relaxed);
+            traceQueued(TraceStage::OutputQueue, queued_frames, rate);
+        }
+        size_t samples = output_ring_.read(buffer.data(), buffer.size());
+        if (samples == 0) {
+            continue;
+        }
+        
+        // Device swapped: whatever was queued was mixed for the old device
+        uint32_t current = device_generation_.load();
+        if (current != generation) {
+            generation = current;
+            continue;
+        }
+        
+        std::lock_guard<std::mutex> device_lock(device_mutex_);
+        if (!virtual_device_) {
+            continue;
+        }
+        
+        int channels = mixer_.getChannels();
+        ScopedStageTimer timer(device_timer_);
+        // Send to virtual device or speakers depending on mode
+        bool written;
+        {
+            TraceScope trace(TraceStage::DeviceWrite);
+            written = virtual_device_->write(buffer.data(), samples / channels, channels);
+        }
+        if (!written) {
+            // Write failed, but don't count as dropped
+        }
+        device_usage_.store(virtual_device_->getBufferUsage(), std::memory_order_relaxed);
+        device_latency_ms_.store(virtual_device_->getLatencyMs(), std::memory_order_relaxed);
+    }
+}
+
+void AudioReceiver::applyOutputGain(float* buffer, size_t samples) {
+    // STEAM WDM-KS FIX: Pre-attenuation to compensate for driver's internal AGC
+    // The Steam driver with WDM-KS has automatic gain that amplifies everything to maximum.
+    // VB-Cable (WASAPI) doesn't have this issue, so it's driver-specific.
+    // Apply 15% attenuation (0.15x) so that after the driver's AGC, audio is at normal levels.
+    // Only applied while feeding the driver, not in speaker mode (set by openVirtualDevice)
+    if (output_attenuation_.load(std::memory_order_relaxed)) {
+        static bool attenuation_logged = false;
+        if (!attenuation_logged) {
+            std::cout << "[AudioReceiver] Steam WDM-KS detected: applying 15% pre-attenuation to compensate for driver AGC" << std::endl;
+            attenuation_logged = true;
+        }
+        
+        const float STEAM_ATTENUATION = 0.15f;  // 15% of original volume (lower = quieter input, less noise)
+        moonmic_dsp_gain(buffer, samples, STEAM_ATTENUATION);
+    }
+}
+
 bool AudioReceiver::isClientAllowed(const std::string& ip) {
     // If whitelist is disabled, allow all
     if (!config_.security.enable_whitelist) {
@@ -376,438 +664,235 @@ bool AudioReceiver::isClientAllowed(const std::string& ip) {
     return false;
 }
 
-void AudioReceiver::onPacketReceived(const uint8_t* data, size_t size, const std::string& sender_ip, uint16_t sender_port, bool is_lagging) {
+void AudioReceiver::onPacketReceived(PacketRef packet) {
+    ScopedStageTimer stage_timer(receive_timer_);
+    TraceScope trace(TraceStage::Route);
+    const uint8_t* data = packet.data();
+    const size_t size = packet.size();
+    const SenderAddress sender = packet->sender;
+    const auto now = packet->arrival;
+    
+    const uint64_t packet_count = packets_received_.add();
+    bytes_received_.add(size);
+    
     std::lock_guard<std::mutex> lock(audio_mutex_);
-    stats_.packets_received++;
-    stats_.bytes_received += size;
-    stats_.last_sender_ip = sender_ip;
-    stats_.is_receiving = true;
-    last_packet_time_ = std::chrono::steady_clock::now();  // Update timestamp for timeout detection
+    
+    // Binary ip:port lookup - no string formatting on the audio path
+    const uint64_t key = sender.key();
+    auto it = sessions_.find(key);
+    SessionPtr session = (it != sessions_.end()) ? it->second : nullptr;
+    if (session) {
+        session->touch(now);  // Update timestamp for timeout detection
+    }
 
-    // Handshake handling: if we receive a MOON handshake at any time, treat it as (re)connection
-    const bool is_handshake_magic = (size >= sizeof(MoonMicHandshake)) &&
-        (((const MoonMicHandshake*)data)->magic == 0x4D4F4F4E || ((const MoonMicHandshake*)data)->magic == 0x4E4F4F4D);
+    const PacketKind kind = classifyPacket(data, size);
 
-    if (is_handshake_magic) {
-        // Reset state to allow new session (e.g., after client reconnect or app close)
-        resetConnectionState();
+    // Handshake handling: if we receive a MOON handshake at any time, treat it as (re)connection
+    if (kind == PacketKind::Handshake) {
+        const std::string sender_ip = sender.ipString();
+        const uint16_t sender_port = sender.hostPort();
+        
+        // Buffering targets are fixed when a session is built: a client that comes
+        // back with another latency profile gets a fresh one
+        LatencyProfile profile = handshakeLatencyProfile(data, size);
+        if (session && session->getLatencyProfile() != profile) {
+            std::cout << "[AudioReceiver] " << sender_ip << ":" << sender_port << " switched to latency profile "
+                      << latencyProfileName(profile) << std::endl;
+            removeSession(key);
+            session = nullptr;
+        }
+        
+        // Reset this client's state to allow a new session (e.g., after client reconnect or app close)
+        // Other clients keep streaming.
+        bool created = false;
+        if (session) {
+            session->getConnectionMonitor().stop();
+            session->reset();
+            session->setValidated(false);
+        } else {
+            session = createSession(sender, profile);
+            if (!session) {
+                packets_dropped_.add();
+                return;  // DENY - host full
+            }
+            created = true;
+        }
 
-        uint16_t current_w = 0, current_h = 0;
-        if (!validateHandshake(data, size, sender_ip, current_w, current_h)) {
-            stats_.packets_dropped++;
+        if (!validateHandshake(data, size, sender_ip, *session)) {
+            packets_dropped_.add();
+            if (created) {
+                removeSession(key);
+            }
             return;  // DENY - invalid handshake
         }
         
+        // Same client reconnecting from a new port: retire its old session
+        if (!session->getUniqueId().empty()) {
+            std::vector<uint64_t> stale;
+            for (const auto& entry : sessions_) {
+                if (entry.second != session && entry.second->getUniqueId() == session->getUniqueId()) {
+                    stale.push_back(entry.first);
+                }
+            }
+            for (const auto& stale_key : stale) {
+                const ClientSession& old = *sessions_[stale_key];
+                std::cout << "[AudioReceiver] Client " << session->getDeviceName() << " reconnected, dropping "
+                          << old.getIp() << ":" << old.getPort() << std::endl;
+                removeSession(stale_key);
+            }
+        }
+        
         // Handshake validated successfully
-        client_validated_ = true;
+        session->setValidated(true);
+        session->touch(now);
         last_validated_ip_ = sender_ip;
-        stats_.is_connected = true;
-        last_validated_time_ = std::chrono::steady_clock::now();
+        last_validated_time_ = now;
 
-        if (!connection_monitor_) {
-            connection_monitor_ = std::make_unique<ConnectionMonitor>();
-        }
         // IMPORTANT: Use sender_port, not config_.server.port
-        connection_monitor_->start(sender_ip, sender_port);
+        ConnectionMonitor& monitor = session->getConnectionMonitor();
+        monitor.start(sender_ip, sender_port);
         std::cout << "[AudioReceiver] Started heartbeat monitor for " << sender_ip << ":" << sender_port << std::endl;
 
         // Send Handshake ACK to confirm availability to client
         // IMPORTANT: Send back the FULL packet received, not just sizeof(MoonMicHandshake)
         // Because the client's moonmic_handshake_t is larger than our local definition
         uint8_t ack_buffer[256];
-        memcpy(ack_buffer, data, std::min(size, sizeof(ack_buffer)));
+        size_t ack_size = std::min(size, sizeof(ack_buffer));
+        memcpy(ack_buffer, data, ack_size);
         
-        // Modify magic to ACK and update resolution fields
+        // Modify magic to ACK and update resolution fields (last resolution the display thread saw)
         MoonMicHandshake* ack = (MoonMicHandshake*)ack_buffer;
         ack->magic = 0x4B434148; // "HACK"
-        if (current_w > 0 && current_h > 0) {
-            ack->display_width = current_w;
-            ack->display_height = current_h;
+        uint32_t current = sunshine_resolution_.load();
+        if (current != 0) {
+            ack->display_width = (uint16_t)(current >> 16);
+            ack->display_height = (uint16_t)(current & 0xFFFF);
         }
         
         // Send FULL packet back (same size as received)
-        connection_monitor_->sendPacket(ack_buffer, size);
-        std::cout << "[AudioReceiver] Sent Handshake ACK (" << size << " bytes) to " << sender_ip << std::endl;
+        monitor.sendPacket(ack_buffer, ack_size);
+        std::cout << "[AudioReceiver] Sent Handshake ACK (" << ack_size << " bytes) to " << sender_ip << std::endl;
+
+        // A paused host tells new clients to hold off too
+        if (paused_) {
+            moonmic_control_packet_t stop_packet = { MOONMIC_CTRL_STOP, 0 };
+            monitor.sendPacket(&stop_packet, sizeof(stop_packet));
+        }
 
         return;  // Handshake consumed, don't process as audio
     }
     
-    // Check for PING (Client Latency Request)
-    // Magic: 0x50494E47 ("PING")
-    const uint32_t PACKET_MAGIC_PING = 0x50494E47;
-    // Magic: 0x504F4E47 ("PONG")
-    const uint32_t PACKET_MAGIC_PONG = 0x504F4E47;
-    
-    if (size >= 12) { // 4 bytes Magic + 8 bytes Timestamp
-        uint32_t magic;
-        memcpy(&magic, data, 4);
-        
-        if (magic == PACKET_MAGIC_PING) {
-             // Client sent PING. Echo back as PONG for Client RTT calc.
-             // Use main receiver socket to reply (better for NAT/Firewal)
-             if (receiver_) {
-                 // Create PONG packet with same timestamp
-                 std::vector<uint8_t> pong(size);
-                 memcpy(pong.data(), data, size);
-                 uint32_t pong_magic = PACKET_MAGIC_PONG;
-                 memcpy(pong.data(), &pong_magic, 4); // Overwrite Magic
-                 
-                 receiver_->sendTo(pong.data(), size, sender_ip, sender_port);
-             }
-             return; 
-        } else if (magic == PACKET_MAGIC_PONG) {
-             // Client replied PONG to our PING. Calculate Host RTT.
-             uint64_t timestamp;
-             memcpy(&timestamp, data + 4, 8);
-             
-             // Get current time in same format (system_clock micros)
-             auto now = std::chrono::system_clock::now();
-             auto duration = now.time_since_epoch();
-             uint64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
-             
-             int64_t diff_us = (int64_t)(now_us - timestamp);
-             
-             // Sanity check (RTT < 5 seconds)
-             if (diff_us >= 0 && diff_us < 5000000) {
-                 stats_.rtt_ms = (int)(diff_us / 1000);
-             }
-             
-             // Refresh connection alive status
-             stats_.last_sender_ip = sender_ip; 
-             stats_.is_receiving = true;
-             last_packet_time_ = std::chrono::steady_clock::now();
-
-             return;
+    if (kind == PacketKind::Ping) {
+        // Client sent PING. Echo back as PONG for Client RTT calc.
+        // Use main receiver socket to reply (better for NAT/Firewal)
+        if (receiver_) {
+            // Create PONG packet with same timestamp
+            std::vector<uint8_t> pong(size);
+            memcpy(pong.data(), data, size);
+            uint32_t pong_magic = PACKET_MAGIC_PONG;
+            memcpy(pong.data(), &pong_magic, 4); // Overwrite Magic
+            
+            receiver_->sendTo(pong.data(), size, sender);
         }
+        return;
     }
     
-    // Parse packet header MANUALLY to match Vita's manual writing
-    // The header size is MOONMIC_HEADER_SIZE (20 bytes: 4+4+8+4)
-    if (size < MOONMIC_HEADER_SIZE) {
-        std::cerr << "[AudioReceiver] Packet too small: " << size << " bytes (expected at least " << MOONMIC_HEADER_SIZE << " for header)" << std::endl;
-        stats_.packets_dropped++;
+    if (kind == PacketKind::Pong) {
+        // Client replied PONG to our PING. Calculate Host RTT.
+        uint64_t timestamp;
+        memcpy(&timestamp, data + 4, 8);
+        
+        // Get current time in same format (system_clock micros)
+        auto wall_now = std::chrono::system_clock::now();
+        auto duration = wall_now.time_since_epoch();
+        uint64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        
+        int64_t diff_us = (int64_t)(now_us - timestamp);
+        
+        // Sanity check (RTT < 5 seconds)
+        if (diff_us >= 0 && diff_us < 5000000) {
+            if (session) {
+                session->setRtt((int)(diff_us / 1000));
+            }
+        }
+        
         return;
     }
-
-    // Read magic (bytes 0-3, little-endian)
-    uint32_t magic = ((uint32_t)data[0] << 0) | ((uint32_t)data[1] << 8) | 
-                     ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
     
-    // Validate magic - must be MMIC for audio packets
-    // (MOON=0x4D4F4F4E is handshake, MMIC=0x4D4D4943 is audio)
-    if (magic != MOONMIC_MAGIC) {
-        // Not an audio packet, ignore (could be handshake probe)
+    if (kind == PacketKind::Runt) {
+        std::cerr << "[AudioReceiver] Packet too small: " << size << " bytes (expected at least " << MOONMIC_HEADER_SIZE << " for header)" << std::endl;
+        packets_dropped_.add();
         return;
     }
-
-    // AUTO-CORRECTION: If we are lagging (backlog detected), drop audio packets to catch up
-    if (is_lagging) {
-        static int lag_drop_counter = 0;
-        lag_drop_counter++;
-        if (lag_drop_counter % 50 == 0) { // Log every 50th drop to avoid spam
-             std::cout << "[AudioReceiver] ⚠ LAG DETECTED: Dropping packet to drain buffer (Backlog > 2048 bytes)" << std::endl;
-        }
-        stats_.packets_dropped++;
-        stats_.packets_dropped_lag++; // Count specific auto-correction drops
-        return; // Drop packet
-    }
-    
-    // Read sequence (bytes 4-7, little-endian)  
-    uint32_t sequence = ((uint32_t)data[4] << 0) | ((uint32_t)data[5] << 8) |
-                        ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
-    
-    // Read timestamp (bytes 8-15, little-endian)
-    uint64_t timestamp = ((uint64_t)data[8] << 0) | ((uint64_t)data[9] << 8) |
-                         ((uint64_t)data[10] << 16) | ((uint64_t)data[11] << 24) |
-                         ((uint64_t)data[12] << 32) | ((uint64_t)data[13] << 40) |
-                         ((uint64_t)data[14] << 48) | ((uint64_t)data[15] << 56);
     
-    // Read sample_rate (bytes 16-19, little-endian)
-    uint32_t sample_rate_field = ((uint32_t)data[16] << 0) |
-                                  ((uint32_t)data[17] << 8) |
-                                  ((uint32_t)data[18] << 16) |
-                                  ((uint32_t)data[19] << 24);
+    // Not an audio packet (MMIC), ignore (could be handshake probe)
+    if (kind != PacketKind::Audio) {
+        return;
+    }
     
-    // Check for RAW mode flag (bit 31)
-    bool is_raw_mode = (sample_rate_field & MOONMIC_RAW_FLAG) != 0;
-    uint32_t stream_rate = sample_rate_field & ~MOONMIC_RAW_FLAG;  // Mask out RAW flag
+    // Parse packet header MANUALLY to match Vita's manual writing
+    // The header size is MOONMIC_HEADER_SIZE (20 bytes: 4+4+8+4)
+    ClientSession::AudioHeader header;
+    ClientSession::parseHeader(data, size, header);
     
     // Log first packet details
-    if (stats_.packets_received == 1) {
+    if (packet_count == 1) {
+        bool is_raw_mode = (header.sample_rate_field & MOONMIC_RAW_FLAG) != 0;
+        uint32_t stream_rate = header.sample_rate_field & MOONMIC_RATE_MASK;  // Mask out RAW/DTX flags
+        
         std::cout << "[AudioReceiver] FIRST PACKET DEBUG (manual read):" << std::endl;
         std::cout << "  Packet size: " << size << " bytes" << std::endl;
-        std::cout << "  magic = 0x" << std::hex << magic << " (expected 0x" << MOONMIC_MAGIC << ")" << std::dec << std::endl;
-        std::cout << "  sequence = " << sequence << std::endl;
-        std::cout << "  timestamp = " << timestamp << std::endl;
+        std::cout << "  magic = 0x" << std::hex << header.magic << " (expected 0x" << MOONMIC_MAGIC << ")" << std::dec << std::endl;
+        std::cout << "  sequence = " << header.sequence << std::endl;
+        std::cout << "  timestamp = " << header.timestamp << std::endl;
         std::cout << "  sample_rate = " << stream_rate << std::endl;
         std::cout << "  raw_mode = " << (is_raw_mode ? "YES" : "NO") << std::endl;
         std::cout << "  Raw header bytes:";
         for (int i = 0; i < 20; i++) {
             std::cout << " " << std::hex << std::setw(2) << std::setfill('0') << (int)data[i];
         }
-        std::cout << std::dec << std::endl << std::endl;
+        std::cout << std::dec << std::setfill(' ') << std::endl << std::endl;
     }
     
-    // First packet: log stream info
-    if (detected_stream_rate_ == 0) {
-        detected_stream_rate_ = stream_rate;
-        rate_logged_ = true;
-        
-        std::cout << "[AudioReceiver] ═══ Stream Detected ═══" << std::endl;
-        std::cout << "[AudioReceiver] Source IP: " << sender_ip << std::endl;
-        std::cout << "[AudioReceiver] Stream sample rate: " << stream_rate << " Hz" << std::endl;
-        std::cout << "[AudioReceiver] Output sample rate: " << system_sample_rate_ << " Hz" << std::endl;
-        std::cout << "[AudioReceiver] Mode: " << (is_raw_mode ? "RAW PCM" : "Opus") << std::endl;
-        
-        if (!resampler_ || stream_rate != detected_stream_rate_) {
-            // Create/Recreate resampler
-            // ALWAYS create it, even if rates match, to support Drift Correction
-            int err = 0;
-            if (resampler_) speex_resampler_destroy(resampler_);
-            
-            resampler_ = speex_resampler_init(
-                config_.audio.channels,
-                stream_rate,           // Input rate 
-                system_sample_rate_,   // Output rate
-                10,                     // Quality (0-10, 10 = best)
-                &err
-            );
-            
-            if (err != RESAMPLER_ERR_SUCCESS || !resampler_) {
-                std::cerr << "[AudioReceiver] Failed to create resampler: " << err << std::endl;
-                return;
-            }
-            
-            std::cout << "[AudioReceiver] ✓ Resampler active: " << stream_rate << "Hz → " 
-                      << system_sample_rate_ << "Hz (quality 10)" << std::endl;
-            if (stream_rate == system_sample_rate_) {
-                std::cout << "[AudioReceiver] (Resampler enabled for Drift Correction)" << std::endl;
-            }
-        }
-        std::cout << "[AudioReceiver] ═══════════════════════\n" << std::endl;
-    }
-    
-    // Skip header
-    const uint8_t* payload = data + MOONMIC_HEADER_SIZE;
-    size_t payload_size = size - MOONMIC_HEADER_SIZE;
-    
-    float* output_buffer = decode_buffer_;
-    int output_frames = 0;
-    
-    if (is_raw_mode) {
-        // RAW mode: Convert int16 PCM to float
-        const int16_t* pcm_int16 = (const int16_t*)payload;
-        int num_samples = payload_size / sizeof(int16_t);
-        output_frames = num_samples / config_.audio.channels;
-        
-        // DEBUG: Log first packet's sample values
-        static bool first_raw_logged = false;
-        if (!first_raw_logged) first_raw_logged = true;
-        
-        // Convert int16 to float
-        // CRITICAL: Divide by 32768.0f (not 32767.0f) for correct normalization
-        for (int i = 0; i < num_samples; i++) {
-            decode_buffer_[i] = (float)pcm_int16[i] / 32768.0f;
-        }
-        
-        // Apply resampling / Drift Correction
-        // Always enter if resampler exists (which is now always true)
-        if (resampler_) {
-            
-            // --- DRIFT CORRECTION LOGIC (Aggressive P-Controller) ---
-            // The Steam driver can drift by 1000Hz+ at 44100Hz.
-            static int packet_counter = 0;
-            if (++packet_counter % 10 == 0) { // Check every ~100-300ms (10 packets)
-                float usage = virtual_device_->getBufferUsage();
-                
-                spx_uint32_t in_rate, out_rate;
-                speex_resampler_get_rate(resampler_, &in_rate, &out_rate);
-                
-                uint32_t base_rate = system_sample_rate_;
-                
-                // Target: 50% buffer usage.
-                float error = usage - 0.5f; // Positive = Too Full (Slow Driver), Negative = Too Empty (Fast Driver)
-                
-                // Deadzone of 5% (0.45 - 0.55)
-                if (std::abs(error) > 0.05f) {
-                    // P-Controller Gain
-                    // If error is 0.4 (Usage 0.9), correction should be massive (e.g. -2000Hz)
-                    // If error is 0.1 (Usage 0.6), correction moderate (e.g. -500Hz)
-                    const int Kp = 5000;
-                    
-                    int correction = (int)(error * Kp);
-                    
-                    // Logic:
-                    // If Buffer Full (Error > 0), we want FEWER samples.
-                    // To get FEWER outputs, we DECREASE the output rate.
-                    // (Ratio = Out/In. Lower Ratio = Fewer Outs).
-                    // So NewRate = BaseRate - Correction.
-                    
-                    int target_rate = (int)base_rate - correction;
-                    
-                    // Limit max deviation to avoid pitch shifting too wildy (+/- 4000Hz)
-                    if (target_rate > (int)base_rate + 4000) target_rate = base_rate + 4000;
-                    if (target_rate < (int)base_rate - 4000) target_rate = base_rate - 4000;
-                    
-                    // Only apply if meaningful change (>10Hz difference from current)
-                    if (std::abs(target_rate - (int)out_rate) > 10) {
-                         // std::cout << "[AudioReceiver] Drift P-Control: Usage=" << usage << " Err=" << error << " Adj=" << correction << " NewRate=" << target_rate << std::endl;
-                         speex_resampler_set_rate(resampler_, in_rate, (spx_uint32_t)target_rate);
-                    }
-                }
-            }
-            // ------------------------------
-        
-            spx_uint32_t in_len = output_frames;
-
-#ifdef _WIN32
-            // Auto-set Default Mic Logic - triggered when stream starts (first packet)
-            // We check this here because this is where we know audio is flowing
-            // Only if NOT in speaker mode
-            if (!config_.audio.use_speaker_mode) {
-                std::string currentId, currentName;
-                if (moonmic::platform::windows::GetDefaultRecordingDevice(currentId, currentName)) {
-                    // Check if current device is NOT our virtual device to avoid overwriting original with self
-                    std::string virtualId = moonmic::platform::windows::FindRecordingDeviceID(config_.audio.recording_endpoint_name);
-                    
-                    // Only proceed if we actually FOUND the virtual device ID
-                    // If virtualId is empty, the driver is missing, so we can't switch to it anyway.
-                    if (!virtualId.empty() && currentId != virtualId) {
-                        std::cout << "[AudioReceiver] Saving original default mic: " << currentName << " (" << currentId << ")" << std::endl;
-                        config_.audio.original_mic_id = currentId;
-                        
-                        // Save config immediately to persist backup ID in case of crash
-                        config_.save(Config::getDefaultConfigPath());
-                        
-                        // Set new default
-                        if (moonmic::platform::windows::SetDefaultRecordingDevice(config_.audio.recording_endpoint_name)) {
-                            std::cout << "[AudioReceiver] Auto-set default mic to: " << config_.audio.recording_endpoint_name << std::endl;
-                        }
-                    }
-                }
-            }
-#endif
-
-            spx_uint32_t out_len = MAX_FRAMES;
-            
-            // Debug: log first resample operation (REMOVED)
-            static bool first_resample_logged = false;
-            if (!first_resample_logged) first_resample_logged = true;
-            
-            int err = speex_resampler_process_float(
-                resampler_,
-                0,  // channel 0 (mono)
-                decode_buffer_,
-                &in_len,
-                resample_buffer_,
-                &out_len
-            );
-            
-            if (!first_resample_logged) {
-                // std::cout << out_len << " frames" << std::endl; // Removed
-                first_resample_logged = true;
-            }
-            
-            if (err != RESAMPLER_ERR_SUCCESS) {
-                stats_.packets_dropped++;
-                std::cerr << "[AudioReceiver] RAW resampling failed: " << err << std::endl;
-                return;
-            }
-            
-            output_buffer = resample_buffer_;
-            output_frames = out_len;
-        }
-        
-        // Log periodically
-        static uint64_t raw_packet_count = 0;
-        if (++raw_packet_count % 100 == 1 && raw_packet_count > 1) {
-            if (isDebugMode()) {
-                std::cout << "[AudioReceiver] Processing RAW: packet #" << stats_.packets_received 
-                          << ", " << output_frames << " frames" << std::endl;
-            }
-        }
-    } else {
-        // Opus mode: Decode compressed audio
-        int decoded_frames = decoder_->decode(payload, payload_size, decode_buffer_, MAX_FRAMES);
-        if (decoded_frames < 0) {
-            stats_.packets_dropped++;
-            std::cerr << "[AudioReceiver] Decode failed for packet from " << sender_ip << std::endl;
+    // Audio from a client that never sent a handshake: only accepted with the whitelist off
+    if (!session) {
+        if (config_.security.enable_whitelist) {
+            packets_dropped_.add();
             return;
         }
-        
-        output_frames = decoded_frames;
-        
-        // Resample only if needed
-        if (system_sample_rate_ != detected_stream_rate_ && resampler_) {
-            spx_uint32_t in_len = decoded_frames;
-            spx_uint32_t out_len = MAX_FRAMES;
-            
-            int err = speex_resampler_process_float(
-                resampler_,
-                0,  // channel 0 (mono)
-                decode_buffer_,
-                &in_len,
-                resample_buffer_,
-                &out_len
-            );
-            
-            if (err != RESAMPLER_ERR_SUCCESS) {
-                stats_.packets_dropped++;
-                std::cerr << "[AudioReceiver] Resampling failed: " << err << std::endl;
-                return;
-            }
-            
-            output_buffer = resample_buffer_;
-            output_frames = out_len;
-        }
-        
-        // Log periodically
-        static uint64_t packet_count = 0;
-        if (++packet_count % 100 == 1 && packet_count > 1) {
-            if (config_.audio.resampling_rate == detected_stream_rate_) {
-                if (isDebugMode()) {
-                    std::cout << "[AudioReceiver] Processing Opus: packet #" << stats_.packets_received 
-                              << ", decoded " << output_frames << " frames" << std::endl;
-                }
-            } else {
-                if (isDebugMode()) {
-                    std::cout << "[AudioReceiver] Processing Opus: packet #" << stats_.packets_received 
-                              << ", decoded=" << decoded_frames << " frames @ " << detected_stream_rate_ << "Hz"
-                              << ", resampled=" << output_frames << " frames @ " << config_.audio.resampling_rate 
-                              << "Hz (Speex)" << std::endl;
-                }
-            }
+        session = createSession(sender);
+        if (!session) {
+            packets_dropped_.add();
+            return;
         }
     }
     
-    // STEAM WDM-KS FIX: Pre-attenuation to compensate for driver's internal AGC
-    // The Steam driver with WDM-KS has automatic gain that amplifies everything to maximum.
-    // VB-Cable (WASAPI) doesn't have this issue, so it's driver-specific.
-    // Apply 15% attenuation (0.15x) so that after the driver's AGC, audio is at normal levels.
-    // Only apply if we are NOT in speaker mode (actually feeding the driver)
-    if (!config_.audio.use_speaker_mode && config_.audio.recording_endpoint_name.find("Steam") != std::string::npos) {
-        static bool attenuation_logged = false;
-        if (!attenuation_logged) {
-            std::cout << "[AudioReceiver] Steam WDM-KS detected: applying 15% pre-attenuation to compensate for driver AGC" << std::endl;
-            attenuation_logged = true;
-        }
-        
-        const float STEAM_ATTENUATION = 0.15f;  // 15% of original volume (lower = quieter input, less noise)
-        for (size_t i = 0; i < output_frames * config_.audio.channels; i++) {
-            output_buffer[i] *= STEAM_ATTENUATION;
-        }
+    if (session->markAudioSeen()) {
+        onStreamStarted();
     }
     
-    // Send to virtual device or speakers depending on mode
-    if (!virtual_device_->write(output_buffer, output_frames, config_.audio.channels)) {
-        // Write failed, but don't count as dropped
+    // Decode on the session's worker (same worker every time keeps packets in order).
+    // The datagram's slab slot moves along with the task - no copy.
+    uint32_t affinity = session->getId();
+    if (!workers_.post(affinity, std::move(session), std::move(packet))) {
+        packets_dropped_.add();  // Decode stage backed up
     }
-    
-    stats_.is_receiving = true;
 }
 
+void AudioReceiver::decodePacket(ClientSession& session, PacketRef packet) {
+    if (!packet) {
+        session.onTick(std::chrono::steady_clock::now());  // housekeeping() tick
+        return;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    queue_timer_.record(packet->arrival, start);
+    traceRecord(TraceStage::DecodeQueue, start - packet->arrival);
+    session.onAudioPacket(std::move(packet));
+    decode_timer_.record(start, std::chrono::steady_clock::now());
+}
 
-bool AudioReceiver::validateHandshake(const uint8_t* data, size_t size, const std::string& sender_ip, uint16_t& out_w, uint16_t& out_h) {
+bool AudioReceiver::validateHandshake(const uint8_t* data, size_t size, const std::string& sender_ip, ClientSession& session) {
     if (size < sizeof(MoonMicHandshake)) {
         std::cerr << "[AudioReceiver] Packet too small for handshake: " << size << " bytes" << std::endl;
         return false;
@@ -825,21 +910,19 @@ bool AudioReceiver::validateHandshake(const uint8_t* data, size_t size, const st
         return false;
     }
     
+    std::string uniqueid = session.getUniqueId();
+    std::string devicename = session.getDeviceName();
     if (hs->uniqueid_len > 0 && hs->uniqueid_len <= 16) {
-        client_uniqueid_ = std::string(hs->uniqueid, hs->uniqueid_len);
+        uniqueid = std::string(hs->uniqueid, hs->uniqueid_len);
     }
     
     if (hs->devicename_len > 0 && hs->devicename_len <= 64) {
-        client_devicename_ = std::string(hs->devicename, hs->devicename_len);
-        stats_.client_name = client_devicename_;
+        devicename = std::string(hs->devicename, hs->devicename_len);
     }
+    session.setIdentity(uniqueid, devicename);
     
     if (!config_.security.enable_whitelist) {
-        std::cout << "[AudioReceiver] Client connected: " << client_devicename_ << " [whitelist disabled]" << std::endl;
-
-        // Reset packet timeout baseline when a fresh handshake arrives
-        last_packet_time_ = std::chrono::steady_clock::now();
-        stats_.is_connected = true;
+        std::cout << "[AudioReceiver] Client connected: " << devicename << " [whitelist disabled]" << std::endl;
         return true;
     }
     
@@ -875,41 +958,24 @@ bool AudioReceiver::validateHandshake(const uint8_t* data, size_t size, const st
         if (grace) {
             std::cout << "[AudioReceiver] Grace-accept pair_status=0 during Sunshine restart (" << grace_ms << "ms since last validation)" << std::endl;
         } else {
-            std::cerr << "[AudioReceiver] DENY: Client '" << client_devicename_ 
+            std::cerr << "[AudioReceiver] DENY: Client '" << devicename 
                       << "' not validated by Sunshine (pair_status=" << (int)hs->pair_status << ")" << std::endl;
             std::cerr << "[AudioReceiver] Ensure client is paired with Sunshine host" << std::endl;
             return false;
         }
     }
     
-    std::cout << "[AudioReceiver] Client validated (pair_status=1): " << client_devicename_ << std::endl;
+    std::cout << "[AudioReceiver] Client validated (pair_status=1): " << devicename << std::endl;
     
     // =========================================================================
     // DISPLAY RESOLUTION CONFIGURATION (Protocol v2+)
     // =========================================================================
-    // If client sent display resolution (version >= 2), configure Sunshine
+    // If client sent display resolution (version >= 2), configure Sunshine.
+    // The WebUI calls are HTTP round trips (and a restart), so they go to the display thread.
     if (hs->version >= 2 && hs->display_width > 0 && hs->display_height > 0) {
         std::cout << "[AudioReceiver] Client requests display resolution: " 
                   << hs->display_width << "x" << hs->display_height << std::endl;
         
-        // Query current resolution
-        out_w = 0; out_h = 0;
-        if (sunshine_webui_) {
-            sunshine_webui_->getCurrentResolution(out_w, out_h);
-        }
-
-        bool force_update = (hs->flags & 0x01); // FORCE_UPDATE
-        bool should_update = true;
-
-        if (out_w > 0 && out_h > 0 && !force_update) {
-            if (out_w != hs->display_width || out_h != hs->display_height) {
-                std::cout << "[AudioReceiver] Resolution mismatch (Current: " << out_w << "x" << out_h 
-                          << ", Target: " << hs->display_width << "x" << hs->display_height 
-                          << "). Waiting for FORCE flag." << std::endl;
-                should_update = false;
-            }
-        }
-
         // Validate it's a standard resolution
         bool is_valid = false;
         if (hs->display_width == 1280 && hs->display_height == 720) is_valid = true;    // 720p
@@ -918,11 +984,10 @@ bool AudioReceiver::validateHandshake(const uint8_t* data, size_t size, const st
         if (hs->display_width == 2560 && hs->display_height == 1440) is_valid = true;   // 1440p
         if (hs->display_width == 3840 && hs->display_height == 2160) is_valid = true;   // 4K
         
-        if (is_valid && should_update) {
-            if (!applyDisplayResolution(hs->display_width, hs->display_height)) {
-                std::cerr << "[AudioReceiver] Warning: host resolution request could not be applied automatically" << std::endl;
-            }
-        } else if (!is_valid) {
+        if (is_valid) {
+            requestDisplayResolution(hs->display_width, hs->display_height,
+                                     (hs->flags & HANDSHAKE_FLAG_FORCE_UPDATE) != 0);
+        } else {
             std::cerr << "[AudioReceiver] Invalid resolution request: " 
                       << hs->display_width << "x" << hs->display_height << std::endl;
         }
@@ -931,6 +996,60 @@ bool AudioReceiver::validateHandshake(const uint8_t* data, size_t size, const st
     return true;
 }
 
+void AudioReceiver::requestDisplayResolution(uint16_t width, uint16_t height, bool force) {
+    std::lock_guard<std::mutex> lock(display_mutex_);
+    display_width_ = width;
+    display_height_ = height;
+    display_force_ = force;
+    display_pending_ = true;
+    display_wake_.notify_one();
+}
+
+void AudioReceiver::displayThreadFunc() {
+    // Prime the resolution reported in handshake ACKs
+    uint16_t current_w = 0, current_h = 0;
+    if (sunshine_webui_ && sunshine_webui_->getCurrentResolution(current_w, current_h)) {
+        sunshine_resolution_ = ((uint32_t)current_w << 16) | current_h;
+    }
+    
+    while (running_) {
+        uint16_t width, height;
+        bool force;
+        {
+            std::unique_lock<std::mutex> lock(display_mutex_);
+            display_wake_.wait(lock, [this] { return display_pending_ || !running_; });
+            if (!running_) {
+                break;
+            }
+            width = display_width_;
+            height = display_height_;
+            force = display_force_;
+            display_pending_ = false;
+        }
+        
+        // Query current resolution
+        current_w = 0; current_h = 0;
+        if (sunshine_webui_ && sunshine_webui_->getCurrentResolution(current_w, current_h)) {
+            sunshine_resolution_ = ((uint32_t)current_w << 16) | current_h;
+        }
+        
+        if (current_w > 0 && current_h > 0 && !force) {
+            if (current_w != width || current_h != height) {
+                std::cout << "[AudioReceiver] Resolution mismatch (Current: " << current_w << "x" << current_h 
+                          << ", Target: " << width << "x" << height 
+                          << "). Waiting for FORCE flag." << std::endl;
+                continue;
+            }
+        }
+        
+        if (applyDisplayResolution(width, height)) {
+            sunshine_resolution_ = ((uint32_t)width << 16) | height;
+        } else {
+            std::cerr << "[AudioReceiver] Warning: host resolution request could not be applied automatically" << std::endl;
+        }
+    }
+}
+
 bool AudioReceiver::applyDisplayResolution(uint16_t width, uint16_t height) {
     bool applied = false;
     bool attempted_sunshine = false;
@@ -977,34 +1096,162 @@ bool AudioReceiver::applyFallbackDisplayResolution(uint16_t width, uint16_t heig
     return false;
 }
 
-AudioReceiver::Stats AudioReceiver::getStats() {
-    // Update connection status
-    stats_.is_connected = client_validated_;
-    stats_.is_paused = paused_;
+void AudioReceiver::housekeeping(std::chrono::steady_clock::time_point now) {
+    std::vector<SessionPtr> sessions;
+    std::vector<Stats::ClientStats> clients;
+    bool any_validated = false;
+    bool any_receiving = false;
+    uint64_t session_drops = 0;
+    
+    {
+        std::lock_guard<std::mutex> lock(audio_mutex_);
+        
+        // Timeout logic: 2 seconds without packets = not receiving
+        // 4 seconds = Assume full disconnect, drop the session (client must handshake again)
+        std::vector<uint64_t> timed_out;
+        for (const auto& entry : sessions_) {
+            auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(now - entry.second->getLastPacketTime());
+            if (diff.count() > DISCONNECT_TIMEOUT_MS) {
+                timed_out.push_back(entry.first);
+            }
+        }
+        for (const auto& key : timed_out) {
+            const ClientSession& session = *sessions_[key];
+            std::cout << "[AudioReceiver] Client disconnected (timeout): " << session.getDeviceName()
+                      << " (" << session.getIp() << ":" << session.getPort() << ")" << std::endl;
+            removeSession(key);
+        }
+        
+        // Connection-side state lives under this lock
+        std::chrono::steady_clock::time_point newest;
+        for (const auto& entry : sessions_) {
+            const ClientSession& session = *entry.second;
+            any_validated = any_validated || session.isValidated();
+            auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(now - session.getLastPacketTime());
+            any_receiving = any_receiving || idle.count() <= CONNECTION_TIMEOUT_MS;
+            
+            if (session.getLastPacketTime() > newest) {
+                newest = session.getLastPacketTime();
+                stats_.client_name = session.getDeviceName();
+                stats_.last_sender_ip = session.getIp();
+                stats_.rtt_ms = session.getRtt();
+            }
+            sessions.push_back(entry.second);
+            
+            Stats::ClientStats client;
+            client.id = session.getId();
+            client.name = session.getDeviceName();
+            client.ip = session.getIp();
+            client.port = session.getPort();
+            client.validated = session.isValidated();
+            client.rtt_ms = session.getRtt();
+            clients.push_back(std::move(client));
+        }
+        stats_.active_clients = (int)sessions_.size();
+        session_drops = retired_session_drops_;
+    }
     
-    // Check for timeout if we think we are connected
-    if (stats_.is_connected && connection_monitor_ && last_validated_time_.time_since_epoch().count() > 0) {
-        auto now = std::chrono::steady_clock::now();
-        auto diff = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_packet_time_);
-        
-        // Timeout logic: 2 seconds without packets = partially disconnected
-        // 4 seconds = Assume full disconnect, reset handshake
-        if (diff.count() > 2000) {
-             stats_.is_receiving = false;
-             // We don't mark is_connected = false immediately, we wait for longer timeout
-             if (diff.count() > 4000) {
-                 stats_.is_connected = false;
-                 // Don't reset connection state fully, allow quick resume
-                 // If we were connected, and now we are not, reset the state
-                 if (client_validated_) {
-                     std::cout << "[AudioReceiver] Client disconnected (timeout): " << client_devicename_ << std::endl;
-                     resetConnectionState();
-                 }
-             }
+    // Release jitter buffer tails: without new packets nothing else drains them.
+    // Queued behind the session's packets on its own worker, so ordering holds.
+    for (const auto& session : sessions) {
+        workers_.post(session->getId(), session, PacketRef());
+    }
+    
+    // Decode-side counters take each session's decode lock - gather them without
+    // holding audio_mutex_ so this thread's own routing is not held up behind a decode
+    Stats agg;
+    uint64_t audio_us = 0;
+    uint64_t suppressed_us = 0;
+    for (size_t i = 0; i < sessions.size(); i++) {
+        ClientSession::Stats s = sessions[i]->getStats();
+        clients[i].session = s;
+        
+        session_drops += s.packets_dropped;
+        agg.packets_dropped_lag += s.packets_dropped_lag;
+        agg.jitter_depth = std::max(agg.jitter_depth, s.jitter.depth);
+        agg.jitter_target_depth = std::max(agg.jitter_target_depth, s.jitter.target_depth);
+        agg.jitter_late += s.jitter.late;
+        agg.jitter_reordered += s.jitter.reordered;
+        agg.jitter_duplicates += s.jitter.duplicates;
+        agg.jitter_lost += s.jitter.lost;
+        agg.jitter_ms = std::max(agg.jitter_ms, s.jitter.jitter_ms);
+        agg.fec_recovered += s.fec_recovered;
+        agg.plc_concealed += s.plc_concealed;
+        audio_us += s.audio_us;
+        suppressed_us += s.dtx_suppressed_us;
+        if (std::abs(s.drift.drift_ppm) >= std::abs(agg.drift_ppm)) {
+            agg.drift_ppm = s.drift.drift_ppm;
+            agg.drift_correction_ppm = s.drift.correction_ppm;
+            agg.mix_level_ms = s.drift.level_ms;
+            agg.mix_level_stddev_ms = s.drift.level_stddev_ms;
         }
     }
-    return stats_;
+    
+    auto stage = [](StageTimer& timer) {
+        StageTimer::Snapshot snap = timer.take();
+        Stats::StageStats out;
+        out.avg_us = snap.avg_us;
+        out.max_us = snap.max_us;
+        return out;
+    };
+    
+    stats_.packets_dropped_lag = agg.packets_dropped_lag;
+    stats_.jitter_depth = agg.jitter_depth;
+    stats_.jitter_target_depth = agg.jitter_target_depth;
+    stats_.jitter_late = agg.jitter_late;
+    stats_.jitter_reordered = agg.jitter_reordered;
+    stats_.jitter_duplicates = agg.jitter_duplicates;
+    stats_.jitter_lost = agg.jitter_lost;
+    stats_.jitter_ms = agg.jitter_ms;
+    stats_.fec_recovered = agg.fec_recovered;
+    stats_.plc_concealed = agg.plc_concealed;
+    stats_.dtx_suppressed_percent = (audio_us + suppressed_us) > 0
+        ? (float)(suppressed_us * 100.0 / (double)(audio_us + suppressed_us)) : 0.0f;
+    stats_.drift_ppm = agg.drift_ppm;
+    stats_.drift_correction_ppm = agg.drift_correction_ppm;
+    stats_.mix_level_ms = agg.mix_level_ms;
+    stats_.mix_level_stddev_ms = agg.mix_level_stddev_ms;
+    
+    // Session counters restart with each session - fold them into the monotonic total
+    // (removed sessions stay in the sum through retired_session_drops_)
+    if (session_drops > session_drops_reported_) {
+        packets_dropped_.add(session_drops - session_drops_reported_);
+    }
+    session_drops_reported_ = session_drops;
+    
+    stats_.is_connected = any_validated;
+    stats_.is_receiving = any_receiving;
+    stats_.is_paused = paused_;
+    
+    // Live counters and gauges: atomics kept by the pipeline threads. The pool is
+    // only read here, on the receive thread, which stop() joins before clearing it.
+    stats_.packets_received = packets_received_.load();
+    stats_.bytes_received = bytes_received_.load();
+    stats_.packets_dropped = packets_dropped_.load();
+    stats_.decode_queue_depth = (uint32_t)workers_.pending();
+    stats_.output_queue_ms = output_queue_ms_.load(std::memory_order_relaxed);
+    stats_.output_queue_usage = output_queue_usage_.load(std::memory_order_relaxed);
+    stats_.device_latency_ms = device_latency_ms_.load(std::memory_order_relaxed);
+    stats_.device_buffer_usage = device_usage_.load(std::memory_order_relaxed);
+    
+    if (now - stage_window_start_ >= std::chrono::milliseconds(STAGE_WINDOW_MS)) {
+        stage_window_start_ = now;
+        stats_.stage_receive = stage(receive_timer_);
+        stats_.stage_queue = stage(queue_timer_);
+        stats_.stage_decode = stage(decode_timer_);
+        stats_.stage_mix = stage(mix_timer_);
+        stats_.stage_device = stage(device_timer_);
+    }
+    
+    std::sort(clients.begin(), clients.end(),
+              [](const Stats::ClientStats& a, const Stats::ClientStats& b) { return a.id < b.id; });
+    stats_.clients = std::move(clients);
+    
+    published_stats_.publish(std::make_shared<const Stats>(stats_));
 }
 
-} // namespace moonmic
+std::shared_ptr<const AudioReceiver::Stats> AudioReceiver::getStats() const {
+    return published_stats_.load();
+}
 
+} // namespace moonmic
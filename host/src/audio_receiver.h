@@ -8,37 +8,28 @@
 #include "config.h"
 #include "sunshine_integration.h"
 #include "sunshine_webui.h"  // Added for setDisplayResolution
-#include "codec/ffmpeg_decoder.h"
 #include "network/udp_receiver.h"
-#include "network/connection_monitor.h"
+#include "network/packet_classifier.h"
 #include "platform/virtual_device.h"
 #include "display_manager.h"
-#include <speex/speex_resampler.h>
+#include "client_session.h"
+#include "audio_mixer.h"
+#include "decode_worker_pool.h"
+#include "pipeline_stats.h"
+#include "platform/spsc_ring.h"
 #include <memory>
 #include <string>
 #include <atomic>
 #include <cstdint>
 #include <chrono>
+#include <condition_variable>
+#include <map>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 namespace moonmic {
 
-// Handshake packet structure (matches libmoonmic client)
-#pragma pack(push, 1)
-struct MoonMicHandshake {
-    uint32_t magic;           // 0x4D4F4F4E ("MOON")
-    uint8_t version;          // 2 (bumped for protocol extension)
-    uint8_t pair_status;      // 0 or 1 from Sunshine validation
-    uint8_t uniqueid_len;     // Length of uniqueid (16)
-    char uniqueid[16];        // Client uniqueid
-    uint8_t devicename_len;   // Length of devicename
-    char devicename[64];      // Device name
-    uint16_t display_width;   // Target display width (0 = don't configure)
-    uint16_t display_height;  // Target display height (0 = don't configure)
-    uint8_t flags;            // Flags (0x01 = FORCE_UPDATE)
-};
-#pragma pack(pop)
-
 // Forward declaration (defined in connection_monitor.h)
 struct MoonMicPing;
 
@@ -47,6 +38,12 @@ struct MoonMicPing;
 
 /**
  * @brief Audio receiver with Opus/PCM support
+ *
+ * Staged pipeline, one thread (or pool) per stage with bounded queues between:
+ *   receive (UDP thread: routing, handshakes) -> SPSC queue per worker ->
+ *   decode (DecodeWorkerPool: jitter buffer, decode, resample) -> MixSource ->
+ *   mix (mixer + output gain) -> SPSC sample ring -> device (VirtualDevice::write)
+ * A blocking device write only stalls the device thread, never socket draining.
  */
 class AudioReceiver {
 public:
@@ -88,26 +85,103 @@ public:
     struct Stats {
         uint64_t packets_received = 0;
         uint64_t packets_dropped = 0;
-        uint64_t packets_dropped_lag = 0; // New: Auto-corrected drops due to lag
+        uint64_t packets_dropped_lag = 0; // Jitter buffer overflow drops (latency cap)
         uint64_t bytes_received = 0;
+        
+        // Jitter buffer
+        uint32_t jitter_depth = 0;         // Packets currently buffered
+        uint32_t jitter_target_depth = 0;  // Adaptive target depth (packets)
+        uint64_t jitter_late = 0;          // Packets that arrived after their playout slot
+        uint64_t jitter_reordered = 0;     // Packets reordered back into sequence
+        uint64_t jitter_duplicates = 0;    // Duplicate packets discarded
+        uint64_t jitter_lost = 0;          // Sequence numbers never received
+        float jitter_ms = 0.0f;            // Interarrival jitter (RFC 3550)
+        
+        // Loss recovery (Opus)
+        uint64_t fec_recovered = 0;        // Lost frames rebuilt from in-band FEC
+        uint64_t plc_concealed = 0;        // Lost frames synthesized by PLC
+        float dtx_suppressed_percent = 0.0f; // Stream time clients suppressed as silence (comfort noise)
+        
+        // Clock drift (session with the largest estimated drift)
+        float drift_ppm = 0.0f;            // Sender + device drift estimate
+        float drift_correction_ppm = 0.0f; // Resampling correction applied
+        float mix_level_ms = 0.0f;         // Mean per-client FIFO level
+        float mix_level_stddev_ms = 0.0f;  // FIFO level variation (buffer stability)
+        
+        // Jitter/loss counters above are summed over sessions; depth and jitter_ms are the worst session
+        int active_clients = 0;      // Sessions currently connected
+        
         std::string last_sender_ip;
-        std::string client_name; 
-        bool is_connected = false;   // Heartbeat alive (client validated)
+        std::string client_name;     // Most recently active client
+        bool is_connected = false;   // Heartbeat alive (any client validated)
         bool is_receiving = false;   // Actually receiving audio data
         bool is_paused = false;      // Receiver is paused
         int rtt_ms = -1;             // Round trip time (ms)
+        
+        // Pipeline: per-stage time, refreshed once per STAGE_WINDOW_MS
+        struct StageStats {
+            float avg_us = 0.0f;
+            float max_us = 0.0f;
+        };
+        StageStats stage_receive;    // Packet routing on the UDP thread
+        StageStats stage_queue;      // Arrival -> decode worker picks it up
+        StageStats stage_decode;     // Jitter buffer + decode + resample
+        StageStats stage_mix;        // Mix + output gain per tick
+        StageStats stage_device;     // VirtualDevice::write
+        uint32_t decode_queue_depth = 0;  // Packets waiting for a decode worker
+        float output_queue_ms = 0.0f;     // Mixed audio waiting for the device thread
+        float device_latency_ms = -1.0f;  // Queued inside the device backend (-1 = not reported)
+        float output_queue_usage = 0.0f;  // Mix -> device ring fill (0..1)
+        float device_buffer_usage = 0.0f; // Device backend's own buffer fill (0..1)
+        
+        // Per-session view (metrics endpoint); sessions in connection order
+        struct ClientStats {
+            uint32_t id = 0;
+            std::string name;
+            std::string ip;
+            uint16_t port = 0;
+            bool validated = false;
+            int rtt_ms = -1;
+            ClientSession::Stats session;
+        };
+        std::vector<ClientStats> clients;
     };
     
-    Stats getStats();  // Checks for connection timeout
+    /**
+     * @brief Current statistics (any thread, never blocks the pipeline)
+     *
+     * The read-only snapshot the receive thread publishes every
+     * HOUSEKEEPING_MS: no copy, no lock, and nothing read from the worker
+     * pool or the output ring. Never null.
+     */
+    std::shared_ptr<const Stats> getStats() const;
     
 private:
-    void onPacketReceived(const uint8_t* data, size_t size, const std::string& sender_ip, uint16_t sender_port, bool is_lagging = false);
+    using SessionPtr = std::shared_ptr<ClientSession>;
+    
+    void onPacketReceived(PacketRef packet);
+    void decodePacket(ClientSession& session, PacketRef packet);  // Decode worker: one packet, or a tick if empty
     bool isClientAllowed(const std::string& ip);
-    bool validateHandshake(const uint8_t* data, size_t size, const std::string& sender_ip, uint16_t& out_w, uint16_t& out_h);
-    void sendControlSignal(uint32_t signal_magic);  // Send STOP/START to client
+    bool validateHandshake(const uint8_t* data, size_t size, const std::string& sender_ip, ClientSession& session);
+    void sendControlSignal(uint32_t signal_magic);  // Send STOP/START to all clients
     bool applyDisplayResolution(uint16_t width, uint16_t height);
     bool applyFallbackDisplayResolution(uint16_t width, uint16_t height);
-    void resetConnectionState();
+    void requestDisplayResolution(uint16_t width, uint16_t height, bool force);  // Queue for the display thread
+    void displayThreadFunc();  // Sunshine WebUI calls (HTTP) - never on the receive thread
+    void resetConnectionState();  // Drop all sessions
+    void housekeeping(std::chrono::steady_clock::time_point now);  // Receive thread: timeouts + stats snapshot
+    
+    // Session table (caller holds audio_mutex_)
+    SessionPtr createSession(const SenderAddress& sender, LatencyProfile profile = LatencyProfile::Unspecified);
+    void removeSession(uint64_t key);
+    ClientSession::Params sessionParams(LatencyProfile profile, const LatencyTargets& targets) const;
+    
+    // Output
+    bool openVirtualDevice(const std::string& output_device);
+    void mixThreadFunc();
+    void deviceThreadFunc();
+    void applyOutputGain(float* buffer, size_t samples);
+    void onStreamStarted();
     
     // Internal helpers that assume mutex is already locked
     void pauseInternal();
@@ -118,38 +192,79 @@ private:
     std::unique_ptr<SunshineIntegration> sunshine_;
     SunshineWebUI* sunshine_webui_ = nullptr;  // Pointer to WebUI instance
     DisplayManager* display_manager_ = nullptr; // Optional direct display control fallback
-    std::unique_ptr<FFmpegDecoder> decoder_;
-    SpeexResamplerState* resampler_;  // Speex resampler (16kHz -> 48kHz)
     std::unique_ptr<UDPReceiver> receiver_;
     std::unique_ptr<VirtualDevice> virtual_device_;
-    std::unique_ptr<ConnectionMonitor> connection_monitor_;
+    
+    // Sessions keyed by SenderAddress::key() (binary ip:port)
+    std::map<uint64_t, SessionPtr> sessions_;
+    uint32_t next_session_id_ = 1;
+    uint64_t session_drops_reported_ = 0;  // Sum of session drop counters at the last housekeeping()
+    uint64_t retired_session_drops_ = 0;   // Final drop counts of removed sessions (audio_mutex_)
+    DecodeWorkerPool workers_;
+    AudioMixer mixer_;
+    std::thread mix_thread_;
     
     std::atomic<bool> running_;
     std::atomic<bool> paused_;
-    Stats stats_;
-    
-    // Handshake validation state
-    bool client_validated_;
-    std::string client_uniqueid_;
-    std::string client_devicename_;
-    std::string last_validated_ip_;  // IP of validated client
     
-    // Auto-detected stream sample rate
-    uint32_t detected_stream_rate_ = 0;
-    int system_sample_rate_ = 0;  // Auto-detected system output rate (48k, 96k, etc)
-    bool rate_logged_ = false;
+    // Stats: hot counters (receive thread) each on their own cache line; housekeeping()
+    // folds them and the gauges below into stats_ and publishes it read-only for getStats()
+    PaddedCounter packets_received_;
+    PaddedCounter bytes_received_;
+    PaddedCounter packets_dropped_;
+    Stats stats_;                              // Receive thread only (stop() after it has joined)
+    PublishedSnapshot<Stats> published_stats_;
     
-    // Connection timeout tracking
-    std::chrono::steady_clock::time_point last_packet_time_;
+    // Last successful validation (grace period while Sunshine restarts)
+    std::string last_validated_ip_;
     std::chrono::steady_clock::time_point last_validated_time_;
-    static constexpr int CONNECTION_TIMEOUT_MS = 2000;  // 2 seconds without packets = disconnected
     
-    // Audio buffers
-    static constexpr size_t MAX_FRAMES = 5760;  // 120ms at 48kHz
-    float decode_buffer_[MAX_FRAMES * 2];  // Decoded audio at 16kHz
-    float resample_buffer_[MAX_FRAMES * 2];  // Resampled audio at 48kHz
+    std::atomic<int> system_sample_rate_;  // Auto-detected system output rate (48k, 96k, etc)
+    LatencyTargets host_targets_;          // Config's latency_profile, or its individual fields (start())
+    
+    // Connection timeout tracking (housekeeping() on the receive thread)
+    static constexpr int CONNECTION_TIMEOUT_MS = 2000;  // 2 seconds without packets = not receiving
+    static constexpr int DISCONNECT_TIMEOUT_MS = 4000;  // 4 seconds = session removed
+    static constexpr int HOUSEKEEPING_MS = 250;         // Timeout checks + stats snapshot period
+    
+    // Mixing
+    static constexpr int MIX_PERIOD_MS = 10;          // Mix thread tick
+    static constexpr int MIX_SOURCE_CAPACITY_MS = 200; // Per-client FIFO cap
+    static constexpr int MIX_CATCHUP_PERIODS = 4;     // Largest block after a stall, in mix periods
+    
+    // Device stage
+    std::thread device_thread_;
+    
+    // Display thread: latest handshake resolution request wins
+    std::thread display_thread_;
+    std::mutex display_mutex_;
+    std::condition_variable display_wake_;
+    bool display_pending_ = false;
+    uint16_t display_width_ = 0;
+    uint16_t display_height_ = 0;
+    bool display_force_ = false;
+    std::atomic<uint32_t> sunshine_resolution_{0};  // Last queried (w << 16) | h, 0 = unknown; for handshake ACKs
+    SpscRing<float> output_ring_;          // Mix thread -> device thread
+    std::mutex output_wake_mutex_;
+    std::condition_variable output_wake_;
+    std::atomic<uint32_t> device_generation_{0};  // Bumped on every device (re)open
+    std::atomic<bool> output_attenuation_{false}; // Steam driver pre-attenuation, per device open
+    std::atomic<float> device_usage_{0.0f};       // Device's own buffer fill after the last write
+    std::atomic<float> device_latency_ms_{-1.0f}; // Device's reported latency after the last write
+    std::atomic<float> output_queue_ms_{0.0f};    // Ring level found by the device thread's last wake
+    std::atomic<float> output_queue_usage_{0.0f};
+    
+    // Per-stage timing (lock-free, drained by housekeeping)
+    StageTimer receive_timer_;
+    StageTimer queue_timer_;
+    StageTimer decode_timer_;
+    StageTimer mix_timer_;
+    StageTimer device_timer_;
+    std::chrono::steady_clock::time_point stage_window_start_;
+    static constexpr int STAGE_WINDOW_MS = 1000;
 
-    std::mutex audio_mutex_; // Protects virtual_device_ and resampler_
+    std::mutex audio_mutex_;   // Protects sessions_ and connection state (never held across device I/O)
+    std::mutex device_mutex_;  // Protects virtual_device_ (device thread vs. device swaps)
 };
 
 } // namespace moonmic
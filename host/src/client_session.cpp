@@ -0,0 +1,520 @@
+/**
+ * @file client_session.cpp
+ * @brief Per-client receive/decode state implementation
+ */
+
+#include "client_session.h"
+#include "../../moonmic_internal.h"  // For MOONMIC_RAW_FLAG / MOONMIC_DTX_FLAG
+#include "../../dsp/moonmic_dsp.h"
+#include "debug.h"
+#include "latency_trace.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace moonmic {
+
+static float frameRms(const float* samples, size_t count) {
+    if (count == 0) {
+        return 0.0f;
+    }
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        sum += (double)samples[i] * samples[i];
+    }
+    return (float)std::sqrt(sum / count);
+}
+
+ClientSession::ClientSession(uint32_t id, const std::string& ip, uint16_t port, const Params& params,
+                             std::shared_ptr<MixSource> source)
+    : id_(id)
+    , ip_(ip)
+    , port_(port)
+    , params_(params)
+    , pending_output_rate_(params.output_rate)
+    , source_(std::move(source))
+    , decode_buffer_(new float[MAX_FRAMES * 2])
+    , resample_buffer_(MAX_FRAMES * 2) {
+    last_packet_time_ = Clock::now();
+    jitter_buffer_.setDepthLimits(params_.jitter_min_depth, params_.jitter_max_depth);
+    drift_.reset(params_.output_rate, (float)params_.drift_target_ms);
+}
+
+ClientSession::~ClientSession() {
+    connection_monitor_.stop();
+    destroyResampler();
+}
+
+void ClientSession::setIdentity(const std::string& uniqueid, const std::string& devicename) {
+    uniqueid_ = uniqueid;
+    devicename_ = devicename;
+}
+
+bool ClientSession::markAudioSeen() {
+    if (audio_seen_) return false;
+    audio_seen_ = true;
+    return true;
+}
+
+void ClientSession::destroyResampler() {
+    if (resampler_) {
+        speex_resampler_destroy(resampler_);
+        resampler_ = nullptr;
+    }
+}
+
+void ClientSession::reset() {
+    std::lock_guard<std::mutex> lock(decode_mutex_);
+
+    // New session starts a fresh sequence space
+    jitter_buffer_.reset();
+
+    // FEC/PLC rely on decoder history - don't carry it over from the previous connection
+    decoder_.reset();
+    opus_decoder_.reset();
+
+    // Force re-creation on next packet with correct rates
+    destroyResampler();
+    stream_rate_ = 0;
+    decode_rate_ = 0;
+    dtx_active_ = false;
+    report_sent_ = false;
+    drift_.reset(params_.output_rate, (float)params_.drift_target_ms);
+
+    if (source_) {
+        source_->clear();
+    }
+    audio_seen_ = false;
+}
+
+void ClientSession::setOutputRate(int rate) {
+    pending_output_rate_ = rate;
+}
+
+ClientSession::Stats ClientSession::getStats() const {
+    std::lock_guard<std::mutex> lock(decode_mutex_);
+    Stats s = stats_;
+    s.jitter = jitter_buffer_.getStats();
+    s.stream_rate = stream_rate_;
+    s.decode_rate = decode_rate_;
+    s.output_rate = (uint32_t)params_.output_rate;
+    s.resample_ratio = (resampler_ && decode_rate_ > 0)
+        ? (double)params_.output_rate * drift_.getRatio() / (double)decode_rate_ : 1.0;
+    s.raw_mode = raw_mode_;
+    s.underruns = source_ ? source_->getUnderruns() : 0;
+    s.drift = drift_.getStats();
+    return s;
+}
+
+bool ClientSession::parseHeader(const uint8_t* data, size_t size, AudioHeader& out) {
+    if (size < MOONMIC_HEADER_SIZE) {
+        return false;
+    }
+
+    // Read field by field - clients (Vita) write the header manually
+    out.magic = ((uint32_t)data[0] << 0) | ((uint32_t)data[1] << 8) |
+                ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+    out.sequence = ((uint32_t)data[4] << 0) | ((uint32_t)data[5] << 8) |
+                   ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+    out.timestamp = ((uint64_t)data[8] << 0) | ((uint64_t)data[9] << 8) |
+                    ((uint64_t)data[10] << 16) | ((uint64_t)data[11] << 24) |
+                    ((uint64_t)data[12] << 32) | ((uint64_t)data[13] << 40) |
+                    ((uint64_t)data[14] << 48) | ((uint64_t)data[15] << 56);
+    out.sample_rate_field = ((uint32_t)data[16] << 0) | ((uint32_t)data[17] << 8) |
+                            ((uint32_t)data[18] << 16) | ((uint32_t)data[19] << 24);
+    return true;
+}
+
+int ClientSession::opusDecodeRate(int device_rate) {
+    switch (device_rate) {
+        case 8000: case 12000: case 16000: case 24000: case 48000:
+            return device_rate;
+        default:
+            return 48000;
+    }
+}
+
+void ClientSession::onAudioPacket(PacketRef packet) {
+    AudioHeader header;
+    if (!packet || !parseHeader(packet.data(), packet.size(), header)) {
+        return;  // AudioReceiver already validated it
+    }
+    const Clock::time_point arrival = packet->arrival;
+
+    std::lock_guard<std::mutex> lock(decode_mutex_);
+    stats_.packets_received++;
+    stats_.bytes_received += packet.size();
+
+    // Device was swapped: rebuild the resampler for the new output rate
+    // (AudioMixer::setFormat already resized our MixSource for it)
+    int output_rate = pending_output_rate_;
+    if (output_rate != params_.output_rate) {
+        if (params_.decoder_rate == 0 && opusDecodeRate(output_rate) != opusDecodeRate(params_.output_rate)) {
+            // The decoder follows the device rate (costs one packet of FEC/PLC history)
+            decoder_.reset();
+            opus_decoder_.reset();
+        }
+        params_.output_rate = output_rate;
+        destroyResampler();
+        stream_rate_ = 0;
+        drift_.reset(params_.output_rate, (float)params_.drift_target_ms);
+    }
+
+    // JITTER BUFFER: order by sequence, drop duplicates and packets that missed their slot
+    // The datagram's slab slot moves into the jitter buffer - no payload copy
+    JitterBuffer::PushResult push_result = jitter_buffer_.push(
+        header.sequence, header.timestamp, header.sample_rate_field, std::move(packet), MOONMIC_HEADER_SIZE);
+
+    if (push_result == JitterBuffer::PushResult::Overflow) {
+        // Buffer exceeded max depth: oldest packet was discarded to cap latency
+        stats_.packets_dropped++;
+        stats_.packets_dropped_lag++;
+        if (stats_.packets_dropped_lag % 50 == 1) {
+            std::cout << "[ClientSession] ⚠ Jitter buffer overflow (" << ip_ << "): dropping oldest packet to cap latency" << std::endl;
+        }
+    } else if (push_result != JitterBuffer::PushResult::Accepted) {
+        stats_.packets_dropped++;
+        return;  // Duplicate, late or oversized
+    }
+
+    // Sender clock vs ours, sampled at arrival (before jitter buffer hold-back)
+    drift_.onPacket(header.timestamp, arrival);
+
+    releaseDuePackets(arrival);
+
+    // Tell the client what arrives here: loss, jitter, buffering
+    if (connection_monitor_.isRunning() &&
+        arrival - last_report_time_ >= std::chrono::milliseconds(MOONMIC_REPORT_INTERVAL_MS)) {
+        last_report_time_ = arrival;
+        sendReceiverReport();
+    }
+}
+
+void ClientSession::onTick(Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(decode_mutex_);
+    releaseDuePackets(now);
+}
+
+void ClientSession::releaseDuePackets(Clock::time_point now) {
+    // Hand every packet that is due to the decoder, in sequence order
+    while (const JitterBuffer::Packet* packet = jitter_buffer_.pop(now)) {
+        processPacket(*packet);
+    }
+}
+
+bool ClientSession::ensureDecoder() {
+    if (opus_decoder_ || decoder_) {
+        return true;
+    }
+
+    // Decode at the device rate when Opus can, so the only resampling left is drift correction
+    int opus_rate = opusDecodeRate(params_.decoder_rate > 0 ? params_.decoder_rate : params_.output_rate);
+
+    // libopus decoder for loss recovery (FFmpeg exposes neither FEC nor PLC)
+    if (params_.enable_fec) {
+        opus_decoder_ = std::make_unique<OpusDecoder>();
+        if (opus_decoder_->init(opus_rate, params_.channels)) {
+            return true;
+        }
+        std::cerr << "[ClientSession] libopus decoder failed, FEC/PLC disabled for " << ip_ << std::endl;
+        opus_decoder_.reset();
+    }
+
+    decoder_ = std::make_unique<FFmpegDecoder>();
+    if (!decoder_->init(opus_rate, params_.channels)) {
+        std::cerr << "[ClientSession] Failed to initialize FFmpeg Opus decoder for " << ip_ << std::endl;
+        decoder_.reset();
+        return false;
+    }
+    return true;
+}
+
+void ClientSession::processPacket(const JitterBuffer::Packet& packet) {
+    bool is_raw_mode = (packet.sample_rate_field & MOONMIC_RAW_FLAG) != 0;
+    bool is_dtx = (packet.sample_rate_field & MOONMIC_DTX_FLAG) != 0;
+    uint32_t stream_rate = packet.sample_rate_field & MOONMIC_RATE_MASK;
+
+    // First packet: log stream info
+    if (stream_rate_ == 0) {
+        stream_rate_ = stream_rate;
+        raw_mode_ = is_raw_mode;
+
+        std::cout << "[ClientSession] ═══ Stream Detected ═══" << std::endl;
+        std::cout << "[ClientSession] Source: " << ip_ << ":" << port_ << " (session " << id_ << ")" << std::endl;
+        std::cout << "[ClientSession] Stream sample rate: " << stream_rate << " Hz" << std::endl;
+        std::cout << "[ClientSession] Output sample rate: " << params_.output_rate << " Hz" << std::endl;
+        std::cout << "[ClientSession] Mode: " << (is_raw_mode ? "RAW PCM" : "Opus") << std::endl;
+        if (!is_raw_mode && !is_dtx) {
+            // Bundled packets decode as one multi-frame Opus packet - nothing else changes
+            std::cout << "[ClientSession] Frames per packet: "
+                      << OpusDecoder::packetFrameCount(packet.data, (int)packet.size) << std::endl;
+        }
+
+        // The resampler runs from what the decoder produces, not from the capture rate
+        if (is_raw_mode) {
+            decode_rate_ = stream_rate;
+        } else if (ensureDecoder()) {
+            decode_rate_ = (uint32_t)(opus_decoder_ ? opus_decoder_->getSampleRate() : decoder_->getSampleRate());
+        } else {
+            stats_.packets_dropped++;
+            stream_rate_ = 0;
+            return;
+        }
+        std::cout << "[ClientSession] Decode sample rate: " << decode_rate_ << " Hz" << std::endl;
+
+        // Create/Recreate resampler - the session's only one
+        // ALWAYS create it, even if rates match, to support Drift Correction
+        int err = 0;
+        destroyResampler();
+
+        resampler_ = speex_resampler_init(
+            params_.channels,
+            decode_rate_,           // Input rate
+            params_.output_rate,    // Output rate
+            10,                     // Quality (0-10, 10 = best)
+            &err
+        );
+
+        if (err != RESAMPLER_ERR_SUCCESS || !resampler_) {
+            std::cerr << "[ClientSession] Failed to create resampler: " << err << std::endl;
+            resampler_ = nullptr;
+            stream_rate_ = 0;
+            return;
+        }
+
+        std::cout << "[ClientSession] ✓ Resampler active: " << decode_rate_ << "Hz → "
+                  << params_.output_rate << "Hz (quality 10)" << std::endl;
+        if ((int)decode_rate_ == params_.output_rate) {
+            std::cout << "[ClientSession] (Resampler enabled for Drift Correction)" << std::endl;
+        }
+        std::cout << "[ClientSession] ═══════════════════════\n" << std::endl;
+    }
+
+    if (is_dtx) {
+        enterDtx(packet, is_raw_mode);
+        return;
+    }
+    if (dtx_active_) {
+        // Sender is talking again: the suppressed stretch ends where this audio starts
+        dtx_active_ = false;
+        if (packet.timestamp > dtx_start_us_) {
+            stats_.dtx_suppressed_us += packet.timestamp - dtx_start_us_;
+        }
+    }
+
+    const uint8_t* payload = packet.data;
+    size_t payload_size = packet.size;
+    int stream_frames = 0;
+
+    float* output_buffer = decode_buffer_.get();
+    int output_frames = 0;
+
+    if (is_raw_mode) {
+        // RAW mode: Convert int16 PCM to float
+        const int16_t* pcm_int16 = (const int16_t*)payload;
+        int num_samples = std::min<int>(payload_size / sizeof(int16_t), MAX_FRAMES * 2);
+        output_frames = num_samples / params_.channels;
+
+        // Convert int16 to float
+        // CRITICAL: Divide by 32768.0f (not 32767.0f) for correct normalization
+        moonmic_dsp_s16_to_float(pcm_int16, decode_buffer_.get(), num_samples);
+        stream_frames = output_frames;
+        last_rms_ = frameRms(decode_buffer_.get(), (size_t)num_samples);
+
+        // Apply resampling / Drift Correction
+        if (!resample(output_frames, output_buffer, output_frames)) {
+            stats_.packets_dropped++;
+            return;
+        }
+    } else {
+        if (!ensureDecoder()) {
+            stats_.packets_dropped++;
+            return;
+        }
+
+        // Opus mode: rebuild frames the jitter buffer gave up on before decoding this one
+        if (packet.lost_before > 0 && opus_decoder_) {
+            recoverLostFrames(packet.lost_before, payload, payload_size);
+        }
+
+        // Decode compressed audio (libopus keeps the state FEC/PLC need)
+        int decoded_frames;
+        {
+            TraceScope trace(TraceStage::Decode);
+            decoded_frames = opus_decoder_
+                ? opus_decoder_->decode(payload, (int)payload_size, decode_buffer_.get(), MAX_FRAMES)
+                : decoder_->decode(payload, payload_size, decode_buffer_.get(), MAX_FRAMES);
+        }
+        if (decoded_frames < 0) {
+            stats_.packets_dropped++;
+            std::cerr << "[ClientSession] Decode failed for packet from " << ip_ << std::endl;
+            return;
+        }
+        stream_frames = decoded_frames;
+
+        if (!resample(decoded_frames, output_buffer, output_frames)) {
+            stats_.packets_dropped++;
+            return;
+        }
+
+        // Log periodically
+        if (++opus_packets_decoded_ % 100 == 1 && opus_packets_decoded_ > 1 && isDebugMode()) {
+            std::cout << "[ClientSession] Processing Opus (" << ip_ << "): decoded=" << decoded_frames
+                      << " frames, output=" << output_frames << " frames @ " << params_.output_rate << "Hz" << std::endl;
+        }
+    }
+
+    stats_.audio_us += (uint64_t)stream_frames * 1000000 / decode_rate_;
+    source_->write(output_buffer, output_frames);
+}
+
+void ClientSession::enterDtx(const JitterBuffer::Packet& packet, bool is_raw_mode) {
+    // Opus markers carry the encoder's DTX frame: decoding it keeps the decoder's
+    // state in step and gives the background level. RAW keeps the last level heard.
+    float level = last_rms_;
+    if (!is_raw_mode && packet.size > 0 && ensureDecoder()) {
+        int frames = opus_decoder_
+            ? opus_decoder_->decode(packet.data, (int)packet.size, decode_buffer_.get(), MAX_FRAMES)
+            : decoder_->decode(packet.data, packet.size, decode_buffer_.get(), MAX_FRAMES);
+        if (frames > 0) {
+            level = frameRms(decode_buffer_.get(), (size_t)frames * params_.channels);
+        }
+    }
+
+    // Keepalive markers repeat every few hundred ms - only the first one starts DTX
+    if (!dtx_active_) {
+        dtx_active_ = true;
+        dtx_start_us_ = packet.timestamp;
+
+        // The FIFO drains on purpose now; don't let the level loop chase it
+        drift_.suspend();
+    }
+    source_->setComfortNoise(std::min(level, MAX_COMFORT_NOISE_RMS));
+}
+
+void ClientSession::applyDriftCorrection(Clock::time_point now) {
+
+    // Client and device clocks drift apart; the Steam driver can drift by 1000Hz+ at 44100Hz.
+    // With several clients each one is corrected against its own mix FIFO.
+    if (!drift_.update(now, source_->available(), source_->getDemandFrames())) {
+        return;
+    }
+
+    // Fractional ratio in milli-Hz: ~0.02ppm resolution, no rounding to whole Hz.
+    // Nominal rates are kept so the anti-aliasing cutoff doesn't move.
+    const double RATE_FRAC_SCALE = 1000.0;
+    spx_uint32_t ratio_num = (spx_uint32_t)(decode_rate_ * RATE_FRAC_SCALE);
+    spx_uint32_t ratio_den = (spx_uint32_t)std::llround(params_.output_rate * RATE_FRAC_SCALE * drift_.getRatio());
+    speex_resampler_set_rate_frac(resampler_, ratio_num, ratio_den, decode_rate_, (spx_uint32_t)params_.output_rate);
+}
+
+void ClientSession::sendReceiverReport() {
+    JitterBuffer::Stats jitter = jitter_buffer_.getStats();
+
+    moonmic_receiver_report_t report = {};
+    report.highest_seq = jitter.highest_seq;
+    report.cumulative_lost = (uint32_t)jitter.lost;
+    report.jitter_us = (uint32_t)std::lround(jitter.jitter_ms * 1000.0f);
+    report.jitter_depth = (uint16_t)std::min<uint32_t>(jitter.depth, 0xFFFF);
+    report.buffer_ms = (uint16_t)std::min<size_t>(source_->available() * 1000 / params_.output_rate, 0xFFFF);
+
+    // RFC 3550 fraction lost: share of the sequences expected since the last report that never came
+    uint32_t expected = jitter.highest_seq - report_highest_seq_;
+    if (report_sent_ && expected > 0 && expected < 0x80000000u && jitter.lost >= report_lost_) {
+        report.fraction_lost = (uint8_t)std::min<uint64_t>((jitter.lost - report_lost_) * 256 / expected, 255);
+    }
+    report_sent_ = true;
+    report_highest_seq_ = jitter.highest_seq;
+    report_lost_ = jitter.lost;
+
+    uint8_t packet[MOONMIC_REPORT_SIZE];
+    moonmic_receiver_report_write(&report, packet);
+    connection_monitor_.sendPacket(packet, sizeof(packet));
+}
+
+void ClientSession::recoverLostFrames(uint32_t lost, const uint8_t* next_payload, size_t next_size) {
+    // The next packet's LBRR data only covers the frame right before it;
+    // anything earlier is concealed. Long gaps are cut short.
+    uint32_t count = std::min(lost, MAX_CONCEALED_FRAMES);
+    bool has_fec = OpusDecoder::packetHasFec(next_payload, (int)next_size);
+
+    for (uint32_t i = 0; i < count; i++) {
+        int frames;
+        if (i == count - 1 && has_fec) {
+            frames = opus_decoder_->decodeFec(next_payload, (int)next_size, decode_buffer_.get(), MAX_FRAMES);
+            if (frames > 0) stats_.fec_recovered++;
+        } else {
+            frames = opus_decoder_->conceal(decode_buffer_.get(), MAX_FRAMES);
+            if (frames > 0) stats_.plc_concealed++;
+        }
+
+        if (frames <= 0) {
+            return;
+        }
+
+        float* output_buffer = decode_buffer_.get();
+        int output_frames = 0;
+        if (resample(frames, output_buffer, output_frames)) {
+            source_->write(output_buffer, output_frames);
+        }
+    }
+}
+
+bool ClientSession::resample(int decoded_frames, float*& output_buffer, int& output_frames) {
+    output_buffer = decode_buffer_.get();
+    output_frames = decoded_frames;
+
+    // Always through the resampler (even at equal rates) - it carries the drift correction
+    if (resampler_) {
+        TraceScope trace(TraceStage::Resample);
+        applyDriftCorrection(Clock::now());
+
+        // Output for the whole packet at the current ratio (drift included): a 120ms bundle
+        // decoded at 48kHz for a 192kHz device, or 16kHz RAW, grows 3-4x. Grown once, reused.
+        const int channels = params_.channels;
+        spx_uint32_t ratio_num = 1, ratio_den = 1;
+        speex_resampler_get_ratio(resampler_, &ratio_num, &ratio_den);
+        size_t max_out = (size_t)decoded_frames * ratio_den / std::max<spx_uint32_t>(ratio_num, 1) + RESAMPLE_SLACK_FRAMES;
+        if (resample_buffer_.size() < max_out * channels) {
+            resample_buffer_.resize(max_out * channels);
+        }
+        max_out = resample_buffer_.size() / channels;
+
+        // Speex may stop short of the input: keep feeding it until the packet is consumed
+        const float* in = decode_buffer_.get();
+        spx_uint32_t in_left = (spx_uint32_t)decoded_frames;
+        size_t out_done = 0;
+        while (in_left > 0 && out_done < max_out) {
+            spx_uint32_t in_len = in_left;
+            spx_uint32_t out_len = (spx_uint32_t)(max_out - out_done);
+            int err = speex_resampler_process_interleaved_float(
+                resampler_,
+                in,
+                &in_len,
+                resample_buffer_.data() + out_done * channels,
+                &out_len
+            );
+
+            if (err != RESAMPLER_ERR_SUCCESS) {
+                std::cerr << "[ClientSession] Resampling failed: " << err << std::endl;
+                return false;
+            }
+            if (in_len == 0 && out_len == 0) {
+                break;  // No progress
+            }
+            in += (size_t)in_len * channels;
+            in_left -= in_len;
+            out_done += out_len;
+        }
+        if (in_left > 0) {
+            stats_.packets_dropped++;  // Tail of the packet didn't fit - an audible gap, so count it
+        }
+
+        output_buffer = resample_buffer_.data();
+        output_frames = (int)out_done;
+    }
+
+    return true;
+}
+
+} // namespace moonmic
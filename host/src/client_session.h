@@ -0,0 +1,212 @@
+/**
+ * @file client_session.h
+ * @brief Per-client receive/decode state for the multi-client host
+ */
+
+#pragma once
+
+#include "codec/ffmpeg_decoder.h"
+#include "codec/opus_decoder.h"
+#include "network/jitter_buffer.h"
+#include "network/connection_monitor.h"
+#include "audio_mixer.h"
+#include "drift_controller.h"
+#include "latency_profile.h"
+#include <speex/speex_resampler.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace moonmic {
+
+/**
+ * @brief One connected client: jitter buffer, decoder, resampler and mix FIFO
+ *
+ * Decode-side methods run on the session's DecodeWorkerPool worker.
+ * Connection-side state (identity, timeouts, heartbeat) is owned by
+ * AudioReceiver and only touched under its lock; the decode side only
+ * sends receiver reports through the (thread-safe) ConnectionMonitor.
+ */
+class ClientSession {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Params {
+        int channels = 1;
+        int decoder_rate = 0;       // Opus decode rate override (0 = follow output_rate)
+        int output_rate = 48000;    // Mixer / device rate
+        bool enable_fec = true;     // libopus with FEC/PLC instead of FFmpeg
+        int jitter_min_depth = 1;
+        int jitter_max_depth = 8;
+        int drift_target_ms = 40;   // MixSource level the drift controller steers to
+        LatencyProfile latency_profile = LatencyProfile::Unspecified;  // Announced in the handshake
+    };
+
+    /**
+     * @brief moonmic audio header (20 bytes, little-endian, written field by field by clients)
+     */
+    struct AudioHeader {
+        uint32_t magic = 0;
+        uint32_t sequence = 0;
+        uint64_t timestamp = 0;          // Sender clock, microseconds
+        uint32_t sample_rate_field = 0;  // Bit 31 = RAW flag, bit 30 = DTX marker
+    };
+
+    /**
+     * @brief Parse the header at the start of an audio datagram
+     * @return false if the datagram is too short
+     */
+    static bool parseHeader(const uint8_t* data, size_t size, AudioHeader& out);
+
+    /**
+     * @brief Rate Opus is decoded at for a device rate: the device rate itself when
+     *        Opus can produce it (8/12/16/24/48kHz), else 48kHz
+     *
+     * Decoding straight to the device rate leaves the session resampler with
+     * drift correction only (ratio ~1).
+     */
+    static int opusDecodeRate(int device_rate);
+
+    struct Stats {
+        uint64_t packets_received = 0;     // Audio datagrams handed to this session
+        uint64_t bytes_received = 0;
+        uint64_t packets_dropped = 0;      // Decode/resample failures and jitter buffer drops
+        uint64_t packets_dropped_lag = 0;  // Jitter buffer overflow drops
+        uint64_t fec_recovered = 0;
+        uint64_t plc_concealed = 0;
+        uint64_t underruns = 0;            // Mix FIFO ran dry
+        uint64_t audio_us = 0;             // Stream time received as audio
+        uint64_t dtx_suppressed_us = 0;    // Stream time the sender suppressed as silence (comfort noise played)
+        JitterBuffer::Stats jitter;
+        DriftController::Stats drift;
+        uint32_t stream_rate = 0;
+        uint32_t decode_rate = 0;          // Resampler input: decoder output rate (stream rate for RAW)
+        uint32_t output_rate = 0;
+        double resample_ratio = 1.0;       // Output / decode rate incl. drift correction (1 = no resampler)
+        bool raw_mode = false;
+    };
+
+    ClientSession(uint32_t id, const std::string& ip, uint16_t port, const Params& params,
+                  std::shared_ptr<MixSource> source);
+    ~ClientSession();
+
+    ClientSession(const ClientSession&) = delete;
+    ClientSession& operator=(const ClientSession&) = delete;
+
+    // ---- Decode side (session worker) ----
+
+    /**
+     * @brief Queue an audio datagram in the jitter buffer and decode everything due
+     * @param packet Complete datagram (header included); the slot is kept until decoded
+     */
+    void onAudioPacket(PacketRef packet);
+
+    /**
+     * @brief Timer tick: decode packets the jitter buffer has held past their delay
+     *
+     * Packet arrival is what normally drains the jitter buffer; once the sender
+     * goes quiet, the packets still held back are only released by this tick.
+     */
+    void onTick(Clock::time_point now);
+
+    /**
+     * @brief Drop buffered audio and decoder history (client reconnected)
+     */
+    void reset();
+
+    /**
+     * @brief Device rate changed - resampler is rebuilt on the next packet
+     */
+    void setOutputRate(int rate);
+
+    Stats getStats() const;
+
+    // ---- Connection side (AudioReceiver, under its lock) ----
+
+    uint32_t getId() const { return id_; }
+    LatencyProfile getLatencyProfile() const { return params_.latency_profile; }
+    const std::string& getIp() const { return ip_; }
+    uint16_t getPort() const { return port_; }
+
+    void setIdentity(const std::string& uniqueid, const std::string& devicename);
+    const std::string& getUniqueId() const { return uniqueid_; }
+    const std::string& getDeviceName() const { return devicename_; }
+
+    void setValidated(bool validated) { validated_ = validated; }
+    bool isValidated() const { return validated_; }
+
+    void touch(Clock::time_point now) { last_packet_time_ = now; }
+    Clock::time_point getLastPacketTime() const { return last_packet_time_; }
+
+    void setRtt(int rtt_ms) { rtt_ms_ = rtt_ms; }
+    int getRtt() const { return rtt_ms_; }
+
+    /**
+     * @brief Returns true exactly once, on the first audio packet of the session
+     */
+    bool markAudioSeen();
+
+    ConnectionMonitor& getConnectionMonitor() { return connection_monitor_; }
+    const std::shared_ptr<MixSource>& getMixSource() const { return source_; }
+
+private:
+    void releaseDuePackets(Clock::time_point now);  // Caller holds decode_mutex_
+    void processPacket(const JitterBuffer::Packet& packet);
+    void enterDtx(const JitterBuffer::Packet& packet, bool is_raw_mode);
+    bool ensureDecoder();
+    void recoverLostFrames(uint32_t lost, const uint8_t* next_payload, size_t next_size);
+    bool resample(int decoded_frames, float*& output_buffer, int& output_frames);
+    void applyDriftCorrection(Clock::time_point now);
+    void sendReceiverReport();
+    void destroyResampler();
+
+    // Identity
+    const uint32_t id_;
+    const std::string ip_;
+    const uint16_t port_;
+    std::string uniqueid_;
+    std::string devicename_;
+    bool validated_ = false;
+    bool audio_seen_ = false;
+    Clock::time_point last_packet_time_;
+    int rtt_ms_ = -1;
+    ConnectionMonitor connection_monitor_;
+
+    // Decode state (guarded by decode_mutex_)
+    mutable std::mutex decode_mutex_;
+    Params params_;
+    std::atomic<int> pending_output_rate_;
+    std::shared_ptr<MixSource> source_;
+    JitterBuffer jitter_buffer_;
+    std::unique_ptr<FFmpegDecoder> decoder_;
+    std::unique_ptr<OpusDecoder> opus_decoder_;
+    SpeexResamplerState* resampler_ = nullptr;
+    uint32_t stream_rate_ = 0;   // Detected from the first packet (0 = not yet)
+    uint32_t decode_rate_ = 0;   // Rate of the PCM handed to the resampler
+    bool raw_mode_ = false;
+    bool dtx_active_ = false;    // Sender is suppressing silence, MixSource plays comfort noise
+    uint64_t dtx_start_us_ = 0;  // Sender timestamp of the marker that started it
+    float last_rms_ = 0.0f;      // Level of the last decoded audio (RAW comfort noise)
+    DriftController drift_;
+    Stats stats_;
+    uint64_t opus_packets_decoded_ = 0;  // Debug log throttle
+
+    // Receiver reports (RTCP RR style, every MOONMIC_REPORT_INTERVAL_MS)
+    Clock::time_point last_report_time_;
+    bool report_sent_ = false;
+    uint32_t report_highest_seq_ = 0;  // Jitter buffer state at the last report
+    uint64_t report_lost_ = 0;
+
+    static constexpr size_t MAX_FRAMES = 5760;  // 120ms at 48kHz
+    static constexpr size_t RESAMPLE_SLACK_FRAMES = 64;  // Rounding + filter state beyond the exact ratio
+    static constexpr uint32_t MAX_CONCEALED_FRAMES = 5;  // PLC fades to silence beyond ~100ms anyway
+    static constexpr float MAX_COMFORT_NOISE_RMS = 0.003f;  // ~-50 dBFS: never louder than a quiet room
+    std::unique_ptr<float[]> decode_buffer_;    // MAX_FRAMES * 2
+    std::vector<float> resample_buffer_;        // Grown to the largest packet x output/decode ratio seen
+};
+
+} // namespace moonmic
@@ -98,37 +98,44 @@ bool FFmpegDecoder::init(int sample_rate, int channels) {
         return false;
     }
     
-    // Initialize resampler (in case decoder outputs planar format, convert to interleaved)
-    swr_ctx_ = swr_alloc();
-    if (!swr_ctx_) {
-        std::cerr << "[FFmpegDecoder] Failed to allocate resampler" << std::endl;
-        cleanup();
-        return false;
-    }
-    
-    // Configure resampler: planar float -> interleaved float
-    av_opt_set_chlayout(swr_ctx_, "in_chlayout", &codec_ctx_->ch_layout, 0);
-    av_opt_set_int(swr_ctx_, "in_sample_rate", sample_rate, 0);
-    av_opt_set_sample_fmt(swr_ctx_, "in_sample_fmt", AV_SAMPLE_FMT_FLTP, 0);  // Planar input
-    
-    av_opt_set_chlayout(swr_ctx_, "out_chlayout", &codec_ctx_->ch_layout, 0);
-    av_opt_set_int(swr_ctx_, "out_sample_rate", sample_rate, 0);
-    av_opt_set_sample_fmt(swr_ctx_, "out_sample_fmt", AV_SAMPLE_FMT_FLT, 0);  // Interleaved output
+    // The decoder may not honour the requested rate (the native Opus decoder is fixed at 48kHz)
+    sample_rate_ = codec_ctx_->sample_rate > 0 ? codec_ctx_->sample_rate : sample_rate;
+    channels_ = channels;
     
-    ret = swr_init(swr_ctx_);
-    if (ret < 0) {
-        char errbuf[256];
-        av_strerror(ret, errbuf, sizeof(errbuf));
-        std::cerr << "[FFmpegDecoder] Failed to initialize resampler: " << errbuf << std::endl;
-        cleanup();
-        return false;
+    // Planar multichannel output needs interleaving; planar mono is already interleaved
+    if (channels > 1) {
+        swr_ctx_ = swr_alloc();
+        if (!swr_ctx_) {
+            std::cerr << "[FFmpegDecoder] Failed to allocate resampler" << std::endl;
+            cleanup();
+            return false;
+        }
+        
+        // Configure resampler: planar float -> interleaved float, no rate change
+        av_opt_set_chlayout(swr_ctx_, "in_chlayout", &codec_ctx_->ch_layout, 0);
+        av_opt_set_int(swr_ctx_, "in_sample_rate", sample_rate_, 0);
+        av_opt_set_sample_fmt(swr_ctx_, "in_sample_fmt", AV_SAMPLE_FMT_FLTP, 0);  // Planar input
+        
+        av_opt_set_chlayout(swr_ctx_, "out_chlayout", &codec_ctx_->ch_layout, 0);
+        av_opt_set_int(swr_ctx_, "out_sample_rate", sample_rate_, 0);
+        av_opt_set_sample_fmt(swr_ctx_, "out_sample_fmt", AV_SAMPLE_FMT_FLT, 0);  // Interleaved output
+        
+        ret = swr_init(swr_ctx_);
+        if (ret < 0) {
+            char errbuf[256];
+            av_strerror(ret, errbuf, sizeof(errbuf));
+            std::cerr << "[FFmpegDecoder] Failed to initialize resampler: " << errbuf << std::endl;
+            cleanup();
+            return false;
+        }
     }
     
-    sample_rate_ = sample_rate;
-    channels_ = channels;
-    
-    std::cout << "[FFmpegDecoder] Initialized: " << sample_rate << "Hz, " 
+    std::cout << "[FFmpegDecoder] Initialized: " << sample_rate_ << "Hz, " 
               << channels << " channels (Opus via FFmpeg)" << std::endl;
+    if (sample_rate_ != sample_rate) {
+        std::cout << "[FFmpegDecoder] Requested " << sample_rate << "Hz, decoder outputs " 
+                  << sample_rate_ << "Hz" << std::endl;
+    }
     return true;
 }
 
@@ -189,7 +196,14 @@ int FFmpegDecoder::decode(const uint8_t* input, int input_size, float* output, i
     }
     
     // Handle both planar and interleaved float formats
-    if (frame_->format == AV_SAMPLE_FMT_FLTP) {
+    if (frame_->format == AV_SAMPLE_FMT_FLTP && !swr_ctx_) {
+        // Planar mono is laid out like interleaved mono - direct copy, no swr pass
+        int frames_to_copy = std::min(num_samples, max_frames);
+        memcpy(output, frame_->data[0], frames_to_copy * sizeof(float));
+        
+        av_frame_unref(frame_); // Unref frame for next decode
+        return frames_to_copy;
+    } else if (frame_->format == AV_SAMPLE_FMT_FLTP) {
         // Planar float - convert to interleaved using SwrContext
         const uint8_t* in_data[AV_NUM_DATA_POINTERS] = {0};
         for (int i = 0; i < codec_ctx_->ch_layout.nb_channels; i++) {
@@ -47,12 +47,18 @@ public:
      */
     int decode(const uint8_t* input, int input_size, float* output, int max_frames);
     
+    /**
+     * Rate decode() actually produces - FFmpeg's native Opus decoder always
+     * outputs 48kHz, whatever rate init() asked for
+     */
+    int getSampleRate() const { return sample_rate_; }
+    
 private:
     const AVCodec* codec_;
     AVCodecContext* codec_ctx_;
     AVFrame* frame_;
     AVPacket* packet_;
-    SwrContext* swr_ctx_;
+    SwrContext* swr_ctx_;  // Planar -> interleaved, multichannel only
     
     int sample_rate_;
     int channels_;
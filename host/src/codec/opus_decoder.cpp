@@ -22,6 +22,11 @@ OpusDecoder::~OpusDecoder() {
 }
 
 bool OpusDecoder::init(int sample_rate, int channels) {
+    if (decoder_) {
+        opus_decoder_destroy(static_cast<::OpusDecoder*>(decoder_));
+        decoder_ = nullptr;
+    }
+    
     int error;
     decoder_ = opus_decoder_create(sample_rate, channels, &error);
     
@@ -71,4 +76,86 @@ int OpusDecoder::decode(const uint8_t* input, int input_size, float* output, int
     return frames;
 }
 
+int OpusDecoder::decodeFec(const uint8_t* next_input, int next_size, float* output, int max_frames) {
+    if (!decoder_ || !next_input || next_size <= 0) {
+        return -1;
+    }
+    
+    // The lost packet is assumed to have the same duration as the one that follows it.
+    // For bundled (multi-frame) packets the LBRR data only covers the last frame;
+    // libopus conceals the leading frames itself when frame_size spans the whole packet.
+    int frame_size = opus_packet_get_nb_samples(next_input, next_size, sample_rate_);
+    if (frame_size <= 0) {
+        return -1;
+    }
+    if (frame_size > max_frames) {
+        frame_size = max_frames;
+    }
+    
+    int frames = opus_decode_float(
+        static_cast<::OpusDecoder*>(decoder_),
+        next_input,
+        next_size,
+        output,
+        frame_size,
+        1  // decode_fec
+    );
+    
+    if (frames < 0) {
+        std::cerr << "[OpusDecoder] FEC decode error: " << opus_strerror(frames) << std::endl;
+        return -1;
+    }
+    
+    return frames;
+}
+
+int OpusDecoder::conceal(float* output, int max_frames) {
+    if (!decoder_) {
+        return -1;
+    }
+    
+    // PLC length must match the previous packet duration
+    opus_int32 frame_size = 0;
+    opus_decoder_ctl(static_cast<::OpusDecoder*>(decoder_), OPUS_GET_LAST_PACKET_DURATION(&frame_size));
+    if (frame_size <= 0) {
+        frame_size = sample_rate_ / 50;  // Nothing decoded yet: assume 20ms
+    }
+    if (frame_size > max_frames) {
+        frame_size = max_frames;
+    }
+    
+    int frames = opus_decode_float(
+        static_cast<::OpusDecoder*>(decoder_),
+        nullptr,
+        0,
+        output,
+        frame_size,
+        0
+    );
+    
+    if (frames < 0) {
+        std::cerr << "[OpusDecoder] PLC error: " << opus_strerror(frames) << std::endl;
+        return -1;
+    }
+    
+    return frames;
+}
+
+bool OpusDecoder::packetHasFec(const uint8_t* input, int input_size) {
+    if (!input || input_size <= 0) {
+        return false;
+    }
+    
+    // TOC config 0-15 = SILK-only / hybrid (LBRR capable), 16-31 = CELT-only (no FEC)
+    return (input[0] >> 3) < 16;
+}
+
+int OpusDecoder::packetFrameCount(const uint8_t* input, int input_size) {
+    if (!input || input_size < 1) {
+        return 0;
+    }
+    int frames = opus_packet_get_nb_frames(input, input_size);
+    return frames > 0 ? frames : 0;
+}
+
 } // namespace moonmic
@@ -18,6 +18,37 @@ public:
     bool reinit(int sample_rate, int channels);  // Recreate decoder with new parameters
     int decode(const uint8_t* input, int input_size, float* output, int max_frames);
     
+    /**
+     * Rebuild the packet lost right before @p next_input from its in-band FEC data
+     * (last frame from FEC, earlier frames of a bundled packet concealed)
+     * @param next_input Packet that followed the lost one
+     * @param next_size Size of next_input in bytes
+     * @param output Output buffer for float samples (interleaved)
+     * @param max_frames Maximum frames to decode
+     * @return Number of frames recovered, or -1 on error
+     */
+    int decodeFec(const uint8_t* next_input, int next_size, float* output, int max_frames);
+    
+    /**
+     * Packet loss concealment: extrapolate one frame from decoder state
+     * @param output Output buffer for float samples (interleaved)
+     * @param max_frames Maximum frames to generate
+     * @return Number of frames generated, or -1 on error
+     */
+    int conceal(float* output, int max_frames);
+    
+    /**
+     * Check whether a packet can carry in-band FEC (SILK or hybrid mode)
+     */
+    static bool packetHasFec(const uint8_t* input, int input_size);
+    
+    /**
+     * Number of Opus frames in a packet (> 1 when the client bundles frames)
+     */
+    static int packetFrameCount(const uint8_t* input, int input_size);
+    
+    int getSampleRate() const { return sample_rate_; }
+    
 private:
     void* decoder_;  // OpusDecoder*
     int sample_rate_;
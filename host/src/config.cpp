@@ -35,6 +35,9 @@ bool Config::load(const std::string& path) {
             auto& s = j["server"];
             if (s.contains("port")) server.port = s["port"];
             if (s.contains("bind_address")) server.bind_address = s["bind_address"];
+            if (s.contains("max_clients")) server.max_clients = s["max_clients"];
+            if (s.contains("metrics_port")) server.metrics_port = s["metrics_port"];
+            if (s.contains("metrics_bind_address")) server.metrics_bind_address = s["metrics_bind_address"];
         }
         
         // Load audio settings
@@ -45,6 +48,13 @@ bool Config::load(const std::string& path) {
             if (a.contains("sample_rate")) audio.sample_rate = a["sample_rate"];  // Backward compat
             if (a.contains("channels")) audio.channels = a["channels"];
             if (a.contains("buffer_size_ms")) audio.buffer_size_ms = a["buffer_size_ms"];
+            if (a.contains("latency_profile")) audio.latency_profile = a["latency_profile"];
+            if (a.contains("jitter_min_depth")) audio.jitter_min_depth = a["jitter_min_depth"];
+            if (a.contains("jitter_max_depth")) audio.jitter_max_depth = a["jitter_max_depth"];
+            if (a.contains("enable_fec")) audio.enable_fec = a["enable_fec"];
+            if (a.contains("decode_threads")) audio.decode_threads = a["decode_threads"];
+            if (a.contains("output_latency_ms")) audio.output_latency_ms = a["output_latency_ms"];
+            if (a.contains("output_prebuf_ms")) audio.output_prebuf_ms = a["output_prebuf_ms"];
             if (a.contains("use_speaker_mode")) audio.use_speaker_mode = a["use_speaker_mode"];
             if (a.contains("driver_device_name")) audio.driver_device_name = a["driver_device_name"];
             if (a.contains("recording_endpoint_name")) audio.recording_endpoint_name = a["recording_endpoint_name"];
@@ -58,6 +68,10 @@ bool Config::load(const std::string& path) {
             }
 
             if (a.contains("driver_type")) audio.driver_type = a["driver_type"];
+            if (a.contains("null_sample_rate")) audio.null_sample_rate = a["null_sample_rate"];
+            if (a.contains("null_period_ms")) audio.null_period_ms = a["null_period_ms"];
+            if (a.contains("null_drift_ppm")) audio.null_drift_ppm = a["null_drift_ppm"];
+            if (a.contains("wav_output_path")) audio.wav_output_path = a["wav_output_path"];
             if (a.contains("auto_set_default_mic")) audio.auto_set_default_mic = a["auto_set_default_mic"];
             if (a.contains("original_mic_id")) audio.original_mic_id = a["original_mic_id"];
         }
@@ -110,16 +124,30 @@ bool Config::save(const std::string& path) {
         
         j["server"]["port"] = server.port;
         j["server"]["bind_address"] = server.bind_address;
+        j["server"]["max_clients"] = server.max_clients;
+        j["server"]["metrics_port"] = server.metrics_port;
+        j["server"]["metrics_bind_address"] = server.metrics_bind_address;
         
         j["audio"]["stream_sample_rate"] = audio.stream_sample_rate;
         j["audio"]["resampling_rate"] = audio.resampling_rate;
         j["audio"]["sample_rate"] = audio.sample_rate;  // Deprecated, for backward compat
         j["audio"]["channels"] = audio.channels;
         j["audio"]["buffer_size_ms"] = audio.buffer_size_ms;
+        j["audio"]["latency_profile"] = audio.latency_profile;
+        j["audio"]["jitter_min_depth"] = audio.jitter_min_depth;
+        j["audio"]["jitter_max_depth"] = audio.jitter_max_depth;
+        j["audio"]["enable_fec"] = audio.enable_fec;
+        j["audio"]["decode_threads"] = audio.decode_threads;
+        j["audio"]["output_latency_ms"] = audio.output_latency_ms;
+        j["audio"]["output_prebuf_ms"] = audio.output_prebuf_ms;
         j["audio"]["use_speaker_mode"] = audio.use_speaker_mode;
         j["audio"]["driver_device_name"] = audio.driver_device_name;
         j["audio"]["recording_endpoint_name"] = audio.recording_endpoint_name;
         j["audio"]["driver_type"] = audio.driver_type;
+        j["audio"]["null_sample_rate"] = audio.null_sample_rate;
+        j["audio"]["null_period_ms"] = audio.null_period_ms;
+        j["audio"]["null_drift_ppm"] = audio.null_drift_ppm;
+        j["audio"]["wav_output_path"] = audio.wav_output_path;
         j["audio"]["auto_set_default_mic"] = audio.auto_set_default_mic;
         j["audio"]["original_mic_id"] = audio.original_mic_id;
         
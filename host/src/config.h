@@ -16,17 +16,32 @@ struct Config {
     struct {
         int port = 48100;
         std::string bind_address = "0.0.0.0";
+        int max_clients = 4;  // Concurrent client sessions mixed into the virtual device
+        int metrics_port = 0;  // OpenMetrics HTTP endpoint in console mode (0 = off)
+        std::string metrics_bind_address = "127.0.0.1";
     } server;
     
     // Audio settings
     struct {
         int stream_sample_rate = 16000;  // Sample rate of incoming stream (e.g., 16kHz from Vita)
-        int resampling_rate = 0;  // Output sample rate (0 = auto-detect from device, or manual override)
+        int resampling_rate = 0;  // Opus decode rate override (0 = the device rate, 48kHz where Opus can't produce it)
         int sample_rate = 0;  // Deprecated: use resampling_rate instead (0 = auto-detect)
         int channels = 1;
         int buffer_size_ms = 20;
+        std::string latency_profile;  // "ultra-low" | "balanced" | "bandwidth-saver" replaces the jitter/output fields
+                                      // below ("" = use them); clients announcing a profile get its jitter targets
+        int jitter_min_depth = 1;  // Jitter buffer hold-back floor (packets)
+        int jitter_max_depth = 8;  // Jitter buffer cap (packets); oldest dropped beyond this
+        bool enable_fec = true;    // Recover lost Opus frames (in-band FEC, PLC fallback) via libopus
+        int decode_threads = 0;    // Decode worker threads (0 = auto)
+        int output_latency_ms = 40;  // Device buffer target (PulseAudio tlength)
+        int output_prebuf_ms = 20;   // Audio buffered before playback (re)starts (PulseAudio prebuf)
         bool use_speaker_mode = false;  // true = play to speakers, false = send to VB-Cable
-        std::string driver_type = "VBCABLE"; // "VBCABLE", "STEAM"
+        std::string driver_type = "VBCABLE"; // "VBCABLE", "STEAM" (Windows); "PIPEWIRE" (Linux); "NULL", "WAVFILE" (any)
+        int null_sample_rate = 48000;     // NULL/WAVFILE: simulated device rate
+        int null_period_ms = 10;          // NULL/WAVFILE: simulated callback period
+        float null_drift_ppm = 0.0f;      // NULL/WAVFILE: device clock error (+ = plays faster than the system clock)
+        std::string wav_output_path = "moonmic-output.wav";  // WAVFILE: recording of what the device played
         std::string driver_device_name = "VB-Audio Virtual Cable"; // For Device Manager
         std::string recording_endpoint_name = "CABLE Output"; // For Audio Mic Setting
         
@@ -612,10 +612,17 @@ void DebugGUI::update(float delta_time, const AudioStats& stats, bool connected,
         total_bytes_ = stats.bytes_received;
         dropped_packets_ = stats.packets_dropped;
         dropped_packets_lag_ = stats.packets_dropped_lag;
+        jitter_depth_ = stats.jitter_depth;
+        jitter_target_depth_ = stats.jitter_target_depth;
+        jitter_ms_ = stats.jitter_ms;
+        fec_recovered_ = stats.fec_recovered;
+        plc_concealed_ = stats.plc_concealed;
+        pipeline_ = stats;
         current_rtt_ = stats.rtt_ms;
         
         // Collect system metrics
         collectSystemMetrics();
+        collectLatencyTrace();
         
         // Add sample
         PerformanceSample sample;
@@ -625,7 +632,7 @@ void DebugGUI::update(float delta_time, const AudioStats& stats, bool connected,
         sample.cpu_usage_percent = current_cpu_;
         sample.memory_mb = current_memory_;
         sample.latency_ms = (current_rtt_ >= 0) ? (float)current_rtt_ : 0.0f;
-        sample.jitter_ms = 0.0f;
+        sample.jitter_ms = stats.jitter_ms;
         sample.packet_loss_percent = (total_packets_ > 0) ? 
             (dropped_packets_ * 100.0f / (total_packets_ + dropped_packets_)) : 0.0f;
         
@@ -804,9 +811,9 @@ void DebugGUI::renderStatisticsTab() {
     ImGui::Text("Packets Dropped:"); ImGui::SameLine(180); ImGui::Text("%llu", (unsigned long long)dropped_packets_);
     
     if (dropped_packets_lag_ > 0) {
-        ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.2f, 1.0f), "Auto-Corrected:"); 
+        ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.2f, 1.0f), "Latency Capped:"); 
         ImGui::SameLine(180); 
-        ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.2f, 1.0f), "%llu (Lag)", (unsigned long long)dropped_packets_lag_);
+        ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.2f, 1.0f), "%llu (Overflow)", (unsigned long long)dropped_packets_lag_);
     }
 
     ImGui::Text("Bytes Received:"); ImGui::SameLine(180); ImGui::Text("%.2f MB", total_bytes_ / (1024.0f * 1024.0f));
@@ -827,6 +834,12 @@ void DebugGUI::renderStatisticsTab() {
     
     ImGui::Text("Packet Loss:"); ImGui::SameLine(120);
     ImGui::TextColored(loss_color, "%.2f%%", loss_percent);
+    ImGui::Text("Jitter:"); ImGui::SameLine(120); ImGui::Text("%.2f ms", jitter_ms_);
+    ImGui::Text("Jitter Buffer:"); ImGui::SameLine(120);
+    ImGui::Text("%u / %u pkts", jitter_depth_, jitter_target_depth_);
+    ImGui::Text("FEC Recovered:"); ImGui::SameLine(120); ImGui::Text("%llu", (unsigned long long)fec_recovered_);
+    ImGui::Text("PLC Concealed:"); ImGui::SameLine(120); ImGui::Text("%llu", (unsigned long long)plc_concealed_);
+    ImGui::Text("DTX Silence:"); ImGui::SameLine(120); ImGui::Text("%.1f%%", pipeline_.dtx_suppressed_percent);
     
     // Quality indicator bar
     ImGui::Text("Stream Quality:");
@@ -834,6 +847,24 @@ void DebugGUI::renderStatisticsTab() {
     ImGui::ProgressBar(quality / 100.0f, ImVec2(-1, 0), "");
     
     ImGui::Columns(1);
+    
+    ImGui::Spacing();
+    ImGui::TextColored(ImVec4(0.6f, 0.8f, 1.0f, 1.0f), "Pipeline");
+    ImGui::Separator();
+    ImGui::Text("Receive:"); ImGui::SameLine(120); ImGui::Text("max %.0f us", pipeline_.receive_max_us);
+    ImGui::Text("Decode Queue:"); ImGui::SameLine(120);
+    ImGui::Text("%u pkts, max wait %.0f us", pipeline_.decode_queue_depth, pipeline_.queue_max_us);
+    ImGui::Text("Decode:"); ImGui::SameLine(120);
+    ImGui::Text("avg %.0f us, max %.0f us", pipeline_.decode_avg_us, pipeline_.decode_max_us);
+    ImGui::Text("Device Write:"); ImGui::SameLine(120);
+    ImGui::Text("max %.0f us, %.1f ms queued", pipeline_.device_max_us, pipeline_.output_queue_ms);
+    if (pipeline_.device_latency_ms >= 0.0f) {
+        ImGui::Text("Device Latency:"); ImGui::SameLine(120); ImGui::Text("%.1f ms", pipeline_.device_latency_ms);
+    }
+    ImGui::Text("Clock Drift:"); ImGui::SameLine(120);
+    ImGui::Text("%+.0f ppm (correcting %+.0f ppm)", pipeline_.drift_ppm, pipeline_.drift_correction_ppm);
+    ImGui::Text("Client Buffer:"); ImGui::SameLine(120);
+    ImGui::Text("%.1f ms +/- %.1f ms", pipeline_.mix_level_ms, pipeline_.mix_level_stddev_ms);
 }
 
 void DebugGUI::renderPerformanceTab() {
@@ -849,6 +880,69 @@ void DebugGUI::renderPerformanceTab() {
     ImGui::Spacing();
     
     memory_graph_->draw(graph_size);
+    ImGui::Spacing();
+    
+    renderLatencyTrace();
+}
+
+void DebugGUI::collectLatencyTrace() {
+    if (!LatencyTrace::ENABLED) return;
+    
+    const LatencyTrace& trace = LatencyTrace::instance();
+    for (int i = 0; i < LatencyTrace::STAGES; i++) {
+        LatencyHistogram::Snapshot snap = trace.snapshot((TraceStage)i);
+        LatencyRow& row = latency_rows_[i];
+        row.count = snap.count;
+        row.mean_us = (float)(snap.meanNs() / 1000.0);
+        row.p50_us = snap.percentileNs(50.0) / 1000.0f;
+        row.p90_us = snap.percentileNs(90.0) / 1000.0f;
+        row.p99_us = snap.percentileNs(99.0) / 1000.0f;
+        row.max_us = snap.max_ns / 1000.0f;
+    }
+}
+
+void DebugGUI::renderLatencyTrace() {
+    ImGui::TextColored(ImVec4(0.6f, 0.8f, 1.0f, 1.0f), "Stage Latency (since reset)");
+    ImGui::Separator();
+    
+    if (!LatencyTrace::ENABLED) {
+        ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f), "Compiled out (MOONMIC_LATENCY_TRACE=OFF)");
+        return;
+    }
+    
+    if (ImGui::Button("Reset")) {
+        LatencyTrace::instance().reset();
+        latency_rows_ = {};
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Dump to Log")) {
+        LatencyTrace::instance().dump(std::cout);
+    }
+    
+    ImGui::Columns(7, "latency_trace", false);
+    const char* headers[] = { "Stage", "Count", "Mean us", "p50 us", "p90 us", "p99 us", "Max us" };
+    for (const char* header : headers) {
+        ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "%s", header);
+        ImGui::NextColumn();
+    }
+    for (int i = 0; i < LatencyTrace::STAGES; i++) {
+        const LatencyRow& row = latency_rows_[i];
+        ImGui::Text("%s", LatencyTrace::stageName((TraceStage)i)); ImGui::NextColumn();
+        if (row.count == 0) {
+            for (int c = 0; c < 6; c++) {
+                ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f), "-");
+                ImGui::NextColumn();
+            }
+            continue;
+        }
+        ImGui::Text("%llu", (unsigned long long)row.count); ImGui::NextColumn();
+        ImGui::Text("%.1f", row.mean_us); ImGui::NextColumn();
+        ImGui::Text("%.1f", row.p50_us); ImGui::NextColumn();
+        ImGui::Text("%.1f", row.p90_us); ImGui::NextColumn();
+        ImGui::Text("%.1f", row.p99_us); ImGui::NextColumn();
+        ImGui::Text("%.1f", row.max_us); ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
 }
 
 void DebugGUI::renderNetworkTab() {
@@ -5,7 +5,9 @@
 
 #pragma once
 
+#include "latency_trace.h"
 #include <imgui.h>
+#include <array>
 #include <deque>
 #include <chrono>
 #include <string>
@@ -23,8 +25,27 @@ namespace moonmic {
 struct AudioStats {
     uint64_t packets_received = 0;
     uint64_t packets_dropped = 0;
-    uint64_t packets_dropped_lag = 0; // New: Auto-corrected drops
+    uint64_t packets_dropped_lag = 0; // Jitter buffer overflow drops
     uint64_t bytes_received = 0;
+    uint32_t jitter_depth = 0;        // Packets held in jitter buffer
+    uint32_t jitter_target_depth = 0; // Adaptive jitter buffer target
+    uint64_t jitter_lost = 0;         // Sequence gaps skipped
+    float jitter_ms = 0.0f;           // Interarrival jitter
+    uint64_t fec_recovered = 0;       // Lost frames rebuilt from Opus FEC
+    uint64_t plc_concealed = 0;       // Lost frames synthesized by Opus PLC
+    float dtx_suppressed_percent = 0.0f; // Stream time clients didn't send (silence)
+    float receive_max_us = 0.0f;      // Pipeline stage timings (max since last update)
+    float queue_max_us = 0.0f;
+    float decode_avg_us = 0.0f;
+    float decode_max_us = 0.0f;
+    float device_max_us = 0.0f;
+    uint32_t decode_queue_depth = 0;  // Packets waiting for a decode worker
+    float output_queue_ms = 0.0f;     // Mixed audio waiting for the device
+    float device_latency_ms = -1.0f;  // Backend-reported output latency (-1 = unknown)
+    float drift_ppm = 0.0f;           // Estimated clock drift (worst client)
+    float drift_correction_ppm = 0.0f;
+    float mix_level_ms = 0.0f;        // Client FIFO level and its variation
+    float mix_level_stddev_ms = 0.0f;
     std::string last_sender_ip;
     std::string client_name;
     bool is_receiving = false;
@@ -238,6 +259,25 @@ private:
     uint64_t total_bytes_ = 0;
     uint64_t dropped_packets_ = 0;
     uint64_t dropped_packets_lag_ = 0; // Cached lag drops
+    uint32_t jitter_depth_ = 0;
+    uint32_t jitter_target_depth_ = 0;
+    float jitter_ms_ = 0.0f;
+    uint64_t fec_recovered_ = 0;
+    uint64_t plc_concealed_ = 0;
+    AudioStats pipeline_;              // Stage timings from the last update
+    
+    // Stage latency histograms (LatencyTrace), summarized at the sample rate
+    struct LatencyRow {
+        uint64_t count = 0;
+        float mean_us = 0.0f;
+        float p50_us = 0.0f;
+        float p90_us = 0.0f;
+        float p99_us = 0.0f;
+        float max_us = 0.0f;
+    };
+    std::array<LatencyRow, LatencyTrace::STAGES> latency_rows_;
+    void collectLatencyTrace();
+    void renderLatencyTrace();
     int current_rtt_ = -1;
     
 #ifdef _WIN32
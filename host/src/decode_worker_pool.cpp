@@ -0,0 +1,109 @@
+/**
+ * @file decode_worker_pool.cpp
+ * @brief Decode worker pool implementation
+ */
+
+#include "decode_worker_pool.h"
+#include <algorithm>
+#include <iostream>
+
+namespace moonmic {
+
+// Queue depth per worker before new tasks are dropped (~1.3s of 20ms packets)
+static constexpr size_t MAX_PENDING_TASKS = 64;
+
+DecodeWorkerPool::DecodeWorkerPool() = default;
+
+DecodeWorkerPool::~DecodeWorkerPool() {
+    stop();
+}
+
+void DecodeWorkerPool::start(size_t threads, Handler handler) {
+    stop();
+    handler_ = std::move(handler);
+
+    if (threads == 0) {
+        size_t cores = std::thread::hardware_concurrency();
+        threads = (cores > 1) ? cores - 1 : 1;
+        threads = std::min<size_t>(threads, 8);
+    }
+
+    for (size_t i = 0; i < threads; i++) {
+        auto worker = std::make_unique<Worker>(MAX_PENDING_TASKS);
+        worker->running = true;
+        worker->thread = std::thread(&DecodeWorkerPool::run, this, worker.get());
+        workers_.push_back(std::move(worker));
+    }
+
+    std::cout << "[DecodeWorkerPool] Started " << threads << " decode worker(s)" << std::endl;
+}
+
+void DecodeWorkerPool::stop() {
+    for (auto& worker : workers_) {
+        worker->running = false;
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->cv.notify_one();
+    }
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+        // Discard what was still queued (releases the packet slots)
+        Job job;
+        while (worker->queue.pop(job)) {
+        }
+    }
+    workers_.clear();
+}
+
+bool DecodeWorkerPool::post(size_t affinity, SessionPtr session, PacketRef packet) {
+    if (workers_.empty()) {
+        if (!handler_) {
+            return false;  // Never started
+        }
+        handler_(*session, std::move(packet));  // Stopped: run inline
+        return true;
+    }
+
+    Worker* worker = workers_[affinity % workers_.size()].get();
+    Job job{std::move(session), std::move(packet)};
+    if (!worker->queue.push(std::move(job))) {
+        return false;  // Worker can't keep up - shed load rather than queue latency
+    }
+
+    // Pairs with the fence in run(): either the worker sees the new task before
+    // parking, or we see it parked and wake it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (worker->sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->cv.notify_one();
+    }
+    return true;
+}
+
+size_t DecodeWorkerPool::pending() const {
+    size_t total = 0;
+    for (const auto& worker : workers_) {
+        total += worker->queue.size();
+    }
+    return total;
+}
+
+void DecodeWorkerPool::run(Worker* worker) {
+    Job job;
+    while (worker->running.load(std::memory_order_acquire)) {
+        if (worker->queue.pop(job)) {
+            handler_(*job.session, std::move(job.packet));
+            job = Job();  // Drop the session reference before parking
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(worker->mutex);
+        worker->sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        worker->cv.wait(lock, [worker] { return !worker->running || !worker->queue.empty(); });
+        worker->sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+} // namespace moonmic
@@ -0,0 +1,96 @@
+/**
+ * @file decode_worker_pool.h
+ * @brief Fixed pool of threads running per-session decode work
+ */
+
+#pragma once
+
+#include "network/packet_slab.h"
+#include "platform/spsc_ring.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace moonmic {
+
+class ClientSession;
+
+/**
+ * @brief Worker threads with per-key ordering
+ *
+ * Tasks posted with the same affinity key always run on the same worker,
+ * in posting order, so a session's packets are decoded sequentially while
+ * different sessions decode in parallel. A task is just the session and the
+ * datagram it processes: the slab slot moves through the queue without a
+ * copy and posting allocates nothing. Every task runs the one handler given
+ * to start().
+ *
+ * Each worker's queue is a bounded wait-free SPSC queue: post() must only be
+ * called from one thread (the UDP receive thread), which then never waits on
+ * a decoding worker. The worker's mutex is only taken to park it when idle.
+ */
+class DecodeWorkerPool {
+public:
+    using SessionPtr = std::shared_ptr<ClientSession>;
+    using Handler = std::function<void(ClientSession& session, PacketRef packet)>;
+
+    DecodeWorkerPool();
+    ~DecodeWorkerPool();
+
+    /**
+     * @brief Start the workers
+     * @param threads Worker count (0 = one per core minus the receive thread, max 8)
+     * @param handler Runs every posted task on its worker
+     */
+    void start(size_t threads, Handler handler);
+
+    /**
+     * @brief Stop workers (pending tasks are discarded)
+     */
+    void stop();
+
+    /**
+     * @brief Queue a task; dropped (slot released) if the worker is backed up
+     * @param packet Datagram to decode, or empty for a timer tick
+     * @return false if the task was dropped
+     */
+    bool post(size_t affinity, SessionPtr session, PacketRef packet);
+
+    size_t size() const { return workers_.size(); }
+
+    /**
+     * @brief Tasks queued across all workers (approximate)
+     */
+    size_t pending() const;
+
+private:
+    struct Job {
+        SessionPtr session;  // Keeps a removed session alive until its last task has run
+        PacketRef packet;
+    };
+
+    struct Worker {
+        explicit Worker(size_t depth) : queue(depth) {}
+
+        std::thread thread;
+        SpscQueue<Job> queue;
+        std::atomic<bool> running{false};
+
+        // Parking only - the queue itself is lock-free
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::atomic<bool> sleeping{false};
+    };
+
+    void run(Worker* worker);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    Handler handler_;  // Set by start() before any worker runs
+};
+
+} // namespace moonmic
@@ -0,0 +1,164 @@
+/**
+ * @file drift_controller.cpp
+ * @brief Clock drift estimation and PI rate control implementation
+ */
+
+#include "drift_controller.h"
+#include <algorithm>
+#include <cmath>
+
+namespace moonmic {
+
+// PI gains on the FIFO level error. The level moves by correction_ppm / 1000 ms
+// per second, so KP = 200 gives a ~5s time constant; KI = KP^2 / 4 (in those
+// units) keeps the loop critically damped.
+static const double KP_PPM_PER_MS = 200.0;
+static const double KI_PPM_PER_MS_S = 10.0;
+static const double LEVEL_ALPHA = 0.2;        // Level low-pass per update (~0.5s)
+static const double ESTIMATE_ALPHA = 0.3;     // Smoothing of successive drift estimates
+static const double RETUNE_PPM = 2.0;         // Skip resampler retunes smaller than this
+static const uint64_t SENDER_JUMP_US = 5000000;  // Timestamp discontinuity = sender restarted
+
+static double clampPpm(double ppm) {
+    return std::max(-(double)DriftController::MAX_CORRECTION_PPM,
+                    std::min((double)DriftController::MAX_CORRECTION_PPM, ppm));
+}
+
+void DriftController::reset(int output_rate, float target_ms) {
+    *this = DriftController();
+    output_rate_ = output_rate > 0 ? output_rate : 48000;
+    target_ms_ = target_ms;
+}
+
+void DriftController::onPacket(uint64_t sender_us, Clock::time_point arrival) {
+    int64_t arrival_us = std::chrono::duration_cast<std::chrono::microseconds>(arrival.time_since_epoch()).count();
+    int64_t transit = arrival_us - (int64_t)sender_us;
+
+    // Sender restarted its clock (or reordering across a wrap): start over
+    if (transit_valid_ && (sender_us + SENDER_JUMP_US < last_sender_us_ ||
+                           sender_us > last_sender_us_ + SENDER_JUMP_US)) {
+        transit_valid_ = false;
+        have_point_ = false;
+    }
+    last_sender_us_ = std::max(last_sender_us_, sender_us);
+    if (!transit_valid_) {
+        last_sender_us_ = sender_us;
+        transit_valid_ = true;
+        window_start_ = arrival;
+        window_min_transit_ = transit;
+        window_min_sender_us_ = sender_us;
+        return;
+    }
+
+    // Least-delayed packet of the window is the one closest to the true clock offset
+    if (transit < window_min_transit_) {
+        window_min_transit_ = transit;
+        window_min_sender_us_ = sender_us;
+    }
+
+    if (arrival - window_start_ < std::chrono::milliseconds(ESTIMATE_WINDOW_MS)) {
+        return;
+    }
+
+    if (have_point_ && window_min_sender_us_ > point_sender_us_) {
+        double ppm = (double)(window_min_transit_ - point_transit_) * 1e6 /
+                     (double)(window_min_sender_us_ - point_sender_us_);
+        ppm = clampPpm(ppm);
+        sender_ppm_ = sender_valid_ ? sender_ppm_ + ESTIMATE_ALPHA * (ppm - sender_ppm_) : ppm;
+        sender_valid_ = true;
+    }
+    have_point_ = true;
+    point_transit_ = window_min_transit_;
+    point_sender_us_ = window_min_sender_us_;
+
+    window_start_ = arrival;
+    window_min_transit_ = transit;
+    window_min_sender_us_ = sender_us;
+}
+
+void DriftController::updateDemand(Clock::time_point now, uint64_t demand_frames) {
+    if (!demand_valid_ || demand_frames < demand_start_frames_) {
+        demand_valid_ = true;
+        demand_start_ = now;
+        demand_start_frames_ = demand_frames;
+        return;
+    }
+
+    auto elapsed = now - demand_start_;
+    if (elapsed < std::chrono::milliseconds(ESTIMATE_WINDOW_MS)) {
+        return;
+    }
+
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    double rate = (double)(demand_frames - demand_start_frames_) / seconds;
+    double ppm = clampPpm((rate / output_rate_ - 1.0) * 1e6);
+    device_ppm_ = device_valid_ ? device_ppm_ + ESTIMATE_ALPHA * (ppm - device_ppm_) : ppm;
+    device_valid_ = true;
+
+    demand_start_ = now;
+    demand_start_frames_ = demand_frames;
+}
+
+void DriftController::updateLevelStats(Clock::time_point now, double level_ms) {
+    level_sum_ += level_ms;
+    level_sum_sq_ += level_ms * level_ms;
+    level_samples_++;
+
+    if (now - level_window_start_ < std::chrono::milliseconds(ESTIMATE_WINDOW_MS)) {
+        return;
+    }
+
+    double mean = level_sum_ / level_samples_;
+    double variance = std::max(0.0, level_sum_sq_ / level_samples_ - mean * mean);
+    stats_.level_ms = (float)mean;
+    stats_.level_stddev_ms = (float)std::sqrt(variance);
+
+    level_window_start_ = now;
+    level_sum_ = 0.0;
+    level_sum_sq_ = 0.0;
+    level_samples_ = 0;
+}
+
+bool DriftController::update(Clock::time_point now, size_t level_frames, uint64_t demand_frames) {
+    double level_ms = (double)level_frames * 1000.0 / output_rate_;
+
+    if (!started_) {
+        started_ = true;
+        last_update_ = now;
+        level_window_start_ = now;
+        level_ms_ = level_ms;
+        updateDemand(now, demand_frames);
+        return false;
+    }
+
+    auto elapsed = now - last_update_;
+    if (elapsed < std::chrono::milliseconds(UPDATE_MS)) {
+        return false;
+    }
+    last_update_ = now;
+    double dt = std::min(1.0, std::chrono::duration<double>(elapsed).count());
+
+    updateDemand(now, demand_frames);
+    updateLevelStats(now, level_ms);
+    level_ms_ += LEVEL_ALPHA * (level_ms - level_ms_);
+
+    // Positive error = FIFO too full = produce fewer samples
+    double error = level_ms_ - target_ms_;
+    integral_ppm_ = clampPpm(integral_ppm_ - KI_PPM_PER_MS_S * error * dt);
+
+    double drift = (sender_valid_ ? sender_ppm_ : 0.0) + (device_valid_ ? device_ppm_ : 0.0);
+    double correction = clampPpm(drift - KP_PPM_PER_MS * error + integral_ppm_);
+
+    stats_.sender_ppm = (float)sender_ppm_;
+    stats_.device_ppm = (float)device_ppm_;
+    stats_.drift_ppm = (float)drift;
+
+    if (std::abs(correction - applied_ppm_) < RETUNE_PPM) {
+        return false;
+    }
+    applied_ppm_ = correction;
+    stats_.correction_ppm = (float)correction;
+    return true;
+}
+
+} // namespace moonmic
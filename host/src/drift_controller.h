@@ -0,0 +1,122 @@
+/**
+ * @file drift_controller.h
+ * @brief Sender/device clock drift estimation and resampler rate control
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace moonmic {
+
+/**
+ * @brief Filtered PI controller for one client's resampling ratio
+ *
+ * Two open-loop estimates give the feed-forward term:
+ *  - sender drift: slope of (local arrival - sender timestamp). Each window
+ *    keeps only its minimum transit time, so queueing delay and jitter
+ *    don't bias the slope.
+ *  - device drift: frames the mixer actually pulled from the client's
+ *    MixSource per local second, against the nominal output rate.
+ * A PI loop on the (low-pass filtered) MixSource fill level removes what the
+ * estimates miss and keeps the FIFO centred on its target.
+ *
+ * The result is a correction in ppm: positive = produce more output samples
+ * per input sample. Not thread-safe; owned by the session's decode side.
+ */
+class DriftController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        float sender_ppm = 0.0f;       // Sender clock vs host clock (+ = sender slow)
+        float device_ppm = 0.0f;       // Mixer demand vs nominal rate (- = device slow)
+        float drift_ppm = 0.0f;        // Estimated total drift (sender + device)
+        float correction_ppm = 0.0f;   // Currently applied resampling correction
+        float level_ms = 0.0f;         // Mean FIFO level over the last stats window
+        float level_stddev_ms = 0.0f;  // FIFO level variation over the last stats window
+    };
+
+    static constexpr int UPDATE_MS = 100;           // Controller period
+    static constexpr int ESTIMATE_WINDOW_MS = 2000; // Min-transit / demand window
+    static constexpr float MAX_CORRECTION_PPM = 80000.0f;  // Steam driver can be off by ~2-5%
+
+    /**
+     * @param output_rate Nominal rate of the MixSource (frames/s)
+     * @param target_ms FIFO level the loop steers to
+     */
+    void reset(int output_rate, float target_ms);
+
+    /**
+     * @brief Feed one datagram's sender timestamp (before jitter buffering)
+     */
+    void onPacket(uint64_t sender_us, Clock::time_point arrival);
+
+    /**
+     * @brief Run the controller if UPDATE_MS has elapsed
+     * @param level_frames Current MixSource fill
+     * @param demand_frames Monotonic count of frames the mixer requested
+     * @return true when the correction moved enough to retune the resampler
+     */
+    bool update(Clock::time_point now, size_t level_frames, uint64_t demand_frames);
+
+    /**
+     * @brief Sender stopped sending (DTX): hold the loop until audio resumes
+     *
+     * The FIFO drains on purpose while the sender is silent, so the level loop
+     * restarts from scratch on the next update; the integral and the drift
+     * estimates are kept.
+     */
+    void suspend() { started_ = false; }
+
+    /**
+     * @brief Output/input ratio multiplier for the resampler (1 + correction)
+     */
+    double getRatio() const { return 1.0 + applied_ppm_ * 1e-6; }
+
+    Stats getStats() const { return stats_; }
+
+private:
+    void updateDemand(Clock::time_point now, uint64_t demand_frames);
+    void updateLevelStats(Clock::time_point now, double level_ms);
+
+    int output_rate_ = 48000;
+    float target_ms_ = 40.0f;
+    Stats stats_;
+
+    // Sender timestamp estimator
+    bool transit_valid_ = false;
+    Clock::time_point window_start_;
+    int64_t window_min_transit_ = 0;
+    uint64_t window_min_sender_us_ = 0;
+    bool have_point_ = false;
+    int64_t point_transit_ = 0;
+    uint64_t point_sender_us_ = 0;
+    uint64_t last_sender_us_ = 0;
+    bool sender_valid_ = false;
+    double sender_ppm_ = 0.0;
+
+    // Device demand estimator
+    bool demand_valid_ = false;
+    Clock::time_point demand_start_;
+    uint64_t demand_start_frames_ = 0;
+    bool device_valid_ = false;
+    double device_ppm_ = 0.0;
+
+    // PI loop
+    bool started_ = false;
+    Clock::time_point last_update_;
+    double level_ms_ = 0.0;   // Low-pass filtered FIFO level
+    double integral_ppm_ = 0.0;
+    double applied_ppm_ = 0.0;
+
+    // Level stability window
+    Clock::time_point level_window_start_;
+    double level_sum_ = 0.0;
+    double level_sum_sq_ = 0.0;
+    uint32_t level_samples_ = 0;
+};
+
+} // namespace moonmic
@@ -0,0 +1,107 @@
+/**
+ * @file latency_profile.h
+ * @brief Host buffering targets for the client latency profiles (moonmic_config_t::latency_profile)
+ */
+
+#pragma once
+
+#include "network/packet_classifier.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace moonmic {
+
+/**
+ * @brief Latency profile a client announces in its handshake (values match MOONMIC_PROFILE_*)
+ *
+ * The client picks frame size, Opus application and complexity from the
+ * profile; the host sizes that client's jitter buffer and mix FIFO to match.
+ */
+enum class LatencyProfile : int {
+    Unspecified = -1,    // Not announced (older clients): host config targets
+    Balanced = 0,        // 20ms frames
+    UltraLow = 1,        // 5ms frames
+    BandwidthSaver = 2   // 40ms frames
+};
+
+/**
+ * @brief How much audio the host holds back for a stream
+ */
+struct LatencyTargets {
+    int mix_target_ms = 40;      // Per-client mix FIFO prime level / drift target
+    int jitter_min_depth = 1;    // Jitter buffer hold-back floor (packets)
+    int jitter_max_depth = 8;    // Jitter buffer cap (packets)
+    int output_latency_ms = 40;  // Device buffer target
+    int output_prebuf_ms = 20;   // Device prebuffer
+};
+
+/**
+ * @brief Targets of a profile (Unspecified returns the built-in defaults, same as Balanced)
+ *
+ * Jitter depths are in packets, so they scale with the profile's frame
+ * size: ultra-low holds 10-60ms of 5ms packets, bandwidth-saver 40-160ms
+ * of 40ms packets.
+ */
+inline LatencyTargets latencyTargets(LatencyProfile profile) {
+    LatencyTargets targets;
+    switch (profile) {
+        case LatencyProfile::UltraLow:
+            targets.mix_target_ms = 20;
+            targets.jitter_min_depth = 2;
+            targets.jitter_max_depth = 12;
+            targets.output_latency_ms = 20;
+            targets.output_prebuf_ms = 10;
+            break;
+        case LatencyProfile::BandwidthSaver:
+            targets.mix_target_ms = 80;
+            targets.jitter_min_depth = 1;
+            targets.jitter_max_depth = 4;
+            targets.output_latency_ms = 60;
+            targets.output_prebuf_ms = 30;
+            break;
+        default:
+            break;
+    }
+    return targets;
+}
+
+inline const char* latencyProfileName(LatencyProfile profile) {
+    switch (profile) {
+        case LatencyProfile::Balanced: return "balanced";
+        case LatencyProfile::UltraLow: return "ultra-low";
+        case LatencyProfile::BandwidthSaver: return "bandwidth-saver";
+        default: return "unspecified";
+    }
+}
+
+/**
+ * @brief Parse a config / command line name ("ultra-low", "balanced", "bandwidth-saver")
+ * @return false for an empty or unknown name (out unchanged)
+ */
+inline bool parseLatencyProfile(const std::string& name, LatencyProfile& out) {
+    for (LatencyProfile profile : { LatencyProfile::Balanced, LatencyProfile::UltraLow, LatencyProfile::BandwidthSaver }) {
+        if (name == latencyProfileName(profile)) {
+            out = profile;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Profile announced in a handshake's flags byte (bits 1-2 = profile + 1)
+ */
+inline LatencyProfile handshakeLatencyProfile(const uint8_t* data, size_t size) {
+    if (size < sizeof(MoonMicHandshake)) {
+        return LatencyProfile::Unspecified;
+    }
+    uint8_t flags = data[offsetof(MoonMicHandshake, flags)];
+    int value = ((flags & HANDSHAKE_FLAG_PROFILE_MASK) >> HANDSHAKE_FLAG_PROFILE_SHIFT) - 1;
+    if (value > (int)LatencyProfile::BandwidthSaver) {
+        return LatencyProfile::Unspecified;
+    }
+    return (LatencyProfile)value;
+}
+
+} // namespace moonmic
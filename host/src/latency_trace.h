@@ -0,0 +1,273 @@
+/**
+ * @file latency_trace.h
+ * @brief Per-stage latency histograms for the host pipeline (datagram -> device)
+ *
+ * Each stage records durations into a log-linear histogram (HDR style: 16
+ * sub-buckets per power of two, so any value is reported within 6.25%) made
+ * of relaxed atomic counters - recording is wait-free and safe from the
+ * realtime audio callback. Readers (debug GUI, dump()) copy a snapshot and
+ * compute percentiles from it.
+ *
+ * Built with -DMOONMIC_LATENCY_TRACE=0 (CMake option MOONMIC_LATENCY_TRACE=OFF)
+ * every hook below is an empty inline function and TraceScope an empty
+ * object, so no clock is read and nothing is stored on the audio path.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+
+#ifndef MOONMIC_LATENCY_TRACE
+#define MOONMIC_LATENCY_TRACE 1
+#endif
+
+namespace moonmic {
+
+/**
+ * @brief Where a datagram's audio spends its time on the way to the speaker, in path order
+ */
+enum class TraceStage : int {
+    SocketReceive = 0,  // Kernel timestamp -> recvmmsg() returned (Linux batch receive only)
+    Route,              // Classification + session routing on the receive thread
+    DecodeQueue,        // recvmmsg() returned -> decode worker picks the packet up
+    Decode,             // Opus / FFmpeg decode of one packet
+    Resample,           // Speex resample + drift correction of one packet
+    OutputQueue,        // Mixed audio waiting in the mix -> device ring
+    DeviceWrite,        // VirtualDevice::write()
+    DeviceRing,         // Audio waiting in the backend's own ring (PortAudio, NULL/WAVFILE)
+    Count
+};
+
+/**
+ * @brief Lock-free log-linear histogram of nanosecond values
+ */
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 35;  // 2^35 ns = 34s; longer values are clamped
+    static constexpr int BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+    static constexpr uint64_t MAX_VALUE = (1ull << MAX_EXPONENT) - 1;
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum_ns = 0;
+        uint64_t max_ns = 0;
+        std::array<uint64_t, BUCKETS> buckets{};
+
+        double meanNs() const { return count ? (double)sum_ns / (double)count : 0.0; }
+
+        // Upper bound of the bucket holding the p-th percentile (never above the recorded max)
+        uint64_t percentileNs(double p) const {
+            if (count == 0) return 0;
+            uint64_t target = (uint64_t)(p / 100.0 * (double)count + 0.5);
+            if (target == 0) target = 1;
+            uint64_t seen = 0;
+            for (int i = 0; i < BUCKETS; i++) {
+                seen += buckets[i];
+                if (seen >= target) {
+                    uint64_t upper = bucketUpper(i);
+                    return upper < max_ns ? upper : max_ns;
+                }
+            }
+            return max_ns;
+        }
+    };
+
+    static int bucketIndex(uint64_t value) {
+        if (value > MAX_VALUE) value = MAX_VALUE;
+        if (value < (uint64_t)(2 * SUB_BUCKETS)) return (int)value;
+        int exponent = 63 - __builtin_clzll(value);
+        int shift = exponent - SUB_BUCKET_BITS;
+        return shift * SUB_BUCKETS + (int)(value >> shift);
+    }
+
+    static uint64_t bucketUpper(int index) {
+        if (index < 2 * SUB_BUCKETS) return (uint64_t)index;
+        int shift = index / SUB_BUCKETS - 1;
+        uint64_t sub = (uint64_t)(index % SUB_BUCKETS + SUB_BUCKETS);
+        return ((sub + 1) << shift) - 1;
+    }
+
+    void record(uint64_t ns) {
+        buckets_[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t max = max_ns_.load(std::memory_order_relaxed);
+        while (ns > max && !max_ns_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Counters are read one by one: a record() racing the copy may be half in it - fine for monitoring
+    Snapshot snapshot() const {
+        Snapshot s;
+        for (int i = 0; i < BUCKETS; i++) {
+            s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        s.count = count_.load(std::memory_order_relaxed);
+        s.sum_ns = sum_ns_.load(std::memory_order_relaxed);
+        s.max_ns = max_ns_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    void reset() {
+        for (auto& bucket : buckets_) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        sum_ns_.store(0, std::memory_order_relaxed);
+        max_ns_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+};
+
+/**
+ * @brief Process-wide set of stage histograms
+ *
+ * One instance, so backends that never see the AudioReceiver (the PortAudio
+ * callback) can record into it too. Histograms accumulate until reset().
+ */
+class LatencyTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr bool ENABLED = MOONMIC_LATENCY_TRACE != 0;
+    static constexpr int STAGES = (int)TraceStage::Count;
+
+    static LatencyTrace& instance() {
+        static LatencyTrace trace;
+        return trace;
+    }
+
+    static const char* stageName(TraceStage stage) {
+        static const char* names[STAGES] = {
+            "socket_receive", "route", "decode_queue", "decode",
+            "resample", "output_queue", "device_write", "device_ring"
+        };
+        return names[(int)stage];
+    }
+
+    void record(TraceStage stage, uint64_t ns) {
+        if (ENABLED) histograms_[(int)stage].record(ns);
+    }
+
+    void record(TraceStage stage, Clock::duration duration) {
+        if (ENABLED) {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+            histograms_[(int)stage].record(ns > 0 ? (uint64_t)ns : 0);
+        }
+    }
+
+    // Audio waiting in a FIFO drained at a constant rate: the oldest of it has waited queued / rate
+    void recordQueued(TraceStage stage, size_t queued_frames, int sample_rate) {
+        if (ENABLED && sample_rate > 0) {
+            histograms_[(int)stage].record((uint64_t)queued_frames * 1000000000ull / (uint64_t)sample_rate);
+        }
+    }
+
+    LatencyHistogram::Snapshot snapshot(TraceStage stage) const {
+        return histograms_[(int)stage].snapshot();
+    }
+
+    void reset() {
+        for (auto& histogram : histograms_) {
+            histogram.reset();
+        }
+    }
+
+    /**
+     * @brief Text table (microseconds) of every stage that has samples, plus the raw buckets
+     */
+    void dump(std::ostream& out) const {
+        if (!ENABLED) {
+            out << "[LatencyTrace] Compiled out (MOONMIC_LATENCY_TRACE=OFF)" << std::endl;
+            return;
+        }
+        out << "[LatencyTrace] Stage latency (us)" << std::endl;
+        out << "  " << std::left << std::setw(16) << "stage" << std::right
+            << std::setw(10) << "count" << std::setw(10) << "mean" << std::setw(10) << "p50"
+            << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+            << std::setw(10) << "max" << std::endl;
+        out << std::fixed << std::setprecision(1);
+        for (int i = 0; i < STAGES; i++) {
+            LatencyHistogram::Snapshot s = histograms_[i].snapshot();
+            if (s.count == 0) continue;
+            out << "  " << std::left << std::setw(16) << stageName((TraceStage)i) << std::right
+                << std::setw(10) << s.count << std::setw(10) << s.meanNs() / 1000.0
+                << std::setw(10) << s.percentileNs(50.0) / 1000.0 << std::setw(10) << s.percentileNs(90.0) / 1000.0
+                << std::setw(10) << s.percentileNs(99.0) / 1000.0 << std::setw(10) << s.percentileNs(99.9) / 1000.0
+                << std::setw(10) << s.max_ns / 1000.0 << std::endl;
+        }
+        // Bucket upper bound (ns):count, for offline plotting
+        for (int i = 0; i < STAGES; i++) {
+            LatencyHistogram::Snapshot s = histograms_[i].snapshot();
+            if (s.count == 0) continue;
+            out << "  buckets " << stageName((TraceStage)i) << ":";
+            for (int b = 0; b < LatencyHistogram::BUCKETS; b++) {
+                if (s.buckets[b]) out << " " << LatencyHistogram::bucketUpper(b) << ":" << s.buckets[b];
+            }
+            out << std::endl;
+        }
+        out << std::defaultfloat;
+    }
+
+private:
+    LatencyTrace() = default;
+
+    std::array<LatencyHistogram, STAGES> histograms_;
+};
+
+/**
+ * @brief Pipeline entry points: with tracing compiled out they are empty, so hot
+ *        paths emit no call (not even instance()'s static-init guard)
+ */
+#if MOONMIC_LATENCY_TRACE
+inline void traceRecord(TraceStage stage, LatencyTrace::Clock::duration duration) {
+    LatencyTrace::instance().record(stage, duration);
+}
+inline void traceRecordNs(TraceStage stage, uint64_t ns) {
+    LatencyTrace::instance().record(stage, ns);
+}
+inline void traceQueued(TraceStage stage, size_t queued_frames, int sample_rate) {
+    LatencyTrace::instance().recordQueued(stage, queued_frames, sample_rate);
+}
+#else
+inline void traceRecord(TraceStage, LatencyTrace::Clock::duration) {}
+inline void traceRecordNs(TraceStage, uint64_t) {}
+inline void traceQueued(TraceStage, size_t, int) {}
+#endif
+
+#if MOONMIC_LATENCY_TRACE
+/**
+ * @brief Records the lifetime of the enclosing scope into a stage histogram
+ */
+class TraceScope {
+public:
+    explicit TraceScope(TraceStage stage) : stage_(stage), start_(LatencyTrace::Clock::now()) {}
+    ~TraceScope() { traceRecord(stage_, LatencyTrace::Clock::now() - start_); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    TraceStage stage_;
+    LatencyTrace::Clock::time_point start_;
+};
+#else
+class TraceScope {
+public:
+    explicit TraceScope(TraceStage) {}
+};
+#endif
+
+} // namespace moonmic
@@ -15,9 +15,12 @@
 #include "version_checker.h"
 #include "debug_gui.h"
 #include "gui_helper.h"
+#include "latency_trace.h"
+#include "metrics_server.h"
 #include "version.h"  // Auto-generated by CMake
 #include <iostream>
 #include <csignal>
+#include <cstdlib>
 #include <thread>
 #include <chrono>
 #include <future>
@@ -58,6 +61,15 @@ static std::string g_latest_version;
 static std::string g_download_url;
 #endif
 
+#ifndef _WIN32
+// SIGUSR1: dump the stage latency histograms (console mode)
+static volatile sig_atomic_t g_dump_latency_trace = 0;
+
+static void dump_signal_handler(int) {
+    g_dump_latency_trace = 1;
+}
+#endif
+
 void signal_handler(int signal) {
     std::cout << "\n[Main] Shutting down..." << std::endl;
     g_running = false;
@@ -703,7 +715,8 @@ void renderGUI(GLFWwindow* window, AudioReceiver& receiver, SunshineIntegration&
     ImGui::Separator();
     
     // Status Indicators (simplified - LEDs instead of detailed stats)
-    auto stats = receiver.getStats();
+    auto snapshot = receiver.getStats();
+    const auto& stats = *snapshot;
     bool connected = stats.is_connected;
     bool receiving = stats.is_receiving;
     bool paused = stats.is_paused;
@@ -714,7 +727,9 @@ void renderGUI(GLFWwindow* window, AudioReceiver& receiver, SunshineIntegration&
     // Show client info if connected
     if (connected) {
         ImGui::SameLine(ImGui::GetWindowWidth() - 200);
-        if (!stats.client_name.empty()) {
+        if (stats.active_clients > 1) {
+            ImGui::TextColored(ImVec4(0.5f, 0.8f, 1.0f, 1.0f), "%d clients", stats.active_clients);
+        } else if (!stats.client_name.empty()) {
             ImGui::TextColored(ImVec4(0.5f, 0.8f, 1.0f, 1.0f), "%s", stats.client_name.c_str());
         } else {
             ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "%s", stats.last_sender_ip.c_str());
@@ -1316,8 +1331,7 @@ int main_gui(int argc, char* argv[]) {
     while (!glfwWindowShouldClose(window) && g_running) {
         // Calculate states for power management
         // Note: We access previous frame stats here, which is fine
-        auto temp_stats = receiver.getStats();
-        bool is_active = temp_stats.is_receiving || g_debug_mode || g_update_available;
+        bool is_active = receiver.getStats()->is_receiving || g_debug_mode || g_update_available;
         
         if (glfwGetWindowAttrib(window, GLFW_ICONIFIED)) {
             // Minimized: Extremely low refresh (1Hz)
@@ -1344,7 +1358,8 @@ int main_gui(int argc, char* argv[]) {
         last_time = now;
         
         // Get current audio stats and convert to AudioStats
-        auto receiver_stats = receiver.getStats();
+        auto receiver_snapshot = receiver.getStats();
+        const auto& receiver_stats = *receiver_snapshot;
         bool connected = !receiver_stats.last_sender_ip.empty();
         bool receiving = receiver_stats.is_receiving;
         
@@ -1354,6 +1369,25 @@ int main_gui(int argc, char* argv[]) {
         stats.packets_dropped = receiver_stats.packets_dropped;
         stats.packets_dropped_lag = receiver_stats.packets_dropped_lag;
         stats.bytes_received = receiver_stats.bytes_received;
+        stats.jitter_depth = receiver_stats.jitter_depth;
+        stats.jitter_target_depth = receiver_stats.jitter_target_depth;
+        stats.jitter_lost = receiver_stats.jitter_lost;
+        stats.jitter_ms = receiver_stats.jitter_ms;
+        stats.fec_recovered = receiver_stats.fec_recovered;
+        stats.plc_concealed = receiver_stats.plc_concealed;
+        stats.dtx_suppressed_percent = receiver_stats.dtx_suppressed_percent;
+        stats.receive_max_us = receiver_stats.stage_receive.max_us;
+        stats.queue_max_us = receiver_stats.stage_queue.max_us;
+        stats.decode_avg_us = receiver_stats.stage_decode.avg_us;
+        stats.decode_max_us = receiver_stats.stage_decode.max_us;
+        stats.device_max_us = receiver_stats.stage_device.max_us;
+        stats.decode_queue_depth = receiver_stats.decode_queue_depth;
+        stats.output_queue_ms = receiver_stats.output_queue_ms;
+        stats.device_latency_ms = receiver_stats.device_latency_ms;
+        stats.drift_ppm = receiver_stats.drift_ppm;
+        stats.drift_correction_ppm = receiver_stats.drift_correction_ppm;
+        stats.mix_level_ms = receiver_stats.mix_level_ms;
+        stats.mix_level_stddev_ms = receiver_stats.mix_level_stddev_ms;
         stats.last_sender_ip = receiver_stats.last_sender_ip;
         stats.client_name = receiver_stats.client_name;
         stats.is_receiving = receiver_stats.is_receiving;
@@ -1480,9 +1514,20 @@ int main_console(int argc, char* argv[]) {
         std::cout << "[Main] Using default configuration" << std::endl;
     }
     
+    // --metrics-port overrides server.metrics_port (not saved)
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--metrics-port" && i + 1 < argc) {
+            config.server.metrics_port = std::atoi(argv[i + 1]);
+            i++;
+        }
+    }
+    
     // Setup signal handler
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+#ifndef _WIN32
+    signal(SIGUSR1, dump_signal_handler);
+#endif
     
     // Create audio receiver
     AudioReceiver receiver;
@@ -1494,21 +1539,43 @@ int main_console(int argc, char* argv[]) {
         return 1;
     }
     
+    // Scrapes are served from the stats this loop publishes - never from the receiver itself
+    MetricsServer metrics;
+    if (config.server.metrics_port > 0) {
+        metrics.start(config.server.metrics_port, config.server.metrics_bind_address);
+    }
+    
     std::cout << "[Main] Press Ctrl+C to stop" << std::endl;
     
     // Main loop
     while (g_running) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
         
+#ifndef _WIN32
+        if (g_dump_latency_trace) {
+            g_dump_latency_trace = 0;
+            LatencyTrace::instance().dump(std::cout);
+        }
+#endif
+        
         // Print stats periodically
-        auto stats = receiver.getStats();
+        auto snapshot = receiver.getStats();
+        const auto& stats = *snapshot;
+        if (metrics.isRunning()) {
+            metrics.publish(snapshot);
+        }
         if (stats.is_receiving) {
             std::cout << "[Stats] Packets: " << stats.packets_received 
                       << " | Dropped: " << stats.packets_dropped
+                      << " | FEC: " << stats.fec_recovered
+                      << " | PLC: " << stats.plc_concealed
+                      << " | DTX: " << (int)(stats.dtx_suppressed_percent + 0.5f) << "%"
+                      << " | Clients: " << stats.active_clients
                       << " | From: " << stats.last_sender_ip << std::endl;
         }
     }
     
+    metrics.stop();
     receiver.stop();
 
 #ifdef _WIN32
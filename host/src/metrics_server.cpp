@@ -0,0 +1,463 @@
+/**
+ * @file metrics_server.cpp
+ * @brief OpenMetrics text exposition over a minimal HTTP server
+ */
+
+#include "metrics_server.h"
+#include "latency_trace.h"
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define closesocket close
+#endif
+
+namespace moonmic {
+
+namespace {
+
+constexpr int ACCEPT_POLL_MS = 200;     // stop() latency
+constexpr int CLIENT_TIMEOUT_MS = 2000; // Slow or idle scraper: give up on the request
+constexpr size_t MAX_REQUEST_SIZE = 4096;
+
+const char* const CONTENT_TYPE = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+/**
+ * @brief Appends metric families in OpenMetrics text format
+ *
+ * Every sample of a family must follow its # TYPE line, so callers emit one
+ * family at a time (all clients, then the next family).
+ */
+class MetricsWriter {
+public:
+    explicit MetricsWriter(std::string& out) : out_(out) {}
+
+    void family(const char* name, const char* type, const char* help) {
+        out_ += "# TYPE ";
+        out_ += name;
+        out_ += ' ';
+        out_ += type;
+        out_ += "\n# HELP ";
+        out_ += name;
+        out_ += ' ';
+        out_ += help;
+        out_ += '\n';
+    }
+
+    // labels: preformatted `key="value",...` (see label()), or empty
+    void sample(const char* name, const char* suffix, const std::string& labels, double value) {
+        out_ += name;
+        out_ += suffix;
+        if (!labels.empty()) {
+            out_ += '{';
+            out_ += labels;
+            out_ += '}';
+        }
+        char buf[32];
+        snprintf(buf, sizeof(buf), " %.9g\n", value);
+        out_ += buf;
+    }
+
+    void sample(const char* name, const char* suffix, const std::string& labels, uint64_t value) {
+        out_ += name;
+        out_ += suffix;
+        if (!labels.empty()) {
+            out_ += '{';
+            out_ += labels;
+            out_ += '}';
+        }
+        out_ += ' ';
+        out_ += std::to_string(value);
+        out_ += '\n';
+    }
+
+    void gauge(const char* name, const char* help, double value) {
+        family(name, "gauge", help);
+        sample(name, "", std::string(), value);
+    }
+
+    void counter(const char* name, const char* help, uint64_t value) {
+        family(name, "counter", help);
+        sample(name, "_total", std::string(), value);
+    }
+
+    static std::string label(const char* key, const std::string& value) {
+        std::string out = key;
+        out += "=\"";
+        for (char c : value) {
+            if (c == '\\') out += "\\\\";
+            else if (c == '"') out += "\\\"";
+            else if (c == '\n') out += "\\n";
+            else out += c;
+        }
+        out += '"';
+        return out;
+    }
+
+    void eof() { out_ += "# EOF\n"; }
+
+private:
+    std::string& out_;
+};
+
+template <typename Socket>
+bool sendAll(Socket fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int n = send(fd, data.data() + sent, (int)(data.size() - sent), 0);
+        if (n <= 0) {
+            return false;
+        }
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+} // namespace
+
+MetricsServer::MetricsServer()
+    : listen_fd_(INVALID_SOCKET) {
+#ifdef _WIN32
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool MetricsServer::start(int port, const std::string& bind_address) {
+    if (running_) {
+        return false;
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listen_fd_ == (socket_t)INVALID_SOCKET) {
+        std::cerr << "[MetricsServer] Failed to create socket" << std::endl;
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr(bind_address.c_str());
+
+    if (bind(listen_fd_, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+        listen(listen_fd_, 4) == SOCKET_ERROR) {
+        std::cerr << "[MetricsServer] Failed to listen on " << bind_address << ":" << port << std::endl;
+        closesocket(listen_fd_);
+        listen_fd_ = INVALID_SOCKET;
+        return false;
+    }
+
+    start_time_ = std::chrono::steady_clock::now();
+    running_ = true;
+    thread_ = std::thread(&MetricsServer::serveLoop, this);
+
+    std::cout << "[MetricsServer] Serving OpenMetrics on http://" << bind_address << ":" << port
+              << "/metrics" << std::endl;
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    closesocket(listen_fd_);
+    listen_fd_ = INVALID_SOCKET;
+}
+
+void MetricsServer::publish(std::shared_ptr<const AudioReceiver::Stats> stats) {
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    snapshot_ = std::move(stats);
+    snapshot_time_ = std::chrono::steady_clock::now();
+}
+
+void MetricsServer::serveLoop() {
+    while (running_) {
+        // Poll so stop() is noticed without closing the socket under accept()
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(listen_fd_, &fds);
+        struct timeval tv;
+        tv.tv_sec = 0;
+        tv.tv_usec = ACCEPT_POLL_MS * 1000;
+        if (select((int)listen_fd_ + 1, &fds, nullptr, nullptr, &tv) <= 0) {
+            continue;
+        }
+
+        socket_t client = accept(listen_fd_, nullptr, nullptr);
+        if (client == (socket_t)INVALID_SOCKET) {
+            continue;
+        }
+        serveClient(client);
+        closesocket(client);
+    }
+}
+
+void MetricsServer::serveClient(socket_t client_fd) {
+#ifdef _WIN32
+    DWORD timeout = CLIENT_TIMEOUT_MS;
+#else
+    struct timeval timeout;
+    timeout.tv_sec = CLIENT_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (CLIENT_TIMEOUT_MS % 1000) * 1000;
+#endif
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+
+    // Only the request line matters; read until the end of the headers
+    std::string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_SIZE) {
+        int n = recv(client_fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            break;
+        }
+        request.append(buf, (size_t)n);
+    }
+
+    size_t line_end = request.find("\r\n");
+    std::string line = request.substr(0, line_end);
+    size_t method_end = line.find(' ');
+    size_t path_end = method_end == std::string::npos ? std::string::npos : line.find(' ', method_end + 1);
+    if (method_end == std::string::npos || path_end == std::string::npos) {
+        sendAll(client_fd, "HTTP/1.0 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        return;
+    }
+    std::string method = line.substr(0, method_end);
+    std::string path = line.substr(method_end + 1, path_end - method_end - 1);
+    size_t query = path.find('?');
+    if (query != std::string::npos) {
+        path.resize(query);
+    }
+
+    if (method != "GET" && method != "HEAD") {
+        sendAll(client_fd, "HTTP/1.0 405 Method Not Allowed\r\nAllow: GET, HEAD\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        return;
+    }
+    if (path != "/metrics" && path != "/") {
+        sendAll(client_fd, "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        return;
+    }
+
+    scrapes_.fetch_add(1, std::memory_order_relaxed);
+    std::string body = render();
+    std::string response = "HTTP/1.0 200 OK\r\nContent-Type: ";
+    response += CONTENT_TYPE;
+    response += "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    if (method == "GET") {
+        response += body;
+    }
+    sendAll(client_fd, response);
+}
+
+std::string MetricsServer::render() {
+    // Take the snapshot under our own lock, format without it - publish() never waits on a slow scrape
+    std::shared_ptr<const AudioReceiver::Stats> snapshot;
+    std::chrono::steady_clock::time_point snapshot_time;
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex_);
+        snapshot = snapshot_;
+        snapshot_time = snapshot_time_;
+    }
+    const bool has_snapshot = snapshot != nullptr;
+    const AudioReceiver::Stats empty;
+    const AudioReceiver::Stats& s = has_snapshot ? *snapshot : empty;
+    const auto now = std::chrono::steady_clock::now();
+
+    std::string out;
+    out.reserve(16384);
+    MetricsWriter w(out);
+
+    w.gauge("moonmic_uptime_seconds", "Time since the metrics endpoint started.",
+            std::chrono::duration<double>(now - start_time_).count());
+    w.gauge("moonmic_stats_age_seconds", "Age of the receiver statistics snapshot served below (-1 = none yet).",
+            has_snapshot ? std::chrono::duration<double>(now - snapshot_time).count() : -1.0);
+    w.counter("moonmic_metrics_scrapes", "Requests served by this endpoint.", scrapes_.load(std::memory_order_relaxed));
+
+    // Connection
+    w.gauge("moonmic_connected", "A validated client is connected (heartbeat alive).", s.is_connected ? 1.0 : 0.0);
+    w.gauge("moonmic_receiving", "Audio arrived within the connection timeout.", s.is_receiving ? 1.0 : 0.0);
+    w.gauge("moonmic_paused", "Receiver is paused.", s.is_paused ? 1.0 : 0.0);
+    w.gauge("moonmic_active_clients", "Client sessions currently connected.", (double)s.active_clients);
+    w.gauge("moonmic_rtt_seconds", "Round trip time to the most recently active client (-1 = unknown).",
+            s.rtt_ms >= 0 ? s.rtt_ms / 1000.0 : -1.0);
+
+    // Traffic
+    w.counter("moonmic_packets_received", "Datagrams received on the audio port.", s.packets_received);
+    w.counter("moonmic_bytes_received", "Bytes received on the audio port.", s.bytes_received);
+    w.counter("moonmic_packets_dropped", "Packets dropped (decode failures, jitter buffer drops).", s.packets_dropped);
+    w.counter("moonmic_packets_dropped_lag", "Packets dropped by the jitter buffer latency cap.", s.packets_dropped_lag);
+
+    // Jitter buffer and loss recovery (counters summed over sessions, gauges are the worst session)
+    w.gauge("moonmic_jitter_depth_packets", "Packets buffered in the fullest jitter buffer.", (double)s.jitter_depth);
+    w.gauge("moonmic_jitter_target_depth_packets", "Largest adaptive jitter buffer target.", (double)s.jitter_target_depth);
+    w.gauge("moonmic_jitter_seconds", "Worst interarrival jitter (RFC 3550).", s.jitter_ms / 1000.0);
+    w.counter("moonmic_jitter_late_packets", "Packets that arrived after their playout slot (current sessions).", s.jitter_late);
+    w.counter("moonmic_jitter_reordered_packets", "Packets reordered back into sequence (current sessions).", s.jitter_reordered);
+    w.counter("moonmic_jitter_duplicate_packets", "Duplicate packets discarded (current sessions).", s.jitter_duplicates);
+    w.counter("moonmic_jitter_lost_packets", "Sequence numbers never received (current sessions).", s.jitter_lost);
+    w.counter("moonmic_fec_recovered_frames", "Lost frames rebuilt from in-band FEC (current sessions).", s.fec_recovered);
+    w.counter("moonmic_plc_concealed_frames", "Lost frames synthesized by PLC (current sessions).", s.plc_concealed);
+    w.gauge("moonmic_dtx_suppressed_ratio", "Share of stream time suppressed as silence by clients.",
+            s.dtx_suppressed_percent / 100.0);
+
+    // Clock drift
+    w.gauge("moonmic_drift_ppm", "Largest estimated sender + device clock drift.", s.drift_ppm);
+    w.gauge("moonmic_drift_correction_ppm", "Resampling correction applied for that drift.", s.drift_correction_ppm);
+    w.gauge("moonmic_mix_level_seconds", "Mean per-client mix FIFO level.", s.mix_level_ms / 1000.0);
+    w.gauge("moonmic_mix_level_stddev_seconds", "Per-client mix FIFO level variation.", s.mix_level_stddev_ms / 1000.0);
+
+    // Pipeline stages (StageTimer windows)
+    struct Stage {
+        const char* name;
+        const AudioReceiver::Stats::StageStats& stats;
+    };
+    const Stage stages[] = {
+        {"receive", s.stage_receive}, {"queue", s.stage_queue}, {"decode", s.stage_decode},
+        {"mix", s.stage_mix}, {"device", s.stage_device}
+    };
+    w.family("moonmic_stage_avg_seconds", "gauge", "Mean time per item in a pipeline stage over the last window.");
+    for (const Stage& stage : stages) {
+        w.sample("moonmic_stage_avg_seconds", "", MetricsWriter::label("stage", stage.name), stage.stats.avg_us / 1e6);
+    }
+    w.family("moonmic_stage_max_seconds", "gauge", "Longest time per item in a pipeline stage over the last window.");
+    for (const Stage& stage : stages) {
+        w.sample("moonmic_stage_max_seconds", "", MetricsWriter::label("stage", stage.name), stage.stats.max_us / 1e6);
+    }
+
+    // Buffers
+    w.gauge("moonmic_decode_queue_depth_packets", "Packets waiting for a decode worker.", (double)s.decode_queue_depth);
+    w.gauge("moonmic_output_queue_seconds", "Mixed audio waiting for the device thread.", s.output_queue_ms / 1000.0);
+    w.gauge("moonmic_output_queue_usage_ratio", "Mix -> device ring fill.", s.output_queue_usage);
+    w.gauge("moonmic_device_buffer_usage_ratio", "Device backend buffer fill.", s.device_buffer_usage);
+    w.gauge("moonmic_device_latency_seconds", "Audio queued inside the device backend (-1 = not reported).",
+            s.device_latency_ms >= 0.0f ? s.device_latency_ms / 1000.0 : -1.0);
+
+    // Per client: labels identify the session; counters restart with a new client_id
+    using Client = AudioReceiver::Stats::ClientStats;
+    std::vector<std::string> client_labels;
+    client_labels.reserve(s.clients.size());
+    for (const Client& c : s.clients) {
+        client_labels.push_back(MetricsWriter::label("client_id", std::to_string(c.id)) + "," +
+                                MetricsWriter::label("client", c.name) + "," +
+                                MetricsWriter::label("ip", c.ip + ":" + std::to_string(c.port)));
+    }
+    auto clientCounter = [&](const char* name, const char* help, const std::function<uint64_t(const Client&)>& value) {
+        w.family(name, "counter", help);
+        for (size_t i = 0; i < s.clients.size(); i++) {
+            w.sample(name, "_total", client_labels[i], value(s.clients[i]));
+        }
+    };
+    auto clientGauge = [&](const char* name, const char* help, const std::function<double(const Client&)>& value) {
+        w.family(name, "gauge", help);
+        for (size_t i = 0; i < s.clients.size(); i++) {
+            w.sample(name, "", client_labels[i], value(s.clients[i]));
+        }
+    };
+    if (!s.clients.empty()) {
+        clientGauge("moonmic_client_validated", "Client passed Sunshine pairing validation.",
+                    [](const Client& c) { return c.validated ? 1.0 : 0.0; });
+        clientGauge("moonmic_client_rtt_seconds", "Round trip time (-1 = unknown).",
+                    [](const Client& c) { return c.rtt_ms >= 0 ? c.rtt_ms / 1000.0 : -1.0; });
+        clientCounter("moonmic_client_packets_received", "Audio packets handed to the session.",
+                      [](const Client& c) { return c.session.packets_received; });
+        clientCounter("moonmic_client_bytes_received", "Audio bytes handed to the session.",
+                      [](const Client& c) { return c.session.bytes_received; });
+        clientCounter("moonmic_client_packets_dropped", "Decode/resample failures and jitter buffer drops.",
+                      [](const Client& c) { return c.session.packets_dropped; });
+        clientCounter("moonmic_client_packets_dropped_lag", "Jitter buffer latency cap drops.",
+                      [](const Client& c) { return c.session.packets_dropped_lag; });
+        clientCounter("moonmic_client_fec_recovered_frames", "Lost frames rebuilt from in-band FEC.",
+                      [](const Client& c) { return c.session.fec_recovered; });
+        clientCounter("moonmic_client_plc_concealed_frames", "Lost frames synthesized by PLC.",
+                      [](const Client& c) { return c.session.plc_concealed; });
+        clientCounter("moonmic_client_underruns", "Mix FIFO ran dry.",
+                      [](const Client& c) { return c.session.underruns; });
+        clientCounter("moonmic_client_jitter_late_packets", "Packets that arrived after their playout slot.",
+                      [](const Client& c) { return c.session.jitter.late; });
+        clientCounter("moonmic_client_jitter_reordered_packets", "Packets reordered back into sequence.",
+                      [](const Client& c) { return c.session.jitter.reordered; });
+        clientCounter("moonmic_client_jitter_duplicate_packets", "Duplicate packets discarded.",
+                      [](const Client& c) { return c.session.jitter.duplicates; });
+        clientCounter("moonmic_client_jitter_lost_packets", "Sequence numbers never received.",
+                      [](const Client& c) { return c.session.jitter.lost; });
+        clientGauge("moonmic_client_jitter_seconds", "Interarrival jitter (RFC 3550).",
+                    [](const Client& c) { return c.session.jitter.jitter_ms / 1000.0; });
+        clientGauge("moonmic_client_jitter_depth_packets", "Packets currently in the jitter buffer.",
+                    [](const Client& c) { return (double)c.session.jitter.depth; });
+        clientGauge("moonmic_client_jitter_target_depth_packets", "Adaptive jitter buffer target.",
+                    [](const Client& c) { return (double)c.session.jitter.target_depth; });
+        clientGauge("moonmic_client_drift_ppm", "Estimated sender + device clock drift.",
+                    [](const Client& c) { return (double)c.session.drift.drift_ppm; });
+        clientGauge("moonmic_client_sender_drift_ppm", "Sender clock vs host clock.",
+                    [](const Client& c) { return (double)c.session.drift.sender_ppm; });
+        clientGauge("moonmic_client_device_drift_ppm", "Mixer demand vs nominal device rate.",
+                    [](const Client& c) { return (double)c.session.drift.device_ppm; });
+        clientGauge("moonmic_client_drift_correction_ppm", "Resampling correction applied.",
+                    [](const Client& c) { return (double)c.session.drift.correction_ppm; });
+        clientGauge("moonmic_client_mix_level_seconds", "Mean mix FIFO level.",
+                    [](const Client& c) { return c.session.drift.level_ms / 1000.0; });
+        clientGauge("moonmic_client_resample_ratio", "Output / decode rate including drift correction (1 = no resampler).",
+                    [](const Client& c) { return c.session.resample_ratio; });
+        clientGauge("moonmic_client_stream_sample_rate_hertz", "Sample rate of the incoming stream.",
+                    [](const Client& c) { return (double)c.session.stream_rate; });
+        clientGauge("moonmic_client_decode_sample_rate_hertz", "Rate the session decodes at (its resampler's input).",
+                    [](const Client& c) { return (double)c.session.decode_rate; });
+        clientGauge("moonmic_client_output_sample_rate_hertz", "Mixer / device sample rate.",
+                    [](const Client& c) { return (double)c.session.output_rate; });
+        clientCounter("moonmic_client_dtx_suppressed_microseconds", "Stream time suppressed as silence by the client.",
+                      [](const Client& c) { return c.session.dtx_suppressed_us; });
+        clientCounter("moonmic_client_audio_microseconds", "Stream time received as audio.",
+                      [](const Client& c) { return c.session.audio_us; });
+    }
+
+    // Latency trace: read from the lock-free histograms, never touches the pipeline
+    if (LatencyTrace::ENABLED) {
+        static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+        w.family("moonmic_latency_seconds", "summary", "Per-stage pipeline latency since start or the last trace reset.");
+        for (int i = 0; i < LatencyTrace::STAGES; i++) {
+            LatencyHistogram::Snapshot snap = LatencyTrace::instance().snapshot((TraceStage)i);
+            std::string stage = MetricsWriter::label("stage", LatencyTrace::stageName((TraceStage)i));
+            for (double q : quantiles) {
+                char qbuf[16];
+                snprintf(qbuf, sizeof(qbuf), "%g", q);
+                w.sample("moonmic_latency_seconds", "", stage + "," + MetricsWriter::label("quantile", qbuf),
+                         snap.percentileNs(q * 100.0) / 1e9);
+            }
+            w.sample("moonmic_latency_seconds", "_sum", stage, snap.sum_ns / 1e9);
+            w.sample("moonmic_latency_seconds", "_count", stage, snap.count);
+        }
+    }
+
+    w.eof();
+    return out;
+}
+
+} // namespace moonmic
@@ -0,0 +1,81 @@
+/**
+ * @file metrics_server.h
+ * @brief Local HTTP endpoint serving receiver statistics as OpenMetrics text
+ */
+
+#pragma once
+
+#include "audio_receiver.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace moonmic {
+
+/**
+ * @brief Minimal HTTP/1.0 server for Prometheus / OpenMetrics scrapes (GET /metrics)
+ *
+ * The server never talks to the AudioReceiver: the owner calls publish()
+ * with the Stats snapshot it already fetched (the headless loop, once a
+ * second) and scrapes render it, taking the server's own mutex only to
+ * grab the pointer. A scrape therefore
+ * never takes audio_mutex_ or a session's decode lock, and all formatting
+ * allocations happen on the server thread. Latency trace percentiles are
+ * read straight from the lock-free histograms.
+ *
+ * One connection is served at a time; meant for localhost or a trusted
+ * management network, not the internet.
+ */
+class MetricsServer {
+public:
+    MetricsServer();
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    /**
+     * @brief Bind and start serving
+     * @param port TCP port
+     * @param bind_address IPv4 address to listen on ("127.0.0.1" = local scrapes only)
+     * @return true if listening
+     */
+    bool start(int port, const std::string& bind_address);
+    void stop();
+    bool isRunning() const { return running_; }
+
+    /**
+     * @brief Replace the snapshot served to scrapes
+     */
+    void publish(std::shared_ptr<const AudioReceiver::Stats> stats);
+
+    /**
+     * @brief OpenMetrics exposition of the current snapshot (the GET /metrics body)
+     */
+    std::string render();
+
+private:
+#ifdef _WIN32
+    using socket_t = unsigned long long; // SOCKET type on Windows x64
+#else
+    using socket_t = int; // POSIX socket type
+#endif
+
+    void serveLoop();
+    void serveClient(socket_t client_fd);
+
+    socket_t listen_fd_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    std::mutex snapshot_mutex_;  // publish() vs. render(); never held by the audio threads
+    std::shared_ptr<const AudioReceiver::Stats> snapshot_;  // nullptr until the first publish()
+    std::chrono::steady_clock::time_point snapshot_time_;
+    std::chrono::steady_clock::time_point start_time_;
+    std::atomic<uint64_t> scrapes_{0};
+};
+
+} // namespace moonmic
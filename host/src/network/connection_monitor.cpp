@@ -34,14 +34,17 @@ void ConnectionMonitor::start(const std::string& client_ip, uint16_t port) {
         return;
     }
     
-    client_ip_ = client_ip;
-    client_port_ = port;
-    
-    // Create UDP socket
-    socket_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
-    if (socket_fd_ == INVALID_SOCKET) {
-        std::cerr << "[ConnectionMonitor] Failed to create socket" << std::endl;
-        return;
+    {
+        std::lock_guard<std::mutex> lock(socket_mutex_);
+        client_ip_ = client_ip;
+        client_port_ = port;
+        
+        // Create UDP socket
+        socket_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        if (socket_fd_ == INVALID_SOCKET) {
+            std::cerr << "[ConnectionMonitor] Failed to create socket" << std::endl;
+            return;
+        }
     }
     
     running_ = true;
@@ -55,21 +58,30 @@ void ConnectionMonitor::stop() {
         return;
     }
     
-    running_ = false;
+    {
+        // Sessions time out on the receive thread: don't sit out the ping interval
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        running_ = false;
+    }
+    wake_.notify_all();
     
     if (ping_thread_.joinable()) {
         ping_thread_.join();
     }
     
-    if (socket_fd_ != INVALID_SOCKET) {
-        closesocket(socket_fd_);
-        socket_fd_ = INVALID_SOCKET;
+    {
+        std::lock_guard<std::mutex> lock(socket_mutex_);
+        if (socket_fd_ != INVALID_SOCKET) {
+            closesocket(socket_fd_);
+            socket_fd_ = INVALID_SOCKET;
+        }
     }
     
     std::cout << "[ConnectionMonitor] Stopped" << std::endl;
 }
 
 void ConnectionMonitor::sendPacket(const void* data, size_t size) {
+    std::lock_guard<std::mutex> lock(socket_mutex_);
     if (!running_ || socket_fd_ == INVALID_SOCKET) {
         std::cerr << "[ConnectionMonitor] Cannot send packet: not running" << std::endl;
         return;
@@ -115,7 +127,8 @@ void ConnectionMonitor::pingThreadFunc() {
         }
         
         // Wait 2 seconds before next ping
-        std::this_thread::sleep_for(std::chrono::seconds(2));
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait_for(lock, std::chrono::seconds(2), [this] { return !running_; });
     }
 }
 
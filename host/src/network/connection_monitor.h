@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <string>
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 
 namespace moonmic {
@@ -41,7 +43,7 @@ public:
     bool isRunning() const { return running_; }
     
     /**
-     * Send arbitrary packet to the client
+     * Send arbitrary packet to the client (thread-safe: decode workers send receiver reports)
      * @param data Packet data to send
      * @param size Size of the packet in bytes
      */
@@ -54,6 +56,9 @@ private:
     std::string client_ip_;
     uint16_t client_port_;
     std::thread ping_thread_;
+    std::mutex wake_mutex_;            // Lets stop() cut the ping interval short
+    std::condition_variable wake_;
+    std::mutex socket_mutex_;  // Guards socket_fd_ / client address against stop() while sending
     int socket_fd_;
 };
 
@@ -0,0 +1,263 @@
+/**
+ * @file jitter_buffer.cpp
+ * @brief Adaptive jitter buffer implementation
+ */
+
+#include "jitter_buffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace moonmic {
+
+// Sequence jumps larger than this are treated as a new stream (client restart)
+static constexpr int32_t RESYNC_THRESHOLD = 1000;
+
+// Longest packet duration accepted for frame-size estimation (Opus max = 120ms)
+static constexpr double MAX_FRAME_US = 120000.0;
+
+static_assert((JitterBuffer::MAX_PACKETS & (JitterBuffer::MAX_PACKETS - 1)) == 0,
+              "MAX_PACKETS must be a power of two");
+
+JitterBuffer::JitterBuffer()
+    : slots_(new Packet[MAX_PACKETS]) {
+    reset();
+}
+
+void JitterBuffer::setDepthLimits(uint32_t min_depth, uint32_t max_depth) {
+    if (max_depth >= MAX_PACKETS) max_depth = MAX_PACKETS - 1;
+    if (max_depth < 1) max_depth = 1;
+    if (min_depth > max_depth) min_depth = max_depth;
+
+    min_depth_ = min_depth;
+    max_depth_ = max_depth;
+    target_depth_ = std::clamp(target_depth_, min_depth_, max_depth_);
+}
+
+void JitterBuffer::reset() {
+    for (size_t i = 0; i < MAX_PACKETS; i++) {
+        slots_[i].slot.reset();
+    }
+    popped_.reset();
+    memset(occupied_, 0, sizeof(occupied_));
+    memset(released_, 0, sizeof(released_));
+
+    have_base_ = false;
+    released_any_ = false;
+    next_seq_ = 0;
+    highest_seq_ = 0;
+    count_ = 0;
+    target_depth_ = min_depth_;
+
+    have_transit_ = false;
+    last_transit_us_ = 0;
+    last_jitter_seq_ = 0;
+    last_jitter_ts_ = 0;
+    jitter_us_ = 0.0;
+    frame_us_ = 20000.0;
+
+    // Counters are cumulative across resets (reported in AudioReceiver::Stats)
+}
+
+JitterBuffer::PushResult JitterBuffer::push(uint32_t sequence, uint64_t timestamp, uint32_t sample_rate_field,
+                                            PacketRef&& packet, size_t header_size) {
+    if (!packet || packet.size() < header_size) {
+        return PushResult::Invalid;
+    }
+    const Clock::time_point arrival = packet->arrival;
+
+    if (!have_base_) {
+        have_base_ = true;
+        next_seq_ = sequence;
+        highest_seq_ = sequence;
+    } else {
+        int32_t d = seqDiff(sequence, next_seq_);
+
+        if (d > RESYNC_THRESHOLD || d < -RESYNC_THRESHOLD) {
+            // Sender restarted its sequence counter - start over
+            reset();
+            have_base_ = true;
+            next_seq_ = sequence;
+            highest_seq_ = sequence;
+        } else if (d < 0) {
+            // Before anything was released we can still move the start back
+            if (!released_any_ && seqDiff(highest_seq_, sequence) < (int32_t)MAX_PACKETS) {
+                next_seq_ = sequence;
+                stats_.reordered++;
+            } else {
+                size_t idx = sequence & (MAX_PACKETS - 1);
+                if (released_[idx] && slots_[idx].sequence == sequence) {
+                    stats_.duplicates++;
+                    return PushResult::Duplicate;
+                }
+                stats_.late++;
+                return PushResult::Late;
+            }
+        } else {
+            size_t idx = sequence & (MAX_PACKETS - 1);
+            if (occupied_[idx] && slots_[idx].sequence == sequence) {
+                stats_.duplicates++;
+                return PushResult::Duplicate;
+            }
+
+            // Far ahead of the playout point (burst loss): skip forward so the
+            // new packet fits in the ring
+            while (seqDiff(sequence, next_seq_) >= (int32_t)MAX_PACKETS) {
+                size_t skip_idx = next_seq_ & (MAX_PACKETS - 1);
+                if (occupied_[skip_idx]) {
+                    occupied_[skip_idx] = false;
+                    slots_[skip_idx].slot.reset();
+                    count_--;
+                    stats_.overflow_drops++;
+                } else {
+                    stats_.lost++;
+                }
+                released_[skip_idx] = false;
+                next_seq_++;
+            }
+
+            if (seqDiff(sequence, highest_seq_) < 0) {
+                stats_.reordered++;
+            }
+        }
+
+        if (seqDiff(sequence, highest_seq_) > 0) {
+            highest_seq_ = sequence;
+        }
+    }
+
+    size_t idx = sequence & (MAX_PACKETS - 1);
+    Packet& slot = slots_[idx];
+    slot.sequence = sequence;
+    slot.timestamp = timestamp;
+    slot.sample_rate_field = sample_rate_field;
+    slot.arrival = arrival;
+    slot.lost_before = 0;
+    slot.data = packet.data() + header_size;
+    slot.size = packet.size() - header_size;
+    slot.slot = std::move(packet);
+    occupied_[idx] = true;
+    released_[idx] = false;
+    count_++;
+
+    updateJitter(sequence, timestamp, arrival);
+
+    // Cap latency: discard the oldest packet instead of letting the queue grow
+    if (count_ > max_depth_) {
+        dropOldest();
+        return PushResult::Overflow;
+    }
+
+    return PushResult::Accepted;
+}
+
+void JitterBuffer::dropOldest() {
+    for (size_t i = 0; i < MAX_PACKETS && count_ > 0; i++) {
+        size_t idx = next_seq_ & (MAX_PACKETS - 1);
+        released_[idx] = false;
+        if (occupied_[idx] && slots_[idx].sequence == next_seq_) {
+            occupied_[idx] = false;
+            slots_[idx].slot.reset();
+            count_--;
+            stats_.overflow_drops++;
+            next_seq_++;
+            return;
+        }
+        stats_.lost++;
+        next_seq_++;
+    }
+}
+
+const JitterBuffer::Packet* JitterBuffer::pop(Clock::time_point now) {
+    if (count_ == 0) {
+        return nullptr;
+    }
+
+    const auto target_delay = std::chrono::microseconds((int64_t)(target_depth_ * frame_us_));
+
+    size_t idx = next_seq_ & (MAX_PACKETS - 1);
+    uint32_t skipped = 0;
+
+    if (!(occupied_[idx] && slots_[idx].sequence == next_seq_)) {
+        // Expected packet is missing - find the next buffered one
+        uint32_t seq = next_seq_;
+        while (skipped < MAX_PACKETS) {
+            size_t i = seq & (MAX_PACKETS - 1);
+            if (occupied_[i] && slots_[i].sequence == seq) break;
+            seq++;
+            skipped++;
+        }
+        if (skipped >= MAX_PACKETS) {
+            return nullptr;  // Should not happen while count_ > 0
+        }
+
+        idx = seq & (MAX_PACKETS - 1);
+
+        // Keep waiting for the missing packet until we hold more than the
+        // target depth or the next packet has waited out the target delay
+        if (count_ <= target_depth_ && (now - slots_[idx].arrival) < target_delay) {
+            return nullptr;
+        }
+
+        for (uint32_t s = 0; s < skipped; s++) {
+            released_[(next_seq_ + s) & (MAX_PACKETS - 1)] = false;
+        }
+        stats_.lost += skipped;
+        next_seq_ = seq;
+    } else if (count_ <= target_depth_ && (now - slots_[idx].arrival) < target_delay) {
+        return nullptr;  // In order but not due yet
+    }
+
+    Packet& slot = slots_[idx];
+    slot.lost_before = skipped;
+    popped_ = std::move(slot.slot);  // Keeps data valid until the next call, frees the previous one
+    occupied_[idx] = false;
+    released_[idx] = true;
+    released_any_ = true;
+    count_--;
+    next_seq_++;
+
+    return &slot;
+}
+
+void JitterBuffer::updateJitter(uint32_t sequence, uint64_t timestamp, Clock::time_point arrival) {
+    int64_t arrival_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        arrival.time_since_epoch()).count();
+
+    // Relative transit time: sender and host clocks are unrelated, only the
+    // variation between packets matters
+    int64_t transit = arrival_us - (int64_t)timestamp;
+
+    if (have_transit_) {
+        double d = (double)std::llabs(transit - last_transit_us_);
+        jitter_us_ += (d - jitter_us_) / 16.0;
+
+        // Track the packet duration from consecutive sequence numbers
+        if (sequence == last_jitter_seq_ + 1 && timestamp > last_jitter_ts_) {
+            double delta = (double)(timestamp - last_jitter_ts_);
+            if (delta <= MAX_FRAME_US) {
+                frame_us_ += (delta - frame_us_) / 16.0;
+            }
+        }
+    }
+
+    have_transit_ = true;
+    last_transit_us_ = transit;
+    last_jitter_seq_ = sequence;
+    last_jitter_ts_ = timestamp;
+
+    // Hold back enough packets to ride out ~3x the measured jitter
+    uint32_t jitter_packets = (uint32_t)std::ceil((3.0 * jitter_us_) / std::max(frame_us_, 1000.0));
+    target_depth_ = std::clamp(min_depth_ + jitter_packets, min_depth_, max_depth_);
+}
+
+JitterBuffer::Stats JitterBuffer::getStats() const {
+    Stats s = stats_;
+    s.depth = count_;
+    s.target_depth = target_depth_;
+    s.jitter_ms = (float)(jitter_us_ / 1000.0);
+    s.highest_seq = highest_seq_;
+    return s;
+}
+
+} // namespace moonmic
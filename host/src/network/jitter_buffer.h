@@ -0,0 +1,135 @@
+/**
+ * @file jitter_buffer.h
+ * @brief Adaptive jitter buffer for moonmic audio packets
+ *
+ * Sits between UDPReceiver and the decoder. Buffered packets keep their
+ * PacketSlab slot (no payload copy); the slot is released once the packet
+ * is dropped or the decoder is done with it. Packets are ordered by the
+ * `sequence` field of moonmic_packet_header_t, duplicates and packets that
+ * arrive after their slot was played out are dropped, and the hold-back depth
+ * follows the RFC 3550 interarrival jitter measured from the sender
+ * `timestamp` field against local arrival time.
+ */
+
+#pragma once
+
+#include "packet_slab.h"
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <memory>
+
+namespace moonmic {
+
+class JitterBuffer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t MAX_PACKETS = 64;      // Ring capacity (must be power of two)
+
+    /**
+     * @brief Buffered packet (header already parsed, payload points into the slot)
+     */
+    struct Packet {
+        uint32_t sequence = 0;
+        uint64_t timestamp = 0;          // Sender timestamp (microseconds)
+        uint32_t sample_rate_field = 0;  // Raw header field (includes RAW flag)
+        Clock::time_point arrival;
+        uint32_t lost_before = 0;        // Sequences skipped right before this packet
+        const uint8_t* data = nullptr;   // Payload after the moonmic header
+        size_t size = 0;
+        PacketRef slot;                  // Owns the datagram data points into
+    };
+
+    enum class PushResult {
+        Accepted,
+        Duplicate,   // Same sequence already buffered or already played out
+        Late,        // Slot already skipped/played, packet arrived too late
+        Overflow,    // Buffer above max depth, oldest packet discarded
+        Invalid      // Empty ref or header larger than the datagram
+    };
+
+    struct Stats {
+        uint32_t depth = 0;          // Packets currently buffered
+        uint32_t target_depth = 0;   // Current adaptive target (packets)
+        uint64_t late = 0;           // Packets that arrived after their slot
+        uint64_t reordered = 0;      // Packets that arrived out of order but in time
+        uint64_t duplicates = 0;     // Duplicate packets dropped
+        uint64_t lost = 0;           // Sequences never received (skipped)
+        uint64_t overflow_drops = 0; // Packets discarded to cap latency
+        float jitter_ms = 0.0f;      // RFC 3550 interarrival jitter estimate
+        uint32_t highest_seq = 0;    // Highest sequence seen (receiver reports)
+    };
+
+    JitterBuffer();
+
+    /**
+     * @brief Set bounds for the adaptive target depth (in packets)
+     */
+    void setDepthLimits(uint32_t min_depth, uint32_t max_depth);
+
+    /**
+     * @brief Drop all buffered packets and restart sequence tracking
+     */
+    void reset();
+
+    /**
+     * @brief Insert a packet
+     * @param sequence Header sequence number
+     * @param timestamp Header timestamp (sender clock, microseconds)
+     * @param sample_rate_field Header sample_rate field (RAW flag preserved)
+     * @param packet Received datagram; ownership moves into the buffer unless
+     *               the result is Duplicate, Late or Invalid
+     * @param header_size Bytes before the payload
+     */
+    PushResult push(uint32_t sequence, uint64_t timestamp, uint32_t sample_rate_field,
+                    PacketRef&& packet, size_t header_size);
+
+    /**
+     * @brief Release the next packet in sequence order if it is due
+     *
+     * A packet is due once enough later packets are buffered to cover the
+     * target depth, or once it has been held for the target delay. If the
+     * expected sequence is missing and the buffer is past its target, the gap
+     * is skipped and reported in Packet::lost_before.
+     *
+     * @param now Current time
+     * @return Pointer valid until the next push()/pop()/reset(), or nullptr
+     */
+    const Packet* pop(Clock::time_point now);
+
+    Stats getStats() const;
+
+private:
+    static int32_t seqDiff(uint32_t a, uint32_t b) { return (int32_t)(a - b); }
+
+    void updateJitter(uint32_t sequence, uint64_t timestamp, Clock::time_point arrival);
+    void dropOldest();
+
+    std::unique_ptr<Packet[]> slots_;
+    PacketRef popped_;  // Slot of the packet last returned by pop()
+    bool occupied_[MAX_PACKETS];
+    bool released_[MAX_PACKETS];  // Slot was played out (vs. skipped) - tells duplicates from late packets
+
+    bool have_base_ = false;     // next_seq_ is valid
+    bool released_any_ = false;  // At least one packet was handed to the decoder
+    uint32_t next_seq_ = 0;      // Next sequence to release
+    uint32_t highest_seq_ = 0;   // Highest sequence seen
+    uint32_t count_ = 0;
+
+    uint32_t min_depth_ = 1;
+    uint32_t max_depth_ = 8;
+    uint32_t target_depth_ = 1;
+
+    // Jitter estimation (RFC 3550 section 6.4.1)
+    bool have_transit_ = false;
+    int64_t last_transit_us_ = 0;
+    uint32_t last_jitter_seq_ = 0;
+    uint64_t last_jitter_ts_ = 0;
+    double jitter_us_ = 0.0;
+    double frame_us_ = 20000.0;  // Estimated packet duration from timestamp deltas
+
+    Stats stats_;
+};
+
+} // namespace moonmic
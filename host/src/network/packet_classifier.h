@@ -0,0 +1,78 @@
+/**
+ * @file packet_classifier.h
+ * @brief Datagram types on the audio port and the receive thread's first-bytes dispatch
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace moonmic {
+
+// Handshake packet structure (matches libmoonmic client)
+#pragma pack(push, 1)
+struct MoonMicHandshake {
+    uint32_t magic;           // 0x4D4F4F4E ("MOON")
+    uint8_t version;          // 2 (bumped for protocol extension)
+    uint8_t pair_status;      // 0 or 1 from Sunshine validation
+    uint8_t uniqueid_len;     // Length of uniqueid (16)
+    char uniqueid[16];        // Client uniqueid
+    uint8_t devicename_len;   // Length of devicename
+    char devicename[64];      // Device name
+    uint16_t display_width;   // Target display width (0 = don't configure)
+    uint16_t display_height;  // Target display height (0 = don't configure)
+    uint8_t flags;            // HANDSHAKE_FLAG_* below
+};
+#pragma pack(pop)
+
+constexpr uint8_t HANDSHAKE_FLAG_FORCE_UPDATE = 0x01;   // Apply display_width/height even if it differs
+constexpr int HANDSHAKE_FLAG_PROFILE_SHIFT = 1;         // Bits 1-2: latency profile + 1 (0 = not announced)
+constexpr uint8_t HANDSHAKE_FLAG_PROFILE_MASK = 0x06;
+
+constexpr uint32_t PACKET_MAGIC_HANDSHAKE = 0x4D4F4F4E;          // "MOON"
+constexpr uint32_t PACKET_MAGIC_HANDSHAKE_SWAPPED = 0x4E4F4F4D;  // Big-endian clients
+constexpr uint32_t PACKET_MAGIC_PING = 0x50494E47;               // "PING" (client latency request)
+constexpr uint32_t PACKET_MAGIC_PONG = 0x504F4E47;               // "PONG" (reply to our PING)
+constexpr uint32_t PACKET_MAGIC_AUDIO = 0x4D4D4943;              // "MMIC" (MOONMIC_MAGIC)
+constexpr size_t PACKET_PING_SIZE = 12;                          // Magic + 8-byte timestamp
+constexpr size_t PACKET_AUDIO_HEADER_SIZE = 20;                  // MOONMIC_HEADER_SIZE
+
+enum class PacketKind {
+    Handshake,  // (Re)connection, validated before anything else from the client is accepted
+    Ping,
+    Pong,
+    Audio,      // Full audio header with the MMIC magic
+    Runt,       // Shorter than any audio header
+    Unknown     // Long enough, but no magic we know (e.g. probes)
+};
+
+/**
+ * @brief Classify a datagram from its size and magic
+ *
+ * Runs for every datagram on the receive thread before any session state is
+ * touched, so it only looks at the first four bytes.
+ */
+inline PacketKind classifyPacket(const uint8_t* data, size_t size) {
+    if (size < 4) {
+        return PacketKind::Runt;
+    }
+    uint32_t magic;
+    memcpy(&magic, data, sizeof(magic));
+
+    if (size >= sizeof(MoonMicHandshake) &&
+        (magic == PACKET_MAGIC_HANDSHAKE || magic == PACKET_MAGIC_HANDSHAKE_SWAPPED)) {
+        return PacketKind::Handshake;
+    }
+    if (size >= PACKET_PING_SIZE) {
+        if (magic == PACKET_MAGIC_PING) return PacketKind::Ping;
+        if (magic == PACKET_MAGIC_PONG) return PacketKind::Pong;
+    }
+    if (size < PACKET_AUDIO_HEADER_SIZE) {
+        return PacketKind::Runt;
+    }
+    return magic == PACKET_MAGIC_AUDIO ? PacketKind::Audio : PacketKind::Unknown;
+}
+
+} // namespace moonmic
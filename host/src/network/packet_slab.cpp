@@ -0,0 +1,84 @@
+/**
+ * @file packet_slab.cpp
+ * @brief Packet slab implementation
+ */
+
+#include "packet_slab.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#endif
+
+namespace moonmic {
+
+uint16_t SenderAddress::hostPort() const {
+    return ntohs(port);
+}
+
+std::string SenderAddress::ipString() const {
+    struct in_addr in;
+    in.s_addr = addr;
+    char buffer[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &in, buffer, INET_ADDRSTRLEN);
+    return std::string(buffer);
+}
+
+PacketRef& PacketRef::operator=(PacketRef&& other) noexcept {
+    if (this != &other) {
+        reset();
+        slab_ = other.slab_;
+        slot_ = other.slot_;
+        other.slab_ = nullptr;
+        other.slot_ = nullptr;
+    }
+    return *this;
+}
+
+void PacketRef::reset() {
+    if (slot_) {
+        slab_->release(slot_);
+        slab_ = nullptr;
+        slot_ = nullptr;
+    }
+}
+
+PacketSlab::PacketSlab(size_t slots)
+    : capacity_(slots)
+    , slots_(new PacketSlot[slots]) {
+    free_.reserve(slots);
+    for (size_t i = 0; i < slots; i++) {
+        free_.push_back(&slots_[i]);
+    }
+}
+
+PacketRef PacketSlab::acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) {
+        exhausted_++;
+        return PacketRef();
+    }
+    PacketSlot* slot = free_.back();
+    free_.pop_back();
+    return PacketRef(this, slot);
+}
+
+void PacketSlab::release(PacketSlot* slot) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(slot);
+}
+
+size_t PacketSlab::available() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return free_.size();
+}
+
+uint64_t PacketSlab::getExhaustedCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return exhausted_;
+}
+
+} // namespace moonmic
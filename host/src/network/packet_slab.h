@@ -0,0 +1,118 @@
+/**
+ * @file packet_slab.h
+ * @brief Preallocated datagram slots handed from UDPReceiver to the decode path
+ *
+ * The receive thread fills slots straight from the socket; a PacketRef then
+ * moves through the worker queue into the session jitter buffer and returns
+ * the slot to the slab when it is dropped. No allocation or payload copy
+ * happens per packet.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace moonmic {
+
+/**
+ * @brief IPv4 sender address kept in network byte order
+ *
+ * Compared in binary form; converted to text only for logging and for
+ * the (rare) handshake path.
+ */
+struct SenderAddress {
+    uint32_t addr = 0;  // sin_addr.s_addr
+    uint16_t port = 0;  // sin_port
+
+    bool operator==(const SenderAddress& other) const { return addr == other.addr && port == other.port; }
+    bool operator!=(const SenderAddress& other) const { return !(*this == other); }
+
+    uint64_t key() const { return ((uint64_t)addr << 16) | port; }
+    uint16_t hostPort() const;
+    std::string ipString() const;
+};
+
+struct PacketSlot {
+    static constexpr size_t MAX_SIZE = 4096;  // Largest datagram accepted (RAW 48kHz stereo fits)
+
+    uint8_t data[MAX_SIZE];
+    size_t size = 0;
+    SenderAddress sender;
+    std::chrono::steady_clock::time_point arrival;
+};
+
+class PacketSlab;
+
+/**
+ * @brief Move-only owner of one slab slot; the slot is released on destruction
+ */
+class PacketRef {
+public:
+    PacketRef() = default;
+    PacketRef(PacketRef&& other) noexcept : slab_(other.slab_), slot_(other.slot_) {
+        other.slab_ = nullptr;
+        other.slot_ = nullptr;
+    }
+    PacketRef& operator=(PacketRef&& other) noexcept;
+    ~PacketRef() { reset(); }
+
+    PacketRef(const PacketRef&) = delete;
+    PacketRef& operator=(const PacketRef&) = delete;
+
+    explicit operator bool() const { return slot_ != nullptr; }
+
+    PacketSlot* get() const { return slot_; }
+    PacketSlot* operator->() const { return slot_; }
+    const uint8_t* data() const { return slot_->data; }
+    size_t size() const { return slot_->size; }
+
+    void reset();
+
+private:
+    friend class PacketSlab;
+    PacketRef(PacketSlab* slab, PacketSlot* slot) : slab_(slab), slot_(slot) {}
+
+    PacketSlab* slab_ = nullptr;
+    PacketSlot* slot_ = nullptr;
+};
+
+/**
+ * @brief Fixed pool of packet slots
+ *
+ * Must outlive every PacketRef it hands out.
+ */
+class PacketSlab {
+public:
+    explicit PacketSlab(size_t slots);
+
+    PacketSlab(const PacketSlab&) = delete;
+    PacketSlab& operator=(const PacketSlab&) = delete;
+
+    /**
+     * @brief Take a free slot
+     * @return Empty ref if every slot is in flight
+     */
+    PacketRef acquire();
+
+    size_t capacity() const { return capacity_; }
+    size_t available() const;
+    uint64_t getExhaustedCount() const;
+
+private:
+    friend class PacketRef;
+    void release(PacketSlot* slot);
+
+    const size_t capacity_;
+    std::unique_ptr<PacketSlot[]> slots_;
+    std::vector<PacketSlot*> free_;  // Reserved up front, never reallocates
+    mutable std::mutex mutex_;
+    uint64_t exhausted_ = 0;
+};
+
+} // namespace moonmic
@@ -4,12 +4,11 @@
  */
 
 #include "udp_receiver.h"
+#include "../latency_trace.h"
 #include <iostream>
+#include <algorithm>
 #include <cstring>
 
-#ifndef _WIN32
-#include <sys/ioctl.h>
-#endif
 #ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
@@ -21,13 +20,25 @@ typedef int socklen_t;
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <errno.h>
 #define INVALID_SOCKET -1
 #define SOCKET_ERROR -1
 #define closesocket close
 #endif
 
+#if defined(__linux__)
+#define MOONMIC_HAVE_RECVMMSG 1
+#include <time.h>
+#endif
+
 namespace moonmic {
 
+// Smaller datagrams can't hold a moonmic header - audio_receiver.cpp does the full validation
+static constexpr size_t MIN_PACKET_SIZE = 20;
+
+// Kernel receive buffer: room for bursts while the receive thread is descheduled
+static constexpr int SOCKET_RCVBUF = 1 << 20;
+
 #ifdef _WIN32
 static DWORD WINAPI thread_func(LPVOID arg) {
     auto* receiver = static_cast<UDPReceiver*>(arg);
@@ -42,10 +53,26 @@ static void* thread_func(void* arg) {
 }
 #endif
 
+// Receive timeout or signal: not an error, just nothing to read
+static bool isTransientError() {
+#ifdef _WIN32
+    int err = WSAGetLastError();
+    return err == WSAETIMEDOUT || err == WSAEWOULDBLOCK || err == WSAEINTR;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
 UDPReceiver::UDPReceiver()
     : socket_fd_(INVALID_SOCKET)
     , running_(false)
-    , thread_handle_(nullptr) {
+    , thread_handle_(nullptr)
+    , slab_(new PacketSlab(SLAB_SLOTS))
+#ifdef MOONMIC_HAVE_RECVMMSG
+    , batch_size_(BATCH_SIZE) {
+#else
+    , batch_size_(1) {
+#endif
 #ifdef _WIN32
     WSADATA wsa;
     WSAStartup(MAKEWORD(2, 2), &wsa);
@@ -54,16 +81,25 @@ UDPReceiver::UDPReceiver()
 
 UDPReceiver::~UDPReceiver() {
     stop();
+    // Staged slots go back before the slab is destroyed
+    for (auto& ref : batch_) {
+        ref.reset();
+    }
 #ifdef _WIN32
     WSACleanup();
 #endif
 }
 
-bool UDPReceiver::start(int port, const std::string& bind_address) {
-    if (running_) {
-        return false;
-    }
-    
+void UDPReceiver::setBatchSize(size_t batch_size) {
+#ifdef MOONMIC_HAVE_RECVMMSG
+    batch_size_ = std::max<size_t>(1, std::min(batch_size, BATCH_SIZE));
+#else
+    (void)batch_size;
+    batch_size_ = 1;
+#endif
+}
+
+bool UDPReceiver::open(int port, const std::string& bind_address) {
     socket_fd_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
     if (socket_fd_ == INVALID_SOCKET) {
         std::cerr << "[UDPReceiver] Failed to create socket" << std::endl;
@@ -74,6 +110,27 @@ bool UDPReceiver::start(int port, const std::string& bind_address) {
     int reuse = 1;
     setsockopt(socket_fd_, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
     
+    int rcvbuf = SOCKET_RCVBUF;
+    setsockopt(socket_fd_, SOL_SOCKET, SO_RCVBUF, (const char*)&rcvbuf, sizeof(rcvbuf));
+    
+    // Periodic wakeup so receiveLoop() sees running_ = false even if close() doesn't interrupt recv
+#ifdef _WIN32
+    DWORD timeout = RECV_TIMEOUT_MS;
+#else
+    struct timeval timeout;
+    timeout.tv_sec = RECV_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (RECV_TIMEOUT_MS % 1000) * 1000;
+#endif
+    setsockopt(socket_fd_, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    
+#ifdef MOONMIC_HAVE_RECVMMSG
+    // Kernel receive timestamps: time spent in the socket buffer (latency trace)
+    if (LatencyTrace::ENABLED) {
+        int on = 1;
+        setsockopt(socket_fd_, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+    }
+#endif
+    
     // Bind to port
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
@@ -88,6 +145,18 @@ bool UDPReceiver::start(int port, const std::string& bind_address) {
         return false;
     }
     
+    return true;
+}
+
+bool UDPReceiver::start(int port, const std::string& bind_address) {
+    if (running_) {
+        return false;
+    }
+    
+    if (!open(port, bind_address)) {
+        return false;
+    }
+    
     running_ = true;
     
     // Start receiver thread
@@ -99,12 +168,17 @@ bool UDPReceiver::start(int port, const std::string& bind_address) {
     thread_handle_ = thread;
 #endif
     
-    std::cout << "[UDPReceiver] Started on " << bind_address << ":" << port << std::endl;
+    std::cout << "[UDPReceiver] Started on " << bind_address << ":" << port
+              << (batch_size_ > 1 ? " (recvmmsg, batch " + std::to_string(batch_size_) + ")" : "") << std::endl;
     return true;
 }
 
 void UDPReceiver::stop() {
     if (!running_) {
+        if (socket_fd_ != INVALID_SOCKET) {
+            closesocket(socket_fd_);  // Opened without start()
+            socket_fd_ = INVALID_SOCKET;
+        }
         return;
     }
     
@@ -131,69 +205,183 @@ void UDPReceiver::stop() {
 }
 
 void UDPReceiver::receiveLoop() {
-    uint8_t buffer[4096];
-    struct sockaddr_in sender_addr;
-    socklen_t sender_len = sizeof(sender_addr);
-    
+    auto next_tick = std::chrono::steady_clock::now() + tick_period_;
     while (running_) {
-        int received = recvfrom(
-            socket_fd_,
-            (char*)buffer,
-            sizeof(buffer),
-            0,
-            (struct sockaddr*)&sender_addr,
-            &sender_len
-        );
-        
-        if (received < 0) {
+        if (receiveOnce() < 0) {
             if (running_) {
                 std::cerr << "[UDPReceiver] Receive error" << std::endl;
             }
             break;
         }
-        
-        // Minimal size check - just verify it's not empty
-        // Let audio_receiver.cpp handle full packet validation
-        if (received < 20) {  // Minimum header size
-            continue;
+        if (tick_callback_) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= next_tick) {
+                next_tick = now + tick_period_;
+                tick_callback_(now);
+            }
         }
-        // Get sender IP
-        char sender_ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &sender_addr.sin_addr, sender_ip, INET_ADDRSTRLEN);
-        uint16_t sender_port = ntohs(sender_addr.sin_port);
-        
-        // CHECK FOR BACKLOG (Lag Detection)
-        bool is_lagging = false;
-        unsigned long bytes_available = 0;
-        
-#ifdef _WIN32
-        ioctlsocket(socket_fd_, FIONREAD, &bytes_available);
-#else
-        ioctl(socket_fd_, FIONREAD, &bytes_available);
+    }
+}
+
+int UDPReceiver::receiveOnce() {
+#ifdef MOONMIC_HAVE_RECVMMSG
+    if (batch_size_ > 1) {
+        return receiveBatch();
+    }
 #endif
+    return receiveSingle();
+}
+
+void UDPReceiver::dispatch(PacketRef& packet, size_t size, const void* sender_addr,
+                           std::chrono::steady_clock::time_point arrival) {
+    const struct sockaddr_in* sin = static_cast<const struct sockaddr_in*>(sender_addr);
+    packet->size = size;
+    packet->sender.addr = sin->sin_addr.s_addr;
+    packet->sender.port = sin->sin_port;
+    packet->arrival = arrival;
+    
+    // Pass COMPLETE packet (including header) to callback
+    // audio_receiver.cpp will parse the header manually
+    if (packet_callback_) {
+        packet_callback_(std::move(packet));
+    }
+    packet.reset();  // Callback didn't take ownership
+}
+
+int UDPReceiver::receiveSingle() {
+    PacketRef& packet = batch_[0];
+    if (!packet) {
+        packet = slab_->acquire();
+    }
+    
+    // Slab exhausted (decode path stalled): still drain the socket, drop the datagram
+    uint8_t* buffer = packet ? packet->data : drain_buffer_;
+    
+    struct sockaddr_in sender_addr;
+    socklen_t sender_len = sizeof(sender_addr);
+    int received = recvfrom(
+        socket_fd_,
+        (char*)buffer,
+        PacketSlot::MAX_SIZE,
+        0,
+        (struct sockaddr*)&sender_addr,
+        &sender_len
+    );
+    
+    if (received < 0) {
+        return isTransientError() ? 0 : -1;
+    }
+    
+    if (!packet) {
+        uint64_t drops = slab_->getExhaustedCount();
+        if (drops % 1000 == 1) {
+            std::cerr << "[UDPReceiver] ⚠ Packet slab exhausted (" << drops << " datagrams dropped) - decode path stalled?" << std::endl;
+        }
+        return 0;
+    }
+    
+    if ((size_t)received < MIN_PACKET_SIZE) {
+        return 0;
+    }
+    
+    dispatch(packet, (size_t)received, &sender_addr, std::chrono::steady_clock::now());
+    return 1;
+}
 
-        // Threshold: 2048 bytes (~2-4 packets depending on size)
-        // If we have more than this waiting in socket buffer, we are lagging.
-        if (bytes_available > 2048) {
-            is_lagging = true;
+#ifdef MOONMIC_HAVE_RECVMMSG
+// Kernel timestamps are CLOCK_REALTIME: compare against the same clock right after the syscall
+static void recordSocketTime(struct mmsghdr* msgs, int count) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    const int64_t now_ns = (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+    for (int i = 0; i < count; i++) {
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg;
+             cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec stamp;
+                memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+                int64_t waited = now_ns - ((int64_t)stamp.tv_sec * 1000000000 + stamp.tv_nsec);
+                traceRecordNs(TraceStage::SocketReceive, (uint64_t)std::max<int64_t>(waited, 0));
+            }
         }
+    }
+}
+#endif
 
-        // Pass COMPLETE packet (including header) to callback
-        // audio_receiver.cpp will parse the header manually
-        if (packet_callback_) {
-            packet_callback_(buffer, received, std::string(sender_ip), sender_port, is_lagging);
+int UDPReceiver::receiveBatch() {
+#ifdef MOONMIC_HAVE_RECVMMSG
+    // Top up the staged slots consumed by the previous batch
+    size_t ready = 0;
+    while (ready < batch_size_) {
+        if (!batch_[ready]) {
+            batch_[ready] = slab_->acquire();
+            if (!batch_[ready]) break;
         }
+        ready++;
+    }
+    
+    if (ready == 0) {
+        return receiveSingle();  // Slab exhausted: drains one datagram into drain_buffer_
     }
+    
+    struct mmsghdr msgs[BATCH_SIZE];
+    struct iovec iovs[BATCH_SIZE];
+    struct sockaddr_in addrs[BATCH_SIZE];
+    alignas(struct cmsghdr) char controls[LatencyTrace::ENABLED ? BATCH_SIZE : 1][CMSG_SPACE(sizeof(struct timespec))];
+    memset(msgs, 0, sizeof(struct mmsghdr) * ready);
+    
+    for (size_t i = 0; i < ready; i++) {
+        iovs[i].iov_base = batch_[i]->data;
+        iovs[i].iov_len = PacketSlot::MAX_SIZE;
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        if (LatencyTrace::ENABLED) {
+            msgs[i].msg_hdr.msg_control = controls[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+        }
+    }
+    
+    // Block for the first datagram, then take whatever else is already queued
+    int received = recvmmsg(socket_fd_, msgs, (unsigned int)ready, MSG_WAITFORONE, nullptr);
+    if (received < 0) {
+        return isTransientError() ? 0 : -1;
+    }
+    
+    auto arrival = std::chrono::steady_clock::now();
+    if (LatencyTrace::ENABLED) {
+        recordSocketTime(msgs, received);
+    }
+    int dispatched = 0;
+    for (int i = 0; i < received; i++) {
+        if (msgs[i].msg_len < MIN_PACKET_SIZE) {
+            continue;  // Slot stays staged for the next batch
+        }
+        dispatch(batch_[i], msgs[i].msg_len, &addrs[i], arrival);
+        dispatched++;
+    }
+    return dispatched;
+#else
+    return receiveSingle();
+#endif
 }
 
 bool UDPReceiver::sendTo(const void* data, size_t size, const std::string& ip, uint16_t port) {
+    SenderAddress dest;
+    dest.addr = inet_addr(ip.c_str());
+    dest.port = htons(port);
+    return sendTo(data, size, dest);
+}
+
+bool UDPReceiver::sendTo(const void* data, size_t size, const SenderAddress& dest) {
     if (socket_fd_ == INVALID_SOCKET) return false;
     
     struct sockaddr_in dest_addr;
     memset(&dest_addr, 0, sizeof(dest_addr));
     dest_addr.sin_family = AF_INET;
-    dest_addr.sin_port = htons(port);
-    dest_addr.sin_addr.s_addr = inet_addr(ip.c_str());
+    dest_addr.sin_port = dest.port;
+    dest_addr.sin_addr.s_addr = dest.addr;
     
     int sent = sendto(socket_fd_, (const char*)data, size, 0, 
                      (struct sockaddr*)&dest_addr, sizeof(dest_addr));
@@ -5,8 +5,11 @@
 
 #pragma once
 
+#include "packet_slab.h"
 #include <stdint.h>
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <string>
 
 namespace moonmic {
@@ -19,9 +22,21 @@ struct PacketHeader {
     uint64_t timestamp;
 };
 
+/**
+ * @brief Receives datagrams into a PacketSlab and hands each slot to the callback
+ *
+ * On Linux the socket is drained with recvmmsg() in batches of up to
+ * BATCH_SIZE datagrams per syscall; elsewhere (or with batch size 1) one
+ * recvfrom() per datagram is used.
+ */
 class UDPReceiver {
 public:
-    using PacketCallback = std::function<void(const uint8_t* data, size_t size, const std::string& sender_ip, uint16_t sender_port, bool is_lagging)>;
+    using PacketCallback = std::function<void(PacketRef packet)>;
+    using TickCallback = std::function<void(std::chrono::steady_clock::time_point now)>;
+    
+    static constexpr size_t BATCH_SIZE = 32;    // Max datagrams per recvmmsg()
+    static constexpr size_t SLAB_SLOTS = 1024;  // Packets in flight (worker queues + jitter buffers)
+    static constexpr int RECV_TIMEOUT_MS = 200; // Lets the loop notice stop() without data
     
     UDPReceiver();
     ~UDPReceiver();
@@ -30,14 +45,49 @@ public:
     void stop();
     bool isRunning() const { return running_; }
     
+    /**
+     * @brief Bind the socket without starting the receive thread (drive with receiveOnce)
+     */
+    bool open(int port, const std::string& bind_address = "0.0.0.0");
+    
     void setPacketCallback(PacketCallback callback) { packet_callback_ = callback; }
     
+    /**
+     * @brief Periodic callback on the receive thread, between datagrams (call before start())
+     *
+     * Runs every period_ms under traffic and at least every RECV_TIMEOUT_MS
+     * when the socket is idle, so it sees time pass without packets.
+     */
+    void setTickCallback(TickCallback callback, int period_ms) {
+        tick_callback_ = callback;
+        tick_period_ = std::chrono::milliseconds(period_ms);
+    }
+    
+    /**
+     * @brief Datagrams per receive syscall (1 = recvfrom per packet); call before start()
+     */
+    void setBatchSize(size_t batch_size);
+    
     void receiveLoop();
     
+    /**
+     * @brief Receive and dispatch whatever is ready (blocks up to RECV_TIMEOUT_MS)
+     * @return Datagrams dispatched, 0 on timeout, -1 on socket error
+     */
+    int receiveOnce();
+    
     // Send packet from the bound socket (thread-safe)
     bool sendTo(const void* data, size_t size, const std::string& ip, uint16_t port);
+    bool sendTo(const void* data, size_t size, const SenderAddress& dest);
+    
+    // Datagrams discarded because every slab slot was in flight
+    uint64_t getSlabDrops() const { return slab_->getExhaustedCount(); }
     
 private:
+    int receiveSingle();
+    int receiveBatch();
+    void dispatch(PacketRef& packet, size_t size, const void* sender_addr,
+                  std::chrono::steady_clock::time_point arrival);
     
 #ifdef _WIN32
     using socket_t = unsigned long long; // SOCKET type on Windows x64
@@ -49,6 +99,13 @@ private:
     bool running_;
     void* thread_handle_;
     PacketCallback packet_callback_;
+    TickCallback tick_callback_;
+    std::chrono::steady_clock::duration tick_period_{};
+    
+    std::unique_ptr<PacketSlab> slab_;
+    size_t batch_size_;
+    PacketRef batch_[BATCH_SIZE];  // Slots staged for the next receive, kept across calls
+    uint8_t drain_buffer_[PacketSlot::MAX_SIZE];  // Receives (and drops) datagrams when the slab is empty
 };
 
 } // namespace moonmic
@@ -0,0 +1,121 @@
+/**
+ * @file pipeline_stats.h
+ * @brief Lock-free per-stage timing and counters for the receive/decode/mix/device pipeline
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace moonmic {
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * @brief Accumulates durations recorded by one pipeline stage
+ *
+ * record() is called on the stage's own thread and never blocks; take() is
+ * called by the stats reader and returns the average/maximum since the
+ * previous take(). The fields are reset individually, so a record() racing
+ * a take() may land in either window - fine for monitoring.
+ */
+class StageTimer {
+public:
+    struct Snapshot {
+        uint64_t count = 0;
+        float avg_us = 0.0f;
+        float max_us = 0.0f;
+    };
+
+    void record(uint64_t us) {
+        count_.fetch_add(1, std::memory_order_relaxed);
+        total_us_.fetch_add(us, std::memory_order_relaxed);
+        uint64_t max = max_us_.load(std::memory_order_relaxed);
+        while (us > max && !max_us_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    void record(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        record(us > 0 ? (uint64_t)us : 0);
+    }
+
+    Snapshot take() {
+        Snapshot s;
+        s.count = count_.exchange(0, std::memory_order_relaxed);
+        uint64_t total = total_us_.exchange(0, std::memory_order_relaxed);
+        s.max_us = (float)max_us_.exchange(0, std::memory_order_relaxed);
+        s.avg_us = s.count ? (float)total / (float)s.count : 0.0f;
+        return s;
+    }
+
+private:
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> total_us_{0};
+    std::atomic<uint64_t> max_us_{0};
+};
+
+/**
+ * @brief Records the lifetime of the enclosing scope into a StageTimer
+ */
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(StageTimer& timer)
+        : timer_(timer), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedStageTimer() { timer_.record(start_, std::chrono::steady_clock::now()); }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+    StageTimer& timer_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * @brief Relaxed event counter alone on its cache line
+ *
+ * Bumped per packet on the receive thread and read by stats pollers; the
+ * padding keeps neighbouring members (and other counters) from bouncing
+ * the line between those threads.
+ */
+class alignas(CACHE_LINE_SIZE) PaddedCounter {
+public:
+    // Returns the new value
+    uint64_t add(uint64_t n = 1) { return value_.fetch_add(n, std::memory_order_relaxed) + n; }
+    uint64_t load() const { return value_.load(std::memory_order_relaxed); }
+    void reset() { value_.store(0, std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+/**
+ * @brief Read-copy-update slot for a snapshot struct (strings, vectors allowed)
+ *
+ * The writer builds a complete new T and publishes it; readers take a
+ * reference to whichever snapshot is current and never see a half-written
+ * one. Readers and the writer never wait on each other beyond the
+ * shared_ptr swap itself.
+ */
+template <typename T>
+class PublishedSnapshot {
+public:
+    void publish(std::shared_ptr<const T> snapshot) {
+        std::atomic_store_explicit(&current_, std::move(snapshot), std::memory_order_release);
+    }
+
+    // nullptr until the first publish()
+    std::shared_ptr<const T> load() const {
+        return std::atomic_load_explicit(&current_, std::memory_order_acquire);
+    }
+
+private:
+    std::shared_ptr<const T> current_;
+};
+
+} // namespace moonmic
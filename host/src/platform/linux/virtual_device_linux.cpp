@@ -1,100 +1,348 @@
 /**
  * @file virtual_device_linux.cpp
- * @brief Linux virtual audio device using PulseAudio
+ * @brief Linux virtual audio device using PulseAudio (asynchronous API)
  */
 
 #include "../virtual_device.h"
-#include <pulse/simple.h>
-#include <pulse/error.h>
+#include "../spsc_ring.h"
+#ifdef HAVE_PIPEWIRE
+#include "virtual_device_pipewire.h"
+#endif
+#include <pulse/pulseaudio.h>
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <cstring>
 
 namespace moonmic {
 
+/**
+ * @brief PulseAudio playback stream driven by pa_threaded_mainloop
+ *
+ * write() never blocks: audio goes into a SPSC ring that the stream's write
+ * callback drains whenever the server requests data (write() also tops the
+ * stream up directly if it already has room). The server buffer is held at
+ * an explicit tlength/prebuf, and the latency reported by
+ * pa_stream_get_latency() drives getBufferUsage().
+ */
 class VirtualDeviceLinux : public VirtualDevice {
 public:
-    VirtualDeviceLinux() : pulse_(nullptr), sample_rate_(0) {}
-    
+    VirtualDeviceLinux() = default;
+
     ~VirtualDeviceLinux() override {
         close();
     }
-    
+
+    void setBufferTargets(int target_ms, int prebuf_ms) override {
+        if (target_ms > 0) target_ms_ = target_ms;
+        if (prebuf_ms >= 0) prebuf_ms_ = std::min(prebuf_ms, target_ms_);
+    }
+
     bool init(const std::string& device_name, int sample_rate, int channels) override {
-        // Handle auto-detect (0) by defaulting to 48000 for now on Linux
-        // TODO: Query PulseAudio server for default sample rate
+        close();
+
+        mainloop_ = pa_threaded_mainloop_new();
+        if (!mainloop_) {
+            std::cerr << "[VirtualDevice] PulseAudio: failed to create mainloop" << std::endl;
+            return false;
+        }
+
+        context_ = pa_context_new(pa_threaded_mainloop_get_api(mainloop_), "moonmic-host");
+        if (!context_) {
+            std::cerr << "[VirtualDevice] PulseAudio: failed to create context" << std::endl;
+            close();
+            return false;
+        }
+        pa_context_set_state_callback(context_, onContextState, this);
+
+        pa_threaded_mainloop_lock(mainloop_);
+
+        if (pa_context_connect(context_, NULL, PA_CONTEXT_NOFLAGS, NULL) < 0 ||
+            pa_threaded_mainloop_start(mainloop_) < 0) {
+            std::cerr << "[VirtualDevice] PulseAudio error: " << pa_strerror(pa_context_errno(context_)) << std::endl;
+            pa_threaded_mainloop_unlock(mainloop_);
+            close();
+            return false;
+        }
+
+        if (!waitForContext()) {
+            std::cerr << "[VirtualDevice] PulseAudio: connection failed: "
+                      << pa_strerror(pa_context_errno(context_)) << std::endl;
+            pa_threaded_mainloop_unlock(mainloop_);
+            close();
+            return false;
+        }
+
+        // Auto (0): play at the default sink's native rate so the server doesn't resample
         if (sample_rate <= 0) {
-            sample_rate = 48000;
+            sample_rate = queryNativeRate();
+            if (sample_rate <= 0) {
+                sample_rate = 48000;
+                std::cout << "[VirtualDevice] PulseAudio: could not query sink rate, using 48000Hz" << std::endl;
+            }
         }
-        
-        sample_rate_ = sample_rate;  // Store for getSampleRate()
-        
+
+        sample_rate_ = sample_rate;
+        channels_ = channels;
+
         pa_sample_spec ss;
         ss.format = PA_SAMPLE_FLOAT32LE;
         ss.rate = sample_rate;
         ss.channels = channels;
-        
+
+        ring_.reset((size_t)sample_rate * channels * RING_MS / 1000);
+
+        stream_ = pa_stream_new(context_, device_name.empty() ? "moonmic-host" : device_name.c_str(), &ss, NULL);
+        if (!stream_) {
+            std::cerr << "[VirtualDevice] PulseAudio: failed to create stream: "
+                      << pa_strerror(pa_context_errno(context_)) << std::endl;
+            pa_threaded_mainloop_unlock(mainloop_);
+            close();
+            return false;
+        }
+        pa_stream_set_state_callback(stream_, onStreamState, this);
+        pa_stream_set_write_callback(stream_, onStreamWrite, this);
+        pa_stream_set_underflow_callback(stream_, onStreamUnderflow, this);
+
+        // Explicit server-side buffering instead of PulseAudio's ~2s default
         pa_buffer_attr attr;
         attr.maxlength = (uint32_t)-1;
-        attr.tlength = (uint32_t)-1;
-        attr.prebuf = (uint32_t)-1;
+        attr.tlength = (uint32_t)pa_usec_to_bytes((pa_usec_t)target_ms_ * 1000, &ss);
+        attr.prebuf = (uint32_t)pa_usec_to_bytes((pa_usec_t)prebuf_ms_ * 1000, &ss);
         attr.minreq = (uint32_t)-1;
-        attr.fragsize = 480 * channels * sizeof(float);
-        
-        int error;
-        pulse_ = pa_simple_new(
-            NULL,
-            "moonmic-host",
-            PA_STREAM_PLAYBACK,
-            NULL,  // Use default sink
-            device_name.c_str(),
-            &ss,
-            NULL,
-            &attr,
-            &error
-        );
-        
-        if (!pulse_) {
-            std::cerr << "[VirtualDevice] PulseAudio error: " << pa_strerror(error) << std::endl;
+        attr.fragsize = (uint32_t)-1;
+
+        pa_stream_flags_t flags = (pa_stream_flags_t)(PA_STREAM_ADJUST_LATENCY |
+                                                      PA_STREAM_INTERPOLATE_TIMING |
+                                                      PA_STREAM_AUTO_TIMING_UPDATE);
+
+        if (pa_stream_connect_playback(stream_, NULL, &attr, flags, NULL, NULL) < 0 || !waitForStream()) {
+            std::cerr << "[VirtualDevice] PulseAudio error: " << pa_strerror(pa_context_errno(context_)) << std::endl;
+            pa_threaded_mainloop_unlock(mainloop_);
+            close();
             return false;
         }
-        
-        std::cout << "[VirtualDevice] Initialized: " << device_name << std::endl;
+
+        const pa_buffer_attr* actual = pa_stream_get_buffer_attr(stream_);
+        if (actual) {
+            std::cout << "[VirtualDevice] PulseAudio buffer: tlength "
+                      << pa_bytes_to_usec(actual->tlength, &ss) / 1000 << "ms, prebuf "
+                      << pa_bytes_to_usec(actual->prebuf, &ss) / 1000 << "ms" << std::endl;
+        }
+
+        pa_threaded_mainloop_unlock(mainloop_);
+
+        std::cout << "[VirtualDevice] Initialized: " << device_name << " @ " << sample_rate_ << "Hz" << std::endl;
         return true;
     }
-    
+
     bool write(const float* data, size_t frames, int channels) override {
-        if (!pulse_) {
+        if (!stream_ || channels != channels_) {
             return false;
         }
-        
-        size_t bytes = frames * channels * sizeof(float);
-        int error;
-        
-        if (pa_simple_write(pulse_, data, bytes, &error) < 0) {
-            std::cerr << "[VirtualDevice] Write error: " << pa_strerror(error) << std::endl;
-            return false;
+
+        // Whole frames only; on overflow the newest audio is dropped
+        size_t samples = frames * channels;
+        size_t space = ring_.capacity() - ring_.available();
+        ring_.write(data, std::min(samples, space - space % channels));
+
+        pa_threaded_mainloop_lock(mainloop_);
+
+        // Top up now if the server already asked for more than the callback could give
+        size_t writable = pa_stream_writable_size(stream_);
+        if (writable != (size_t)-1 && writable > 0) {
+            fill(writable);
         }
-        
+        updateLatency();
+
+        pa_threaded_mainloop_unlock(mainloop_);
         return true;
     }
-    
+
     void close() override {
-        if (pulse_) {
-            pa_simple_free(pulse_);
-            pulse_ = nullptr;
+        if (mainloop_) {
+            pa_threaded_mainloop_lock(mainloop_);
+            if (stream_) {
+                pa_stream_set_write_callback(stream_, NULL, NULL);
+                pa_stream_set_state_callback(stream_, NULL, NULL);
+                pa_stream_set_underflow_callback(stream_, NULL, NULL);
+                pa_stream_disconnect(stream_);
+                pa_stream_unref(stream_);
+                stream_ = nullptr;
+            }
+            if (context_) {
+                pa_context_set_state_callback(context_, NULL, NULL);
+                pa_context_disconnect(context_);
+                pa_context_unref(context_);
+                context_ = nullptr;
+            }
+            pa_threaded_mainloop_unlock(mainloop_);
+            pa_threaded_mainloop_stop(mainloop_);
+            pa_threaded_mainloop_free(mainloop_);
+            mainloop_ = nullptr;
         }
+
+        if (underflows_ > 0) {
+            std::cout << "[VirtualDevice] PulseAudio underflows: " << underflows_.load() << std::endl;
+            underflows_ = 0;
+        }
+        latency_us_ = -1;
     }
-    
+
     int getSampleRate() const override {
         return sample_rate_;
     }
-    
+
+    // Queued audio (ring + server) relative to twice the tlength target:
+    // 0.5 = on target, > 0.75 makes the mixer skip ticks until it drains
+    float getBufferUsage() const override {
+        int64_t latency = latency_us_.load(std::memory_order_relaxed);
+        if (latency < 0) return 0.0f;
+        return std::min(1.0f, (float)latency / (float)(2 * target_ms_ * 1000));
+    }
+
+    float getLatencyMs() const override {
+        int64_t latency = latency_us_.load(std::memory_order_relaxed);
+        return latency < 0 ? -1.0f : (float)latency / 1000.0f;
+    }
+
 private:
-    pa_simple* pulse_;
-    int sample_rate_;
+    static constexpr int RING_MS = 200;  // Local queue in front of the server buffer
+
+    // ---- Mainloop thread (or caller holding the mainloop lock) ----
+
+    static void onContextState(pa_context* c, void* userdata) {
+        (void)c;
+        auto* self = static_cast<VirtualDeviceLinux*>(userdata);
+        pa_threaded_mainloop_signal(self->mainloop_, 0);
+    }
+
+    static void onStreamState(pa_stream* s, void* userdata) {
+        (void)s;
+        auto* self = static_cast<VirtualDeviceLinux*>(userdata);
+        pa_threaded_mainloop_signal(self->mainloop_, 0);
+    }
+
+    static void onStreamWrite(pa_stream* s, size_t nbytes, void* userdata) {
+        (void)s;
+        auto* self = static_cast<VirtualDeviceLinux*>(userdata);
+        self->fill(nbytes);
+    }
+
+    static void onStreamUnderflow(pa_stream* s, void* userdata) {
+        (void)s;
+        auto* self = static_cast<VirtualDeviceLinux*>(userdata);
+        self->underflows_++;
+    }
+
+    static void onSinkInfo(pa_context* c, const pa_sink_info* info, int eol, void* userdata) {
+        (void)c;
+        auto* self = static_cast<VirtualDeviceLinux*>(userdata);
+        if (eol == 0 && info) {
+            self->native_rate_ = (int)info->sample_spec.rate;
+        }
+        pa_threaded_mainloop_signal(self->mainloop_, 0);
+    }
+
+    // Move whole frames from the ring into the server buffer (up to nbytes)
+    void fill(size_t nbytes) {
+        const size_t frame_bytes = channels_ * sizeof(float);
+
+        while (nbytes >= frame_bytes) {
+            size_t available = ring_.available() * sizeof(float);
+            size_t n = std::min(nbytes, available);
+            n -= n % frame_bytes;
+            if (n == 0) {
+                break;  // Nothing queued - let prebuf handle the gap
+            }
+
+            void* buffer = nullptr;
+            if (pa_stream_begin_write(stream_, &buffer, &n) < 0 || !buffer) {
+                break;
+            }
+            n -= n % frame_bytes;
+
+            size_t got = ring_.read(static_cast<float*>(buffer), n / sizeof(float)) * sizeof(float);
+            if (got == 0) {
+                pa_stream_cancel_write(stream_);
+                break;
+            }
+            pa_stream_write(stream_, buffer, got, NULL, 0, PA_SEEK_RELATIVE);
+            nbytes -= got;
+        }
+    }
+
+    void updateLatency() {
+        pa_usec_t server_us = 0;
+        int negative = 0;
+        if (pa_stream_get_latency(stream_, &server_us, &negative) < 0) {
+            return;  // No timing info yet
+        }
+
+        int64_t queued_us = (int64_t)ring_.available() * 1000000 / ((int64_t)sample_rate_ * channels_);
+        int64_t total = (negative ? 0 : (int64_t)server_us) + queued_us;
+        latency_us_.store(total, std::memory_order_relaxed);
+    }
+
+    bool waitForContext() {
+        while (true) {
+            pa_context_state_t state = pa_context_get_state(context_);
+            if (state == PA_CONTEXT_READY) return true;
+            if (!PA_CONTEXT_IS_GOOD(state)) return false;
+            pa_threaded_mainloop_wait(mainloop_);
+        }
+    }
+
+    bool waitForStream() {
+        while (true) {
+            pa_stream_state_t state = pa_stream_get_state(stream_);
+            if (state == PA_STREAM_READY) return true;
+            if (!PA_STREAM_IS_GOOD(state)) return false;
+            pa_threaded_mainloop_wait(mainloop_);
+        }
+    }
+
+    // Default sink's sample rate (mainloop lock held); 0 if unknown
+    int queryNativeRate() {
+        native_rate_ = 0;
+        pa_operation* op = pa_context_get_sink_info_by_name(context_, "@DEFAULT_SINK@", onSinkInfo, this);
+        if (!op) {
+            return 0;
+        }
+        while (pa_operation_get_state(op) == PA_OPERATION_RUNNING) {
+            pa_threaded_mainloop_wait(mainloop_);
+        }
+        pa_operation_unref(op);
+
+        if (native_rate_ > 0) {
+            std::cout << "[VirtualDevice] PulseAudio default sink runs at " << native_rate_ << "Hz" << std::endl;
+        }
+        return native_rate_;
+    }
+
+    pa_threaded_mainloop* mainloop_ = nullptr;
+    pa_context* context_ = nullptr;
+    pa_stream* stream_ = nullptr;
+
+    int sample_rate_ = 0;
+    int channels_ = 1;
+    int native_rate_ = 0;
+    int target_ms_ = 40;
+    int prebuf_ms_ = 20;
+
+    SpscRing<float> ring_;  // write() -> write callback
+    std::atomic<int64_t> latency_us_{-1};
+    std::atomic<uint64_t> underflows_{0};
 };
 
-std::unique_ptr<VirtualDevice> VirtualDevice::create() {
+std::unique_ptr<VirtualDevice> VirtualDevice::create(const std::string& driver_type) {
+    if (driver_type == "PIPEWIRE") {
+#ifdef HAVE_PIPEWIRE
+        return std::make_unique<VirtualDevicePipeWire>();
+#else
+        std::cerr << "[VirtualDevice] Built without PipeWire support, using PulseAudio" << std::endl;
+#endif
+    }
     return std::make_unique<VirtualDeviceLinux>();
 }
 
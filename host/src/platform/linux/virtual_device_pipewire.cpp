@@ -0,0 +1,406 @@
+/**
+ * @file virtual_device_pipewire.cpp
+ * @brief PipeWire Audio/Source virtual microphone implementation
+ */
+
+#include "virtual_device_pipewire.h"
+#include <pipewire/pipewire.h>
+#include <pipewire/extensions/metadata.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/pod/builder.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace moonmic {
+
+static const char* PW_NODE_NAME = "moonmic-mic";
+static const char* PW_NODE_DESCRIPTION = "MoonMic Virtual Microphone";
+static const int PW_CONNECT_TIMEOUT_S = 3;
+static const int PW_RING_MS = 200;
+
+static const pw_stream_events* streamEvents() {
+    static pw_stream_events events = [] {
+        pw_stream_events e;
+        memset(&e, 0, sizeof(e));
+        e.version = PW_VERSION_STREAM_EVENTS;
+        e.state_changed = [](void* data, enum pw_stream_state, enum pw_stream_state state, const char* error) {
+            static_cast<VirtualDevicePipeWire*>(data)->onStateChanged((int)state, error);
+        };
+        e.param_changed = [](void* data, uint32_t id, const spa_pod* param) {
+            static_cast<VirtualDevicePipeWire*>(data)->onParamChanged(id, param);
+        };
+        e.process = [](void* data) {
+            static_cast<VirtualDevicePipeWire*>(data)->process();
+        };
+        return e;
+    }();
+    return &events;
+}
+
+// Graph rate lookup: the daemon's "settings" metadata carries clock.rate (and
+// clock.force-rate while something pins the graph). Loop thread callbacks.
+struct GraphRateQuery {
+    pw_thread_loop* loop = nullptr;
+    pw_core* core = nullptr;
+    pw_registry* registry = nullptr;
+    pw_metadata* settings = nullptr;
+    spa_hook core_listener;
+    spa_hook registry_listener;
+    spa_hook settings_listener;
+    int sync_seq = 0;
+    bool done = false;
+    int rate = 0;
+    int force_rate = 0;
+};
+
+static const pw_metadata_events* settingsEvents() {
+    static pw_metadata_events events = [] {
+        pw_metadata_events e;
+        memset(&e, 0, sizeof(e));
+        e.version = PW_VERSION_METADATA_EVENTS;
+        e.property = [](void* data, uint32_t subject, const char* key, const char*, const char* value) -> int {
+            auto* query = static_cast<GraphRateQuery*>(data);
+            if (subject == PW_ID_CORE && key && value) {
+                if (strcmp(key, "clock.rate") == 0) query->rate = atoi(value);
+                if (strcmp(key, "clock.force-rate") == 0) query->force_rate = atoi(value);
+            }
+            return 0;
+        };
+        return e;
+    }();
+    return &events;
+}
+
+static const pw_registry_events* registryEvents() {
+    static pw_registry_events events = [] {
+        pw_registry_events e;
+        memset(&e, 0, sizeof(e));
+        e.version = PW_VERSION_REGISTRY_EVENTS;
+        e.global = [](void* data, uint32_t id, uint32_t, const char* type, uint32_t, const spa_dict* props) {
+            auto* query = static_cast<GraphRateQuery*>(data);
+            const char* name = props ? spa_dict_lookup(props, PW_KEY_METADATA_NAME) : nullptr;
+            if (query->settings || strcmp(type, PW_TYPE_INTERFACE_Metadata) != 0 || !name || strcmp(name, "settings") != 0) {
+                return;
+            }
+            query->settings = static_cast<pw_metadata*>(
+                pw_registry_bind(query->registry, id, PW_TYPE_INTERFACE_Metadata, PW_VERSION_METADATA, 0));
+            if (query->settings) {
+                pw_metadata_add_listener(query->settings, &query->settings_listener, settingsEvents(), query);
+                // One more round trip so the bound metadata's properties arrive before done
+                query->sync_seq = pw_core_sync(query->core, PW_ID_CORE, query->sync_seq);
+            }
+        };
+        return e;
+    }();
+    return &events;
+}
+
+static const pw_core_events* queryCoreEvents() {
+    static pw_core_events events = [] {
+        pw_core_events e;
+        memset(&e, 0, sizeof(e));
+        e.version = PW_VERSION_CORE_EVENTS;
+        e.done = [](void* data, uint32_t id, int seq) {
+            auto* query = static_cast<GraphRateQuery*>(data);
+            if (id == PW_ID_CORE && seq == query->sync_seq) {
+                query->done = true;
+                pw_thread_loop_signal(query->loop, false);
+            }
+        };
+        e.error = [](void* data, uint32_t id, int, int, const char*) {
+            auto* query = static_cast<GraphRateQuery*>(data);
+            if (id == PW_ID_CORE) {
+                query->done = true;
+                pw_thread_loop_signal(query->loop, false);
+            }
+        };
+        return e;
+    }();
+    return &events;
+}
+
+VirtualDevicePipeWire::VirtualDevicePipeWire() {
+    pw_init(nullptr, nullptr);
+}
+
+VirtualDevicePipeWire::~VirtualDevicePipeWire() {
+    close();
+    pw_deinit();
+}
+
+void VirtualDevicePipeWire::setBufferTargets(int target_ms, int prebuf_ms) {
+    if (target_ms > 0) target_ms_ = target_ms;
+    if (prebuf_ms >= 0) prebuf_ms_ = std::min(prebuf_ms, target_ms_);
+}
+
+bool VirtualDevicePipeWire::init(const std::string& device_name, int sample_rate, int channels) {
+    close();
+
+    loop_ = pw_thread_loop_new("moonmic-pipewire", nullptr);
+    if (!loop_ || pw_thread_loop_start(loop_) < 0) {
+        std::cerr << "[PipeWire] Failed to start thread loop" << std::endl;
+        close();
+        return false;
+    }
+
+    pw_thread_loop_lock(loop_);
+
+    // Auto (0): run at the graph's clock rate so the adapter doesn't resample
+    if (sample_rate <= 0) {
+        sample_rate = queryGraphRate();
+    }
+    sample_rate_ = sample_rate;
+    channels_ = channels;
+
+    ring_.reset((size_t)sample_rate_ * channels_ * PW_RING_MS / 1000);
+    prebuf_samples_ = (size_t)sample_rate_ * channels_ * prebuf_ms_ / 1000;
+    primed_ = false;
+    streaming_ = false;
+    failed_ = false;
+
+    // Ask the graph for a quantum of half the latency target (two quanta in flight)
+    uint32_t quantum = (uint32_t)std::max(64, sample_rate_ * target_ms_ / 2000);
+
+    const std::string description = device_name.empty() ? PW_NODE_DESCRIPTION : device_name;
+    pw_properties* props = pw_properties_new(
+        PW_KEY_MEDIA_TYPE, "Audio",
+        PW_KEY_MEDIA_CATEGORY, "Capture",
+        PW_KEY_MEDIA_ROLE, "Communication",
+        PW_KEY_MEDIA_CLASS, "Audio/Source",
+        PW_KEY_NODE_NAME, PW_NODE_NAME,
+        PW_KEY_NODE_DESCRIPTION, description.c_str(),
+        nullptr);
+    pw_properties_setf(props, PW_KEY_NODE_LATENCY, "%u/%u", quantum, (unsigned)sample_rate_);
+
+    stream_ = pw_stream_new_simple(pw_thread_loop_get_loop(loop_), "moonmic-host", props, streamEvents(), this);
+    if (!stream_) {
+        pw_thread_loop_unlock(loop_);
+        std::cerr << "[PipeWire] Failed to create stream (is the PipeWire daemon running?)" << std::endl;
+        close();
+        return false;
+    }
+
+    spa_audio_info_raw info;
+    memset(&info, 0, sizeof(info));
+    info.format = SPA_AUDIO_FORMAT_F32;
+    info.rate = (uint32_t)sample_rate_;
+    info.channels = (uint32_t)channels_;
+    if (channels_ == 1) {
+        info.position[0] = SPA_AUDIO_CHANNEL_MONO;
+    } else {
+        info.position[0] = SPA_AUDIO_CHANNEL_FL;
+        info.position[1] = SPA_AUDIO_CHANNEL_FR;
+    }
+
+    uint8_t pod_buffer[1024];
+    spa_pod_builder builder;
+    spa_pod_builder_init(&builder, pod_buffer, sizeof(pod_buffer));
+    const spa_pod* params[1];
+    params[0] = spa_format_audio_raw_build(&builder, SPA_PARAM_EnumFormat, &info);
+
+    // Source node: not autoconnected - applications link to it like any microphone
+    int res = pw_stream_connect(stream_, PW_DIRECTION_OUTPUT, PW_ID_ANY,
+                                (enum pw_stream_flags)(PW_STREAM_FLAG_MAP_BUFFERS | PW_STREAM_FLAG_RT_PROCESS),
+                                params, 1);
+    if (res < 0) {
+        pw_thread_loop_unlock(loop_);
+        std::cerr << "[PipeWire] pw_stream_connect failed: " << strerror(-res) << std::endl;
+        close();
+        return false;
+    }
+
+    // Wait for the node to be created (PAUSED until something records from it)
+    while (!streaming_ && !failed_) {
+        if (pw_thread_loop_timed_wait(loop_, PW_CONNECT_TIMEOUT_S) != 0) {
+            break;
+        }
+    }
+    bool ok = streaming_ && !failed_;
+    pw_thread_loop_unlock(loop_);
+
+    if (!ok) {
+        std::cerr << "[PipeWire] Stream did not become ready" << std::endl;
+        close();
+        return false;
+    }
+
+    std::cout << "[PipeWire] Audio/Source '" << description << "' ready @ " << sample_rate_ << "Hz, "
+              << channels_ << "ch, quantum " << quantum << " frames" << std::endl;
+    return true;
+}
+
+bool VirtualDevicePipeWire::write(const float* data, size_t frames, int channels) {
+    if (!stream_ || channels != channels_) {
+        return false;
+    }
+
+    // Whole frames only; on overflow the newest audio is dropped
+    size_t samples = frames * channels;
+    size_t space = ring_.capacity() - ring_.available();
+    ring_.write(data, std::min(samples, space - space % channels));
+    return true;
+}
+
+void VirtualDevicePipeWire::close() {
+    if (loop_) {
+        pw_thread_loop_lock(loop_);
+        if (stream_) {
+            pw_stream_destroy(stream_);
+            stream_ = nullptr;
+        }
+        pw_thread_loop_unlock(loop_);
+        pw_thread_loop_stop(loop_);
+        pw_thread_loop_destroy(loop_);
+        loop_ = nullptr;
+    }
+
+    if (underruns_ > 0) {
+        std::cout << "[PipeWire] Underruns: " << underruns_.load() << std::endl;
+        underruns_ = 0;
+    }
+    streaming_ = false;
+}
+
+float VirtualDevicePipeWire::getBufferUsage() const {
+    // 0.5 = at the latency target, > 0.75 makes the mixer skip ticks until it drains
+    if (sample_rate_ <= 0) return 0.0f;
+    float queued_ms = getLatencyMs();
+    return std::min(1.0f, queued_ms / (float)(2 * target_ms_));
+}
+
+float VirtualDevicePipeWire::getLatencyMs() const {
+    if (sample_rate_ <= 0) return -1.0f;
+    float ring_ms = (float)ring_.available() * 1000.0f / (float)(sample_rate_ * channels_);
+    float quantum_ms = (float)quantum_frames_.load(std::memory_order_relaxed) * 1000.0f / (float)sample_rate_;
+    return ring_ms + quantum_ms;
+}
+
+int VirtualDevicePipeWire::queryGraphRate() const {
+    // The daemon's live setting, not default.clock.rate from our own client config
+    // (loop lock held; the listeners run on the loop thread while we wait)
+    int rate = 48000;
+    pw_context* context = pw_context_new(pw_thread_loop_get_loop(loop_), nullptr, 0);
+    if (!context) {
+        return rate;
+    }
+
+    GraphRateQuery query;
+    query.loop = loop_;
+    query.core = pw_context_connect(context, nullptr, 0);
+    if (query.core) {
+        spa_zero(query.core_listener);
+        spa_zero(query.registry_listener);
+        spa_zero(query.settings_listener);
+        pw_core_add_listener(query.core, &query.core_listener, queryCoreEvents(), &query);
+        query.registry = pw_core_get_registry(query.core, PW_VERSION_REGISTRY, 0);
+        if (query.registry) {
+            pw_registry_add_listener(query.registry, &query.registry_listener, registryEvents(), &query);
+        }
+        query.sync_seq = pw_core_sync(query.core, PW_ID_CORE, 0);
+        while (!query.done) {
+            if (pw_thread_loop_timed_wait(loop_, PW_CONNECT_TIMEOUT_S) != 0) {
+                break;
+            }
+        }
+
+        if (query.settings) {
+            spa_hook_remove(&query.settings_listener);
+            pw_proxy_destroy(reinterpret_cast<pw_proxy*>(query.settings));
+        }
+        if (query.registry) {
+            spa_hook_remove(&query.registry_listener);
+            pw_proxy_destroy(reinterpret_cast<pw_proxy*>(query.registry));
+        }
+        spa_hook_remove(&query.core_listener);
+        pw_core_disconnect(query.core);
+    }
+    pw_context_destroy(context);
+
+    if (query.force_rate > 0) {
+        rate = query.force_rate;
+    } else if (query.rate > 0) {
+        rate = query.rate;
+    } else {
+        std::cerr << "[PipeWire] Graph clock.rate unavailable, assuming " << rate << "Hz" << std::endl;
+    }
+    return rate;
+}
+
+void VirtualDevicePipeWire::onStateChanged(int state, const char* error) {
+    if (state == PW_STREAM_STATE_ERROR) {
+        std::cerr << "[PipeWire] Stream error: " << (error ? error : "unknown") << std::endl;
+        failed_ = true;
+    } else if (state == PW_STREAM_STATE_PAUSED || state == PW_STREAM_STATE_STREAMING) {
+        streaming_ = true;
+    } else if (state == PW_STREAM_STATE_UNCONNECTED) {
+        streaming_ = false;
+    }
+    pw_thread_loop_signal(loop_, false);
+}
+
+void VirtualDevicePipeWire::onParamChanged(uint32_t id, const spa_pod* param) {
+    if (!param || id != SPA_PARAM_Format) {
+        return;
+    }
+
+    spa_audio_info_raw info;
+    memset(&info, 0, sizeof(info));
+    if (spa_format_audio_raw_parse(param, &info) < 0) {
+        return;
+    }
+    // We offer a single fixed format; the adapter converts for the graph if needed
+    if ((int)info.rate != sample_rate_ || (int)info.channels != channels_) {
+        std::cerr << "[PipeWire] Unexpected negotiated format: " << info.rate << "Hz, "
+                  << info.channels << "ch" << std::endl;
+    }
+}
+
+void VirtualDevicePipeWire::process() {
+    // Realtime graph thread: no locks, no allocation, no logging
+    pw_buffer* b = pw_stream_dequeue_buffer(stream_);
+    if (!b) {
+        return;
+    }
+
+    spa_buffer* buf = b->buffer;
+    float* dst = static_cast<float*>(buf->datas[0].data);
+    if (!dst) {
+        pw_stream_queue_buffer(stream_, b);
+        return;
+    }
+
+    const uint32_t stride = sizeof(float) * channels_;
+    uint32_t frames = buf->datas[0].maxsize / stride;
+#if PW_CHECK_VERSION(0, 3, 49)
+    if (b->requested > 0) {
+        frames = std::min<uint32_t>((uint32_t)b->requested, frames);
+    }
+#endif
+    quantum_frames_.store(frames, std::memory_order_relaxed);
+
+    const size_t samples = (size_t)frames * channels_;
+    size_t got = 0;
+    if (!primed_ && ring_.available() >= prebuf_samples_) {
+        primed_ = true;
+    }
+    if (primed_) {
+        got = ring_.read(dst, samples);
+        if (got < samples) {
+            underruns_.fetch_add(1, std::memory_order_relaxed);
+            primed_ = false;  // Ran dry: rebuild prebuf instead of stuttering every quantum
+        }
+    }
+    if (got < samples) {
+        memset(dst + got, 0, (samples - got) * sizeof(float));
+    }
+
+    buf->datas[0].chunk->offset = 0;
+    buf->datas[0].chunk->stride = stride;
+    buf->datas[0].chunk->size = frames * stride;
+    pw_stream_queue_buffer(stream_, b);
+}
+
+} // namespace moonmic
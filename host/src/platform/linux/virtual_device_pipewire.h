@@ -0,0 +1,70 @@
+/**
+ * @file virtual_device_pipewire.h
+ * @brief Linux virtual microphone as a native PipeWire Audio/Source node
+ */
+
+#pragma once
+
+#include "../virtual_device.h"
+#include "../spsc_ring.h"
+#include <atomic>
+#include <cstdint>
+
+struct pw_thread_loop;
+struct pw_stream;
+struct spa_pod;
+
+namespace moonmic {
+
+/**
+ * @brief PipeWire output stream published as an Audio/Source node
+ *
+ * Applications see the node as a microphone directly - no null-sink and
+ * monitor pair, no extra resampling/buffering hop through PulseAudio.
+ * write() fills a SPSC ring; the graph's realtime process callback drains
+ * one quantum per cycle and emits silence while the ring is (re)priming.
+ */
+class VirtualDevicePipeWire : public VirtualDevice {
+public:
+    VirtualDevicePipeWire();
+    ~VirtualDevicePipeWire() override;
+
+    bool init(const std::string& device_name, int sample_rate, int channels) override;
+    bool write(const float* data, size_t frames, int channels) override;
+    void close() override;
+    int getSampleRate() const override { return sample_rate_; }
+    float getBufferUsage() const override;
+    float getLatencyMs() const override;
+    void setBufferTargets(int target_ms, int prebuf_ms) override;
+
+    uint64_t getUnderruns() const { return underruns_.load(std::memory_order_relaxed); }
+
+    // pw_stream_events callbacks (loop / graph threads)
+    void onStateChanged(int state, const char* error);
+    void onParamChanged(uint32_t id, const spa_pod* param);
+    void process();
+
+private:
+    int queryGraphRate() const;
+
+    pw_thread_loop* loop_ = nullptr;
+    pw_stream* stream_ = nullptr;
+
+    int sample_rate_ = 0;
+    int channels_ = 1;
+    int target_ms_ = 40;
+    int prebuf_ms_ = 20;
+
+    // Realtime side
+    SpscRing<float> ring_;  // write() -> process()
+    size_t prebuf_samples_ = 0;
+    bool primed_ = false;
+    std::atomic<uint32_t> quantum_frames_{0};
+    std::atomic<uint64_t> underruns_{0};
+
+    // Stream state, updated on the loop thread
+    std::atomic<bool> streaming_{false};
+    std::atomic<bool> failed_{false};
+};
+
+} // namespace moonmic
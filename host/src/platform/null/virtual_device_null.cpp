@@ -0,0 +1,242 @@
+/**
+ * @file virtual_device_null.cpp
+ * @brief Simulated output devices (NULL / WAVFILE driver types)
+ */
+
+#include "virtual_device_null.h"
+#include "../../latency_trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace moonmic {
+
+namespace {
+constexpr int kMaxCatchUpPeriods = 4;    // Clock thread stalled longer than this: drop the gap
+}
+
+NullVirtualDevice::NullVirtualDevice(const SimulatedDeviceOptions& options)
+    : options_(options) {
+    if (options_.period_ms <= 0) options_.period_ms = 10;
+}
+
+NullVirtualDevice::~NullVirtualDevice() {
+    close();
+}
+
+void NullVirtualDevice::setBufferTargets(int target_ms, int prebuf_ms) {
+    if (target_ms > 0) target_ms_ = target_ms;
+    prebuf_ms_ = std::min(std::max(0, prebuf_ms), target_ms_);
+}
+
+bool NullVirtualDevice::init(const std::string& device_name, int sample_rate, int channels) {
+    (void)device_name;
+    close();
+
+    // 0 = "use the device's native rate", which for a simulated device is the configured one
+    sample_rate_ = sample_rate > 0 ? sample_rate : (options_.sample_rate > 0 ? options_.sample_rate : 48000);
+    channels_ = channels > 0 ? channels : 1;
+    prebuf_samples_ = (size_t)sample_rate_ * prebuf_ms_ / 1000 * channels_;
+
+    // Twice the buffer target, like the PortAudio ring: getBufferUsage() is on the other
+    // backends' scale and the mixer's 0.75 back-off holds 1.5x the target, so drift shows
+    // up in the DriftController instead of as queued latency. At least two periods.
+    int ring_ms = std::max(2 * target_ms_, 2 * options_.period_ms);
+    ring_.reset((size_t)sample_rate_ * ring_ms / 1000 * channels_);
+    size_t period_frames = (size_t)sample_rate_ * options_.period_ms / 1000;
+    period_buffer_.assign(std::max<size_t>(period_frames, 1) * channels_, 0.0f);
+    primed_ = false;
+    underruns_ = 0;
+    frames_played_ = 0;
+    frames_dropped_ = 0;
+
+    if (!openSink()) {
+        return false;
+    }
+
+    running_ = true;
+    clock_thread_ = std::thread(&NullVirtualDevice::clockLoop, this);
+
+    std::cout << "[NullDevice] " << sample_rate_ << "Hz " << channels_ << "ch, "
+              << options_.period_ms << "ms period, drift " << options_.drift_ppm << "ppm, prebuf "
+              << prebuf_ms_ << "ms" << std::endl;
+    return true;
+}
+
+void NullVirtualDevice::close() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    if (clock_thread_.joinable()) {
+        clock_thread_.join();
+    }
+    closeSink();
+
+    std::cout << "[NullDevice] Played " << (double)frames_played_.load() / sample_rate_ << "s, underruns: "
+              << underruns_.load() << ", frames dropped (ring full): " << frames_dropped_.load() << std::endl;
+}
+
+bool NullVirtualDevice::write(const float* data, size_t frames, int channels) {
+    if (!running_ || channels != channels_) {
+        return false;
+    }
+
+    // Whole frames only; on overflow the newest audio is dropped
+    size_t samples = frames * channels_;
+    size_t space = ring_.capacity() - ring_.available();
+    size_t to_write = std::min(samples, space - space % channels_);
+    ring_.write(data, to_write);
+    if (to_write < samples) {
+        frames_dropped_.fetch_add((samples - to_write) / channels_, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+float NullVirtualDevice::getLatencyMs() const {
+    if (sample_rate_ <= 0) return -1.0f;
+    return (float)ring_.available() / channels_ * 1000.0f / sample_rate_;
+}
+
+void NullVirtualDevice::clockLoop() {
+    using clock = std::chrono::steady_clock;
+    const auto period = std::chrono::milliseconds(options_.period_ms);
+    const double rate = sample_rate_ * (1.0 + options_.drift_ppm / 1e6);
+    const size_t period_frames = period_buffer_.size() / channels_;
+
+    // Frames owed are derived from the total elapsed time, so rounding never accumulates
+    auto epoch = clock::now();
+    uint64_t consumed = 0;
+    auto wake = epoch;
+
+    while (running_) {
+        wake += period;
+        std::this_thread::sleep_until(wake);
+
+        auto now = clock::now();
+        double elapsed = std::chrono::duration<double>(now - epoch).count();
+        uint64_t due = (uint64_t)(elapsed * rate) - consumed;
+        if (due > period_frames * kMaxCatchUpPeriods) {
+            // Scheduler stall (or a debugger): a real card would have underrun, not played a burst
+            consumed += due - period_frames;
+            due = period_frames;
+            wake = now;
+        }
+
+        while (due > 0) {
+            size_t frames = std::min<uint64_t>(due, period_frames);
+            size_t samples = frames * channels_;
+            float* out = period_buffer_.data();
+
+            if (!primed_ && ring_.available() >= std::max<size_t>(prebuf_samples_, 1)) {
+                primed_ = true;
+            }
+            if (LatencyTrace::ENABLED && primed_) {
+                traceQueued(TraceStage::DeviceRing, ring_.available() / channels_, sample_rate_);
+            }
+            size_t got = primed_ ? ring_.read(out, samples) : 0;
+            got -= got % channels_;
+            if (got < samples) {
+                std::memset(out + got, 0, (samples - got) * sizeof(float));
+                if (primed_) {
+                    underruns_.fetch_add(1, std::memory_order_relaxed);
+                    primed_ = false;
+                }
+            }
+
+            onPlayed(out, frames);
+            frames_played_.fetch_add(frames, std::memory_order_relaxed);
+            consumed += frames;
+            due -= frames;
+        }
+    }
+}
+
+WavFileVirtualDevice::WavFileVirtualDevice(const SimulatedDeviceOptions& options)
+    : NullVirtualDevice(options) {
+    if (options_.wav_path.empty()) options_.wav_path = "moonmic-output.wav";
+}
+
+WavFileVirtualDevice::~WavFileVirtualDevice() {
+    close();  // Before ~NullVirtualDevice: closeSink() must still dispatch here
+}
+
+static void putLE16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void putLE32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+void WavFileVirtualDevice::writeHeader(uint32_t data_bytes) {
+    // RIFF/WAVE, fmt (IEEE float, 18-byte form), fact, data
+    uint8_t h[58];
+    memcpy(h, "RIFF", 4);
+    putLE32(h + 4, 50 + data_bytes);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    putLE32(h + 16, 18);
+    putLE16(h + 20, 3);
+    putLE16(h + 22, (uint16_t)channels_);
+    putLE32(h + 24, (uint32_t)sample_rate_);
+    putLE32(h + 28, (uint32_t)(sample_rate_ * channels_ * sizeof(float)));
+    putLE16(h + 32, (uint16_t)(channels_ * sizeof(float)));
+    putLE16(h + 34, 32);
+    putLE16(h + 36, 0);
+    memcpy(h + 38, "fact", 4);
+    putLE32(h + 42, 4);
+    putLE32(h + 46, data_bytes / (uint32_t)(channels_ * sizeof(float)));
+    memcpy(h + 50, "data", 4);
+    putLE32(h + 54, data_bytes);
+    fseek(file_, 0, SEEK_SET);
+    fwrite(h, 1, sizeof(h), file_);
+}
+
+bool WavFileVirtualDevice::openSink() {
+    file_ = fopen(options_.wav_path.c_str(), "wb");
+    if (!file_) {
+        std::cerr << "[WavFileDevice] Cannot create " << options_.wav_path << std::endl;
+        return false;
+    }
+    data_bytes_ = 0;
+    writeHeader(0);
+    std::cout << "[WavFileDevice] Recording output to " << options_.wav_path << std::endl;
+    return true;
+}
+
+void WavFileVirtualDevice::onPlayed(const float* samples, size_t frames) {
+    // Little-endian hosts only, like the rest of the wire/file handling
+    size_t samples_count = frames * channels_;
+    if (data_bytes_ + samples_count * sizeof(float) > 0xFFFFFFF0ull) {
+        return;  // RIFF size limit (~6h at 48kHz stereo): stop recording, keep playing
+    }
+    data_bytes_ += fwrite(samples, sizeof(float), samples_count, file_) * sizeof(float);
+}
+
+void WavFileVirtualDevice::closeSink() {
+    if (!file_) {
+        return;
+    }
+    writeHeader((uint32_t)data_bytes_);
+    fclose(file_);
+    file_ = nullptr;
+    std::cout << "[WavFileDevice] Wrote " << data_bytes_ / (channels_ * sizeof(float)) << " frames to "
+              << options_.wav_path << std::endl;
+}
+
+std::unique_ptr<VirtualDevice> createSimulatedDevice(const std::string& driver_type,
+                                                     const SimulatedDeviceOptions& options) {
+    if (driver_type == "NULL") {
+        return std::make_unique<NullVirtualDevice>(options);
+    }
+    if (driver_type == "WAVFILE") {
+        return std::make_unique<WavFileVirtualDevice>(options);
+    }
+    return nullptr;
+}
+
+} // namespace moonmic
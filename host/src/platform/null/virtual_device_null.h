@@ -0,0 +1,111 @@
+/**
+ * @file virtual_device_null.h
+ * @brief Simulated output devices for headless runs: discard (NULL) or record to a WAV file (WAVFILE)
+ */
+
+#pragma once
+
+#include "../virtual_device.h"
+#include "../spsc_ring.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace moonmic {
+
+// Config::audio null_* / wav_output_path, see config.h
+struct SimulatedDeviceOptions {
+    int sample_rate = 48000;
+    int period_ms = 10;
+    float drift_ppm = 0.0f;
+    std::string wav_path;
+};
+
+/**
+ * @brief Output device without hardware, driven by a simulated sound card clock
+ *
+ * write() fills an SPSC ring sized like the PortAudio one (twice the buffer
+ * target) and drops the newest audio when it is full, so getBufferUsage()
+ * means the same thing to the mixer's pacing. A clock thread wakes every period_ms and consumes
+ * the frames that the device would have played by then at
+ * sample_rate * (1 + drift_ppm / 1e6) - positive drift plays faster than the
+ * system clock, negative slower, like a real card's crystal against the
+ * client's. Playback waits for prebuf_ms of audio at start and after every
+ * underrun (PulseAudio prebuf semantics).
+ */
+class NullVirtualDevice : public VirtualDevice {
+public:
+    explicit NullVirtualDevice(const SimulatedDeviceOptions& options);
+    ~NullVirtualDevice() override;
+
+    bool init(const std::string& device_name, int sample_rate, int channels) override;
+    bool write(const float* data, size_t frames, int channels) override;
+    void close() override;
+    int getSampleRate() const override { return sample_rate_; }
+    float getBufferUsage() const override { return ring_.usage(); }
+    float getLatencyMs() const override;
+    void setBufferTargets(int target_ms, int prebuf_ms) override;
+
+    uint64_t getUnderruns() const { return underruns_.load(std::memory_order_relaxed); }
+    uint64_t getFramesPlayed() const { return frames_played_.load(std::memory_order_relaxed); }
+
+protected:
+    virtual bool openSink() { return true; }
+    // Clock thread: one period as the device played it (silence included), interleaved
+    virtual void onPlayed(const float* samples, size_t frames) { (void)samples; (void)frames; }
+    virtual void closeSink() {}
+
+    SimulatedDeviceOptions options_;
+    int sample_rate_ = 0;
+    int channels_ = 1;
+
+private:
+    void clockLoop();
+
+    int target_ms_ = 40;
+    int prebuf_ms_ = 20;
+    size_t prebuf_samples_ = 0;
+
+    SpscRing<float> ring_;            // write() -> clockLoop()
+    std::vector<float> period_buffer_;
+    std::thread clock_thread_;
+    std::atomic<bool> running_{false};
+    bool primed_ = false;             // Clock thread only
+
+    std::atomic<uint64_t> underruns_{0};
+    std::atomic<uint64_t> frames_played_{0};
+    std::atomic<uint64_t> frames_dropped_{0};  // Ring full in write()
+};
+
+/**
+ * @brief NullVirtualDevice that also records what it played as a 32-bit float WAV
+ *
+ * The file is written by the clock thread, including the silence emitted
+ * while priming or after an underrun, so gaps show up where a listener
+ * would have heard them. Sizes in the header are filled in on close().
+ */
+class WavFileVirtualDevice : public NullVirtualDevice {
+public:
+    explicit WavFileVirtualDevice(const SimulatedDeviceOptions& options);
+    ~WavFileVirtualDevice() override;
+
+protected:
+    bool openSink() override;
+    void onPlayed(const float* samples, size_t frames) override;
+    void closeSink() override;
+
+private:
+    void writeHeader(uint32_t data_bytes);
+
+    FILE* file_ = nullptr;
+    uint64_t data_bytes_ = 0;
+};
+
+// "NULL" / "WAVFILE" driver types; nullptr for anything else (hardware backends)
+std::unique_ptr<VirtualDevice> createSimulatedDevice(const std::string& driver_type,
+                                                     const SimulatedDeviceOptions& options);
+
+} // namespace moonmic
@@ -15,6 +15,9 @@ DEFINE_GUID(KSDATAFORMAT_SUBTYPE_IEEE_FLOAT, 0x00000003, 0x0000, 0x0010, 0x80, 0
 #endif
 
 #include "virtual_device_pa.h"
+#include "latency_trace.h"
+#include "../../../../dsp/moonmic_dsp.h"
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 #include <vector>
@@ -35,17 +38,17 @@ VirtualDevicePortAudio::~VirtualDevicePortAudio() {
     Pa_Terminate();
 }
 
+void VirtualDevicePortAudio::setBufferTargets(int target_ms, int prebuf_ms) {
+    (void)prebuf_ms;  // The callback plays whatever is queued
+    if (target_ms > 0) target_ms_ = target_ms;
+}
+
 void VirtualDevicePortAudio::close() {
     if (stream_) {
         Pa_AbortStream(stream_); // Stop immediately
         Pa_CloseStream(stream_);
         stream_ = nullptr;
     }
-    
-    if (resampler_) {
-        speex_resampler_destroy(resampler_);
-        resampler_ = nullptr;
-    }
 }
 
 bool VirtualDevicePortAudio::init(const std::string& device_name, int sample_rate, int channels) {
@@ -201,19 +204,10 @@ bool VirtualDevicePortAudio::init(const std::string& device_name, int sample_rat
     }
 #endif
 
-    source_sample_rate_ = sample_rate;
-    if (source_sample_rate_ <= 0) source_sample_rate_ = target_rate;
-
     outputParameters.sampleFormat = target_format;
     outputParameters.channelCount = target_channels;
     channels_ = target_channels;
 
-    // Initialize Ring Buffer (0.8 seconds / 800ms)
-    rb_size_ = target_channels * target_rate * 0.8; 
-    ring_buffer_.resize(rb_size_, 0.0f);
-    rb_read_pos_ = 0;
-    rb_write_pos_ = 0;
-    
     // WDM-KS often requires explicit buffer size
     // Use 1024 frames for stability
     unsigned long frames_per_buffer = using_wdmks ? 1024 : paFramesPerBufferUnspecified;
@@ -221,6 +215,15 @@ bool VirtualDevicePortAudio::init(const std::string& device_name, int sample_rat
         std::cout << "[PortAudio] WDM-KS: using explicit buffer size (1024 frames)" << std::endl;
     }
 
+    // Ring at twice the buffer target, like the other backends' usage scale: the mixer
+    // backs off at 0.75, so at most 1.5x the target queues here (not 600ms of an 800ms ring).
+    // Never smaller than two callback buffers.
+    size_t ring_frames = (size_t)target_rate * 2 * target_ms_ / 1000;
+    if (using_wdmks) {
+        ring_frames = std::max(ring_frames, (size_t)frames_per_buffer * 2);
+    }
+    ring_.reset(ring_frames * target_channels);
+
     // Try opening with the PRECISE native format
     PaError err = Pa_OpenStream(
         &stream_,
@@ -241,13 +244,10 @@ bool VirtualDevicePortAudio::init(const std::string& device_name, int sample_rat
         return false;
     }
 
-    if (actual_sample_rate_ != source_sample_rate_) {
-        std::cout << "[PortAudio] Resampling required: " << source_sample_rate_ << "Hz -> " << actual_sample_rate_ << "Hz" << std::endl;
-        int resampler_err;
-        resampler_ = speex_resampler_init(target_channels, source_sample_rate_, actual_sample_rate_, 3, &resampler_err);
-        if (!resampler_) {
-            std::cerr << "[PortAudio] Failed to initialize Speex resampler: " << resampler_err << std::endl;
-        }
+    // No resampling here: callers feed getSampleRate() audio (the sessions' resamplers target it)
+    if (sample_rate > 0 && sample_rate != actual_sample_rate_) {
+        std::cout << "[PortAudio] Requested " << sample_rate << "Hz, device runs at " << actual_sample_rate_
+                  << "Hz - write() expects " << actual_sample_rate_ << "Hz audio" << std::endl;
     }
 
     err = Pa_StartStream(stream_);
@@ -262,23 +262,7 @@ bool VirtualDevicePortAudio::init(const std::string& device_name, int sample_rat
     return true;
 }
 float VirtualDevicePortAudio::getBufferUsage() const {
-    // This is technically const but we lock a mutable mutex or cast away const
-    // std::lock_guard ...
-    // To solve constness with mutex, mutex should be mutable. 
-    // Assuming mutex_ is not mutable, I'll allow race (read is atomic-ish enough for metrics).
-    // Or better, cast away const.
-    // Actually, mutex_ IS usually mutable in C++ classes if used in const methods.
-    // Let's check header. "std::mutex mutex_;" - Not mutable.
-    // I'll implement it without lock for speed, or assume float access is atomic enough for estimation.
-    
-    size_t r = rb_read_pos_;
-    size_t w = rb_write_pos_;
-    size_t s = rb_size_;
-    
-    if (s == 0) return 0.0f;
-    
-    size_t count = (w + s - r) % s;
-    return (float)count / (float)s;
+    return ring_.usage();
 }
 
 bool VirtualDevicePortAudio::write(const float* data, size_t frames, int channels) {
@@ -286,11 +270,11 @@ bool VirtualDevicePortAudio::write(const float* data, size_t frames, int channel
 
     // Prepare data to write (handle mono->stereo conversion if needed)
     const float* write_ptr = data;
-    std::vector<float> mono_to_stereo_buffer;
     size_t in_frames = frames;
     int in_channels = channels;
 
     if (in_channels != channels_) {
+        std::vector<float>& mono_to_stereo_buffer = convert_buffer_;
         mono_to_stereo_buffer.resize(frames * channels_);
         for (size_t i = 0; i < frames; i++) {
             for (int ch = 0; ch < channels_; ch++) {
@@ -310,43 +294,11 @@ bool VirtualDevicePortAudio::write(const float* data, size_t frames, int channel
         in_channels = channels_;
     }
 
-    // Handle resampling
-    std::vector<float> resampled_buffer;
-    if (resampler_) {
-        // Calculate output frames (approximate but should be safe with a bit of extra)
-        // Actual output might be slightly more/less due to fractional ratio
-        spx_uint32_t out_frames = (frames * actual_sample_rate_ / source_sample_rate_) + 10;
-        resampled_buffer.resize(out_frames * channels_);
-        
-        spx_uint32_t in_len = (spx_uint32_t)frames;
-        spx_uint32_t out_len = (spx_uint32_t)out_frames;
-        
-        speex_resampler_process_interleaved_float(resampler_, write_ptr, &in_len, resampled_buffer.data(), &out_len);
-        
-        write_ptr = resampled_buffer.data();
-        in_frames = out_len;
-    }
-
+    // Push whole frames to the ring; on overflow the newest audio is dropped
     size_t samples_to_write = in_frames * channels_;
-
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    // Push data to ring buffer
-    size_t write_pos = rb_write_pos_;
-    size_t read_pos = rb_read_pos_;
-    size_t size = rb_size_;
-
-    for (size_t i = 0; i < samples_to_write; i++) {
-        size_t next_write_pos = (write_pos + 1) % size;
-        if (next_write_pos == read_pos) {
-             // std::cerr << "[PortAudio] Ring buffer overflow!" << std::endl;
-             break;
-        }
-        ring_buffer_[write_pos] = write_ptr[i];
-        write_pos = next_write_pos;
-    }
-    
-    rb_write_pos_ = write_pos;
+    size_t space = ring_.capacity() - ring_.available();
+    samples_to_write = std::min(samples_to_write, space - space % channels_);
+    ring_.write(write_ptr, samples_to_write);
     return true;
 }
 
@@ -356,44 +308,33 @@ int VirtualDevicePortAudio::paCallback(const void* inputBuffer, void* outputBuff
                                       PaStreamCallbackFlags statusFlags,
                                       void* userData) {
     auto* device = static_cast<VirtualDevicePortAudio*>(userData);
-    int16_t* out = static_cast<int16_t*>(outputBuffer);
     size_t samples_needed = framesPerBuffer * device->channels_;
     
-    std::lock_guard<std::mutex> lock(device->mutex_);
-    
-    size_t read_pos = device->rb_read_pos_;
-    size_t write_pos = device->rb_write_pos_;
-    size_t size = device->rb_size_;
-    
-    size_t samples_read = 0;
+    // How long the audio played now sat in the ring (wait-free, fine in the callback)
+    if (LatencyTrace::ENABLED) {
+        traceQueued(TraceStage::DeviceRing, device->ring_.available() / device->channels_,
+                    device->actual_sample_rate_);
+    }
     
-    // Fill output buffer from ring buffer (convert Float -> Target)
+    // Realtime thread: no locks, no allocation - drain the ring segment by segment
+    // and convert Float -> Target in bulk
     if (device->is_float_) {
         float* out = static_cast<float*>(outputBuffer);
-        while (samples_read < samples_needed) {
-            if (read_pos == write_pos) break;
-            out[samples_read++] = device->ring_buffer_[read_pos];
-            read_pos = (read_pos + 1) % size;
-        }
+        size_t samples_read = device->ring_.read(out, samples_needed);
         if (samples_read < samples_needed) {
             std::memset(out + samples_read, 0, (samples_needed - samples_read) * sizeof(float));
         }
     } else {
         int16_t* out = static_cast<int16_t*>(outputBuffer);
-        while (samples_read < samples_needed) {
-            if (read_pos == write_pos) break;
-            float val = device->ring_buffer_[read_pos];
-            if (val > 1.0f) val = 1.0f;
-            if (val < -1.0f) val = -1.0f;
-            out[samples_read++] = static_cast<int16_t>(val * 32767.0f);
-            read_pos = (read_pos + 1) % size;
-        }
+        size_t samples_read = device->ring_.consume(samples_needed, [&out](const float* data, size_t n) {
+            moonmic_dsp_float_to_s16(data, out, n);
+            out += n;
+        });
         if (samples_read < samples_needed) {
-            std::memset(out + samples_read, 0, (samples_needed - samples_read) * sizeof(int16_t));
+            std::memset(out, 0, (samples_needed - samples_read) * sizeof(int16_t));
         }
     }
     
-    device->rb_read_pos_ = read_pos;
     return paContinue;
 }
 
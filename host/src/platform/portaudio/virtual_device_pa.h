@@ -1,10 +1,9 @@
 #pragma once
 
 #include "platform/virtual_device.h"
+#include "platform/spsc_ring.h"
 #include <portaudio.h>
 #include <vector>
-#include <mutex>
-#include <speex/speex_resampler.h>
 
 namespace moonmic {
 
@@ -16,8 +15,9 @@ public:
     bool init(const std::string& device_name, int sample_rate, int channels) override;
     bool write(const float* data, size_t frames, int channels) override;
     void close() override;
-    int getSampleRate() const override { return actual_sample_rate_; }
+    int getSampleRate() const override { return actual_sample_rate_; }  // write() takes audio at this rate
     float getBufferUsage() const override;
+    void setBufferTargets(int target_ms, int prebuf_ms) override;
     
     // PortAudio callback
     static int paCallback(const void* inputBuffer, void* outputBuffer,
@@ -31,18 +31,13 @@ private:
     int actual_sample_rate_ = 48000;
     int channels_ = 2; // Output channels
     bool is_float_ = false; // Output is Float32
+    int target_ms_ = 40;    // Ring fill the mixer steers to (it backs off at 3/4 of 2x this)
     
-    // Ring Buffer for Callback Mode
-    std::vector<float> ring_buffer_;
-    size_t rb_read_pos_ = 0;
-    size_t rb_write_pos_ = 0;
-    size_t rb_size_ = 0;
+    // Ring Buffer for Callback Mode: write() produces, paCallback consumes (wait-free)
+    SpscRing<float> ring_;
     
-    std::mutex mutex_;
-    
-    // Resampling
-    SpeexResamplerState* resampler_ = nullptr;
-    int source_sample_rate_ = 0; // Input rate (from network)
+    // write() scratch, reused between calls
+    std::vector<float> convert_buffer_;
 };
 
 } // namespace moonmic
@@ -0,0 +1,216 @@
+/**
+ * @file spsc_ring.h
+ * @brief Wait-free single-producer/single-consumer sample ring and object queue
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace moonmic {
+
+/**
+ * @brief Fixed-capacity ring shared by exactly one writer and one reader thread
+ *
+ * Neither side ever blocks, so the reader can run in a realtime audio
+ * callback while the network thread writes. Indices grow monotonically and
+ * are only wrapped when addressing the storage; each side publishes its
+ * index with release ordering after copying, so the other side never sees
+ * a partially written block. Transfers are done as at most two contiguous
+ * segments instead of per-sample modulo arithmetic.
+ *
+ * reset() and the constructor are not thread-safe: call them while neither
+ * side is running.
+ */
+template <typename T>
+class SpscRing {
+public:
+    SpscRing() = default;
+    explicit SpscRing(size_t capacity) { reset(capacity); }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * @brief Reallocate storage and drop all contents
+     */
+    void reset(size_t capacity) {
+        buffer_.assign(capacity, T());
+        capacity_ = capacity;
+        write_index_.store(0, std::memory_order_relaxed);
+        read_index_.store(0, std::memory_order_relaxed);
+        cached_read_ = 0;
+        cached_write_ = 0;
+    }
+
+    // ---- Producer side ----
+
+    /**
+     * @brief Append up to `count` items
+     * @return Items written (less than count when the ring is full)
+     */
+    size_t write(const T* data, size_t count) {
+        const size_t w = write_index_.load(std::memory_order_relaxed);
+        if (capacity_ - (w - cached_read_) < count) {
+            cached_read_ = read_index_.load(std::memory_order_acquire);
+        }
+        const size_t n = std::min(count, capacity_ - (w - cached_read_));
+        if (n == 0) {
+            return 0;
+        }
+
+        const size_t pos = w % capacity_;
+        const size_t first = std::min(n, capacity_ - pos);
+        memcpy(&buffer_[pos], data, first * sizeof(T));
+        if (n > first) {
+            memcpy(&buffer_[0], data + first, (n - first) * sizeof(T));
+        }
+
+        write_index_.store(w + n, std::memory_order_release);
+        return n;
+    }
+
+    // ---- Consumer side ----
+
+    /**
+     * @brief Hand up to `count` items to fn(const T* data, size_t n) as contiguous segments
+     *
+     * Lets the consumer convert straight out of the ring (e.g. float -> int16)
+     * without an intermediate copy. fn is called at most twice.
+     * @return Items consumed
+     */
+    template <typename Fn>
+    size_t consume(size_t count, Fn&& fn) {
+        const size_t r = read_index_.load(std::memory_order_relaxed);
+        if (cached_write_ - r < count) {
+            cached_write_ = write_index_.load(std::memory_order_acquire);
+        }
+        const size_t n = std::min(count, cached_write_ - r);
+        if (n == 0) {
+            return 0;
+        }
+
+        const size_t pos = r % capacity_;
+        const size_t first = std::min(n, capacity_ - pos);
+        fn(&buffer_[pos], first);
+        if (n > first) {
+            fn(&buffer_[0], n - first);
+        }
+
+        read_index_.store(r + n, std::memory_order_release);
+        return n;
+    }
+
+    /**
+     * @brief Copy out up to `count` items
+     * @return Items read
+     */
+    size_t read(T* out, size_t count) {
+        return consume(count, [&out](const T* data, size_t n) {
+            memcpy(out, data, n * sizeof(T));
+            out += n;
+        });
+    }
+
+    // ---- Either side (approximate while the other side runs) ----
+
+    size_t available() const {
+        // Read index first: it can only advance towards the write index
+        const size_t r = read_index_.load(std::memory_order_acquire);
+        return write_index_.load(std::memory_order_acquire) - r;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    float usage() const {
+        if (capacity_ == 0) return 0.0f;
+        return (float)available() / (float)capacity_;
+    }
+
+private:
+    std::vector<T> buffer_;
+    size_t capacity_ = 0;
+
+    // Producer and consumer state on separate cache lines
+    alignas(64) std::atomic<size_t> write_index_{0};
+    size_t cached_read_ = 0;   // Producer's last view of read_index_
+
+    alignas(64) std::atomic<size_t> read_index_{0};
+    size_t cached_write_ = 0;  // Consumer's last view of write_index_
+};
+
+/**
+ * @brief Bounded wait-free SPSC queue of movable objects
+ *
+ * Same index protocol as SpscRing, but one object per slot so it can carry
+ * non-trivial types (tasks, packet slot references). A popped slot is reset
+ * to T() so whatever it owned is released by the consumer, not when the
+ * producer later overwrites it.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) : slots_(capacity), capacity_(capacity) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * @brief Producer: enqueue, or return false (item untouched) when full
+     */
+    bool push(T&& item) {
+        const size_t w = write_index_.load(std::memory_order_relaxed);
+        if (w - cached_read_ >= capacity_) {
+            cached_read_ = read_index_.load(std::memory_order_acquire);
+            if (w - cached_read_ >= capacity_) {
+                return false;
+            }
+        }
+        slots_[w % capacity_] = std::move(item);
+        write_index_.store(w + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Consumer: dequeue into `out`, or return false when empty
+     */
+    bool pop(T& out) {
+        const size_t r = read_index_.load(std::memory_order_relaxed);
+        if (r == cached_write_) {
+            cached_write_ = write_index_.load(std::memory_order_acquire);
+            if (r == cached_write_) {
+                return false;
+            }
+        }
+        T& slot = slots_[r % capacity_];
+        out = std::move(slot);
+        slot = T();
+        read_index_.store(r + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        const size_t r = read_index_.load(std::memory_order_acquire);
+        return write_index_.load(std::memory_order_acquire) - r;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return capacity_; }
+
+private:
+    std::vector<T> slots_;
+    const size_t capacity_;
+
+    alignas(64) std::atomic<size_t> write_index_{0};
+    size_t cached_read_ = 0;
+
+    alignas(64) std::atomic<size_t> read_index_{0};
+    size_t cached_write_ = 0;
+};
+
+} // namespace moonmic
@@ -22,7 +22,14 @@ public:
     // Returns buffer usage fraction (0.0 to 1.0). Default 0.0 for non-buffered devices.
     virtual float getBufferUsage() const { return 0.0f; }
     
-    static std::unique_ptr<VirtualDevice> create();
+    // Audio queued ahead of the speaker/driver in ms (-1 = unknown)
+    virtual float getLatencyMs() const { return -1.0f; }
+    
+    // Requested output buffering, set before init(). Backends without a tunable buffer ignore it.
+    virtual void setBufferTargets(int target_ms, int prebuf_ms) { (void)target_ms; (void)prebuf_ms; }
+    
+    // driver_type is Config::audio.driver_type; platforms map it to a backend ("PIPEWIRE" on Linux)
+    static std::unique_ptr<VirtualDevice> create(const std::string& driver_type = "");
 };
 
 } // namespace moonmic
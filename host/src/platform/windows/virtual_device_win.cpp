@@ -6,6 +6,7 @@
 
 #include "../virtual_device.h"
 #include "driver_installer.h"
+#include "../../../../dsp/moonmic_dsp.h"
 #define INITGUID
 #include <windows.h>
 #include <vector>
@@ -309,9 +310,7 @@ public:
         // If input channels match system channels, direct copy/convert
         if (channels == system_channels_) {
             if (convert_to_int16_) {
-                for (size_t i = 0; i < frames * channels; i++) {
-                    int16_buffer[i] = toInt16(data[i]);
-                }
+                moonmic_dsp_float_to_s16(data, int16_buffer, frames * channels);
             } else {
                 memcpy(buffer, data, frames * channels * sizeof(float));
             }
@@ -467,7 +466,8 @@ private:
     }
 };
 
-std::unique_ptr<VirtualDevice> VirtualDevice::create() {
+std::unique_ptr<VirtualDevice> VirtualDevice::create(const std::string& driver_type) {
+    (void)driver_type;  // VBCABLE/STEAM select the endpoint, not the backend
 #ifdef USE_PORTAUDIO
     // Use PortAudio implementation (supports WDM-KS for Steam Driver)
     return std::make_unique<VirtualDevicePortAudio>();
@@ -33,6 +33,36 @@ extern "C" {
 /** Default UDP port for microphone transmission */
 #define MOONMIC_DEFAULT_PORT 48100
 
+/** Default expected packet loss (%) - drives Opus in-band FEC redundancy */
+#define MOONMIC_DEFAULT_PACKET_LOSS_PERC 10
+
+/** Most Opus frames bundled into one datagram (Opus also caps a packet at 120ms of audio) */
+#define MOONMIC_MAX_FRAMES_PER_PACKET 6
+
+/** Latency profiles (moonmic_config_t::latency_profile): encoder settings and host buffering together */
+#define MOONMIC_PROFILE_BALANCED        0  /**< 20ms frames, AUDIO application, complexity 10; host holds ~40ms (default) */
+#define MOONMIC_PROFILE_ULTRA_LOW       1  /**< 5ms frames, RESTRICTED_LOWDELAY (CELT only, no in-band FEC), reduced complexity, 5ms capture; host holds ~20ms */
+#define MOONMIC_PROFILE_BANDWIDTH_SAVER 2  /**< 40ms frames, VOIP application, complexity 10; host holds ~80ms */
+
+/** Default RAW-mode VAD threshold (dBFS): frames quieter than this after gain are suppressed */
+#define MOONMIC_DEFAULT_VAD_THRESHOLD_DB -50
+
+/** Capture backends (moonmic_config_t::capture_backend) */
+#define MOONMIC_CAPTURE_DEFAULT 0  /**< Platform default (PulseAudio on Linux) */
+#define MOONMIC_CAPTURE_ALSA    1  /**< Linux: direct ALSA mmap, no sound server (built with ALSA only) */
+#define MOONMIC_CAPTURE_FILE    2  /**< Any platform: WAV or raw PCM file (capture_device = path), looped */
+#define MOONMIC_CAPTURE_SYNTH   3  /**< Any platform: signal generator (capture_signal) */
+
+/** Test signals (capture_backend = MOONMIC_CAPTURE_SYNTH) */
+#define MOONMIC_SIGNAL_SINE     0  /**< Sine at capture_signal_hz (default 440Hz) */
+#define MOONMIC_SIGNAL_IMPULSE  1  /**< One-sample impulses, capture_signal_hz per second (default 2) */
+#define MOONMIC_SIGNAL_NOISE    2  /**< White noise (fixed seed: identical every run) */
+#define MOONMIC_SIGNAL_BURST    3  /**< 5ms 1kHz tone bursts, capture_signal_hz per second (default 2): latency markers */
+
+/** Pacing of the file / signal generator backends */
+#define MOONMIC_PACING_REALTIME 0  /**< Deliver audio at the sample rate, like a microphone */
+#define MOONMIC_PACING_FAST     1  /**< As fast as the client consumes it (encode / packetization stress) */
+
 // ============================================================================
 
 /**
@@ -64,8 +94,62 @@ typedef struct {
     // NEW: Display resolution control (for Sunshine configuration)
     uint16_t target_display_width;   /**< Target rendering width (e.g., 1280, 1920, 0=don't configure) */
     uint16_t target_display_height;  /**< Target rendering height (e.g., 720, 1080, 0=don't configure) */
+    
+    // NEW: Loss resilience (Opus mode only)
+    int packet_loss_perc;     /**< Expected packet loss % for Opus in-band FEC (0 = default 10%, -1 = FEC off) */
+    
+    // NEW: Packet rate (Opus mode only)
+    uint8_t frames_per_packet; /**< Opus frames bundled per datagram (0/1 = no bundling, max 6, at most 120ms); adds (N-1) frames of latency */
+    
+    // NEW: Capture latency
+    uint8_t capture_fragment_ms; /**< Capture fragment size in ms (0 = platform default, 10 on Linux); smaller = lower latency, more wakeups */
+    uint8_t capture_backend;     /**< MOONMIC_CAPTURE_* (0 = platform default) */
+    const char* capture_device;  /**< Backend device name, e.g. ALSA "hw:0", or the file path for MOONMIC_CAPTURE_FILE (NULL = default) */
+    
+    // NEW: Test capture sources (MOONMIC_CAPTURE_FILE / MOONMIC_CAPTURE_SYNTH)
+    uint8_t capture_pacing;      /**< MOONMIC_PACING_* (0 = real time) */
+    uint8_t capture_signal;      /**< MOONMIC_SIGNAL_* for MOONMIC_CAPTURE_SYNTH */
+    float capture_signal_hz;     /**< Sine frequency / impulses or bursts per second (0 = signal default) */
+    float capture_signal_level;  /**< Peak amplitude before gain, 0.0-1.0 (0 = 0.5) */
+    
+    // NEW: Silence suppression (needs a host that understands DTX markers)
+    bool dtx;                    /**< Don't send silence: Opus DTX, or an energy VAD in RAW mode; the host plays comfort noise */
+    int8_t vad_threshold_db;     /**< RAW-mode VAD threshold in dBFS (0 = default -50) */
+    
+    // NEW: Adaptive bitrate (Opus mode)
+    bool adaptive_bitrate;       /**< Follow host loss reports and RTT between min_bitrate and bitrate */
+    uint32_t min_bitrate;        /**< ABR floor in bps (0 = default 12000) */
+    
+    // NEW: Latency profile (announced to the host in the handshake)
+    uint8_t latency_profile;     /**< MOONMIC_PROFILE_* (0 = balanced) */
+    uint8_t frame_ms;            /**< Opus frame duration override: 5, 10, 20, 40 or 60 (0 = profile default) */
 } moonmic_config_t;
 
+/**
+ * @brief Transmission statistics (moonmic_get_stats)
+ *
+ * The report_* fields come from the host's periodic receiver report
+ * (every ~500ms while audio arrives) and describe what the host sees.
+ */
+typedef struct {
+    // Sender
+    uint32_t packets_sent;        /**< Audio packets sent (next sequence number) */
+    float suppressed_ratio;       /**< Frames suppressed as silence (dtx), 0.0-1.0 */
+    int rtt_ms;                   /**< Round-trip time, -1 if unknown */
+    uint32_t bitrate;             /**< Current Opus bitrate (bps, 0 in RAW mode) */
+    int complexity;               /**< Current Opus complexity (-1 in RAW mode) */
+    
+    // Last receiver report from the host
+    bool report_valid;            /**< false until the first report arrives */
+    uint32_t report_age_ms;       /**< Time since the report arrived */
+    uint32_t highest_seq;         /**< Highest sequence number the host received */
+    uint32_t cumulative_lost;     /**< Packets the host never got (jitter buffer gaps) */
+    float fraction_lost;          /**< Loss since the previous report, 0.0-1.0 */
+    float jitter_ms;              /**< Interarrival jitter (RFC 3550) */
+    uint16_t jitter_depth;        /**< Packets held in the host jitter buffer */
+    uint16_t buffer_ms;           /**< Decoded audio queued for playout on the host */
+} moonmic_stats_t;
+
 /**
  * @brief Error callback function type
  * @param error Error message (null-terminated string)
@@ -130,6 +214,30 @@ void moonmic_set_error_callback(moonmic_client_t* client,
  */
 void moonmic_set_gain(moonmic_client_t* client, float gain);
 
+/**
+ * @brief Change the Opus bitrate while running (Opus mode)
+ * With adaptive_bitrate this is the ceiling the controller works under.
+ * @param client Client instance
+ * @param bitrate Bits per second (6000-510000)
+ */
+void moonmic_set_bitrate(moonmic_client_t* client, uint32_t bitrate);
+
+/**
+ * @brief Change the Opus encoder complexity while running (Opus mode)
+ * With adaptive_bitrate this is the ceiling; it is lowered while encoding
+ * takes more than half of the frame time.
+ * @param client Client instance
+ * @param complexity 0 (fastest) - 10 (best, default)
+ */
+void moonmic_set_complexity(moonmic_client_t* client, int complexity);
+
+/**
+ * @brief Fraction of frames suppressed as silence since the client was created
+ * @param client Client instance
+ * @return 0.0-1.0 (always 0 with dtx disabled)
+ */
+float moonmic_get_suppressed_ratio(moonmic_client_t* client);
+
 /**
  * @brief Set status callback
  * @param client Client instance
@@ -167,6 +275,14 @@ const char* moonmic_get_version();
  */
 int moonmic_client_get_rtt(moonmic_client_t* client);
 
+/**
+ * @brief Get sender counters and the host's last receiver report
+ * @param client Client instance
+ * @param stats Filled on success
+ * @return false if client or stats is NULL
+ */
+bool moonmic_get_stats(moonmic_client_t* client, moonmic_stats_t* stats);
+
 #ifdef __cplusplus
 }
 #endif
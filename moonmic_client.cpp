@@ -7,6 +7,8 @@
 #include "moonmic_internal.h"
 #include "moonmic_debug.h"
 #include "heartbeat_monitor.h"
+#include "dsp/moonmic_dsp.h"
+#include <cmath>
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
@@ -28,8 +30,184 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <time.h>
 #endif
 
+// Audio packet buffer: header + largest Opus packet
+#define MOONMIC_PACKET_BUFFER_SIZE 4000
+
+// Encoder side of a latency profile (the host derives its buffering from the same profile)
+typedef struct {
+    const char* name;
+    uint8_t frame_ms;
+    moonmic_opus_app_t application;
+    int complexity;
+    uint8_t capture_fragment_ms;  // Used when capture_fragment_ms is 0 (0 = platform default)
+} moonmic_profile_t;
+
+static moonmic_profile_t moonmic_get_profile(uint8_t latency_profile) {
+    switch (latency_profile) {
+        case MOONMIC_PROFILE_ULTRA_LOW:
+            // 5ms reads: a 10ms read would hold every other frame back by 5ms
+            return { "ultra-low", 5, MOONMIC_OPUS_APP_LOWDELAY, PLATFORM_LOWDELAY_COMPLEXITY, 5 };
+        case MOONMIC_PROFILE_BANDWIDTH_SAVER:
+            return { "bandwidth-saver", 40, MOONMIC_OPUS_APP_VOIP, MOONMIC_DEFAULT_COMPLEXITY, 0 };
+        default:
+            return { "balanced", 20, MOONMIC_OPUS_APP_AUDIO, MOONMIC_DEFAULT_COMPLEXITY, 0 };
+    }
+}
+
+// Opus frame durations an 8-bit millisecond count can express (2.5ms can't)
+static bool moonmic_valid_frame_ms(uint8_t frame_ms) {
+    return frame_ms == 5 || frame_ms == 10 || frame_ms == 20 || frame_ms == 40 || frame_ms == 60;
+}
+
+// Stamp the header in front of the payload at packet + MOONMIC_HEADER_SIZE and send
+static void moonmic_send_audio_packet(moonmic_client_t* client, uint8_t* packet, size_t payload_bytes,
+                                      uint32_t packet_sample_rate, uint64_t timestamp) {
+    moonmic_write_packet_header(packet, client->sender->sequence++, timestamp, packet_sample_rate);
+    udp_sender_send(client->sender, packet, MOONMIC_HEADER_SIZE + payload_bytes);
+}
+
+// Send the pending bundle as one multi-frame Opus packet, stamped with its first frame's time
+static void moonmic_send_bundle(moonmic_client_t* client, uint8_t* packet) {
+    int bytes = moonmic_opus_bundler_flush(client->bundler, packet + MOONMIC_HEADER_SIZE,
+                                           MOONMIC_PACKET_BUFFER_SIZE - MOONMIC_HEADER_SIZE);
+    if (bytes > 0) {
+        moonmic_send_audio_packet(client, packet, bytes, client->config.sample_rate, client->bundle_timestamp);
+    }
+}
+
+// Level of a RAW frame in dBFS (RMS, after gain)
+static float moonmic_frame_dbfs(const int16_t* pcm, size_t samples) {
+    if (samples == 0) {
+        return -120.0f;
+    }
+    double sum = 0.0;
+    for (size_t i = 0; i < samples; i++) {
+        sum += (double)pcm[i] * pcm[i];
+    }
+    double rms = std::sqrt(sum / samples) / 32768.0;
+    return rms > 1e-6 ? (float)(20.0 * std::log10(rms)) : -120.0f;
+}
+
+// Silence suppression: returns true if the frame must not be sent.
+// Suppressed frames take no sequence number, so the host sees no loss. On entering
+// silence, and every MOONMIC_DTX_KEEPALIVE_US after that, a DTX marker goes out so
+// the host switches to comfort noise and keeps the session alive.
+static bool moonmic_dtx_suppress(moonmic_client_t* client, uint8_t* packet, bool silent,
+                                 const uint8_t* marker_payload, size_t marker_bytes,
+                                 uint32_t packet_sample_rate, uint64_t capture_us) {
+    client->frames_total++;
+    if (!silent) {
+        client->dtx_active = false;
+        return false;
+    }
+    client->frames_suppressed++;
+    
+    if (!client->dtx_active || capture_us - client->dtx_marker_us >= MOONMIC_DTX_KEEPALIVE_US) {
+        // Audio still waiting in a bundle goes out before the marker
+        if (moonmic_opus_bundler_count(client->bundler) > 0) {
+            moonmic_send_bundle(client, packet);
+        }
+        if (marker_bytes > 0 && marker_payload != packet + MOONMIC_HEADER_SIZE) {
+            memcpy(packet + MOONMIC_HEADER_SIZE, marker_payload, marker_bytes);
+        }
+        moonmic_send_audio_packet(client, packet, marker_bytes, packet_sample_rate | MOONMIC_DTX_FLAG, capture_us);
+        client->dtx_active = true;
+        client->dtx_marker_us = capture_us;
+    }
+    return true;
+}
+
+// Apply moonmic_set_bitrate / moonmic_set_complexity and, with adaptive_bitrate,
+// the controller's decisions. Runs between encodes, so the ctls never race opus_encode.
+static void moonmic_update_encoder(moonmic_client_t* client, uint32_t encode_us) {
+    moonmic_abr_t* abr = &client->abr;
+    uint64_t now_ms = moonmic_get_timestamp_us() / 1000;
+    moonmic_abr_set_limits(abr, client->config.bitrate, client->complexity);
+    
+    if (client->config.adaptive_bitrate) {
+        uint32_t frame_us = (uint32_t)((uint64_t)client->target_frame_size * 1000000 / client->encoder->sample_rate);
+        moonmic_abr_on_encode(abr, now_ms, encode_us, frame_us);
+        
+        // Each receiver report once (arrival times are a report interval apart)
+        moonmic_receiver_report_t report;
+        uint32_t age_ms = 0;
+        if (heartbeat_monitor_get_report(client->heartbeat_monitor, &report, &age_ms)) {
+            uint64_t arrival_ms = now_ms - age_ms;
+            if (arrival_ms > client->abr_report_ms + MOONMIC_REPORT_INTERVAL_MS / 2) {
+                client->abr_report_ms = arrival_ms;
+                moonmic_abr_on_report(abr, now_ms, report.fraction_lost / 256.0f, moonmic_client_get_rtt(client));
+            }
+        }
+    } else {
+        abr->bitrate = abr->max_bitrate;
+        abr->complexity = abr->max_complexity;
+    }
+    
+    moonmic_opus_encoder_set_bitrate(client->encoder, abr->bitrate);
+    moonmic_opus_encoder_set_complexity(client->encoder, abr->complexity);
+    moonmic_opus_encoder_set_packet_loss_perc(client->encoder, abr->loss_perc);
+}
+
+// Encode the full frame in accumulation_buffer (captured at frame_timestamp) and send it,
+// queue it in the bundle or suppress it. Bundling encodes into frame_buffer, a side
+// buffer; otherwise frame_buffer is packet + MOONMIC_HEADER_SIZE. False if encoding failed.
+static bool moonmic_encode_frame(moonmic_client_t* client, uint8_t* packet, uint8_t* frame_buffer) {
+    MOONMIC_LOG("[OPUS_ENCODE] Encoding %zu samples from accumulation buffer", client->target_frame_size);
+    
+    uint64_t encode_start_us = moonmic_get_timestamp_us();
+    int encoded_bytes = moonmic_opus_encoder_encode(
+        client->encoder,
+        client->accumulation_buffer,
+        client->target_frame_size,
+        frame_buffer,
+        client->bundler ? MOONMIC_OPUS_MAX_FRAME_BYTES : MOONMIC_PACKET_BUFFER_SIZE - MOONMIC_HEADER_SIZE
+    );
+    
+    MOONMIC_LOG("[OPUS_ENCODE] Encoded result: %d bytes", encoded_bytes);
+    
+    if (encoded_bytes < 0) {
+        return false;
+    }
+    
+    uint32_t packet_sample_rate = client->config.sample_rate;  // No RAW flag
+    
+    // Settings take effect from the next frame
+    moonmic_update_encoder(client, (uint32_t)(moonmic_get_timestamp_us() - encode_start_us));
+    
+    // DTX: the encoder's VAD/signal classifier already turned silence into a 1-2 byte frame
+    bool suppressed = client->config.dtx &&
+        moonmic_dtx_suppress(client, packet, encoded_bytes <= MOONMIC_OPUS_DTX_MAX_BYTES,
+                             frame_buffer, encoded_bytes, packet_sample_rate, client->frame_timestamp);
+    
+    if (suppressed) {
+        // Nothing to send - the marker (if due) already went out
+    } else if (client->bundler) {
+        // BUNDLING: queue the frame, send once frames_per_packet are collected
+        if (moonmic_opus_bundler_count(client->bundler) == 0) {
+            client->bundle_timestamp = client->frame_timestamp;
+        }
+        int added = moonmic_opus_bundler_add(client->bundler, frame_buffer, encoded_bytes);
+        if (added == 0) {
+            // Encoder switched mode/bandwidth: ship the frames so far, start a new bundle
+            moonmic_send_bundle(client, packet);
+            client->bundle_timestamp = client->frame_timestamp;
+            added = moonmic_opus_bundler_add(client->bundler, frame_buffer, encoded_bytes);
+        }
+        if (added < 0) {
+            MOONMIC_LOG("[OPUS_ENCODE] ERROR: Failed to bundle frame (%d bytes), dropping", encoded_bytes);
+        } else if (moonmic_opus_bundler_count(client->bundler) >= client->config.frames_per_packet) {
+            moonmic_send_bundle(client, packet);
+        }
+    } else {
+        // Send via UDP
+        moonmic_send_audio_packet(client, packet, encoded_bytes, packet_sample_rate, client->frame_timestamp);
+    }
+    return true;
+}
+
 // Worker thread function
 static void* moonmic_worker_thread(void* arg) {
     moonmic_client_t* client = (moonmic_client_t*)arg;
@@ -39,6 +217,8 @@ static void* moonmic_worker_thread(void* arg) {
     handshake.magic = 0x4D4F4F4E;  // "MOON"
     handshake.version = 2;  // Bumped for protocol extension
     handshake.pair_status = client->config.pair_status;
+    handshake.flags = (uint8_t)(((client->config.latency_profile + 1) << MOONMIC_FLAG_PROFILE_SHIFT) &
+                                MOONMIC_FLAG_PROFILE_MASK);
     
     // Display resolution (0 = don't configure, non-zero = configure)
     handshake.display_width = client->config.target_display_width;
@@ -59,10 +239,11 @@ static void* moonmic_worker_thread(void* arg) {
     
     // Send initial handshake
     if (udp_sender_send(client->sender, &handshake, sizeof(handshake))) {
-        MOONMIC_LOG("[moonmic_worker] Handshake sent: device='%s', uniqueid_len=%d, resolution=%dx%d", 
+        MOONMIC_LOG("[moonmic_worker] Handshake sent: device='%s', uniqueid_len=%d, resolution=%dx%d, profile=%s", 
                    client->config.devicename ? client->config.devicename : "unknown",
                    handshake.uniqueid_len,
-                   handshake.display_width, handshake.display_height);
+                   handshake.display_width, handshake.display_height,
+                   moonmic_get_profile(client->config.latency_profile).name);
     } else {
         MOONMIC_LOG("[moonmic_worker] WARNING: Failed to send handshake");
     }
@@ -72,14 +253,17 @@ static void* moonmic_worker_thread(void* arg) {
     const int frame_size = 480; // Will be adjusted per-platform
     const int buffer_size = frame_size * client->config.channels;
     float* pcm_buffer = (float*)malloc(buffer_size * sizeof(float));
-    uint8_t* opus_buffer = (uint8_t*)malloc(4000); // Max Opus packet size
+    uint8_t* opus_buffer = (uint8_t*)malloc(MOONMIC_PACKET_BUFFER_SIZE); // Max Opus packet size
+    uint8_t* bundle_frame = client->bundler ? (uint8_t*)malloc(MOONMIC_OPUS_MAX_FRAME_BYTES) : NULL;
+    uint8_t* frame_buffer = client->bundler ? bundle_frame : opus_buffer + MOONMIC_HEADER_SIZE;
     
-    if (!pcm_buffer || !opus_buffer) {
+    if (!pcm_buffer || !opus_buffer || !frame_buffer) {
         if (client->error_callback) {
             client->error_callback("Failed to allocate buffers", client->error_userdata);
         }
         free(pcm_buffer);
         free(opus_buffer);
+        free(bundle_frame);
         return NULL;
     }
     
@@ -122,6 +306,9 @@ static void* moonmic_worker_thread(void* arg) {
             }
             
             if (!is_connected) {
+                // Frames queued before the host went away are stale
+                moonmic_opus_bundler_reset(client->bundler);
+                
                 // In suspension mode - periodically send handshake probe to detect host
                 uint64_t now = moonmic_get_timestamp_us() / 1000;  // Convert to ms
                 
@@ -155,6 +342,7 @@ static void* moonmic_worker_thread(void* arg) {
             // Check if host has paused transmission (STOP signal received)
             if (is_connected && heartbeat_monitor_is_paused(client->heartbeat_monitor)) {
                 // Host is connected but has sent STOP signal - pause audio transmission
+                moonmic_opus_bundler_reset(client->bundler);
 #ifdef _WIN32
                 Sleep(100);  // Sleep 100ms
 #else
@@ -167,6 +355,13 @@ static void* moonmic_worker_thread(void* arg) {
         // Capture audio
         int frames_read = client->capture->read(client->capture, pcm_buffer, frame_size);
         
+        // When the first sample was captured (platforms without capture clocks: now)
+        uint64_t capture_us = client->capture->get_capture_timestamp
+            ? client->capture->get_capture_timestamp(client->capture) : 0;
+        if (capture_us == 0) {
+            capture_us = moonmic_get_timestamp_us();
+        }
+        
         // DEBUG: Log first few iterations
         if (loop_count < 3) {
             MOONMIC_LOG("[moonmic_worker] Loop %d: frames_read = %d", loop_count, frames_read);
@@ -192,75 +387,44 @@ static void* moonmic_worker_thread(void* arg) {
         
         // RAW mode: send immediately without accumulation
         if (client->config.raw_mode) {
-            // Apply gain (read dynamically from config for slider changes)
-            const float GAIN = client->config.gain;
-            for (int i = 0; i < frames_read * client->config.channels; i++) {
-                pcm_buffer[i] *= GAIN;
-                // Clamp after gain
-                if (pcm_buffer[i] > 1.0f) pcm_buffer[i] = 1.0f;
-                if (pcm_buffer[i] < -1.0f) pcm_buffer[i] = -1.0f;
-            }
-            
-            // Convert float to int16 for transmission
+            // Gain (read dynamically from config for slider changes), clamp and
+            // int16 conversion in one pass, straight into the packet
             int16_t* pcm_int16 = (int16_t*)(opus_buffer + MOONMIC_HEADER_SIZE);
-            for (int i = 0; i < frames_read * client->config.channels; i++) {
-                pcm_int16[i] = (int16_t)(pcm_buffer[i] * 32767.0f);
-            }
+            moonmic_dsp_gain_clamp_to_s16(pcm_buffer, pcm_int16, frames_read * client->config.channels,
+                                          client->config.gain);
             int encoded_bytes = frames_read * client->config.channels * sizeof(int16_t);
             uint32_t packet_sample_rate = client->config.sample_rate | MOONMIC_RAW_FLAG;
             
-            // Prepare and send packet (same header logic as before)
-            uint8_t* header_ptr = opus_buffer;
-            uint32_t magic = MOONMIC_MAGIC;
-            header_ptr[0] = (magic >> 0) & 0xFF;
-            header_ptr[1] = (magic >> 8) & 0xFF;
-            header_ptr[2] = (magic >> 16) & 0xFF;
-            header_ptr[3] = (magic >> 24) & 0xFF;
-            
-            uint32_t seq = client->sender->sequence++;
-            header_ptr[4] = (seq >> 0) & 0xFF;
-            header_ptr[5] = (seq >> 8) & 0xFF;
-            header_ptr[6] = (seq >> 16) & 0xFF;
-            header_ptr[7] = (seq >> 24) & 0xFF;
-            
-            uint64_t ts = moonmic_get_timestamp_us();
-            header_ptr[8] = (ts >> 0) & 0xFF;
-            header_ptr[9] = (ts >> 8) & 0xFF;
-            header_ptr[10] = (ts >> 16) & 0xFF;
-            header_ptr[11] = (ts >> 24) & 0xFF;
-            header_ptr[12] = (ts >> 32) & 0xFF;
-            header_ptr[13] = (ts >> 40) & 0xFF;
-            header_ptr[14] = (ts >> 48) & 0xFF;
-            header_ptr[15] = (ts >> 56) & 0xFF;
-            
-            header_ptr[16] = (packet_sample_rate >> 0) & 0xFF;
-            header_ptr[17] = (packet_sample_rate >> 8) & 0xFF;
-            header_ptr[18] = (packet_sample_rate >> 16) & 0xFF;
-            header_ptr[19] = (packet_sample_rate >> 24) & 0xFF;
+            // Energy VAD with hangover, so word endings and short pauses still go out
+            if (client->config.dtx) {
+                int threshold_db = client->config.vad_threshold_db
+                    ? client->config.vad_threshold_db : MOONMIC_DEFAULT_VAD_THRESHOLD_DB;
+                if (moonmic_frame_dbfs(pcm_int16, frames_read * client->config.channels) >= threshold_db) {
+                    client->vad_hangover_until = capture_us + MOONMIC_VAD_HANGOVER_US;
+                }
+                bool silent = capture_us >= client->vad_hangover_until;
+                if (moonmic_dtx_suppress(client, opus_buffer, silent, NULL, 0, packet_sample_rate, capture_us)) {
+                    continue;
+                }
+            }
             
-            size_t total_size = MOONMIC_HEADER_SIZE + encoded_bytes;
-            udp_sender_send(client->sender, opus_buffer, total_size);
+            moonmic_send_audio_packet(client, opus_buffer, encoded_bytes, packet_sample_rate, capture_us);
             continue;  // Skip Opus encoding
         }
         
-        // OPUS MODE: Accumulate frames until we reach 320 samples (20ms @ 16kHz)
-        int samples_to_copy = frames_read * client->config.channels;
-        int space_available = (client->target_frame_size - client->accumulated_samples) * client->config.channels;
-        
+        // OPUS MODE: cut the read into target_frame_size frames. Reads rarely line up with
+        // frames (Vita 256 vs 320 samples, 10ms reads vs 5/20/40ms frames), so one read may
+        // finish several frames or none.
+        const uint8_t channels = client->config.channels;
+        int samples_to_copy = frames_read * channels;
         
         // Apply gain to samples (BEFORE encoding)
         // This is critical because Vita microphone has very low volume
         // Read gain from config EVERY frame to allow dynamic adjustment
         // (User can change gain via UI slider without reconnecting)
+        // Clamped to prevent overflow (hard clipping)
         const float GAIN = client->config.gain;
-        
-        for (int i = 0; i < samples_to_copy; i++) {
-            pcm_buffer[i] *= GAIN;
-            
-            // Clamp to prevent overflow (hard clipping)
-            if (pcm_buffer[i] > 1.0f) pcm_buffer[i] = 1.0f;
-            if (pcm_buffer[i] < -1.0f) pcm_buffer[i] = -1.0f;
-        }
+        moonmic_dsp_gain_clamp(pcm_buffer, samples_to_copy, GAIN);
         
         // DEBUG: Log accumulation state
         static int accum_log_count = 0;
@@ -272,122 +436,41 @@ static void* moonmic_worker_thread(void* arg) {
             accum_log_count++;
         }
         
-        if (samples_to_copy <= space_available) {
-            // Copy all samples to accumulation buffer
-            memcpy(client->accumulation_buffer + client->accumulated_samples * client->config.channels,
-                   pcm_buffer,
-                   samples_to_copy * sizeof(float));
-            client->accumulated_samples += frames_read;
-            
-            if (accum_log_count < 10) {
-                MOONMIC_LOG("[ACCUM] Copied ALL %d frames, new total: %zu/%zu",
-                           frames_read, client->accumulated_samples, client->target_frame_size);
+        size_t consumed = 0;  // Frames of pcm_buffer already moved to the accumulator
+        while (consumed < (size_t)frames_read) {
+            if (client->accumulated_samples == 0) {
+                // Capture time of this frame's first sample (the encoder runs at the capture rate)
+                client->frame_timestamp = capture_us + (uint64_t)consumed * 1000000 / client->encoder->sample_rate;
             }
-        } else {
-            // Copy only what fits to complete the current frame
-            int frames_to_copy = space_available; // Single channel logic for simplicity in variable name, but handles channels below
-            
-            memcpy(client->accumulation_buffer + client->accumulated_samples * client->config.channels,
-                   pcm_buffer,
-                   frames_to_copy * client->config.channels * sizeof(float));
-            client->accumulated_samples += frames_to_copy;
-            
-            // At this point buffer is FULL (320 samples) -> Encode and Send happens below
-            // WE MUST REMEMBER TO COPY THE REST after sending!
-            // We'll handle this by checking if we have leftovers AFTER the send block
-        }
-        
-        // Calculate leftovers for later
-        int samples_leftover = 0;
-        int leftover_offset = 0;
-        if (samples_to_copy > space_available) {
-             samples_leftover = samples_to_copy - space_available;
-             leftover_offset = space_available;
-        }
-        
-        // When we have enough samples (320), encode with Opus
-        if (client->accumulated_samples >= client->target_frame_size) {
-            MOONMIC_LOG("[OPUS_ENCODE] Encoding %zu samples from accumulation buffer", client->accumulated_samples);
-            MOONMIC_LOG("[OPUS_ENCODE] First 10 buffer samples: %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f %.4f",
-                       client->accumulation_buffer[0], client->accumulation_buffer[1],
-                       client->accumulation_buffer[2], client->accumulation_buffer[3],
-                       client->accumulation_buffer[4], client->accumulation_buffer[5],
-                       client->accumulation_buffer[6], client->accumulation_buffer[7],
-                       client->accumulation_buffer[8], client->accumulation_buffer[9]);
             
-            int encoded_bytes = moonmic_opus_encoder_encode(
-                client->encoder,
-                client->accumulation_buffer,
-                client->target_frame_size,
-                opus_buffer + MOONMIC_HEADER_SIZE,
-                4000 - MOONMIC_HEADER_SIZE
-            );
+            size_t space = client->target_frame_size - client->accumulated_samples;
+            size_t take = (size_t)frames_read - consumed;
+            if (take > space) {
+                take = space;
+            }
+            memcpy(client->accumulation_buffer + client->accumulated_samples * channels,
+                   pcm_buffer + consumed * channels,
+                   take * channels * sizeof(float));
+            client->accumulated_samples += take;
+            consumed += take;
             
-            MOONMIC_LOG("[OPUS_ENCODE] Encoded result: %d bytes", encoded_bytes);
+            if (client->accumulated_samples < client->target_frame_size) {
+                break;  // Frame completes with the next read
+            }
             
-            if (encoded_bytes < 0) {
+            client->accumulated_samples = 0;
+            if (!moonmic_encode_frame(client, opus_buffer, frame_buffer)) {
                 if (client->error_callback) {
                     client->error_callback("Opus encoding failed", client->error_userdata);
                 }
-                client->accumulated_samples = 0;  // Reset on error
-                MOONMIC_LOG("[OPUS_ENCODE] ERROR: Encoding failed, resetting buffer");
-                continue;
-            }
-            
-            uint32_t packet_sample_rate = client->config.sample_rate;  // No RAW flag
-            
-            // Prepare packet header
-            uint8_t* header_ptr = opus_buffer;
-            uint32_t magic = MOONMIC_MAGIC;
-            header_ptr[0] = (magic >> 0) & 0xFF;
-            header_ptr[1] = (magic >> 8) & 0xFF;
-            header_ptr[2] = (magic >> 16) & 0xFF;
-            header_ptr[3] = (magic >> 24) & 0xFF;
-            
-            uint32_t seq = client->sender->sequence++;
-            header_ptr[4] = (seq >> 0) & 0xFF;
-            header_ptr[5] = (seq >> 8) & 0xFF;
-            header_ptr[6] = (seq >> 16) & 0xFF;
-            header_ptr[7] = (seq >> 24) & 0xFF;
-            
-            uint64_t ts = moonmic_get_timestamp_us();
-            header_ptr[8] = (ts >> 0) & 0xFF;
-            header_ptr[9] = (ts >> 8) & 0xFF;
-            header_ptr[10] = (ts >> 16) & 0xFF;
-            header_ptr[11] = (ts >> 24) & 0xFF;
-            header_ptr[12] = (ts >> 32) & 0xFF;
-            header_ptr[13] = (ts >> 40) & 0xFF;
-            header_ptr[14] = (ts >> 48) & 0xFF;
-            header_ptr[15] = (ts >> 56) & 0xFF;
-            
-            header_ptr[16] = (packet_sample_rate >> 0) & 0xFF;
-            header_ptr[17] = (packet_sample_rate >> 8) & 0xFF;
-            header_ptr[18] = (packet_sample_rate >> 16) & 0xFF;
-            header_ptr[19] = (packet_sample_rate >> 24) & 0xFF;
-            
-            // Send via UDP
-            size_t total_size = MOONMIC_HEADER_SIZE + encoded_bytes;
-            udp_sender_send(client->sender, opus_buffer, total_size);
-            
-            // Reset accumulation buffer for next frame
-            client->accumulated_samples = 0;
-            
-            // If we had leftovers from the input buffer, copy them now
-            if (samples_leftover > 0) {
-               memcpy(client->accumulation_buffer, 
-                      pcm_buffer + leftover_offset, // pcm_buffer is float* so pointer arithmetic works on samples
-                      samples_leftover * sizeof(float));
-               client->accumulated_samples = samples_leftover / client->config.channels; // Assuming leftovers are multiple of channels
-               
-               if (accum_log_count < 10) {
-                   MOONMIC_LOG("[ACCUM] Carried over %d leftover samples to new frame", samples_leftover);
-               }
+                MOONMIC_LOG("[OPUS_ENCODE] ERROR: Encoding failed, dropping frame");
             }
         }
     }
     
     free(pcm_buffer);
     free(opus_buffer);
+    free(bundle_frame);
     return NULL;
 }
 
@@ -427,6 +510,15 @@ moonmic_client_t* moonmic_create(const moonmic_config_t* config) {
         client->config.devicename = NULL;
     }
     
+    if (config->capture_device && config->capture_device[0]) {
+        strncpy(client->capture_device_storage, config->capture_device, sizeof(client->capture_device_storage) - 1);
+        client->capture_device_storage[sizeof(client->capture_device_storage) - 1] = '\0';
+        client->config.capture_device = client->capture_device_storage;
+    } else {
+        client->capture_device_storage[0] = '\0';
+        client->config.capture_device = NULL;
+    }
+    
     MOONMIC_LOG("[moonmic_create] Copied strings: uniqueid='%s', devicename='%s'", 
                 client->config.uniqueid ? client->config.uniqueid : "(null)",
                 client->config.devicename ? client->config.devicename : "(null)");
@@ -435,10 +527,11 @@ moonmic_client_t* moonmic_create(const moonmic_config_t* config) {
     client->handshake_sent = false;
 
     
-    // Initialize accumulation buffer (for Opus frame batching)
+    // Initialize accumulation buffer (for Opus frame batching); the frame size
+    // needs the encoder rate, known once capture is initialized
     client->accumulation_buffer = NULL;
     client->accumulated_samples = 0;
-    client->target_frame_size = 320;  // 20ms @ 16kHz (valid Opus frame size)
+    client->target_frame_size = 0;
     
     // Set defaults
     if (client->config.port == 0) {
@@ -453,25 +546,73 @@ moonmic_client_t* moonmic_create(const moonmic_config_t* config) {
     if (client->config.bitrate == 0) {
         client->config.bitrate = 64000;
     }
+    if (client->config.latency_profile > MOONMIC_PROFILE_BANDWIDTH_SAVER) {
+        MOONMIC_LOG("[moonmic_create] WARNING: Unknown latency profile %d, using balanced",
+                    client->config.latency_profile);
+        client->config.latency_profile = MOONMIC_PROFILE_BALANCED;
+    }
+    moonmic_profile_t profile = moonmic_get_profile(client->config.latency_profile);
+    if (client->config.frame_ms != 0 && !moonmic_valid_frame_ms(client->config.frame_ms)) {
+        MOONMIC_LOG("[moonmic_create] WARNING: %dms is not an Opus frame size, using %dms",
+                    client->config.frame_ms, profile.frame_ms);
+        client->config.frame_ms = 0;
+    }
+    if (client->config.frame_ms == 0) {
+        client->config.frame_ms = profile.frame_ms;
+    }
+    if (client->config.capture_fragment_ms == 0) {
+        client->config.capture_fragment_ms = profile.capture_fragment_ms;
+    }
+    client->complexity = profile.complexity;
+    if (client->config.packet_loss_perc == 0) {
+        client->config.packet_loss_perc = MOONMIC_DEFAULT_PACKET_LOSS_PERC;
+    }
+    if (client->config.frames_per_packet == 0) {
+        client->config.frames_per_packet = 1;
+    }
+    if (client->config.frames_per_packet > MOONMIC_MAX_FRAMES_PER_PACKET) {
+        client->config.frames_per_packet = MOONMIC_MAX_FRAMES_PER_PACKET;
+    }
+    if (client->config.frames_per_packet * client->config.frame_ms > 120) {
+        client->config.frames_per_packet = 120 / client->config.frame_ms;  // Opus packet limit
+    }
     
-    MOONMIC_LOG("[moonmic_create] Config: %dHz, %dch, %dbps, port=%d",
-        client->config.sample_rate, client->config.channels, client->config.bitrate, client->config.port);
+    MOONMIC_LOG("[moonmic_create] Config: %dHz, %dch, %dbps, port=%d, profile=%s (%dms frames)",
+        client->config.sample_rate, client->config.channels, client->config.bitrate, client->config.port,
+        profile.name, client->config.frame_ms);
     
-    // Create platform-specific audio capture
+    // Create audio capture: a portable test source, or the platform's microphone
+    bool realtime_capture = client->config.capture_pacing != MOONMIC_PACING_FAST;
+    if (client->config.capture_backend == MOONMIC_CAPTURE_FILE) {
+        MOONMIC_LOG("[moonmic_create] Using file capture: %s",
+                    client->config.capture_device ? client->config.capture_device : "(none)");
+        client->capture = audio_capture_create_file(realtime_capture);
+    } else if (client->config.capture_backend == MOONMIC_CAPTURE_SYNTH) {
+        MOONMIC_LOG("[moonmic_create] Using signal generator capture");
+        client->capture = audio_capture_create_synth(client->config.capture_signal, client->config.capture_signal_hz,
+                                                     client->config.capture_signal_level, realtime_capture);
+    } else {
 #ifdef __vita__
-    MOONMIC_LOG("[moonmic_create] Creating Vita audio capture");
-    client->capture = audio_capture_create_vita();
+        MOONMIC_LOG("[moonmic_create] Creating Vita audio capture");
+        client->capture = audio_capture_create_vita();
 #elif _WIN32
-    client->capture = audio_capture_create_windows();
+        client->capture = audio_capture_create_windows();
 #elif __linux__
-    client->capture = audio_capture_create_linux();
+#ifdef MOONMIC_HAVE_ALSA
+        if (client->config.capture_backend == MOONMIC_CAPTURE_ALSA) {
+            MOONMIC_LOG("[moonmic_create] Using direct ALSA capture");
+            client->capture = audio_capture_create_alsa();
+        } else
+#endif
+        client->capture = audio_capture_create_linux();
 #elif __APPLE__
-    client->capture = audio_capture_create_macos();
+        client->capture = audio_capture_create_macos();
 #elif __ANDROID__
-    client->capture = audio_capture_create_android();
+        client->capture = audio_capture_create_android();
 #else
     #error "Unsupported platform"
 #endif
+    }
     
     if (!client->capture) {
         MOONMIC_LOG("[moonmic_create] ERROR: Failed to create audio capture");
@@ -481,6 +622,8 @@ moonmic_client_t* moonmic_create(const moonmic_config_t* config) {
     
     MOONMIC_LOG("[moonmic_create] Initializing audio capture");
     // Initialize audio capture
+    client->capture->fragment_ms = client->config.capture_fragment_ms;
+    client->capture->device_name = client->config.capture_device;
     if (!client->capture->init(client->capture, client->config.sample_rate, client->config.channels)) {
         MOONMIC_LOG("[moonmic_create] ERROR: Failed to initialize audio capture");
         client->capture->close(client->capture);
@@ -498,16 +641,23 @@ moonmic_client_t* moonmic_create(const moonmic_config_t* config) {
         MOONMIC_LOG("[moonmic_create] Creating Opus encoder");
         
         // Get native sample rate from platform (e.g., 16kHz for Vita)
-        uint32_t encoder_sample_rate = client->capture->get_native_sample_rate(client->capture);
+        uint32_t encoder_sample_rate = client->capture->get_native_sample_rate
+            ? client->capture->get_native_sample_rate(client->capture)
+            : client->config.sample_rate;
         uint32_t encoder_bitrate = client->config.bitrate;
         
         MOONMIC_LOG("[moonmic_create] Using %uHz for Opus (platform native rate)", encoder_sample_rate);
+        client->target_frame_size = (size_t)encoder_sample_rate * client->config.frame_ms / 1000;
         
         // Create Opus encoder
         client->encoder = moonmic_opus_encoder_create(
             encoder_sample_rate,
             client->config.channels,
-            encoder_bitrate
+            encoder_bitrate,
+            profile.application,
+            client->complexity,
+            client->config.packet_loss_perc,
+            client->config.dtx
         );
         if (!client->encoder) {
             MOONMIC_LOG("[moonmic_create] ERROR: Failed to create Opus encoder");
@@ -516,6 +666,26 @@ moonmic_client_t* moonmic_create(const moonmic_config_t* config) {
             free(client);
             return NULL;
         }
+        
+        moonmic_abr_init(&client->abr, client->config.bitrate, client->config.min_bitrate,
+                         client->encoder->packet_loss_perc, client->complexity);
+        if (client->config.adaptive_bitrate) {
+            MOONMIC_LOG("[moonmic_create] Adaptive bitrate: %u-%u bps",
+                        client->abr.min_bitrate, client->abr.max_bitrate);
+        }
+        
+        // Frame bundling: fewer, larger packets at the cost of N-1 frames of latency
+        if (client->config.frames_per_packet > 1) {
+            client->bundler = moonmic_opus_bundler_create(client->config.frames_per_packet);
+            if (!client->bundler) {
+                MOONMIC_LOG("[moonmic_create] WARNING: Bundler unavailable, sending one frame per packet");
+                client->config.frames_per_packet = 1;
+            } else {
+                MOONMIC_LOG("[moonmic_create] Bundling %d frames per packet (%d pps)",
+                            client->config.frames_per_packet,
+                            1000 / (client->config.frame_ms * client->config.frames_per_packet));
+            }
+        }
     }
     
     MOONMIC_LOG("[moonmic_create] Creating UDP sender to %s:%d", client->config.host_ip, client->config.port);
@@ -546,14 +716,16 @@ moonmic_client_t* moonmic_create(const moonmic_config_t* config) {
         }
     }
     
-    // Allocate accumulation buffer for Opus mode (for 320-sample batching)
+    // Allocate accumulation buffer for Opus mode (one frame)
     if (!client->config.raw_mode) {
         size_t buffer_size = client->target_frame_size * client->config.channels;
         client->accumulation_buffer = (float*)malloc(buffer_size * sizeof(float));
         if (!client->accumulation_buffer) {
             MOONMIC_LOG("[moonmic_create] ERROR: Failed to allocate accumulation buffer");
+            heartbeat_monitor_destroy(client->heartbeat_monitor);  // Before its socket closes
             udp_sender_destroy(client->sender);
             moonmic_opus_encoder_destroy(client->encoder);
+            moonmic_opus_bundler_destroy(client->bundler);
             client->capture->close(client->capture);
             free(client->capture);
             free(client);
@@ -581,12 +753,20 @@ void moonmic_destroy(moonmic_client_t* client) {
     
     moonmic_stop(client);
     
+    // The monitor thread polls and sends on the sender's socket: join it before the fd is closed
+    if (client->heartbeat_monitor) {
+        heartbeat_monitor_destroy(client->heartbeat_monitor);
+        client->heartbeat_monitor = NULL;
+    }
     if (client->sender) {
         udp_sender_destroy(client->sender);
     }
     if (client->encoder) {
         moonmic_opus_encoder_destroy(client->encoder);
     }
+    if (client->bundler) {
+        moonmic_opus_bundler_destroy(client->bundler);
+    }
     if (client->capture) {
         client->capture->close(client->capture);
         free(client->capture);
@@ -595,9 +775,6 @@ void moonmic_destroy(moonmic_client_t* client) {
     if (client->accumulation_buffer) {
         free(client->accumulation_buffer);
     }
-    if (client->heartbeat_monitor) {
-        heartbeat_monitor_destroy(client->heartbeat_monitor);
-    }
     
     free(client);
     MOONMIC_LOG("[moonmic_destroy] Client destroyed");
@@ -678,6 +855,11 @@ uint64_t moonmic_get_timestamp_us(void) {
     QueryPerformanceFrequency(&frequency);
     QueryPerformanceCounter(&counter);
     return (uint64_t)((counter.QuadPart * 1000000) / frequency.QuadPart);
+#elif defined(__linux__)
+    // Monotonic: same clock as the capture timestamps, immune to NTP/wall-clock steps
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 #else
     struct timeval tv;
     gettimeofday(&tv, NULL);
@@ -722,6 +904,23 @@ void moonmic_set_gain(moonmic_client_t* client, float gain) {
     }
 }
 
+void moonmic_set_bitrate(moonmic_client_t* client, uint32_t bitrate) {
+    if (client) {
+        // Opus range (RFC 6716: 6 - 510 kbps)
+        if (bitrate < 6000) bitrate = 6000;
+        if (bitrate > 510000) bitrate = 510000;
+        client->config.bitrate = bitrate;
+    }
+}
+
+void moonmic_set_complexity(moonmic_client_t* client, int complexity) {
+    if (client) {
+        if (complexity < 0) complexity = 0;
+        if (complexity > 10) complexity = 10;
+        client->complexity = complexity;
+    }
+}
+
 moonmic_connection_status_t moonmic_get_connection_status(moonmic_client_t* client) {
     if (!client || !client->heartbeat_monitor) {
         return MOONMIC_DISCONNECTED;
@@ -739,6 +938,36 @@ int moonmic_client_get_rtt(moonmic_client_t* client) {
     return heartbeat_monitor_get_rtt(client->heartbeat_monitor);
 }
 
+float moonmic_get_suppressed_ratio(moonmic_client_t* client) {
+    if (!client || client->frames_total == 0) return 0.0f;
+    return (float)client->frames_suppressed / (float)client->frames_total;
+}
+
+bool moonmic_get_stats(moonmic_client_t* client, moonmic_stats_t* stats) {
+    if (!client || !stats) return false;
+    memset(stats, 0, sizeof(*stats));
+    
+    stats->packets_sent = client->sender ? client->sender->sequence : 0;
+    stats->suppressed_ratio = moonmic_get_suppressed_ratio(client);
+    stats->rtt_ms = moonmic_client_get_rtt(client);
+    stats->bitrate = client->encoder ? client->encoder->bitrate : 0;
+    stats->complexity = client->encoder ? client->encoder->complexity : -1;
+    
+    moonmic_receiver_report_t report;
+    uint32_t age_ms = 0;
+    if (client->heartbeat_monitor && heartbeat_monitor_get_report(client->heartbeat_monitor, &report, &age_ms)) {
+        stats->report_valid = true;
+        stats->report_age_ms = age_ms;
+        stats->highest_seq = report.highest_seq;
+        stats->cumulative_lost = report.cumulative_lost;
+        stats->fraction_lost = report.fraction_lost / 256.0f;
+        stats->jitter_ms = report.jitter_us / 1000.0f;
+        stats->jitter_depth = report.jitter_depth;
+        stats->buffer_ms = report.buffer_ms;
+    }
+    return true;
+}
+
 bool moonmic_is_connected(moonmic_client_t* client) {
     return moonmic_get_connection_status(client) == MOONMIC_CONNECTED;
 }
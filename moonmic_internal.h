@@ -16,6 +16,7 @@ extern "C" {
 
 // Forward declarations
 typedef struct moonmic_opus_encoder_t moonmic_opus_encoder_t;
+typedef struct moonmic_opus_bundler_t moonmic_opus_bundler_t;
 typedef struct udp_sender_t udp_sender_t;
 typedef struct audio_capture_t audio_capture_t;
 
@@ -41,9 +42,44 @@ typedef struct {
 } moonmic_handshake_t;
 
 #define MOONMIC_FLAG_FORCE_UPDATE 0x01
+// Bits 1-2: latency_profile + 1 (0 = not announced, older clients); the host sizes
+// this client's jitter buffer and mix FIFO from it
+#define MOONMIC_FLAG_PROFILE_SHIFT 1
+#define MOONMIC_FLAG_PROFILE_MASK  0x06
 
 #pragma pack(pop)
 
+// Adaptive bitrate state (see codec/opus_abr.cpp)
+typedef struct {
+    uint32_t max_bitrate;       // config.bitrate / moonmic_set_bitrate
+    uint32_t min_bitrate;
+    uint32_t bitrate;           // Current target
+    int base_loss_perc;         // Configured FEC loss expectation (0 = FEC off)
+    int loss_perc;              // Current OPUS_SET_PACKET_LOSS_PERC
+    float loss_ewma;            // Smoothed host-reported loss fraction
+    int min_rtt_ms;             // RTT baseline (-1 = none yet)
+    int window_min_rtt_ms;      // Minimum of the current baseline window
+    uint64_t rtt_window_ms;
+    uint64_t last_decrease_ms;
+    uint64_t last_increase_ms;
+    
+    int max_complexity;         // moonmic_set_complexity
+    int complexity;             // Current OPUS_SET_COMPLEXITY
+    uint64_t encode_window_ms;  // Start of the encode-time window
+    uint64_t encode_us_sum;
+    uint64_t frame_us_sum;
+} moonmic_abr_t;
+
+#define MOONMIC_ABR_DEFAULT_MIN_BITRATE 12000
+#define MOONMIC_DEFAULT_COMPLEXITY 10
+
+// Opus application of a latency profile (OPUS_APPLICATION_* in codec/opus_encoder.cpp)
+typedef enum {
+    MOONMIC_OPUS_APP_AUDIO = 0,     // Balanced: best general quality
+    MOONMIC_OPUS_APP_VOIP = 1,      // Bandwidth saver: speech-tuned, intelligible at low bitrates
+    MOONMIC_OPUS_APP_LOWDELAY = 2   // Ultra-low: CELT only, lowest algorithmic delay, no in-band FEC
+} moonmic_opus_app_t;
+
 /**
  * @brief Internal client structure
  */
@@ -54,16 +90,38 @@ struct moonmic_client_t {
     // Components
     audio_capture_t* capture;
     moonmic_opus_encoder_t* encoder;
+    moonmic_opus_bundler_t* bundler;  // NULL unless frames_per_packet > 1
     udp_sender_t* sender;
     
     // State
     bool active;
     bool running;
     
-    // Frame accumulation buffer for Opus (Vita gives 256, Opus needs 320)
+    // Frame accumulation buffer for Opus: capture reads (Vita 256, Linux 10ms) are cut
+    // into frames of config.frame_ms
     float* accumulation_buffer;
-    size_t accumulated_samples;  // Current samples in buffer
-    size_t target_frame_size;    // Target frame size for Opus (320 @ 16kHz)
+    size_t accumulated_samples;  // Frames (per channel) in buffer
+    size_t target_frame_size;    // Opus frame size at the encoder rate (320 = 20ms @ 16kHz)
+    
+    // Capture time of the first sample in accumulation_buffer
+    uint64_t frame_timestamp;
+    
+    // Frame bundling: timestamp of the first frame in the pending bundle
+    uint64_t bundle_timestamp;
+    
+    // Silence suppression (config.dtx): while silent only a DTX marker is sent
+    // every MOONMIC_DTX_KEEPALIVE_US, so sequence numbers stay contiguous
+    bool dtx_active;              // Currently suppressing
+    uint64_t dtx_marker_us;       // Capture time of the last marker
+    uint64_t vad_hangover_until;  // RAW VAD: keep sending until this capture time
+    uint64_t frames_total;        // Frames seen by VAD/DTX (Opus: encoded frames, RAW: capture reads)
+    uint64_t frames_suppressed;
+    
+    // Encoder control (Opus mode): moonmic_set_bitrate writes config.bitrate,
+    // moonmic_set_complexity writes complexity; the worker applies both
+    int complexity;               // Ceiling, 0-10
+    moonmic_abr_t abr;            // Applied values (fixed at the ceilings without adaptive_bitrate)
+    uint64_t abr_report_ms;       // Arrival time of the last receiver report fed to the ABR
     
     // Callbacks
     moonmic_error_callback_t error_callback;
@@ -80,6 +138,7 @@ struct moonmic_client_t {
     // String storage (copies to prevent dangling pointers)
     char uniqueid_storage[32];
     char devicename_storage[128];
+    char capture_device_storage[128];
     
     // Heartbeat monitor
     struct heartbeat_monitor_t* heartbeat_monitor;
@@ -111,11 +170,24 @@ struct audio_capture_t {
      */
     int (*read)(audio_capture_t* self, float* buffer, size_t frames);
     
+    /**
+     * @brief Capture time of the first frame returned by the last read()
+     * Optional (NULL = unknown, packets are stamped with send time).
+     * @return Microseconds on the moonmic_get_timestamp_us() clock, 0 if unknown
+     */
+    uint64_t (*get_capture_timestamp)(audio_capture_t* self);
+    
     /**
      * @brief Close audio capture
      */
     void (*close)(audio_capture_t* self);
     
+    // Requested capture fragment in ms, set before init() (0 = platform default)
+    uint32_t fragment_ms;
+    
+    // Requested capture device, set before init() (NULL = platform default)
+    const char* device_name;
+    
     // Platform-specific data
     void* platform_data;
 };
@@ -128,6 +200,30 @@ struct moonmic_opus_encoder_t {
     uint32_t sample_rate;
     uint8_t channels;
     uint32_t bitrate;
+    int packet_loss_perc;  // 0 = in-band FEC disabled
+    moonmic_opus_app_t application;
+    int complexity;
+    bool dtx;              // Encoder emits MOONMIC_OPUS_DTX_MAX_BYTES frames for silence
+};
+
+// Largest single Opus frame (RFC 6716 section 3.4)
+#define MOONMIC_OPUS_MAX_FRAME_BYTES 1275
+
+// With DTX on, libopus encodes frames its VAD classifies as silence in 1-2 bytes
+#define MOONMIC_OPUS_DTX_MAX_BYTES 2
+
+// Silence suppression timing
+#define MOONMIC_DTX_KEEPALIVE_US 400000  // Marker interval while silent (keeps the host session alive)
+#define MOONMIC_VAD_HANGOVER_US 200000   // RAW VAD: keep sending this long after the last loud frame
+
+/**
+ * @brief Combines consecutive Opus frames into one multi-frame packet
+ */
+struct moonmic_opus_bundler_t {
+    void* repacketizer;  // OpusRepacketizer*
+    uint8_t* storage;    // Frame copies - the repacketizer only keeps pointers
+    int max_frames;
+    int count;           // Frames in the pending bundle
 };
 
 /**
@@ -146,18 +242,50 @@ struct udp_sender_t {
 typedef struct __attribute__((packed)) {
     uint32_t magic;      // 0x4D4D4943 ("MMIC")
     uint32_t sequence;   // Packet sequence number
-    uint64_t timestamp;  // Microseconds since start
+    uint64_t timestamp;  // Capture time of the first sample, microseconds (sender's monotonic clock)
     uint32_t sample_rate; // Sample rate of encoded audio (e.g., 16000, 48000)
                          // Bit 31: RAW mode flag (1 = uncompressed PCM, 0 = Opus)
+                         // Bit 30: DTX marker (sender is suppressing silence from this packet on)
 } moonmic_packet_header_t;
 
 #define MOONMIC_MAGIC 0x4D4D4943
 #define MOONMIC_RAW_FLAG 0x80000000  // Bit 31 set = RAW mode
+#define MOONMIC_DTX_FLAG 0x40000000  // Bit 30 set = DTX marker: RAW payload empty, Opus payload is the DTX frame
+#define MOONMIC_RATE_MASK 0x3FFFFFFF // Sample rate bits of the field
 #define MOONMIC_VERSION "1.0.0"
 // Header size: magic(4) + sequence(4) + timestamp(8) + sample_rate(4) = 20 bytes
 // Use this constant instead of sizeof() due to compiler alignment issues on ARM
 #define MOONMIC_HEADER_SIZE 20
 
+// Write the 20-byte audio header byte by byte (little-endian).
+// Don't use moonmic_packet_header_t directly - struct packing is unreliable on ARM.
+static inline void moonmic_write_packet_header(uint8_t* header_ptr, uint32_t seq, uint64_t ts, uint32_t packet_sample_rate) {
+    uint32_t magic = MOONMIC_MAGIC;
+    header_ptr[0] = (magic >> 0) & 0xFF;
+    header_ptr[1] = (magic >> 8) & 0xFF;
+    header_ptr[2] = (magic >> 16) & 0xFF;
+    header_ptr[3] = (magic >> 24) & 0xFF;
+    
+    header_ptr[4] = (seq >> 0) & 0xFF;
+    header_ptr[5] = (seq >> 8) & 0xFF;
+    header_ptr[6] = (seq >> 16) & 0xFF;
+    header_ptr[7] = (seq >> 24) & 0xFF;
+    
+    header_ptr[8] = (ts >> 0) & 0xFF;
+    header_ptr[9] = (ts >> 8) & 0xFF;
+    header_ptr[10] = (ts >> 16) & 0xFF;
+    header_ptr[11] = (ts >> 24) & 0xFF;
+    header_ptr[12] = (ts >> 32) & 0xFF;
+    header_ptr[13] = (ts >> 40) & 0xFF;
+    header_ptr[14] = (ts >> 48) & 0xFF;
+    header_ptr[15] = (ts >> 56) & 0xFF;
+    
+    header_ptr[16] = (packet_sample_rate >> 0) & 0xFF;
+    header_ptr[17] = (packet_sample_rate >> 8) & 0xFF;
+    header_ptr[18] = (packet_sample_rate >> 16) & 0xFF;
+    header_ptr[19] = (packet_sample_rate >> 24) & 0xFF;
+}
+
 // Control signal magic numbers (host -> client)
 #define MOONMIC_CTRL_STOP  0x53544F50  // "STOP" - host is pausing, stop transmitting
 #define MOONMIC_CTRL_START 0x53545254  // "STRT" - host is resuming, start transmitting
@@ -170,6 +298,60 @@ typedef struct {
 } moonmic_control_packet_t;
 #pragma pack(pop)
 
+// Receiver report (host -> client, every MOONMIC_REPORT_INTERVAL_MS while audio arrives)
+// 24 bytes, little-endian, written and read field by field:
+//   0 magic  4 highest_seq  8 cumulative_lost  12 jitter_us  16 jitter_depth(u16)
+//   18 buffer_ms(u16)  20 fraction_lost(u8, /256 since last report)  21 reserved[3]
+#define MOONMIC_CTRL_REPORT 0x52525054  // "RRPT"
+#define MOONMIC_REPORT_SIZE 24
+#define MOONMIC_REPORT_INTERVAL_MS 500
+
+typedef struct moonmic_receiver_report_t {
+    uint32_t highest_seq;      // Highest sequence received
+    uint32_t cumulative_lost;  // Sequences skipped by the jitter buffer
+    uint32_t jitter_us;        // RFC 3550 interarrival jitter
+    uint16_t jitter_depth;     // Packets held in the jitter buffer
+    uint16_t buffer_ms;        // Mix FIFO level
+    uint8_t fraction_lost;     // Loss since the previous report, fixed point /256
+} moonmic_receiver_report_t;
+
+static inline void moonmic_report_put32(uint8_t* p, uint32_t v) {
+    p[0] = (v >> 0) & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static inline uint32_t moonmic_report_get32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 0) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void moonmic_receiver_report_write(const moonmic_receiver_report_t* report, uint8_t* out) {
+    moonmic_report_put32(out + 0, MOONMIC_CTRL_REPORT);
+    moonmic_report_put32(out + 4, report->highest_seq);
+    moonmic_report_put32(out + 8, report->cumulative_lost);
+    moonmic_report_put32(out + 12, report->jitter_us);
+    out[16] = report->jitter_depth & 0xFF;
+    out[17] = (report->jitter_depth >> 8) & 0xFF;
+    out[18] = report->buffer_ms & 0xFF;
+    out[19] = (report->buffer_ms >> 8) & 0xFF;
+    out[20] = report->fraction_lost;
+    out[21] = out[22] = out[23] = 0;
+}
+
+static inline bool moonmic_receiver_report_parse(const uint8_t* data, size_t size, moonmic_receiver_report_t* out) {
+    if (size < MOONMIC_REPORT_SIZE || moonmic_report_get32(data) != MOONMIC_CTRL_REPORT) {
+        return false;
+    }
+    out->highest_seq = moonmic_report_get32(data + 4);
+    out->cumulative_lost = moonmic_report_get32(data + 8);
+    out->jitter_us = moonmic_report_get32(data + 12);
+    out->jitter_depth = (uint16_t)(data[16] | (data[17] << 8));
+    out->buffer_ms = (uint16_t)(data[18] | (data[19] << 8));
+    out->fraction_lost = data[20];
+    return true;
+}
+
 // Receiver state enum
 typedef enum {
     MOONMIC_STATE_STOPPED = 0,     // Not running
@@ -185,18 +367,54 @@ audio_capture_t* audio_capture_create_vita(void);
 audio_capture_t* audio_capture_create_windows(void);
 #elif __linux__
 audio_capture_t* audio_capture_create_linux(void);
+#ifdef MOONMIC_HAVE_ALSA
+audio_capture_t* audio_capture_create_alsa(void);
+#endif
 #elif __APPLE__
 audio_capture_t* audio_capture_create_macos(void);
 #elif __ANDROID__
 audio_capture_t* audio_capture_create_android(void);
 #endif
 
+// Portable test sources (platform/common), any platform
+audio_capture_t* audio_capture_create_file(bool realtime);
+audio_capture_t* audio_capture_create_synth(uint8_t signal, float hz, float level, bool realtime);
+
 // Codec functions (renamed to avoid conflicts with libopus)
-moonmic_opus_encoder_t* moonmic_opus_encoder_create(uint32_t sample_rate, uint8_t channels, uint32_t bitrate);
+moonmic_opus_encoder_t* moonmic_opus_encoder_create(uint32_t sample_rate, uint8_t channels, uint32_t bitrate,
+                                                     moonmic_opus_app_t application, int complexity,
+                                                     int packet_loss_perc, bool dtx);
 void moonmic_opus_encoder_destroy(moonmic_opus_encoder_t* encoder);
 int moonmic_opus_encoder_encode(moonmic_opus_encoder_t* encoder, const float* pcm, int frame_size, 
                        uint8_t* output, int max_output_bytes);
 
+// Runtime encoder settings (ABR / moonmic_set_bitrate / moonmic_set_complexity)
+void moonmic_opus_encoder_set_bitrate(moonmic_opus_encoder_t* encoder, uint32_t bitrate);
+void moonmic_opus_encoder_set_complexity(moonmic_opus_encoder_t* encoder, int complexity);
+// Ignored while FEC is off (created with packet_loss_perc 0)
+void moonmic_opus_encoder_set_packet_loss_perc(moonmic_opus_encoder_t* encoder, int packet_loss_perc);
+
+// Adaptive bitrate (codec/opus_abr.cpp), driven by receiver reports, RTT and encode time
+void moonmic_abr_init(moonmic_abr_t* abr, uint32_t max_bitrate, uint32_t min_bitrate,
+                      int packet_loss_perc, int max_complexity);
+// New ceilings from the application; current values are clamped to them
+void moonmic_abr_set_limits(moonmic_abr_t* abr, uint32_t max_bitrate, int max_complexity);
+// One receiver report (fraction_lost 0-1) plus the current RTT (-1 = unknown)
+void moonmic_abr_on_report(moonmic_abr_t* abr, uint64_t now_ms, float fraction_lost, int rtt_ms);
+// Time spent in one encode call vs. the frame's duration
+void moonmic_abr_on_encode(moonmic_abr_t* abr, uint64_t now_ms, uint32_t encode_us, uint32_t frame_us);
+
+// Frame bundling (opus_repacketizer)
+moonmic_opus_bundler_t* moonmic_opus_bundler_create(int max_frames);
+void moonmic_opus_bundler_destroy(moonmic_opus_bundler_t* bundler);
+// Returns 1 if queued, 0 if the frame's mode/bandwidth differs from the pending bundle
+// (flush first, then add again), -1 on error
+int moonmic_opus_bundler_add(moonmic_opus_bundler_t* bundler, const uint8_t* frame, int size);
+int moonmic_opus_bundler_count(const moonmic_opus_bundler_t* bundler);
+// Writes the pending frames as one packet and starts a new bundle; returns bytes or -1
+int moonmic_opus_bundler_flush(moonmic_opus_bundler_t* bundler, uint8_t* output, int max_output_bytes);
+void moonmic_opus_bundler_reset(moonmic_opus_bundler_t* bundler);
+
 // Speex resampler functions
 typedef struct moonmic_speex_resampler_t moonmic_speex_resampler_t;
 moonmic_speex_resampler_t* moonmic_speex_resampler_create(uint32_t in_rate, uint32_t out_rate, uint8_t channels);
@@ -0,0 +1,300 @@
+/**
+ * @file audio_capture_file.cpp
+ * @brief File capture backend: WAV (16-bit PCM / 32-bit float) or raw PCM, looped
+ *
+ * capture_device is the path. Files starting with a RIFF/WAVE header must
+ * match the configured sample rate; their channels are mixed down or
+ * duplicated to the configured count. Anything else is read as raw
+ * little-endian int16 at the configured rate and channel count.
+ *
+ * At the end of the data the file starts over, so a short recording can
+ * drive a long run. Selected with capture_backend = MOONMIC_CAPTURE_FILE.
+ */
+
+#include "capture_pacing.h"
+#include "../moonmic_debug.h"
+#include "dsp/moonmic_dsp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILE_DEFAULT_PERIOD_MS 10
+#define WAV_FORMAT_PCM 1
+#define WAV_FORMAT_FLOAT 3
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+
+typedef struct {
+    bool realtime;               // Set at create()
+
+    FILE* file;
+    moonmic_capture_pacer_t pacer;
+    uint8_t channels;            // Delivered
+    uint8_t file_channels;
+    bool is_float;               // float32 samples, else int16
+    long data_start;             // Offset of the first sample
+    uint64_t data_bytes;         // Whole frames only
+    uint64_t data_read;          // Bytes of the data chunk consumed this pass
+    uint32_t period_frames;
+    uint8_t* raw;                // One period as stored in the file
+    float* converted;            // One period, file channel layout
+    uint64_t last_read_us;
+    uint32_t loops;
+} file_audio_data_t;
+
+static uint32_t file_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t file_le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static long file_size(FILE* file) {
+    long here = ftell(file);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, here, SEEK_SET);
+    return size;
+}
+
+// Finds "fmt " and "data"; leaves the format in data, returns false if unsupported
+static bool file_parse_wav(file_audio_data_t* data, uint32_t sample_rate) {
+    uint8_t chunk[8];
+    uint32_t wav_rate = 0;
+    bool have_format = false;
+
+    fseek(data->file, 12, SEEK_SET);
+    while (fread(chunk, 1, sizeof(chunk), data->file) == sizeof(chunk)) {
+        uint32_t size = file_le32(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            uint8_t fmt[40] = {0};
+            size_t want = size < sizeof(fmt) ? size : sizeof(fmt);
+            if (fread(fmt, 1, want, data->file) != want) {
+                return false;
+            }
+            uint16_t format = file_le16(fmt);
+            if (format == WAV_FORMAT_EXTENSIBLE && size >= 26) {
+                format = file_le16(fmt + 24);  // First two bytes of the subformat GUID
+            }
+            uint16_t bits = file_le16(fmt + 14);
+            data->file_channels = (uint8_t)file_le16(fmt + 2);
+            wav_rate = file_le32(fmt + 4);
+            if (format == WAV_FORMAT_PCM && bits == 16) {
+                data->is_float = false;
+            } else if (format == WAV_FORMAT_FLOAT && bits == 32) {
+                data->is_float = true;
+            } else {
+                MOONMIC_LOG("[FileCapture] Unsupported WAV format %u / %u bits (16-bit PCM or 32-bit float only)",
+                            format, bits);
+                return false;
+            }
+            have_format = true;
+            fseek(data->file, (long)(size - want + (size & 1)), SEEK_CUR);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!have_format) {
+                return false;
+            }
+            data->data_start = ftell(data->file);
+            uint64_t available = (uint64_t)(file_size(data->file) - data->data_start);
+            // Streamed WAVs leave the size at 0 / 0xFFFFFFFF: read to the end
+            data->data_bytes = (size == 0 || size == 0xFFFFFFFF || size > available) ? available : size;
+            break;
+        } else {
+            fseek(data->file, (long)(size + (size & 1)), SEEK_CUR);
+        }
+    }
+
+    if (!have_format || data->data_start == 0 || data->file_channels == 0) {
+        MOONMIC_LOG("[FileCapture] Not a usable WAV file (no fmt/data chunk)");
+        return false;
+    }
+    if (wav_rate != sample_rate) {
+        MOONMIC_LOG("[FileCapture] File is %uHz but the client is configured for %uHz", wav_rate, sample_rate);
+        return false;
+    }
+    return true;
+}
+
+static void file_audio_free(file_audio_data_t* data) {
+    if (data->file) {
+        fclose(data->file);
+        data->file = NULL;
+    }
+    free(data->raw);
+    free(data->converted);
+    data->raw = NULL;
+    data->converted = NULL;
+}
+
+static bool file_audio_init(audio_capture_t* self, uint32_t sample_rate, uint8_t channels) {
+    file_audio_data_t* data = (file_audio_data_t*)self->platform_data;
+    if (!data || sample_rate == 0 || channels == 0) {
+        return false;
+    }
+    if (!self->device_name || !self->device_name[0]) {
+        MOONMIC_LOG("[FileCapture] No file given (capture_device)");
+        return false;
+    }
+
+    data->file = fopen(self->device_name, "rb");
+    if (!data->file) {
+        MOONMIC_LOG("[FileCapture] Cannot open '%s'", self->device_name);
+        return false;
+    }
+
+    uint8_t riff[12];
+    bool is_wav = fread(riff, 1, sizeof(riff), data->file) == sizeof(riff) &&
+                  memcmp(riff, "RIFF", 4) == 0 && memcmp(riff + 8, "WAVE", 4) == 0;
+    if (is_wav) {
+        if (!file_parse_wav(data, sample_rate)) {
+            file_audio_free(data);
+            return false;
+        }
+    } else {
+        data->file_channels = channels;
+        data->is_float = false;
+        data->data_start = 0;
+        data->data_bytes = (uint64_t)file_size(data->file);
+    }
+
+    size_t sample_bytes = data->is_float ? sizeof(float) : sizeof(int16_t);
+    size_t frame_bytes = data->file_channels * sample_bytes;
+    data->data_bytes -= data->data_bytes % frame_bytes;
+    if (data->data_bytes == 0) {
+        MOONMIC_LOG("[FileCapture] '%s' holds no audio", self->device_name);
+        file_audio_free(data);
+        return false;
+    }
+
+    uint32_t period_ms = self->fragment_ms ? self->fragment_ms : FILE_DEFAULT_PERIOD_MS;
+    data->channels = channels;
+    data->period_frames = sample_rate * period_ms / 1000;
+    data->raw = (uint8_t*)malloc(data->period_frames * frame_bytes);
+    data->converted = (float*)malloc(data->period_frames * data->file_channels * sizeof(float));
+    if (!data->raw || !data->converted) {
+        file_audio_free(data);
+        return false;
+    }
+
+    fseek(data->file, data->data_start, SEEK_SET);
+    data->data_read = 0;
+    data->loops = 0;
+    moonmic_capture_pacer_init(&data->pacer, sample_rate, data->realtime);
+
+    MOONMIC_LOG("[FileCapture] '%s': %s %s, %uch -> %uch, %.1fs, %s", self->device_name,
+                is_wav ? "WAV" : "raw", data->is_float ? "float32" : "int16", data->file_channels, channels,
+                (double)(data->data_bytes / frame_bytes) / sample_rate,
+                data->realtime ? "real time" : "as fast as possible");
+    return true;
+}
+
+static uint32_t file_audio_get_native_sample_rate(audio_capture_t* self) {
+    file_audio_data_t* data = (file_audio_data_t*)self->platform_data;
+    return data ? data->pacer.sample_rate : MOONMIC_DEFAULT_SAMPLE_RATE;
+}
+
+// Fills raw with `frames` whole frames, wrapping around at the end of the data
+static bool file_read_frames(file_audio_data_t* data, size_t frames, size_t frame_bytes) {
+    size_t done = 0;
+    while (done < frames) {
+        if (data->data_read >= data->data_bytes) {
+            fseek(data->file, data->data_start, SEEK_SET);
+            data->data_read = 0;
+            data->loops++;
+        }
+        uint64_t left = (data->data_bytes - data->data_read) / frame_bytes;
+        size_t want = frames - done < left ? frames - done : (size_t)left;
+        size_t got = fread(data->raw + done * frame_bytes, frame_bytes, want, data->file);
+        if (got == 0) {
+            return false;  // File shrank or I/O error
+        }
+        data->data_read += got * frame_bytes;
+        done += got;
+    }
+    return true;
+}
+
+static int file_audio_read(audio_capture_t* self, float* buffer, size_t frames) {
+    file_audio_data_t* data = (file_audio_data_t*)self->platform_data;
+    if (!data || !data->file) {
+        return -1;
+    }
+
+    if (frames > data->period_frames) {
+        frames = data->period_frames;
+    }
+    size_t file_samples = frames * data->file_channels;
+    size_t frame_bytes = data->file_channels * (data->is_float ? sizeof(float) : sizeof(int16_t));
+    if (!file_read_frames(data, frames, frame_bytes)) {
+        MOONMIC_LOG("[FileCapture] Read failed");
+        return -1;
+    }
+    data->last_read_us = moonmic_capture_pacer_advance(&data->pacer, frames);
+
+    // Samples are little-endian like every platform libmoonmic runs on
+    float* samples = data->channels == data->file_channels ? buffer : data->converted;
+    if (data->is_float) {
+        memcpy(samples, data->raw, file_samples * sizeof(float));
+    } else {
+        moonmic_dsp_s16_to_float((const int16_t*)data->raw, samples, file_samples);
+    }
+
+    if (samples == data->converted) {
+        for (size_t i = 0; i < frames; i++) {
+            const float* in = data->converted + i * data->file_channels;
+            float* out = buffer + i * data->channels;
+            if (data->channels == 1) {
+                float sum = 0.0f;
+                for (uint8_t ch = 0; ch < data->file_channels; ch++) {
+                    sum += in[ch];
+                }
+                out[0] = sum / data->file_channels;
+            } else {
+                for (uint8_t ch = 0; ch < data->channels; ch++) {
+                    out[ch] = in[ch < data->file_channels ? ch : data->file_channels - 1];
+                }
+            }
+        }
+    }
+    return (int)frames;
+}
+
+static uint64_t file_audio_get_capture_timestamp(audio_capture_t* self) {
+    file_audio_data_t* data = (file_audio_data_t*)self->platform_data;
+    return data ? data->last_read_us : 0;
+}
+
+static void file_audio_close(audio_capture_t* self) {
+    file_audio_data_t* data = (file_audio_data_t*)self->platform_data;
+    if (!data) {
+        return;
+    }
+
+    if (data->loops > 0) {
+        MOONMIC_LOG("[FileCapture] Played the file %u time(s)", data->loops + 1);
+    }
+    file_audio_free(data);
+    free(data);
+    self->platform_data = NULL;
+}
+
+audio_capture_t* audio_capture_create_file(bool realtime) {
+    audio_capture_t* capture = (audio_capture_t*)calloc(1, sizeof(audio_capture_t));
+    file_audio_data_t* data = (file_audio_data_t*)calloc(1, sizeof(file_audio_data_t));
+    if (!capture || !data) {
+        free(capture);
+        free(data);
+        return NULL;
+    }
+
+    data->realtime = realtime;
+
+    capture->init = file_audio_init;
+    capture->get_native_sample_rate = file_audio_get_native_sample_rate;
+    capture->read = file_audio_read;
+    capture->get_capture_timestamp = file_audio_get_capture_timestamp;
+    capture->close = file_audio_close;
+    capture->platform_data = data;
+
+    return capture;
+}
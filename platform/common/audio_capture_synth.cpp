@@ -0,0 +1,160 @@
+/**
+ * @file audio_capture_synth.cpp
+ * @brief Signal generator capture backend (sine, impulse train, white noise, tone bursts)
+ *
+ * Needs no audio hardware, so the encoder and transport can be exercised on
+ * a headless box; the output is identical on every run (the noise uses a
+ * fixed seed). Selected with capture_backend = MOONMIC_CAPTURE_SYNTH.
+ */
+
+#include "capture_pacing.h"
+#include "../moonmic_debug.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define SYNTH_DEFAULT_PERIOD_MS 10
+#define SYNTH_DEFAULT_SINE_HZ 440.0f
+#define SYNTH_DEFAULT_IMPULSE_HZ 2.0f
+#define SYNTH_BURST_MS 5
+#define SYNTH_BURST_TONE_HZ 1000.0
+#define SYNTH_DEFAULT_LEVEL 0.5f
+#define SYNTH_TWO_PI 6.283185307179586
+
+typedef struct {
+    // Set at create()
+    uint8_t signal;
+    float hz;
+    float level;
+    bool realtime;
+
+    moonmic_capture_pacer_t pacer;
+    uint8_t channels;
+    uint32_t period_frames;
+    double phase;                // Sine phase, radians
+    uint64_t impulse_interval;   // Frames between impulses / burst starts
+    uint64_t burst_frames;       // Length of one burst
+    uint32_t noise_state;        // xorshift32
+    uint64_t last_read_us;
+} synth_audio_data_t;
+
+static bool synth_audio_init(audio_capture_t* self, uint32_t sample_rate, uint8_t channels) {
+    synth_audio_data_t* data = (synth_audio_data_t*)self->platform_data;
+    if (!data || sample_rate == 0 || channels == 0) {
+        return false;
+    }
+
+    uint32_t period_ms = self->fragment_ms ? self->fragment_ms : SYNTH_DEFAULT_PERIOD_MS;
+    data->channels = channels;
+    data->period_frames = sample_rate * period_ms / 1000;
+    data->phase = 0.0;
+    data->noise_state = 0x12345678;
+    if (data->level <= 0.0f || data->level > 1.0f) {
+        data->level = SYNTH_DEFAULT_LEVEL;
+    }
+    if (data->hz <= 0.0f) {
+        bool periodic = data->signal == MOONMIC_SIGNAL_IMPULSE || data->signal == MOONMIC_SIGNAL_BURST;
+        data->hz = periodic ? SYNTH_DEFAULT_IMPULSE_HZ : SYNTH_DEFAULT_SINE_HZ;
+    }
+    data->impulse_interval = (uint64_t)(sample_rate / data->hz);
+    if (data->impulse_interval == 0) {
+        data->impulse_interval = 1;
+    }
+    data->burst_frames = (uint64_t)sample_rate * SYNTH_BURST_MS / 1000;
+    moonmic_capture_pacer_init(&data->pacer, sample_rate, data->realtime);
+
+    static const char* names[] = { "sine", "impulse", "noise", "burst" };
+    MOONMIC_LOG("[Synth] %s %.1fHz, level %.2f, %uHz %uch, %s",
+                data->signal <= MOONMIC_SIGNAL_BURST ? names[data->signal] : "?", data->hz, data->level,
+                sample_rate, channels, data->realtime ? "real time" : "as fast as possible");
+    return true;
+}
+
+static uint32_t synth_audio_get_native_sample_rate(audio_capture_t* self) {
+    synth_audio_data_t* data = (synth_audio_data_t*)self->platform_data;
+    return data ? data->pacer.sample_rate : MOONMIC_DEFAULT_SAMPLE_RATE;
+}
+
+static float synth_next_sample(synth_audio_data_t* data, uint64_t frame) {
+    switch (data->signal) {
+    case MOONMIC_SIGNAL_IMPULSE:
+        return frame % data->impulse_interval == 0 ? data->level : 0.0f;
+    case MOONMIC_SIGNAL_BURST: {
+        // Starts at phase 0 on every frame that is a multiple of the interval
+        uint64_t offset = frame % data->impulse_interval;
+        return offset < data->burst_frames
+            ? data->level * (float)sin(SYNTH_TWO_PI * SYNTH_BURST_TONE_HZ * offset / data->pacer.sample_rate)
+            : 0.0f;
+    }
+    case MOONMIC_SIGNAL_NOISE: {
+        uint32_t x = data->noise_state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        data->noise_state = x;
+        return data->level * ((float)x / 2147483648.0f - 1.0f);
+    }
+    default: {
+        float value = data->level * (float)sin(data->phase);
+        data->phase += SYNTH_TWO_PI * data->hz / data->pacer.sample_rate;
+        if (data->phase >= SYNTH_TWO_PI) {
+            data->phase -= SYNTH_TWO_PI;
+        }
+        return value;
+    }
+    }
+}
+
+static int synth_audio_read(audio_capture_t* self, float* buffer, size_t frames) {
+    synth_audio_data_t* data = (synth_audio_data_t*)self->platform_data;
+    if (!data || data->period_frames == 0) {
+        return -1;
+    }
+
+    if (frames > data->period_frames) {
+        frames = data->period_frames;
+    }
+    uint64_t first_frame = data->pacer.position;
+    data->last_read_us = moonmic_capture_pacer_advance(&data->pacer, frames);
+
+    for (size_t i = 0; i < frames; i++) {
+        float value = synth_next_sample(data, first_frame + i);
+        for (uint8_t ch = 0; ch < data->channels; ch++) {
+            buffer[i * data->channels + ch] = value;
+        }
+    }
+    return (int)frames;
+}
+
+static uint64_t synth_audio_get_capture_timestamp(audio_capture_t* self) {
+    synth_audio_data_t* data = (synth_audio_data_t*)self->platform_data;
+    return data ? data->last_read_us : 0;
+}
+
+static void synth_audio_close(audio_capture_t* self) {
+    free(self->platform_data);
+    self->platform_data = NULL;
+}
+
+audio_capture_t* audio_capture_create_synth(uint8_t signal, float hz, float level, bool realtime) {
+    audio_capture_t* capture = (audio_capture_t*)calloc(1, sizeof(audio_capture_t));
+    synth_audio_data_t* data = (synth_audio_data_t*)calloc(1, sizeof(synth_audio_data_t));
+    if (!capture || !data) {
+        free(capture);
+        free(data);
+        return NULL;
+    }
+
+    data->signal = signal;
+    data->hz = hz;
+    data->level = level;
+    data->realtime = realtime;
+
+    capture->init = synth_audio_init;
+    capture->get_native_sample_rate = synth_audio_get_native_sample_rate;
+    capture->read = synth_audio_read;
+    capture->get_capture_timestamp = synth_audio_get_capture_timestamp;
+    capture->close = synth_audio_close;
+    capture->platform_data = data;
+
+    return capture;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file capture_pacing.h
+ * @brief Virtual device clock for the file and signal generator capture backends
+ *
+ * Frame N counts as recorded at epoch + N/rate. In real-time mode a read
+ * returns once its last frame is due, like a sound card period; if the reader
+ * stops for longer than that (client waiting for the host) the gap is dropped
+ * the way a device overrun drops it, instead of arriving as a burst.
+ * In fast mode reads return immediately, stamped with the current time.
+ */
+
+#pragma once
+
+#include "../moonmic_internal.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+typedef struct {
+    uint32_t sample_rate;
+    bool realtime;
+    bool started;
+    uint64_t position;   // Frames delivered
+    uint64_t epoch_us;   // Capture time of frame 0 (moonmic_get_timestamp_us clock)
+} moonmic_capture_pacer_t;
+
+static inline void moonmic_capture_pacer_init(moonmic_capture_pacer_t* pacer, uint32_t sample_rate, bool realtime) {
+    pacer->sample_rate = sample_rate;
+    pacer->realtime = realtime;
+    pacer->started = false;
+    pacer->position = 0;
+    pacer->epoch_us = 0;
+}
+
+static inline uint64_t moonmic_capture_pacer_time(const moonmic_capture_pacer_t* pacer, uint64_t frame) {
+    return pacer->epoch_us + frame * 1000000 / pacer->sample_rate;
+}
+
+/**
+ * @brief Account for the next `frames` frames, waiting until they are due in real-time mode
+ * @return Capture time of the first of them
+ */
+static inline uint64_t moonmic_capture_pacer_advance(moonmic_capture_pacer_t* pacer, size_t frames) {
+    uint64_t now = moonmic_get_timestamp_us();
+    if (!pacer->realtime) {
+        pacer->position += frames;
+        return now;
+    }
+
+    uint64_t period_us = (uint64_t)frames * 1000000 / pacer->sample_rate;
+    if (!pacer->started || now > moonmic_capture_pacer_time(pacer, pacer->position + frames) + period_us) {
+        pacer->epoch_us = now - pacer->position * 1000000 / pacer->sample_rate;
+        pacer->started = true;
+    }
+
+    uint64_t first_us = moonmic_capture_pacer_time(pacer, pacer->position);
+    uint64_t due_us = moonmic_capture_pacer_time(pacer, pacer->position + frames);
+    while ((now = moonmic_get_timestamp_us()) < due_us) {
+#ifdef _WIN32
+        Sleep((DWORD)((due_us - now + 999) / 1000));
+#else
+        usleep((useconds_t)(due_us - now));
+#endif
+    }
+    pacer->position += frames;
+    return first_us;
+}
@@ -0,0 +1,231 @@
+/**
+ * @file audio_capture_alsa.cpp
+ * @brief Linux audio capture directly on ALSA (mmap), for systems without a sound server
+ *
+ * The PCM runs with one period per Opus frame (20ms unless a capture fragment
+ * is requested), so the capture thread wakes exactly once per frame and reads
+ * straight out of the DMA buffer via snd_pcm_mmap_begin/commit - no sound
+ * server hop, no extra copy. Capture times come from the driver's monotonic
+ * htimestamp minus the frames still waiting in the buffer.
+ *
+ * Works on hardware PCMs ("hw:0"), plughw, and for testing on the snd-dummy
+ * kernel module ("hw:Dummy").
+ */
+
+#include "../moonmic_internal.h"
+#include "../moonmic_debug.h"
+#include "dsp/moonmic_dsp.h"
+#include <alsa/asoundlib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ALSA_DEFAULT_DEVICE "default"
+#define ALSA_OPUS_FRAME_MS 20
+#define ALSA_PERIODS 4
+
+typedef struct {
+    snd_pcm_t* pcm;
+    uint32_t sample_rate;
+    uint8_t channels;
+    bool s16;                        // Device only does S16_LE: convert on read
+    snd_pcm_uframes_t period_frames;
+    uint64_t last_read_us;           // Capture time of the first frame of the last read()
+    uint64_t xruns;
+} alsa_audio_data_t;
+
+static bool alsa_configure(alsa_audio_data_t* data, uint32_t sample_rate, uint8_t channels, uint32_t period_ms) {
+    snd_pcm_hw_params_t* hw;
+    snd_pcm_hw_params_alloca(&hw);
+    snd_pcm_hw_params_any(data->pcm, hw);
+
+    if (snd_pcm_hw_params_set_access(data->pcm, hw, SND_PCM_ACCESS_MMAP_INTERLEAVED) < 0) {
+        MOONMIC_LOG("[ALSA] Device has no mmap access (try plughw: or hw:)");
+        return false;
+    }
+    if (snd_pcm_hw_params_set_format(data->pcm, hw, SND_PCM_FORMAT_FLOAT_LE) == 0) {
+        data->s16 = false;
+    } else if (snd_pcm_hw_params_set_format(data->pcm, hw, SND_PCM_FORMAT_S16_LE) == 0) {
+        data->s16 = true;
+    } else {
+        MOONMIC_LOG("[ALSA] Neither FLOAT_LE nor S16_LE supported");
+        return false;
+    }
+    if (snd_pcm_hw_params_set_channels(data->pcm, hw, channels) < 0) {
+        MOONMIC_LOG("[ALSA] %u channel(s) not supported", channels);
+        return false;
+    }
+
+    unsigned int rate = sample_rate;
+    if (snd_pcm_hw_params_set_rate_near(data->pcm, hw, &rate, NULL) < 0) {
+        return false;
+    }
+
+    // One period per Opus frame: a single wakeup per encoded frame
+    snd_pcm_uframes_t period = rate * period_ms / 1000;
+    snd_pcm_uframes_t buffer = period * ALSA_PERIODS;
+    snd_pcm_hw_params_set_period_size_near(data->pcm, hw, &period, NULL);
+    snd_pcm_hw_params_set_buffer_size_near(data->pcm, hw, &buffer);
+
+    if (snd_pcm_hw_params(data->pcm, hw) < 0) {
+        MOONMIC_LOG("[ALSA] Failed to apply hw params");
+        return false;
+    }
+    snd_pcm_hw_params_get_period_size(hw, &data->period_frames, NULL);
+
+    snd_pcm_sw_params_t* sw;
+    snd_pcm_sw_params_alloca(&sw);
+    snd_pcm_sw_params_current(data->pcm, sw);
+    snd_pcm_sw_params_set_avail_min(data->pcm, sw, data->period_frames);
+    snd_pcm_sw_params_set_tstamp_mode(data->pcm, sw, SND_PCM_TSTAMP_ENABLE);
+    snd_pcm_sw_params_set_tstamp_type(data->pcm, sw, SND_PCM_TSTAMP_TYPE_MONOTONIC);
+    if (snd_pcm_sw_params(data->pcm, sw) < 0) {
+        MOONMIC_LOG("[ALSA] Failed to apply sw params");
+        return false;
+    }
+
+    data->sample_rate = rate;
+    data->channels = channels;
+    return true;
+}
+
+static bool alsa_audio_init(audio_capture_t* self, uint32_t sample_rate, uint8_t channels) {
+    alsa_audio_data_t* data = (alsa_audio_data_t*)calloc(1, sizeof(alsa_audio_data_t));
+    if (!data) {
+        return false;
+    }
+
+    const char* device = (self->device_name && self->device_name[0]) ? self->device_name : ALSA_DEFAULT_DEVICE;
+    int err = snd_pcm_open(&data->pcm, device, SND_PCM_STREAM_CAPTURE, 0);
+    if (err < 0) {
+        MOONMIC_LOG("[ALSA] Cannot open '%s': %s", device, snd_strerror(err));
+        free(data);
+        return false;
+    }
+
+    uint32_t period_ms = self->fragment_ms ? self->fragment_ms : ALSA_OPUS_FRAME_MS;
+    if (!alsa_configure(data, sample_rate, channels, period_ms) || snd_pcm_start(data->pcm) < 0) {
+        snd_pcm_close(data->pcm);
+        free(data);
+        return false;
+    }
+
+    MOONMIC_LOG("[ALSA] Capturing from '%s': %uHz, %uch, %s, period %lu frames",
+                device, data->sample_rate, data->channels, data->s16 ? "S16" : "FLOAT",
+                (unsigned long)data->period_frames);
+
+    self->platform_data = data;
+    return true;
+}
+
+static uint32_t alsa_audio_get_native_sample_rate(audio_capture_t* self) {
+    alsa_audio_data_t* data = (alsa_audio_data_t*)self->platform_data;
+    return data ? data->sample_rate : MOONMIC_DEFAULT_SAMPLE_RATE;
+}
+
+// Overrun (reader too slow) or suspend: restart capture, the lost audio is gone
+static bool alsa_recover(alsa_audio_data_t* data, int err) {
+    data->xruns++;
+    if (snd_pcm_recover(data->pcm, err, 1) < 0) {
+        return false;
+    }
+    return snd_pcm_start(data->pcm) >= 0 || snd_pcm_state(data->pcm) == SND_PCM_STATE_RUNNING;
+}
+
+static int alsa_audio_read(audio_capture_t* self, float* buffer, size_t frames) {
+    alsa_audio_data_t* data = (alsa_audio_data_t*)self->platform_data;
+    if (!data || !data->pcm) {
+        return -1;
+    }
+
+    // Sleep until the driver has the frames (one period = one wakeup)
+    snd_pcm_sframes_t avail = snd_pcm_avail_update(data->pcm);
+    while (avail >= 0 && (size_t)avail < frames) {
+        int ready = snd_pcm_wait(data->pcm, (int)(2 * data->period_frames * 1000 / data->sample_rate) + 1);
+        if (ready == 0) {
+            break;  // Timed out: hand back what there is
+        }
+        avail = ready < 0 ? ready : snd_pcm_avail_update(data->pcm);
+    }
+    if (avail < 0) {
+        return alsa_recover(data, (int)avail) ? 0 : -1;
+    }
+
+    // avail frames were captured up to tstamp: the oldest one is avail/rate earlier
+    snd_pcm_uframes_t ts_avail = 0;
+    snd_htimestamp_t tstamp;
+    if (snd_pcm_htimestamp(data->pcm, &ts_avail, &tstamp) == 0 && (tstamp.tv_sec || tstamp.tv_nsec)) {
+        uint64_t ts_us = (uint64_t)tstamp.tv_sec * 1000000 + tstamp.tv_nsec / 1000;
+        data->last_read_us = ts_us - (uint64_t)ts_avail * 1000000 / data->sample_rate;
+    } else {
+        data->last_read_us = 0;
+    }
+
+    size_t done = 0;
+    size_t want = (size_t)avail < frames ? (size_t)avail : frames;
+    while (done < want) {
+        const snd_pcm_channel_area_t* areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t n = want - done;
+        int err = snd_pcm_mmap_begin(data->pcm, &areas, &offset, &n);
+        if (err < 0) {
+            return alsa_recover(data, err) ? (int)done : -1;
+        }
+
+        // Interleaved: one area describes all channels
+        const uint8_t* base = (const uint8_t*)areas[0].addr + (areas[0].first + offset * areas[0].step) / 8;
+        size_t samples = n * data->channels;
+        float* out = buffer + done * data->channels;
+        if (data->s16) {
+            moonmic_dsp_s16_to_float((const int16_t*)base, out, samples);
+        } else {
+            memcpy(out, base, samples * sizeof(float));
+        }
+
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(data->pcm, offset, n);
+        if (committed < 0 || (snd_pcm_uframes_t)committed != n) {
+            return alsa_recover(data, committed < 0 ? (int)committed : -EPIPE) ? (int)(done + n) : -1;
+        }
+        done += n;
+    }
+
+    return (int)done;
+}
+
+static uint64_t alsa_audio_get_capture_timestamp(audio_capture_t* self) {
+    alsa_audio_data_t* data = (alsa_audio_data_t*)self->platform_data;
+    return data ? data->last_read_us : 0;
+}
+
+static void alsa_audio_close(audio_capture_t* self) {
+    alsa_audio_data_t* data = (alsa_audio_data_t*)self->platform_data;
+    if (!data) {
+        return;
+    }
+
+    if (data->xruns > 0) {
+        MOONMIC_LOG("[ALSA] Overruns: %llu", (unsigned long long)data->xruns);
+    }
+    if (data->pcm) {
+        snd_pcm_drop(data->pcm);
+        snd_pcm_close(data->pcm);
+    }
+
+    free(data);
+    self->platform_data = NULL;
+}
+
+audio_capture_t* audio_capture_create_alsa(void) {
+    audio_capture_t* capture = (audio_capture_t*)calloc(1, sizeof(audio_capture_t));
+    if (!capture) {
+        return NULL;
+    }
+
+    capture->init = alsa_audio_init;
+    capture->get_native_sample_rate = alsa_audio_get_native_sample_rate;
+    capture->read = alsa_audio_read;
+    capture->get_capture_timestamp = alsa_audio_get_capture_timestamp;
+    capture->close = alsa_audio_close;
+    capture->platform_data = NULL;
+
+    return capture;
+}
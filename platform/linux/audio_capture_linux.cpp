@@ -1,84 +1,297 @@
 /**
  * @file audio_capture_linux.cpp
- * @brief Linux audio capture implementation using PulseAudio
- * 
+ * @brief Linux audio capture implementation using PulseAudio (asynchronous API)
+ *
  * Based on Sunshine's implementation (src/platform/linux/audio.cpp)
+ *
+ * A pa_threaded_mainloop delivers fragments through the stream's read
+ * callback into a ring buffer; read() waits on the mainloop lock until enough
+ * frames are buffered. Every fragment is stamped with its capture time
+ * (CLOCK_MONOTONIC, same clock as moonmic_get_timestamp_us) from the stream
+ * latency at delivery, so packet timestamps reflect when audio was captured
+ * rather than when it was sent.
  */
 
 #include "../moonmic_internal.h"
-#include <pulse/simple.h>
-#include <pulse/error.h>
+#include <pulse/pulseaudio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define LINUX_DEFAULT_FRAGMENT_MS 10
+#define LINUX_RING_MS 500
+#define LINUX_CONNECT_TIMEOUT_US 3000000
+
 typedef struct {
-    pa_simple* pulse;
+    pa_threaded_mainloop* mainloop;
+    pa_context* context;
+    pa_stream* stream;
+    pa_time_event* wakeup;    // Bounds read() waits when the source delivers nothing
     uint32_t sample_rate;
     uint8_t channels;
+    uint32_t fragment_frames;
+
+    // Ring of captured frames (guarded by the mainloop lock)
+    float* ring;
+    uint64_t ring_frames;     // Capacity in frames
+    uint64_t write_frame;     // Total frames written
+    uint64_t read_frame;      // Total frames read (or dropped on overflow)
+
+    // Capture time of frame number anchor_frame (timestamps are linear in between)
+    uint64_t anchor_frame;
+    uint64_t anchor_us;
+    uint64_t last_read_us;    // Capture time of the first frame of the last read()
+    uint64_t overruns;
+
+    bool failed;
 } linux_audio_data_t;
 
+static void linux_context_state_cb(pa_context* c, void* userdata) {
+    linux_audio_data_t* data = (linux_audio_data_t*)userdata;
+    (void)c;
+    pa_threaded_mainloop_signal(data->mainloop, 0);
+}
+
+static void linux_stream_state_cb(pa_stream* s, void* userdata) {
+    linux_audio_data_t* data = (linux_audio_data_t*)userdata;
+    if (pa_stream_get_state(s) == PA_STREAM_FAILED) {
+        data->failed = true;
+    }
+    pa_threaded_mainloop_signal(data->mainloop, 0);
+}
+
+// Mainloop thread: periodic wakeup so a blocked read() can time out
+static void linux_wakeup_cb(pa_mainloop_api* api, pa_time_event* e, const struct timeval* tv, void* userdata) {
+    linux_audio_data_t* data = (linux_audio_data_t*)userdata;
+    (void)api;
+    (void)tv;
+    pa_context_rttime_restart(data->context, e,
+                              pa_rtclock_now() + (pa_usec_t)data->fragment_frames * PA_USEC_PER_SEC / data->sample_rate);
+    pa_threaded_mainloop_signal(data->mainloop, 0);
+}
+
+static void linux_ring_push(linux_audio_data_t* data, const float* samples, size_t frames) {
+    for (size_t done = 0; done < frames; ) {
+        uint64_t pos = data->write_frame % data->ring_frames;
+        size_t n = frames - done;
+        if (n > data->ring_frames - pos) {
+            n = (size_t)(data->ring_frames - pos);
+        }
+        if (samples) {
+            memcpy(data->ring + pos * data->channels, samples + done * data->channels,
+                   n * data->channels * sizeof(float));
+        } else {
+            memset(data->ring + pos * data->channels, 0, n * data->channels * sizeof(float));  // Hole
+        }
+        data->write_frame += n;
+        done += n;
+    }
+
+    // Reader fell behind: drop the oldest audio to keep latency bounded
+    if (data->write_frame - data->read_frame > data->ring_frames) {
+        data->read_frame = data->write_frame - data->ring_frames;
+        data->overruns++;
+    }
+}
+
+// Mainloop thread: drain every fragment the server has for us
+static void linux_stream_read_cb(pa_stream* s, size_t nbytes, void* userdata) {
+    linux_audio_data_t* data = (linux_audio_data_t*)userdata;
+    (void)nbytes;
+
+    // Everything still unread in the stream was captured `latency` ago or later
+    uint64_t now_us = moonmic_get_timestamp_us();
+    pa_usec_t latency = 0;
+    int negative = 0;
+    bool have_latency = pa_stream_get_latency(s, &latency, &negative) >= 0 && !negative;
+    uint64_t first_us = have_latency && latency < now_us ? now_us - latency : now_us;
+    uint64_t first_frame = data->write_frame;
+
+    const size_t frame_bytes = data->channels * sizeof(float);
+    const void* fragment = NULL;
+    size_t bytes = 0;
+    while (pa_stream_readable_size(s) > 0 && pa_stream_peek(s, &fragment, &bytes) >= 0) {
+        if (bytes == 0) {
+            break;  // Nothing buffered
+        }
+        // fragment == NULL with bytes > 0 is a hole in the stream: keep the timeline, insert silence
+        linux_ring_push(data, (const float*)fragment, bytes / frame_bytes);
+        pa_stream_drop(s);
+    }
+
+    if (data->write_frame != first_frame) {
+        data->anchor_frame = first_frame;
+        data->anchor_us = first_us;
+    }
+    pa_threaded_mainloop_signal(data->mainloop, 0);
+}
+
+static void linux_audio_destroy(linux_audio_data_t* data) {
+    if (data->mainloop) {
+        pa_threaded_mainloop_stop(data->mainloop);
+    }
+    if (data->wakeup) {
+        pa_threaded_mainloop_get_api(data->mainloop)->time_free(data->wakeup);
+    }
+    if (data->stream) {
+        pa_stream_disconnect(data->stream);
+        pa_stream_unref(data->stream);
+    }
+    if (data->context) {
+        pa_context_disconnect(data->context);
+        pa_context_unref(data->context);
+    }
+    if (data->mainloop) {
+        pa_threaded_mainloop_free(data->mainloop);
+    }
+    free(data->ring);
+    free(data);
+}
+
 static bool linux_audio_init(audio_capture_t* self, uint32_t sample_rate, uint8_t channels) {
     linux_audio_data_t* data = (linux_audio_data_t*)calloc(1, sizeof(linux_audio_data_t));
     if (!data) {
         return false;
     }
-    
+
+    uint32_t fragment_ms = self->fragment_ms ? self->fragment_ms : LINUX_DEFAULT_FRAGMENT_MS;
+    data->sample_rate = sample_rate;
+    data->channels = channels;
+    data->fragment_frames = sample_rate * fragment_ms / 1000;
+    data->ring_frames = (uint64_t)sample_rate * LINUX_RING_MS / 1000;
+    data->ring = (float*)calloc((size_t)data->ring_frames * channels, sizeof(float));
+    data->mainloop = pa_threaded_mainloop_new();
+    if (!data->ring || !data->mainloop) {
+        linux_audio_destroy(data);
+        return false;
+    }
+
+    data->context = pa_context_new(pa_threaded_mainloop_get_api(data->mainloop), "moonmic");
+    if (!data->context) {
+        linux_audio_destroy(data);
+        return false;
+    }
+    pa_context_set_state_callback(data->context, linux_context_state_cb, data);
+    data->wakeup = pa_context_rttime_new(data->context, pa_rtclock_now(), linux_wakeup_cb, data);
+
+    if (pa_context_connect(data->context, NULL, PA_CONTEXT_NOFLAGS, NULL) < 0 ||
+        pa_threaded_mainloop_start(data->mainloop) < 0) {
+        linux_audio_destroy(data);
+        return false;
+    }
+
+    pa_threaded_mainloop_lock(data->mainloop);
+
+    // Wait for the server connection
+    uint64_t deadline = moonmic_get_timestamp_us() + LINUX_CONNECT_TIMEOUT_US;
+    pa_context_state_t context_state;
+    while ((context_state = pa_context_get_state(data->context)) != PA_CONTEXT_READY) {
+        if (!PA_CONTEXT_IS_GOOD(context_state) || moonmic_get_timestamp_us() > deadline) {
+            pa_threaded_mainloop_unlock(data->mainloop);
+            linux_audio_destroy(data);
+            return false;
+        }
+        pa_threaded_mainloop_wait(data->mainloop);
+    }
+
     // Configure PulseAudio sample spec
     pa_sample_spec ss;
     ss.format = PA_SAMPLE_FLOAT32LE;
     ss.rate = sample_rate;
     ss.channels = channels;
-    
-    // Configure buffer attributes for low latency
+
+    data->stream = pa_stream_new(data->context, "Microphone Input", &ss, NULL);
+    if (!data->stream) {
+        pa_threaded_mainloop_unlock(data->mainloop);
+        linux_audio_destroy(data);
+        return false;
+    }
+    pa_stream_set_state_callback(data->stream, linux_stream_state_cb, data);
+    pa_stream_set_read_callback(data->stream, linux_stream_read_cb, data);
+
+    // Fragment size drives both the delivery period and (with ADJUST_LATENCY) the source latency
     pa_buffer_attr attr;
     attr.maxlength = (uint32_t)-1;
     attr.tlength = (uint32_t)-1;
     attr.prebuf = (uint32_t)-1;
     attr.minreq = (uint32_t)-1;
-    attr.fragsize = 480 * channels * sizeof(float);  // 10ms at 48kHz
-    
-    int error;
-    
-    // Create PulseAudio simple connection for recording
-    data->pulse = pa_simple_new(
-        NULL,                           // Use default server
-        "moonmic",                      // Application name
-        PA_STREAM_RECORD,               // Record stream
-        NULL,                           // Use default device
-        "Microphone Input",             // Stream description
-        &ss,                            // Sample specification
-        NULL,                           // Use default channel map
-        &attr,                          // Buffer attributes
-        &error                          // Error code
-    );
-    
-    if (!data->pulse) {
-        free(data);
+    attr.fragsize = data->fragment_frames * channels * sizeof(float);
+
+    pa_stream_flags_t flags = (pa_stream_flags_t)(PA_STREAM_ADJUST_LATENCY | PA_STREAM_INTERPOLATE_TIMING |
+                                                  PA_STREAM_AUTO_TIMING_UPDATE);
+    if (pa_stream_connect_record(data->stream, NULL, &attr, flags) < 0) {
+        pa_threaded_mainloop_unlock(data->mainloop);
+        linux_audio_destroy(data);
         return false;
     }
-    
-    data->sample_rate = sample_rate;
-    data->channels = channels;
+
+    pa_stream_state_t stream_state;
+    while ((stream_state = pa_stream_get_state(data->stream)) != PA_STREAM_READY) {
+        if (!PA_STREAM_IS_GOOD(stream_state) || moonmic_get_timestamp_us() > deadline) {
+            pa_threaded_mainloop_unlock(data->mainloop);
+            linux_audio_destroy(data);
+            return false;
+        }
+        pa_threaded_mainloop_wait(data->mainloop);
+    }
+
+    pa_threaded_mainloop_unlock(data->mainloop);
+
     self->platform_data = data;
-    
     return true;
 }
 
+static uint32_t linux_audio_get_native_sample_rate(audio_capture_t* self) {
+    // PulseAudio resamples to whatever rate the stream was opened with
+    linux_audio_data_t* data = (linux_audio_data_t*)self->platform_data;
+    return data ? data->sample_rate : MOONMIC_DEFAULT_SAMPLE_RATE;
+}
+
 static int linux_audio_read(audio_capture_t* self, float* buffer, size_t frames) {
     linux_audio_data_t* data = (linux_audio_data_t*)self->platform_data;
-    if (!data || !data->pulse) {
+    if (!data || !data->stream) {
         return -1;
     }
-    
-    size_t bytes_to_read = frames * data->channels * sizeof(float);
-    int error;
-    
-    // Read from PulseAudio (blocking call)
-    if (pa_simple_read(data->pulse, buffer, bytes_to_read, &error) < 0) {
+
+    pa_threaded_mainloop_lock(data->mainloop);
+
+    // Block until enough audio is buffered; give up after a few fragments of silence
+    // from the server (returns what is there, possibly 0) so the caller can check state
+    uint64_t deadline = moonmic_get_timestamp_us() + 4 * (uint64_t)data->fragment_frames * 1000000 / data->sample_rate;
+    while (data->write_frame - data->read_frame < frames && !data->failed &&
+           moonmic_get_timestamp_us() < deadline) {
+        pa_threaded_mainloop_wait(data->mainloop);
+    }
+    if (data->failed) {
+        pa_threaded_mainloop_unlock(data->mainloop);
         return -1;
     }
-    
-    return (int)frames;
+
+    size_t available = (size_t)(data->write_frame - data->read_frame);
+    size_t n = available < frames ? available : frames;
+
+    // Capture time of the first frame handed out
+    int64_t offset = (int64_t)data->read_frame - (int64_t)data->anchor_frame;
+    data->last_read_us = data->anchor_us + offset * 1000000 / (int64_t)data->sample_rate;
+
+    for (size_t done = 0; done < n; ) {
+        uint64_t pos = data->read_frame % data->ring_frames;
+        size_t chunk = n - done;
+        if (chunk > data->ring_frames - pos) {
+            chunk = (size_t)(data->ring_frames - pos);
+        }
+        memcpy(buffer + done * data->channels, data->ring + pos * data->channels,
+               chunk * data->channels * sizeof(float));
+        data->read_frame += chunk;
+        done += chunk;
+    }
+
+    pa_threaded_mainloop_unlock(data->mainloop);
+    return (int)n;
+}
+
+static uint64_t linux_audio_get_capture_timestamp(audio_capture_t* self) {
+    linux_audio_data_t* data = (linux_audio_data_t*)self->platform_data;
+    return data ? data->last_read_us : 0;
 }
 
 static void linux_audio_close(audio_capture_t* self) {
@@ -86,12 +299,8 @@ static void linux_audio_close(audio_capture_t* self) {
     if (!data) {
         return;
     }
-    
-    if (data->pulse) {
-        pa_simple_free(data->pulse);
-    }
-    
-    free(data);
+
+    linux_audio_destroy(data);
     self->platform_data = NULL;
 }
 
@@ -100,11 +309,13 @@ audio_capture_t* audio_capture_create_linux(void) {
     if (!capture) {
         return NULL;
     }
-    
+
     capture->init = linux_audio_init;
+    capture->get_native_sample_rate = linux_audio_get_native_sample_rate;
     capture->read = linux_audio_read;
+    capture->get_capture_timestamp = linux_audio_get_capture_timestamp;
     capture->close = linux_audio_close;
     capture->platform_data = NULL;
-    
+
     return capture;
 }
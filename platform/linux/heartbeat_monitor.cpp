@@ -4,15 +4,20 @@
  */
 
 #include "../heartbeat_monitor.h"
+#include "../moonmic_internal.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <arpa/inet.h>
 #include <unistd.h>
+#include <poll.h>
 #include <pthread.h>
 #include <sys/time.h>
 #include <cstring>
 #include <cstdlib>
 
 #define PING_MAGIC 0x50494E47  // "PING"
+#define PONG_MAGIC 0x504F4E47  // "PONG"
+#define PING_INTERVAL_MS 1000
 #define PING_TIMEOUT_MS 3000   // 3 seconds
 #define CTRL_STOP_MAGIC 0x53544F50  // "STOP"
 #define CTRL_START_MAGIC 0x53545254  // "STRT"
@@ -25,12 +30,19 @@ struct ping_packet {
 #pragma pack(pop)
 
 struct heartbeat_monitor_t {
-    int socket;
+    int socket;                   // Shared with udp_sender (not owned)
+    struct sockaddr_in dest_addr; // Host, for our PINGs and PONG replies
     volatile int running;
     volatile moonmic_connection_status_t status;
-    volatile uint64_t last_ping_time;
+    volatile uint64_t last_ping_time;  // Last PING/PONG from the host
+    volatile int current_rtt;          // RTT in ms, -1 = unknown
     pthread_t thread;
     volatile int paused;  // 1 if host sent STOP, 0 if host sent START
+    
+    // Last receiver report (guarded by report_lock)
+    pthread_mutex_t report_lock;
+    moonmic_receiver_report_t report;
+    uint64_t report_time;  // 0 = none yet
 };
 
 // Get time in milliseconds
@@ -44,34 +56,79 @@ static uint64_t get_time_ms() {
 static void* monitor_thread_func(void* param) {
     heartbeat_monitor_t* monitor = (heartbeat_monitor_t*)param;
     uint8_t buffer[32];
+    uint64_t last_sent_ping = 0;
+    
+    // The socket is the sender's non-blocking one: wait with poll(), not SO_RCVTIMEO
+    struct pollfd pfd;
+    pfd.fd = monitor->socket;
+    pfd.events = POLLIN;
     
     while (__sync_fetch_and_add(&monitor->running, 0)) {
-        // Receive with timeout
-        ssize_t received = recv(monitor->socket, buffer, sizeof(buffer), 0);
+        // PING the host every second (client-side RTT)
+        uint64_t now = get_time_ms();
+        if (now - last_sent_ping >= PING_INTERVAL_MS) {
+            ping_packet packet;
+            packet.magic = PING_MAGIC;
+            packet.timestamp = now;
+            sendto(monitor->socket, &packet, sizeof(packet), 0,
+                   (struct sockaddr*)&monitor->dest_addr, sizeof(monitor->dest_addr));
+            last_sent_ping = now;
+        }
         
-        if (received >= 4) {  // At least magic number
-            uint32_t magic;
-            memcpy(&magic, buffer, sizeof(magic));
+        if (poll(&pfd, 1, 100) > 0 && (pfd.revents & POLLIN)) {
+            ssize_t received = recv(monitor->socket, buffer, sizeof(buffer), 0);
             
-            if (magic == PING_MAGIC && received == sizeof(ping_packet)) {
-                // Valid PING received
-                monitor->last_ping_time = get_time_ms();
-                monitor->status = MOONMIC_CONNECTED;
-            }
-            else if (magic == CTRL_STOP_MAGIC && received == 8) {
-                // STOP signal from host - pause transmission
-                __sync_lock_test_and_set(&monitor->paused, 1);
-            }
-            else if (magic == CTRL_START_MAGIC && received == 8) {
-                // START signal from host - resume transmission
-                __sync_lock_test_and_set(&monitor->paused, 0);
+            if (received >= 4) {  // At least magic number
+                uint32_t magic;
+                memcpy(&magic, buffer, sizeof(magic));
+                
+                if (magic == PING_MAGIC && received == sizeof(ping_packet)) {
+                    // Host keepalive: mark connected, echo as PONG so the host can measure RTT
+                    monitor->last_ping_time = get_time_ms();
+                    monitor->status = MOONMIC_CONNECTED;
+                    
+                    uint32_t pong = PONG_MAGIC;
+                    memcpy(buffer, &pong, sizeof(pong));
+                    sendto(monitor->socket, buffer, (size_t)received, 0,
+                           (struct sockaddr*)&monitor->dest_addr, sizeof(monitor->dest_addr));
+                }
+                else if (magic == PONG_MAGIC && received == sizeof(ping_packet)) {
+                    // Reply to our PING: carries our own timestamp back
+                    ping_packet packet;
+                    memcpy(&packet, buffer, sizeof(packet));
+                    uint64_t current = get_time_ms();
+                    monitor->last_ping_time = current;
+                    monitor->status = MOONMIC_CONNECTED;
+                    
+                    int64_t diff = (int64_t)(current - packet.timestamp);
+                    if (diff >= 0 && diff < 5000) {
+                        monitor->current_rtt = (int)diff;
+                    }
+                }
+                else if (magic == CTRL_STOP_MAGIC && received == 8) {
+                    // STOP signal from host - pause transmission
+                    __sync_lock_test_and_set(&monitor->paused, 1);
+                }
+                else if (magic == CTRL_START_MAGIC && received == 8) {
+                    // START signal from host - resume transmission
+                    __sync_lock_test_and_set(&monitor->paused, 0);
+                }
+                else if (magic == MOONMIC_CTRL_REPORT) {
+                    moonmic_receiver_report_t report;
+                    if (moonmic_receiver_report_parse(buffer, (size_t)received, &report)) {
+                        pthread_mutex_lock(&monitor->report_lock);
+                        monitor->report = report;
+                        monitor->report_time = get_time_ms();
+                        pthread_mutex_unlock(&monitor->report_lock);
+                    }
+                }
             }
         }
         
         // Check for timeout
-        uint64_t now = get_time_ms();
-        if (now - monitor->last_ping_time > PING_TIMEOUT_MS) {
+        if (get_time_ms() - monitor->last_ping_time > PING_TIMEOUT_MS) {
             monitor->status = MOONMIC_DISCONNECTED;
+            monitor->current_rtt = -1;
         }
     }
     
@@ -80,34 +137,21 @@ static void* monitor_thread_func(void* param) {
 
 extern "C" {
 
-heartbeat_monitor_t* heartbeat_monitor_create(uint16_t port) {
-    heartbeat_monitor_t* monitor = (heartbeat_monitor_t*)calloc(1, sizeof(heartbeat_monitor_t));
-    if (!monitor) {
+heartbeat_monitor_t* heartbeat_monitor_create(int socket_fd, const char* host_ip, uint16_t host_port) {
+    if (socket_fd < 0 || !host_ip) {
         return nullptr;
     }
     
-    // Create UDP socket
-    monitor->socket = socket(AF_INET, SOCK_DGRAM, 0);
-    if (monitor->socket < 0) {
-        free(monitor);
+    heartbeat_monitor_t* monitor = (heartbeat_monitor_t*)calloc(1, sizeof(heartbeat_monitor_t));
+    if (!monitor) {
         return nullptr;
     }
     
-    // Set socket timeout (100ms)
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = 100000;  // 100ms
-    setsockopt(monitor->socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-    
-    // Bind to port
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(port);
-    addr.sin_addr.s_addr = INADDR_ANY;
-    
-    if (bind(monitor->socket, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        close(monitor->socket);
+    // Same socket as the sender: the host replies to the source port of our audio
+    monitor->socket = socket_fd;
+    monitor->dest_addr.sin_family = AF_INET;
+    monitor->dest_addr.sin_port = htons(host_port);
+    if (inet_pton(AF_INET, host_ip, &monitor->dest_addr.sin_addr) != 1) {
         free(monitor);
         return nullptr;
     }
@@ -115,12 +159,14 @@ heartbeat_monitor_t* heartbeat_monitor_create(uint16_t port) {
     // Initialize state
     monitor->status = MOONMIC_DISCONNECTED;
     monitor->last_ping_time = 0;
+    monitor->current_rtt = -1;
     monitor->running = 1;
     monitor->paused = 0;  // Start unpaused
+    pthread_mutex_init(&monitor->report_lock, nullptr);
     
     // Create monitor thread
     if (pthread_create(&monitor->thread, nullptr, monitor_thread_func, monitor) != 0) {
-        close(monitor->socket);
+        pthread_mutex_destroy(&monitor->report_lock);
         free(monitor);
         return nullptr;
     }
@@ -137,8 +183,9 @@ void heartbeat_monitor_destroy(heartbeat_monitor_t* monitor) {
     
     // Wait for thread to exit
     pthread_join(monitor->thread, nullptr);
+    pthread_mutex_destroy(&monitor->report_lock);
     
-    close(monitor->socket);
+    // The socket belongs to udp_sender
     free(monitor);
 }
 
@@ -149,6 +196,10 @@ moonmic_connection_status_t heartbeat_monitor_get_status(heartbeat_monitor_t* mo
     return monitor->status;
 }
 
+int heartbeat_monitor_get_rtt(heartbeat_monitor_t* monitor) {
+    return monitor ? monitor->current_rtt : -1;
+}
+
 bool heartbeat_monitor_is_connected(heartbeat_monitor_t* monitor) {
     return heartbeat_monitor_get_status(monitor) == MOONMIC_CONNECTED;
 }
@@ -160,4 +211,20 @@ bool heartbeat_monitor_is_paused(heartbeat_monitor_t* monitor) {
     return __sync_fetch_and_add(&monitor->paused, 0) != 0;
 }
 
+bool heartbeat_monitor_get_report(heartbeat_monitor_t* monitor, moonmic_receiver_report_t* report, uint32_t* age_ms) {
+    if (!monitor || !report) {
+        return false;
+    }
+    pthread_mutex_lock(&monitor->report_lock);
+    bool valid = monitor->report_time != 0;
+    if (valid) {
+        *report = monitor->report;
+        if (age_ms) {
+            *age_ms = (uint32_t)(get_time_ms() - monitor->report_time);
+        }
+    }
+    pthread_mutex_unlock(&monitor->report_lock);
+    return valid;
+}
+
 } // extern "C"
@@ -15,6 +15,9 @@
 #define PLATFORM_PCM_BUFFER_SIZE 4096    // PCM buffer size in frames
 #define PLATFORM_OPUS_BUFFER_SIZE 4000   // Opus packet buffer size in bytes
 
+// Opus complexity of MOONMIC_PROFILE_ULTRA_LOW (CELT-only 5ms frames: fast encode, little quality lost)
+#define PLATFORM_LOWDELAY_COMPLEXITY 5
+
 // Linux doesn't need padding
 #define PLATFORM_NEEDS_PADDING 0
 #define PLATFORM_PADDED_FRAME_SIZE 480   // Same as grain
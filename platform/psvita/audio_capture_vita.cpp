@@ -6,6 +6,7 @@
 #include "moonmic_internal.h"
 #include "moonmic_debug.h"
 #include "platform_config.h"  // Platform-specific configuration
+#include "dsp/moonmic_dsp.h"
 #include <psp2/audioin.h>
 #include <psp2/kernel/threadmgr.h>
 #include <stdlib.h>
@@ -117,9 +118,7 @@ static int vita_audio_read(audio_capture_t* self, float* buffer, size_t frames)
     
     // Convert SIGNED S16 to float32 [-1.0, 1.0]
     // Format is signed: -32768 to 32767, 0 = silence
-    for (size_t i = 0; i < frames * data->channels; i++) {
-        buffer[i] = static_cast<float>(data->temp_buffer[i]) / 32768.0f;
-    }
+    moonmic_dsp_s16_to_float(data->temp_buffer, buffer, frames * data->channels);
     
     return frames;
 }
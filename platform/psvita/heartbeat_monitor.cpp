@@ -4,6 +4,7 @@
  */
 
 #include "../heartbeat_monitor.h"
+#include "../moonmic_internal.h"
 #include <psp2/kernel/processmgr.h>
 #include <psp2/kernel/threadmgr.h>
 #include <sys/socket.h>
@@ -37,6 +38,11 @@ struct heartbeat_monitor_t {
     volatile int current_rtt;         // RTT in ms
     SceUID thread_id;
     volatile int paused;
+    
+    // Last receiver report (guarded by report_lock)
+    SceUID report_lock;
+    moonmic_receiver_report_t report;
+    uint64_t report_time;             // 0 = none yet
 };
 
 // Get time in milliseconds
@@ -137,6 +143,15 @@ static int monitor_thread_func(SceSize args, void* argp) {
                     monitor->paused = 0;
                     printf("[heartbeat_mon] Resumed\n");
                 }
+                else if (magic == MOONMIC_CTRL_REPORT) {
+                    moonmic_receiver_report_t report;
+                    if (moonmic_receiver_report_parse(buffer, (size_t)received, &report)) {
+                        sceKernelLockMutex(monitor->report_lock, 1, nullptr);
+                        monitor->report = report;
+                        monitor->report_time = get_time_ms();
+                        sceKernelUnlockMutex(monitor->report_lock, 1);
+                    }
+                }
             }
         }
         
@@ -186,6 +201,7 @@ heartbeat_monitor_t* heartbeat_monitor_create(int socket_fd, const char* host_ip
     monitor->current_rtt = -1;
     monitor->running = 1;
     monitor->paused = 0;  // Start unpaused
+    monitor->report_lock = sceKernelCreateMutex("heartbeat_report", 0, 0, nullptr);
     
     // Create monitor thread using Vita kernel thread (keeps efficient threading)
     monitor->thread_id = sceKernelCreateThread("heartbeat_mon", monitor_thread_func, 
@@ -213,6 +229,10 @@ void heartbeat_monitor_destroy(heartbeat_monitor_t* monitor) {
     // Do NOT close shared socket here, udp_sender owns it
     // close(monitor->socket); 
     
+    if (monitor->report_lock >= 0) {
+        sceKernelDeleteMutex(monitor->report_lock);
+    }
+    
     free(monitor);
 }
 
@@ -232,4 +252,20 @@ bool heartbeat_monitor_is_paused(heartbeat_monitor_t* monitor) {
     return monitor ? (monitor->paused != 0) : false;
 }
 
+bool heartbeat_monitor_get_report(heartbeat_monitor_t* monitor, moonmic_receiver_report_t* report, uint32_t* age_ms) {
+    if (!monitor || !report || monitor->report_lock < 0) {
+        return false;
+    }
+    sceKernelLockMutex(monitor->report_lock, 1, nullptr);
+    bool valid = monitor->report_time != 0;
+    if (valid) {
+        *report = monitor->report;
+        if (age_ms) {
+            *age_ms = (uint32_t)(get_time_ms() - monitor->report_time);
+        }
+    }
+    sceKernelUnlockMutex(monitor->report_lock, 1);
+    return valid;
+}
+
 } // extern "C"
@@ -15,6 +15,9 @@
 #define PLATFORM_PCM_BUFFER_SIZE 4096    // PCM buffer size in frames
 #define PLATFORM_OPUS_BUFFER_SIZE 4000   // Opus packet buffer size in bytes
 
+// Opus complexity of MOONMIC_PROFILE_ULTRA_LOW (200 encodes/s on the Vita CPU: keep each one cheap)
+#define PLATFORM_LOWDELAY_COMPLEXITY 2
+
 // Vita needs padding from 256 to 320 for Opus frame size compatibility (20ms @ 16kHz)
 #define PLATFORM_NEEDS_PADDING 1
 #define PLATFORM_PADDED_FRAME_SIZE 320   // 20ms @ 16kHz (standard Opus frame)
@@ -4,6 +4,7 @@
  */
 
 #include "../heartbeat_monitor.h"
+#include "../moonmic_internal.h"
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <windows.h>
@@ -13,6 +14,8 @@
 #pragma comment(lib, "ws2_32.lib")
 
 #define PING_MAGIC 0x50494E47  // "PING"
+#define PONG_MAGIC 0x504F4E47  // "PONG"
+#define PING_INTERVAL_MS 1000
 #define PING_TIMEOUT_MS 3000   // 3 seconds
 #define CTRL_STOP_MAGIC 0x53544F50  // "STOP"
 #define CTRL_START_MAGIC 0x53545254  // "STRT"
@@ -25,12 +28,19 @@ struct ping_packet {
 #pragma pack(pop)
 
 struct heartbeat_monitor_t {
-    SOCKET socket;
+    SOCKET socket;                // Shared with udp_sender (not owned)
+    sockaddr_in dest_addr;        // Host, for our PINGs and PONG replies
     volatile LONG running;
     volatile moonmic_connection_status_t status;
-    volatile ULONGLONG last_ping_time;
+    volatile ULONGLONG last_ping_time;  // Last PING/PONG from the host
+    volatile LONG current_rtt;          // RTT in ms, -1 = unknown
     HANDLE thread_handle;
     volatile LONG paused;  // 1 if host sent STOP, 0 if host sent START
+    
+    // Last receiver report (guarded by report_lock)
+    CRITICAL_SECTION report_lock;
+    moonmic_receiver_report_t report;
+    ULONGLONG report_time;  // 0 = none yet
 };
 
 // Get time in milliseconds
@@ -42,19 +52,56 @@ static ULONGLONG get_time_ms() {
 static DWORD WINAPI monitor_thread_func(LPVOID param) {
     heartbeat_monitor_t* monitor = (heartbeat_monitor_t*)param;
     uint8_t buffer[32];
+    ULONGLONG last_sent_ping = 0;
     
     while (InterlockedCompareExchange(&monitor->running, 0, 0)) {
-        // Receive with timeout
-        int received = recv(monitor->socket, (char*)buffer, sizeof(buffer), 0);
+        // PING the host every second (client-side RTT)
+        ULONGLONG now = get_time_ms();
+        if (now - last_sent_ping >= PING_INTERVAL_MS) {
+            ping_packet packet;
+            packet.magic = PING_MAGIC;
+            packet.timestamp = now;
+            sendto(monitor->socket, (const char*)&packet, sizeof(packet), 0,
+                   (sockaddr*)&monitor->dest_addr, sizeof(monitor->dest_addr));
+            last_sent_ping = now;
+        }
+        
+        // The socket is the sender's non-blocking one: wait with select(), not SO_RCVTIMEO
+        fd_set read_set;
+        FD_ZERO(&read_set);
+        FD_SET(monitor->socket, &read_set);
+        timeval timeout = { 0, 100 * 1000 };
+        int received = 0;
+        if (select(0, &read_set, nullptr, nullptr, &timeout) > 0) {
+            received = recv(monitor->socket, (char*)buffer, sizeof(buffer), 0);
+        }
         
         if (received >= 4) {  // At least magic number
             uint32_t magic;
             memcpy(&magic, buffer, sizeof(magic));
             
             if (magic == PING_MAGIC && received == sizeof(ping_packet)) {
-                // Valid PING received
+                // Host keepalive: mark connected, echo as PONG so the host can measure RTT
                 monitor->last_ping_time = get_time_ms();
                 monitor->status = MOONMIC_CONNECTED;
+                
+                uint32_t pong = PONG_MAGIC;
+                memcpy(buffer, &pong, sizeof(pong));
+                sendto(monitor->socket, (const char*)buffer, received, 0,
+                       (sockaddr*)&monitor->dest_addr, sizeof(monitor->dest_addr));
+            }
+            else if (magic == PONG_MAGIC && received == sizeof(ping_packet)) {
+                // Reply to our PING: carries our own timestamp back
+                ping_packet packet;
+                memcpy(&packet, buffer, sizeof(packet));
+                ULONGLONG current = get_time_ms();
+                monitor->last_ping_time = current;
+                monitor->status = MOONMIC_CONNECTED;
+                
+                int64_t diff = (int64_t)(current - packet.timestamp);
+                if (diff >= 0 && diff < 5000) {
+                    InterlockedExchange(&monitor->current_rtt, (LONG)diff);
+                }
             }
             else if (magic == CTRL_STOP_MAGIC && received == 8) {
                 // STOP signal from host - pause transmission
@@ -64,29 +111,32 @@ static DWORD WINAPI monitor_thread_func(LPVOID param) {
                 // START signal from host - resume transmission
                 InterlockedExchange(&monitor->paused, 0);
             }
+            else if (magic == MOONMIC_CTRL_REPORT) {
+                moonmic_receiver_report_t report;
+                if (moonmic_receiver_report_parse(buffer, (size_t)received, &report)) {
+                    EnterCriticalSection(&monitor->report_lock);
+                    monitor->report = report;
+                    monitor->report_time = get_time_ms();
+                    LeaveCriticalSection(&monitor->report_lock);
+                }
+            }
         }
         
         // Check for timeout
-        ULONGLONG now = get_time_ms();
-        if (now - monitor->last_ping_time > PING_TIMEOUT_MS) {
+        if (get_time_ms() - monitor->last_ping_time > PING_TIMEOUT_MS) {
             monitor->status = MOONMIC_DISCONNECTED;
+            InterlockedExchange(&monitor->current_rtt, -1);
         }
-}
+    }
     
     return 0;
 }
 
 extern "C" {
 
-heartbeat_monitor_t* heartbeat_monitor_create(uint16_t port) {
-    // Initialize Winsock
-    static bool wsa_initialized = false;
-    if (!wsa_initialized) {
-        WSADATA wsaData;
-        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-            return nullptr;
-        }
-        wsa_initialized = true;
+heartbeat_monitor_t* heartbeat_monitor_create(int socket_fd, const char* host_ip, uint16_t host_port) {
+    if (socket_fd < 0 || !host_ip) {
+        return nullptr;
     }
     
     heartbeat_monitor_t* monitor = (heartbeat_monitor_t*)calloc(1, sizeof(heartbeat_monitor_t));
@@ -94,26 +144,12 @@ heartbeat_monitor_t* heartbeat_monitor_create(uint16_t port) {
         return nullptr;
     }
     
-    // Create UDP socket
-    monitor->socket = socket(AF_INET, SOCK_DGRAM, 0);
-    if (monitor->socket == INVALID_SOCKET) {
-        free(monitor);
-        return nullptr;
-    }
-    
-    // Set socket timeout (100ms)
-    DWORD timeout_ms = 100;
-    setsockopt(monitor->socket, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout_ms, sizeof(timeout_ms));
-    
-    // Bind to port
-    sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(port);
-    addr.sin_addr.s_addr = INADDR_ANY;
-    
-    if (bind(monitor->socket, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
-        closesocket(monitor->socket);
+    // Same socket as the sender (Winsock already started by udp_sender):
+    // the host replies to the source port of our audio
+    monitor->socket = (SOCKET)socket_fd;
+    monitor->dest_addr.sin_family = AF_INET;
+    monitor->dest_addr.sin_port = htons(host_port);
+    if (inet_pton(AF_INET, host_ip, &monitor->dest_addr.sin_addr) != 1) {
         free(monitor);
         return nullptr;
     }
@@ -121,13 +157,15 @@ heartbeat_monitor_t* heartbeat_monitor_create(uint16_t port) {
     // Initialize state
     monitor->status = MOONMIC_DISCONNECTED;
     monitor->last_ping_time = 0;
+    InterlockedExchange(&monitor->current_rtt, -1);
     InterlockedExchange(&monitor->running, 1);
     InterlockedExchange(&monitor->paused, 0);  // Start unpaused
+    InitializeCriticalSection(&monitor->report_lock);
     
     // Create monitor thread
     monitor->thread_handle = CreateThread(nullptr, 0, monitor_thread_func, monitor, 0, nullptr);
     if (!monitor->thread_handle) {
-        closesocket(monitor->socket);
+        DeleteCriticalSection(&monitor->report_lock);
         free(monitor);
         return nullptr;
     }
@@ -147,8 +185,9 @@ void heartbeat_monitor_destroy(heartbeat_monitor_t* monitor) {
         WaitForSingleObject(monitor->thread_handle, INFINITE);
         CloseHandle(monitor->thread_handle);
     }
+    DeleteCriticalSection(&monitor->report_lock);
     
-    closesocket(monitor->socket);
+    // The socket belongs to udp_sender
     free(monitor);
 }
 
@@ -159,6 +198,10 @@ moonmic_connection_status_t heartbeat_monitor_get_status(heartbeat_monitor_t* mo
     return monitor->status;
 }
 
+int heartbeat_monitor_get_rtt(heartbeat_monitor_t* monitor) {
+    return monitor ? (int)InterlockedCompareExchange(&monitor->current_rtt, 0, 0) : -1;
+}
+
 bool heartbeat_monitor_is_connected(heartbeat_monitor_t* monitor) {
     return heartbeat_monitor_get_status(monitor) == MOONMIC_CONNECTED;
 }
@@ -170,4 +213,20 @@ bool heartbeat_monitor_is_paused(heartbeat_monitor_t* monitor) {
     return InterlockedCompareExchange(&monitor->paused, 0, 0) != 0;
 }
 
+bool heartbeat_monitor_get_report(heartbeat_monitor_t* monitor, moonmic_receiver_report_t* report, uint32_t* age_ms) {
+    if (!monitor || !report) {
+        return false;
+    }
+    EnterCriticalSection(&monitor->report_lock);
+    bool valid = monitor->report_time != 0;
+    if (valid) {
+        *report = monitor->report;
+        if (age_ms) {
+            *age_ms = (uint32_t)(get_time_ms() - monitor->report_time);
+        }
+    }
+    LeaveCriticalSection(&monitor->report_lock);
+    return valid;
+}
+
 } // extern "C"